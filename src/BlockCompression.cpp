@@ -0,0 +1,360 @@
+#include "BlockCompression.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace ReShade
+{
+	namespace
+	{
+		// Encodes a single channel block in the 8 value mode of BC4, which is exact for the end points and uniform in between
+		void EncodeBC4Block(const unsigned char block[16], unsigned char destination[8])
+		{
+			const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+
+			// Horizontal minimum and maximum of all 16 values
+			__m128i minimum = _mm_min_epu8(values, _mm_srli_si128(values, 8)), maximum = _mm_max_epu8(values, _mm_srli_si128(values, 8));
+			minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4)), maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+			minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 2)), maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 2));
+			minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 1)), maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 1));
+
+			const int low = _mm_cvtsi128_si32(minimum) & 0xFF, high = _mm_cvtsi128_si32(maximum) & 0xFF, range = high - low;
+
+			destination[0] = static_cast<unsigned char>(high);
+			destination[1] = static_cast<unsigned char>(low);
+
+			if (range == 0)
+			{
+				std::memset(destination + 2, 0, 6);
+				return;
+			}
+
+			// The interpolation step of each value is the number of midpoints between palette entries it lies above, 'value - low >= (2 * step - 1) * range / 14'
+			const __m128i zero = _mm_setzero_si128(), offset = _mm_set1_epi16(static_cast<short>(low));
+			__m128i distance[2] = { _mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(values, zero), offset), _mm_set1_epi16(14)), _mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(values, zero), offset), _mm_set1_epi16(14)) };
+			__m128i steps[2] = { zero, zero };
+
+			for (int step = 1; step < 8; ++step)
+			{
+				const __m128i threshold = _mm_set1_epi16(static_cast<short>((2 * step - 1) * range - 1));
+
+				steps[0] = _mm_sub_epi16(steps[0], _mm_cmpgt_epi16(distance[0], threshold));
+				steps[1] = _mm_sub_epi16(steps[1], _mm_cmpgt_epi16(distance[1], threshold));
+			}
+
+			unsigned short stepValues[16];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(stepValues), steps[0]);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(stepValues + 8), steps[1]);
+
+			// Palette order is maximum, minimum and then the six interpolated values from the maximum down
+			static const unsigned long long indices[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+			unsigned long long bits = 0;
+
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				bits |= indices[stepValues[i]] << (i * 3);
+			}
+			for (unsigned int i = 0; i < 6; ++i)
+			{
+				destination[2 + i] = static_cast<unsigned char>(bits >> (i * 8));
+			}
+		}
+
+		// Expands a 5:6:5 color to 8 bits per channel
+		void Unpack565(unsigned int color, float rgb[3])
+		{
+			const unsigned int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+
+			rgb[0] = static_cast<float>((r << 3) | (r >> 2));
+			rgb[1] = static_cast<float>((g << 2) | (g >> 4));
+			rgb[2] = static_cast<float>((b << 3) | (b >> 2));
+		}
+		unsigned int Pack565(const float rgb[3])
+		{
+			const auto quantize = [](float value, float maximum) { return static_cast<unsigned int>(std::min(std::max(value, 0.0f), 255.0f) * maximum / 255.0f + 0.5f); };
+
+			return (quantize(rgb[0], 31.0f) << 11) | (quantize(rgb[1], 63.0f) << 5) | quantize(rgb[2], 31.0f);
+		}
+
+		// End points per 8-bit value whose first interpolated entry comes closest to it, which represents single color blocks better than the end points alone
+		struct SingleColorTable
+		{
+			unsigned char Match5[256][2], Match6[256][2];
+
+			SingleColorTable()
+			{
+				Build(Match5, 5);
+				Build(Match6, 6);
+			}
+
+			static void Build(unsigned char table[256][2], unsigned int bits)
+			{
+				const int size = 1 << bits;
+
+				for (int value = 0; value < 256; ++value)
+				{
+					int bestError = 256;
+
+					for (int first = 0; first < size; ++first)
+					{
+						for (int second = 0; second < size; ++second)
+						{
+							const int expanded0 = (first << (8 - bits)) | (first >> (2 * bits - 8)), expanded1 = (second << (8 - bits)) | (second >> (2 * bits - 8));
+
+							// Hardware only has to interpolate within 3% of the exact result, so end points further apart are penalized
+							const int error = std::abs((2 * expanded0 + expanded1) / 3 - value) + std::abs(expanded0 - expanded1) * 3 / 100;
+
+							if (error < bestError)
+							{
+								table[value][0] = static_cast<unsigned char>(first);
+								table[value][1] = static_cast<unsigned char>(second);
+								bestError = error;
+							}
+						}
+					}
+				}
+			}
+		};
+
+		// Picks the closest palette entry for every pixel by projecting it onto the line from the first to the second end point, 't' steps in thirds of it
+		void SelectColorSteps(const __m128i pixels[4], const float color0[3], const float color1[3], unsigned char steps[16])
+		{
+			const int direction[3] = { static_cast<int>(color1[0] - color0[0]), static_cast<int>(color1[1] - color0[1]), static_cast<int>(color1[2] - color0[2]) };
+			const int length = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+
+			if (length == 0)
+			{
+				std::memset(steps, 0, 16);
+				return;
+			}
+
+			const __m128i zero = _mm_setzero_si128(), axis = _mm_setr_epi16(static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0, static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0);
+			const __m128i origin = _mm_set1_epi32(static_cast<int>(color0[0]) * direction[0] + static_cast<int>(color0[1]) * direction[1] + static_cast<int>(color0[2]) * direction[2]);
+			const __m128 scale = _mm_set1_ps(3.0f / length);
+			__m128i projected[4];
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				// Alpha is multiplied by zero, which leaves the sums of red and green plus blue per pixel
+				const __m128 low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels[i], zero), axis)), high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels[i], zero), axis));
+				const __m128i dot = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+
+				projected[i] = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(dot, origin)), scale));
+			}
+
+			const __m128i low = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(projected[0], projected[1]), zero), _mm_set1_epi16(3)), high = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(projected[2], projected[3]), zero), _mm_set1_epi16(3));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(steps), _mm_packus_epi16(low, high));
+		}
+		// Least squares fit of both end points to the pixels given their palette steps, returns false if all pixels use the same entry
+		bool RefineColorEndpoints(const __m128i pixels[4], const unsigned char steps[16], float color0[3], float color1[3])
+		{
+			// Weights are in thirds, 'a' for the first and 'b' for the second end point, so that 'a * color0 + b * color1 = 3 * pixel'
+			int aa = 0, ab = 0, bb = 0;
+
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				const int b = steps[i], a = 3 - b;
+
+				aa += a * a, ab += a * b, bb += b * b;
+			}
+
+			const int determinant = aa * bb - ab * ab;
+
+			if (determinant == 0)
+			{
+				return false;
+			}
+
+			// Sums of all pixels and of the pixels weighted by 'b', which both fit in 16 bits
+			const __m128i zero = _mm_setzero_si128(), stepValues = _mm_loadu_si128(reinterpret_cast<const __m128i *>(steps));
+			const __m128i stepPairs[2] = { _mm_unpacklo_epi16(_mm_unpacklo_epi8(stepValues, zero), _mm_unpacklo_epi8(stepValues, zero)), _mm_unpackhi_epi16(_mm_unpacklo_epi8(stepValues, zero), _mm_unpacklo_epi8(stepValues, zero)) };
+			const __m128i stepPairsHigh[2] = { _mm_unpacklo_epi16(_mm_unpackhi_epi8(stepValues, zero), _mm_unpackhi_epi8(stepValues, zero)), _mm_unpackhi_epi16(_mm_unpackhi_epi8(stepValues, zero), _mm_unpackhi_epi8(stepValues, zero)) };
+			const __m128i weights[8] = {
+				_mm_unpacklo_epi32(stepPairs[0], stepPairs[0]), _mm_unpackhi_epi32(stepPairs[0], stepPairs[0]), _mm_unpacklo_epi32(stepPairs[1], stepPairs[1]), _mm_unpackhi_epi32(stepPairs[1], stepPairs[1]),
+				_mm_unpacklo_epi32(stepPairsHigh[0], stepPairsHigh[0]), _mm_unpackhi_epi32(stepPairsHigh[0], stepPairsHigh[0]), _mm_unpacklo_epi32(stepPairsHigh[1], stepPairsHigh[1]), _mm_unpackhi_epi32(stepPairsHigh[1], stepPairsHigh[1])
+			};
+			__m128i sum = zero, weightedSum = zero;
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				const __m128i low = _mm_unpacklo_epi8(pixels[i], zero), high = _mm_unpackhi_epi8(pixels[i], zero);
+
+				sum = _mm_add_epi16(sum, _mm_add_epi16(low, high));
+				weightedSum = _mm_add_epi16(weightedSum, _mm_add_epi16(_mm_mullo_epi16(low, weights[i * 2]), _mm_mullo_epi16(high, weights[i * 2 + 1])));
+			}
+
+			short sums[8], weightedSums[8];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(sums), _mm_add_epi16(sum, _mm_srli_si128(sum, 8)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(weightedSums), _mm_add_epi16(weightedSum, _mm_srli_si128(weightedSum, 8)));
+
+			const float scale = 3.0f / determinant;
+
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				const int bx = weightedSums[c], ax = 3 * sums[c] - bx;
+
+				color0[c] = (bb * ax - ab * bx) * scale;
+				color1[c] = (aa * bx - ab * ax) * scale;
+			}
+
+			return true;
+		}
+		void QuantizeColorEndpoints(const float color0[3], const float color1[3], unsigned int packed[2], float expanded0[3], float expanded1[3])
+		{
+			packed[0] = Pack565(color0);
+			packed[1] = Pack565(color1);
+
+			Unpack565(packed[0], expanded0);
+			Unpack565(packed[1], expanded1);
+		}
+		// End points along the diagonal of the bounding box that follows the colors, refined by least squares
+		void FitColorEndpoints(const unsigned char block[64], const __m128i pixels[4], unsigned int minimumBits, unsigned int maximumBits, unsigned int packed[2], unsigned int &bits)
+		{
+			float color0[3], color1[3];
+			int center[3], ranges[3];
+			unsigned int reference = 0;
+
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				color0[c] = static_cast<float>((maximumBits >> (c * 8)) & 0xFF);
+				color1[c] = static_cast<float>((minimumBits >> (c * 8)) & 0xFF);
+				center[c] = static_cast<int>(color0[c] + color1[c]);
+				ranges[c] = static_cast<int>(color0[c] - color1[c]);
+
+				if (ranges[c] > ranges[reference])
+				{
+					reference = c;
+				}
+			}
+
+			// Channels falling while the one with the largest range rises run along the other diagonal of the box
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				int covariance = 0;
+
+				for (unsigned int i = 0; c != reference && i < 16; ++i)
+				{
+					covariance += (block[i * 4 + c] * 2 - center[c]) * (block[i * 4 + reference] * 2 - center[reference]);
+				}
+
+				if (covariance < 0)
+				{
+					std::swap(color0[c], color1[c]);
+				}
+
+				// Inset the end points a bit, since the extremes of the box are rarely hit exactly
+				const float inset = (color0[c] - color1[c]) / 16.0f;
+				color0[c] -= inset;
+				color1[c] += inset;
+			}
+
+			unsigned char steps[16];
+			float expanded0[3], expanded1[3];
+
+			QuantizeColorEndpoints(color0, color1, packed, expanded0, expanded1);
+			SelectColorSteps(pixels, expanded0, expanded1, steps);
+
+			for (unsigned int iteration = 0; iteration < 2 && packed[0] != packed[1] && RefineColorEndpoints(pixels, steps, color0, color1); ++iteration)
+			{
+				QuantizeColorEndpoints(color0, color1, packed, expanded0, expanded1);
+				SelectColorSteps(pixels, expanded0, expanded1, steps);
+			}
+
+			// Palette order is the first end point, the second one and then the two interpolated values from the first one on
+			static const unsigned int indices[4] = { 0, 2, 3, 1 };
+
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				bits |= indices[steps[i]] << (i * 2);
+			}
+		}
+		// Encodes the color part of a BC1/BC3 block, which is always in four color mode so it is valid for BC3 as well
+		void CompressColorBlock(const unsigned char block[64], unsigned char destination[8])
+		{
+			__m128i pixels[4];
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				pixels[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block) + i);
+			}
+
+			__m128i minimum = _mm_min_epu8(_mm_min_epu8(pixels[0], pixels[1]), _mm_min_epu8(pixels[2], pixels[3])), maximum = _mm_max_epu8(_mm_max_epu8(pixels[0], pixels[1]), _mm_max_epu8(pixels[2], pixels[3]));
+			minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 8)), maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 8));
+			minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4)), maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+
+			const unsigned int minimumBits = static_cast<unsigned int>(_mm_cvtsi128_si32(minimum)), maximumBits = static_cast<unsigned int>(_mm_cvtsi128_si32(maximum));
+			unsigned int packed[2], bits = 0;
+
+			if (((minimumBits ^ maximumBits) & 0xFFFFFF) == 0)
+			{
+				static const SingleColorTable table;
+				const unsigned int r = minimumBits & 0xFF, g = (minimumBits >> 8) & 0xFF, b = (minimumBits >> 16) & 0xFF;
+
+				packed[0] = (table.Match5[r][0] << 11) | (table.Match6[g][0] << 5) | table.Match5[b][0];
+				packed[1] = (table.Match5[r][1] << 11) | (table.Match6[g][1] << 5) | table.Match5[b][1];
+				bits = 0xAAAAAAAA;
+			}
+			else
+			{
+				FitColorEndpoints(block, pixels, minimumBits, maximumBits, packed, bits);
+			}
+
+			// The four color mode requires the first end point to be the larger one, swapping them swaps the palette entries pairwise
+			if (packed[0] < packed[1])
+			{
+				std::swap(packed[0], packed[1]);
+				bits ^= 0x55555555;
+			}
+			else if (packed[0] == packed[1])
+			{
+				bits = 0;
+			}
+
+			destination[0] = static_cast<unsigned char>(packed[0]), destination[1] = static_cast<unsigned char>(packed[0] >> 8);
+			destination[2] = static_cast<unsigned char>(packed[1]), destination[3] = static_cast<unsigned char>(packed[1] >> 8);
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				destination[4 + i] = static_cast<unsigned char>(bits >> (i * 8));
+			}
+		}
+	}
+
+	void CompressBC1Block(const unsigned char block[64], unsigned char destination[8])
+	{
+		CompressColorBlock(block, destination);
+	}
+	void CompressBC3Block(const unsigned char block[64], unsigned char destination[16])
+	{
+		// The alpha block of BC3 has the same layout as a BC4 block
+		unsigned char alpha[16];
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			alpha[i] = block[i * 4 + 3];
+		}
+
+		EncodeBC4Block(alpha, destination);
+		CompressColorBlock(block, destination + 8);
+	}
+	void CompressBC4Block(const unsigned char block[16], unsigned char destination[8])
+	{
+		EncodeBC4Block(block, destination);
+	}
+	void CompressBC5Block(const unsigned char block[32], unsigned char destination[16])
+	{
+		unsigned char channel[2][16];
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			channel[0][i] = block[i * 2];
+			channel[1][i] = block[i * 2 + 1];
+		}
+
+		EncodeBC4Block(channel[0], destination);
+		EncodeBC4Block(channel[1], destination + 8);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace ReShade
+{
+	/*
+	 * SSE2 encoders for single 4x4 blocks, with the pixels of the block in rows from the top left.
+	 * BC1 and BC3 take RGBA pixels and always use the four color mode, BC4 takes one and BC5 two interleaved channels and always use the eight value mode.
+	 */
+	void CompressBC1Block(const unsigned char block[64], unsigned char destination[8]);
+	void CompressBC3Block(const unsigned char block[64], unsigned char destination[16]);
+	void CompressBC4Block(const unsigned char block[16], unsigned char destination[8]);
+	void CompressBC5Block(const unsigned char block[32], unsigned char destination[16]);
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "DumpWriter.hpp"
+#include "WorkerThreads.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <stb_image_write.h>
+#include <boost\filesystem\operations.hpp>
+
+extern "C" unsigned char *stbi_write_png_to_mem(unsigned char *pixels, int stride_bytes, int x, int y, int n, int *out_len);
+
+namespace ReShade
+{
+	namespace
+	{
+		// Formats half precision is enough for, everything else is written as 32-bit float. The 16, 11 and 10-bit float formats are exact, 8-bit values like 'k / 255' are not,
+		// but the nearest half is less than half a step of 1/255 away from them, so they still quantize back to the same byte.
+		bool IsHalfSufficient(TexelFormat format)
+		{
+			switch (format)
+			{
+				case TexelFormat::R8:
+				case TexelFormat::RG8:
+				case TexelFormat::RGBA8:
+				case TexelFormat::BGRA8:
+				case TexelFormat::RG11B10F:
+				case TexelFormat::R16F:
+				case TexelFormat::RG16F:
+				case TexelFormat::RGBA16F:
+					return true;
+				default:
+					return false;
+			}
+		}
+	}
+
+	DumpWriter::DumpWriter() : mQueuedBytes(0), mMemoryLimit(512 * 1024 * 1024), mSubmitted(0), mWritten(0), mFailed(0), mActive(0), mExit(false)
+	{
+		const unsigned int count = std::max(std::min(std::thread::hardware_concurrency() / 2, 4u), 1u);
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			this->mThreads.emplace_back(&DumpWriter::WorkerMain, this);
+		}
+	}
+	DumpWriter::~DumpWriter()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(this->mMutex);
+
+			this->mExit = true;
+		}
+
+		// Workers finish the queue before exiting, so no dump started before is lost
+		this->mQueueCondition.notify_all();
+
+		for (std::thread &thread : this->mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	void DumpWriter::SetMemoryLimit(std::size_t bytes)
+	{
+		{
+			const std::lock_guard<std::mutex> lock(this->mMutex);
+
+			this->mMemoryLimit = bytes;
+		}
+
+		this->mSpaceCondition.notify_all();
+	}
+	void DumpWriter::Submit(Image &&image)
+	{
+		const std::size_t size = image.Data.size();
+
+		std::unique_lock<std::mutex> lock(this->mMutex);
+
+		// A new capture starts counting from zero once the previous one was written completely
+		if (this->mQueue.empty() && this->mActive == 0)
+		{
+			this->mSubmitted = this->mWritten = this->mFailed = 0;
+		}
+
+		// Always accept an image when nothing is queued, so a single image larger than the limit cannot block forever
+		this->mSpaceCondition.wait(lock, [this, size]() { return this->mQueuedBytes == 0 || this->mQueuedBytes + size <= this->mMemoryLimit; });
+
+		this->mQueuedBytes += size;
+		this->mSubmitted++;
+		this->mQueue.push_back(std::move(image));
+
+		lock.unlock();
+
+		this->mQueueCondition.notify_one();
+	}
+
+	DumpWriter::Progress DumpWriter::GetProgress()
+	{
+		const std::lock_guard<std::mutex> lock(this->mMutex);
+
+		Progress progress;
+		progress.Submitted = this->mSubmitted;
+		progress.Written = this->mWritten;
+		progress.Failed = this->mFailed;
+		progress.QueuedBytes = this->mQueuedBytes;
+
+		return progress;
+	}
+
+	void DumpWriter::WorkerMain()
+	{
+		const WorkerThreadScope scope;
+
+		while (true)
+		{
+			Image image;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mMutex);
+
+				this->mQueueCondition.wait(lock, [this]() { return this->mExit || !this->mQueue.empty(); });
+
+				if (this->mQueue.empty())
+				{
+					return;
+				}
+
+				image = std::move(this->mQueue.front());
+				this->mQueue.pop_front();
+				this->mActive++;
+			}
+
+			const std::size_t size = image.Data.size();
+
+			// Decoding needs the raw texels, which writing the image converts in place
+			const bool decoded = image.Decode == nullptr || WriteDecoded(image);
+			const bool success = Write(image) && decoded;
+
+			{
+				const std::lock_guard<std::mutex> lock(this->mMutex);
+
+				this->mActive--;
+				this->mQueuedBytes -= size;
+				(success ? this->mWritten : this->mFailed)++;
+			}
+
+			this->mSpaceCondition.notify_all();
+		}
+	}
+	bool DumpWriter::Write(Image &image)
+	{
+		if (image.Format == ImageFormat::EXR || image.Format == ImageFormat::PFM)
+		{
+			return WriteFloat(image);
+		}
+
+		if (image.SourceFormat != TexelFormat::RGBA8)
+		{
+			std::vector<unsigned char> converted(image.Width * image.Height * 4);
+			ConvertToRGBA8(image.SourceFormat, image.Data.data(), image.Width * GetTexelSize(image.SourceFormat), image.Width, image.Height, converted.data(), image.Width * 4);
+
+			image.Data.swap(converted);
+		}
+
+		unsigned char *const data = image.Data.data();
+		const unsigned char alpha = image.Type == TraceBundle::RecordType::DeltaFrame ? 0 : 0xFF;
+
+		for (std::size_t i = 3, size = image.Data.size(); i < size; i += 4)
+		{
+			// Render targets often store something other than coverage in alpha, which would make the image unreadable
+			data[i] = alpha;
+		}
+
+		TraceBundle::Record record = { };
+		record.Bucket = image.Bucket;
+		record.Draw = image.Draw;
+		record.Target = reinterpret_cast<std::uintptr_t>(image.Target);
+		record.Width = image.Width;
+		record.Height = image.Height;
+
+		if (image.Bundle != nullptr && (image.Type == TraceBundle::RecordType::KeyFrame || image.Type == TraceBundle::RecordType::DeltaFrame))
+		{
+			std::vector<unsigned char> encoded;
+			EncodeQOI(data, image.Width, image.Height, encoded);
+
+			record.Type = image.Type;
+			record.Format = static_cast<std::uint32_t>(ImageFormat::QOI);
+
+			return image.Bundle->Add(record, image.Path.generic_string(), encoded.data(), encoded.size());
+		}
+
+		// Tiles are encoded by the bundle, so only the ones not seen before cost any time
+		if (image.Bundle != nullptr && image.Bundle->IsTiled())
+		{
+			return image.Bundle->AddTiled(record, image.Path.generic_string(), data, image.Width, image.Height);
+		}
+
+		std::vector<unsigned char> encoded;
+
+		if (image.Format == ImageFormat::PNG)
+		{
+			int size = 0;
+			unsigned char *const png = stbi_write_png_to_mem(data, image.Width * 4, image.Width, image.Height, 4, &size);
+
+			if (png == nullptr)
+			{
+				return false;
+			}
+
+			encoded.assign(png, png + size);
+			std::free(png);
+		}
+		else if (image.Format == ImageFormat::QOI)
+		{
+			EncodeQOI(data, image.Width, image.Height, encoded);
+		}
+		else
+		{
+			EncodeFastPNG(data, image.Width, image.Height, encoded);
+		}
+
+		return WriteEncoded(image, encoded);
+	}
+	bool DumpWriter::WriteDecoded(const Image &image)
+	{
+		const std::size_t count = image.Width * image.Height;
+		std::vector<float> values(count * 4);
+		ConvertToRGBA32F(image.SourceFormat, image.Data.data(), image.Width * GetTexelSize(image.SourceFormat), image.Width, image.Height, values.data(), image.Width * 16);
+
+		DecodeGBuffer(*image.Decode, values.data(), count);
+
+		// Decoded images are for viewing, so float dump formats fall back to PNG for them
+		Image decoded;
+		decoded.Path = image.Path.string() + "_decoded";
+		decoded.Format = image.Format == ImageFormat::EXR || image.Format == ImageFormat::PFM ? ImageFormat::FastPNG : image.Format;
+		decoded.Bundle = image.Bundle;
+		decoded.Type = TraceBundle::RecordType::Image;
+		decoded.Bucket = image.Bucket;
+		decoded.Draw = image.Draw;
+		decoded.Target = image.Target;
+		decoded.Width = image.Width;
+		decoded.Height = image.Height;
+		decoded.SourceFormat = TexelFormat::RGBA8;
+		decoded.Data.resize(count * 4);
+
+		ConvertToRGBA8(TexelFormat::RGBA32F, reinterpret_cast<const unsigned char *>(values.data()), image.Width * 16, image.Width, image.Height, decoded.Data.data(), image.Width * 4);
+
+		return Write(decoded);
+	}
+	bool DumpWriter::WriteFloat(Image &image)
+	{
+		const std::size_t count = image.Width * image.Height * 4;
+		std::vector<float> values(count);
+		ConvertToRGBA32F(image.SourceFormat, image.Data.data(), image.Width * GetTexelSize(image.SourceFormat), image.Width, image.Height, values.data(), image.Width * 16);
+
+		// Alpha is kept as is, the point of float dumps is getting the exact values
+		const unsigned int channels = GetTexelChannels(image.SourceFormat);
+		std::vector<unsigned char> encoded;
+
+		if (image.Format == ImageFormat::PFM)
+		{
+			EncodePFM(values.data(), image.Width, image.Height, channels, encoded);
+		}
+		else if (IsHalfSufficient(image.SourceFormat))
+		{
+			std::vector<std::uint16_t> halfs(count);
+			ConvertFloatToHalf(values.data(), halfs.data(), count);
+
+			EncodeEXR(halfs.data(), image.Width, image.Height, channels, true, encoded);
+		}
+		else
+		{
+			EncodeEXR(values.data(), image.Width, image.Height, channels, false, encoded);
+		}
+
+		return WriteEncoded(image, encoded);
+	}
+	bool DumpWriter::WriteEncoded(const Image &image, const std::vector<unsigned char> &encoded)
+	{
+		// Bundle entries are named without extension like all other records, readers derive it from the format
+		if (image.Bundle != nullptr)
+		{
+			TraceBundle::Record record = { };
+			record.Type = TraceBundle::RecordType::Image;
+			record.Format = static_cast<std::uint32_t>(image.Format);
+			record.Bucket = image.Bucket;
+			record.Draw = image.Draw;
+			record.Target = reinterpret_cast<std::uintptr_t>(image.Target);
+			record.Width = image.Width;
+			record.Height = image.Height;
+
+			return image.Bundle->Add(record, image.Path.generic_string(), encoded.data(), encoded.size());
+		}
+
+		const boost::filesystem::path path = image.Path.string() + GetImageExtension(image.Format);
+
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(path.parent_path(), ec);
+
+		std::ofstream file(path.string(), std::ios::binary);
+		file.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+
+		return file.good();
+	}
+}
\ No newline at end of file
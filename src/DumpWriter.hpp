@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ImageEncoder.hpp"
+#include "TraceBundle.hpp"
+#include "TextureConversion.hpp"
+#include "GBufferDecode.hpp"
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <boost\filesystem\path.hpp>
+
+namespace ReShade
+{
+	/*
+	 * Converts and writes image dumps on worker threads, so capturing a frame trace only costs the render thread a readback copy.
+	 * The memory held by queued images is capped: Submitting blocks until the workers made enough room, which throttles the game instead of running out of memory.
+	 */
+	class DumpWriter
+	{
+	public:
+		struct Image
+		{
+			boost::filesystem::path Path; // Without extension, it depends on the format
+			ImageFormat Format;
+			std::shared_ptr<TraceBundleWriter> Bundle; // Added to this bundle instead of written to a file, 'Path' is then the name in the bundle
+			TraceBundle::RecordType Type; // Key and delta frames of a stream are always encoded as QOI and need a bundle
+			unsigned int Bucket, Draw;
+			const void *Target;
+			unsigned int Width, Height;
+			TexelFormat SourceFormat;
+			std::vector<unsigned char> Data; // Tightly packed rows of texels in the source format, converted to RGBA by the workers
+			std::shared_ptr<const GBufferProfile> Decode; // Also write a decoded copy with '_decoded' appended to the path
+		};
+		struct Progress
+		{
+			unsigned int Submitted, Written, Failed;
+			std::size_t QueuedBytes;
+		};
+
+		DumpWriter();
+		~DumpWriter();
+
+		void SetMemoryLimit(std::size_t bytes);
+		void Submit(Image &&image);
+
+		Progress GetProgress();
+
+	private:
+		void WorkerMain();
+		static bool Write(Image &image);
+		static bool WriteDecoded(const Image &image);
+		static bool WriteFloat(Image &image);
+		static bool WriteEncoded(const Image &image, const std::vector<unsigned char> &encoded);
+
+		std::vector<std::thread> mThreads;
+		std::mutex mMutex;
+		std::condition_variable mQueueCondition, mSpaceCondition;
+		std::deque<Image> mQueue;
+		std::size_t mQueuedBytes, mMemoryLimit;
+		unsigned int mSubmitted, mWritten, mFailed, mActive;
+		bool mExit;
+	};
+}
\ No newline at end of file
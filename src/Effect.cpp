@@ -849,6 +849,19 @@ namespace ReShade
 	{
 		return this->mDesc;
 	}
+	const Effect::Technique::Schedule Effect::Technique::GetPassSchedule(unsigned int index) const
+	{
+		if (index < this->mPassSchedules.size())
+		{
+			return this->mPassSchedules[index];
+		}
+		else
+		{
+			const Schedule schedule = { 1, 0 };
+
+			return schedule;
+		}
+	}
 
 	void Effect::Technique::Render() const
 	{
@@ -108,7 +108,8 @@ namespace ReShade
 			const Annotation GetAnnotation(const std::string &name) const;
 			const Description GetDescription() const;
 
-			virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size) = 0;
+			// Only uploads of the first level with 'generateMipmaps' set fill the remaining levels from it, callers uploading a whole chain leave it off
+			virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps) = 0;
 
 		protected:
 			Description mDesc;
@@ -174,6 +175,10 @@ namespace ReShade
 			{
 				unsigned int Passes;
 			};
+			struct Schedule
+			{
+				unsigned int Interval, Phase; // A phase of 'UINT_MAX' leaves it up to the runtime to pick one
+			};
 
 		public:
 			Technique(const Description &desc);
@@ -181,6 +186,7 @@ namespace ReShade
 
 			const Annotation GetAnnotation(const std::string &name) const;
 			const Description GetDescription() const;
+			const Schedule GetPassSchedule(unsigned int index) const;
 
 			void Render() const;
 			virtual void RenderPass(unsigned int index) const = 0;
@@ -188,6 +194,12 @@ namespace ReShade
 		protected:
 			Description mDesc;
 			std::unordered_map<std::string, Effect::Annotation>	mAnnotations;
+			std::vector<Schedule> mPassSchedules;
+		};
+		struct PassTiming
+		{
+			unsigned int Technique, Pass;
+			float Duration; // Milliseconds the GPU spent on the pass
 		};
 
 	public:
@@ -206,6 +218,21 @@ namespace ReShade
 		virtual void Begin() const = 0;
 		virtual void End() const = 0;
 
+		// GPU timing of the passes rendered in a frame, results become available a few frames later and runtimes without timer queries never report any
+		virtual void BeginTimings(unsigned long long frame)
+		{
+		}
+		virtual void TimePass(unsigned int technique, unsigned int pass)
+		{
+		}
+		virtual void EndTimings()
+		{
+		}
+		virtual bool GetTimings(unsigned long long &frame, std::vector<PassTiming> &timings)
+		{
+			return false;
+		}
+
 	protected:
 		std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 		std::unordered_map<std::string, std::unique_ptr<Constant>> mConstants;
@@ -0,0 +1,1439 @@
+#include "EffectAnalysis.hpp"
+
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/algorithm/string.hpp>
+
+namespace ReShade
+{
+	namespace
+	{
+		std::string NormalizeSemantic(const char *semantic)
+		{
+			std::string result = boost::to_upper_copy(std::string(semantic));
+
+			if (result == "VERTEXID")
+			{
+				result = "SV_VERTEXID";
+			}
+			if (!std::isdigit(static_cast<unsigned char>(result.back())))
+			{
+				result += '0';
+			}
+
+			return result;
+		}
+
+		class BackBufferAccessAnalyzer
+		{
+		public:
+			BackBufferAccessAnalyzer(const EffectTree &ast) : mAST(ast), mAccess(EffectPassInfo::Access::None), mDiscards(false), mCurrentInEntryPoint(false)
+			{
+			}
+
+			void Analyze(const EffectNodes::Function &function)
+			{
+				if (function.Parameters != EffectTree::Null)
+				{
+					const EffectNodes::Variable *parameter = &this->mAST[function.Parameters].As<EffectNodes::Variable>();
+
+					do
+					{
+						this->mParameters.insert(parameter->Index);
+
+						if (parameter->NextDeclaration != EffectTree::Null)
+						{
+							parameter = &this->mAST[parameter->NextDeclaration].As<EffectNodes::Variable>();
+						}
+						else
+						{
+							parameter = nullptr;
+						}
+					}
+					while (parameter != nullptr);
+				}
+
+				this->mVisitedFunctions.insert(function.Index);
+
+				this->mCurrentInEntryPoint = true;
+
+				Visit(function.Definition);
+
+				this->mCurrentInEntryPoint = false;
+
+				// Samples at the texture coordinate are only pointwise if that coordinate is never modified anywhere in the shader
+				for (EffectTree::Index parameter : this->mSampledParameters)
+				{
+					if (this->mWrittenParameters.count(parameter) != 0)
+					{
+						Mark(EffectPassInfo::Access::Neighbourhood);
+						break;
+					}
+				}
+			}
+
+			EffectPassInfo::Access GetAccess() const
+			{
+				return this->mAccess;
+			}
+			bool Discards() const
+			{
+				return this->mDiscards;
+			}
+			const std::unordered_set<EffectTree::Index> &GetSamplers() const
+			{
+				return this->mSamplers;
+			}
+			const std::unordered_set<std::string> &GetSampledSemantics() const
+			{
+				return this->mSampledSemantics;
+			}
+
+		private:
+			void Mark(EffectPassInfo::Access access)
+			{
+				this->mAccess = std::max(this->mAccess, access);
+			}
+			void MarkWritten(EffectTree::Index index)
+			{
+				while (index != EffectTree::Null)
+				{
+					const EffectTree::Node &node = this->mAST[index];
+
+					if (node.Is<EffectNodes::LValue>())
+					{
+						this->mWrittenParameters.insert(node.As<EffectNodes::LValue>().Reference);
+						break;
+					}
+					else if (node.Is<EffectNodes::Swizzle>())
+					{
+						index = node.As<EffectNodes::Swizzle>().Operands[0];
+					}
+					else if (node.Is<EffectNodes::Expression>())
+					{
+						index = node.As<EffectNodes::Expression>().Operands[0];
+					}
+					else
+					{
+						break;
+					}
+				}
+			}
+			void RecordSampler(EffectTree::Index index)
+			{
+				if (index != EffectTree::Null && this->mAST[index].Is<EffectNodes::LValue>())
+				{
+					const EffectNodes::Variable &variable = this->mAST[this->mAST[index].As<EffectNodes::LValue>().Reference].As<EffectNodes::Variable>();
+
+					if (variable.Type.IsSampler())
+					{
+						this->mSamplers.insert(variable.Index);
+					}
+				}
+			}
+			bool IsBackBufferReference(EffectTree::Index index) const
+			{
+				if (index == EffectTree::Null || !this->mAST[index].Is<EffectNodes::LValue>())
+				{
+					return false;
+				}
+
+				const EffectNodes::Variable &variable = this->mAST[this->mAST[index].As<EffectNodes::LValue>().Reference].As<EffectNodes::Variable>();
+
+				return IsBackBufferSampler(this->mAST, variable);
+			}
+			EffectTree::Index GetTexCoordParameter(EffectTree::Index index, const char *&texcoord) const
+			{
+				const EffectTree::Node &node = this->mAST[index];
+				const EffectNodes::Variable *semantic = nullptr;
+				EffectTree::Index parameter = EffectTree::Null;
+
+				if (node.Is<EffectNodes::LValue>())
+				{
+					parameter = node.As<EffectNodes::LValue>().Reference;
+					semantic = &this->mAST[parameter].As<EffectNodes::Variable>();
+				}
+				else if (node.Is<EffectNodes::Expression>() && node.As<EffectNodes::Expression>().Operator == EffectNodes::Expression::Field && this->mAST[node.As<EffectNodes::Expression>().Operands[0]].Is<EffectNodes::LValue>())
+				{
+					parameter = this->mAST[node.As<EffectNodes::Expression>().Operands[0]].As<EffectNodes::LValue>().Reference;
+					semantic = &this->mAST[node.As<EffectNodes::Expression>().Operands[1]].As<EffectNodes::Variable>();
+				}
+
+				if (semantic == nullptr || this->mParameters.count(parameter) == 0)
+				{
+					return EffectTree::Null;
+				}
+				if (semantic->Semantic == nullptr || !boost::starts_with(semantic->Semantic, "TEXCOORD") || !semantic->Type.IsFloatingPoint() || semantic->Type.Rows != 2 || semantic->Type.Cols != 1 || semantic->Type.IsArray())
+				{
+					return EffectTree::Null;
+				}
+
+				texcoord = semantic->Semantic;
+
+				return parameter;
+			}
+
+			void Visit(EffectTree::Index index)
+			{
+				using namespace EffectNodes;
+
+				if (index == EffectTree::Null)
+				{
+					return;
+				}
+
+				const EffectTree::Node &node = this->mAST[index];
+
+				if (node.Is<LValue>())
+				{
+					RecordSampler(index);
+
+					// A sampler referenced outside of a texture intrinsic escapes the analysis (e.g. when passed to a helper function)
+					if (IsBackBufferReference(index))
+					{
+						Mark(EffectPassInfo::Access::Neighbourhood);
+					}
+				}
+				else if (node.Is<Expression>())
+				{
+					const Expression &expression = node.As<Expression>();
+
+					switch (expression.Operator)
+					{
+						case Expression::Tex:
+						case Expression::TexLevel:
+						case Expression::TexGather:
+						case Expression::TexBias:
+						case Expression::TexFetch:
+						case Expression::TexSize:
+						case Expression::TexOffset:
+						case Expression::TexLevelOffset:
+						case Expression::TexGatherOffset:
+							RecordSampler(expression.Operands[0]);
+
+							if (IsBackBufferReference(expression.Operands[0]))
+							{
+								const char *texcoord = nullptr;
+								const EffectTree::Index parameter = (expression.Operator == Expression::Tex && this->mCurrentInEntryPoint) ? GetTexCoordParameter(expression.Operands[1], texcoord) : EffectTree::Null;
+
+								if (parameter != EffectTree::Null)
+								{
+									this->mSampledParameters.insert(parameter);
+									this->mSampledSemantics.insert(NormalizeSemantic(texcoord));
+
+									Mark(EffectPassInfo::Access::Pointwise);
+								}
+								else
+								{
+									Mark(EffectPassInfo::Access::Neighbourhood);
+								}
+							}
+							Visit(expression.Operands[1]);
+							Visit(expression.Operands[2]);
+							return;
+						case Expression::Field:
+							Visit(expression.Operands[0]);
+							return;
+						case Expression::Increase:
+						case Expression::Decrease:
+						case Expression::PostIncrease:
+						case Expression::PostDecrease:
+							MarkWritten(expression.Operands[0]);
+							break;
+					}
+
+					for (unsigned int i = 0; i < 3; ++i)
+					{
+						Visit(expression.Operands[i]);
+					}
+				}
+				else if (node.Is<Swizzle>())
+				{
+					Visit(node.As<Swizzle>().Operands[0]);
+				}
+				else if (node.Is<Assignment>())
+				{
+					MarkWritten(node.As<Assignment>().Left);
+
+					Visit(node.As<Assignment>().Left);
+					Visit(node.As<Assignment>().Right);
+				}
+				else if (node.Is<Sequence>())
+				{
+					VisitList(node.As<Sequence>().Expressions);
+				}
+				else if (node.Is<InitializerList>())
+				{
+					VisitList(node.As<InitializerList>().Expressions);
+				}
+				else if (node.Is<Constructor>())
+				{
+					VisitList(node.As<Constructor>().Arguments);
+				}
+				else if (node.Is<Call>())
+				{
+					const Call &call = node.As<Call>();
+					const Function &callee = this->mAST[call.Callee].As<Function>();
+
+					VisitList(call.Arguments);
+
+					if (call.Arguments != EffectTree::Null && callee.Parameters != EffectTree::Null)
+					{
+						const RValue *argument = &this->mAST[call.Arguments].As<RValue>();
+						const Variable *parameter = &this->mAST[callee.Parameters].As<Variable>();
+
+						while (true)
+						{
+							if (parameter->Type.HasQualifier(Type::Qualifier::Out))
+							{
+								MarkWritten(argument->Index);
+							}
+
+							if (argument->NextExpression == EffectTree::Null || parameter->NextDeclaration == EffectTree::Null)
+							{
+								break;
+							}
+
+							argument = &this->mAST[argument->NextExpression].As<RValue>();
+							parameter = &this->mAST[parameter->NextDeclaration].As<Variable>();
+						}
+					}
+
+					if (this->mVisitedFunctions.insert(callee.Index).second)
+					{
+						const bool inEntryPoint = this->mCurrentInEntryPoint;
+
+						this->mCurrentInEntryPoint = false;
+
+						Visit(callee.Definition);
+
+						this->mCurrentInEntryPoint = inEntryPoint;
+					}
+				}
+				else if (node.Is<ExpressionStatement>())
+				{
+					Visit(node.As<ExpressionStatement>().Expression);
+				}
+				else if (node.Is<DeclarationStatement>())
+				{
+					Visit(node.As<DeclarationStatement>().Declaration);
+				}
+				else if (node.Is<Variable>())
+				{
+					Visit(node.As<Variable>().Initializer);
+					Visit(node.As<Variable>().NextDeclarator);
+				}
+				else if (node.Is<If>())
+				{
+					Visit(node.As<If>().Condition);
+					Visit(node.As<If>().StatementOnTrue);
+					Visit(node.As<If>().StatementOnFalse);
+				}
+				else if (node.Is<Switch>())
+				{
+					Visit(node.As<Switch>().Test);
+
+					for (EffectTree::Index cases = node.As<Switch>().Cases; cases != EffectTree::Null; cases = this->mAST[cases].As<Case>().NextCase)
+					{
+						Visit(this->mAST[cases].As<Case>().Statements);
+					}
+				}
+				else if (node.Is<For>())
+				{
+					Visit(node.As<For>().Initialization);
+					Visit(node.As<For>().Condition);
+					Visit(node.As<For>().Iteration);
+					Visit(node.As<For>().Statements);
+				}
+				else if (node.Is<While>())
+				{
+					Visit(node.As<While>().Condition);
+					Visit(node.As<While>().Statements);
+				}
+				else if (node.Is<Return>())
+				{
+					if (node.As<Return>().Discard)
+					{
+						this->mDiscards = true;
+					}
+
+					Visit(node.As<Return>().Value);
+				}
+				else if (node.Is<StatementBlock>())
+				{
+					for (EffectTree::Index statement = node.As<StatementBlock>().Statements; statement != EffectTree::Null; statement = this->mAST[statement].As<Statement>().NextStatement)
+					{
+						Visit(statement);
+					}
+				}
+			}
+			void VisitList(EffectTree::Index index)
+			{
+				for (; index != EffectTree::Null; index = this->mAST[index].As<EffectNodes::RValue>().NextExpression)
+				{
+					Visit(index);
+				}
+			}
+
+			const EffectTree &mAST;
+			EffectPassInfo::Access mAccess;
+			bool mDiscards, mCurrentInEntryPoint;
+			std::unordered_set<EffectTree::Index> mParameters, mSampledParameters, mWrittenParameters, mVisitedFunctions, mSamplers;
+			std::unordered_set<std::string> mSampledSemantics;
+		};
+
+		/*
+		 * Runs a vertex shader on the CPU for a single vertex, as far as its outputs only depend on the vertex ID and constants.
+		 * Anything else (uniforms, textures, loops, structs, most intrinsics) makes the evaluation fail, so callers can only draw conclusions from a success.
+		 */
+		class VertexShaderEvaluator
+		{
+		public:
+			struct Value
+			{
+				float Components[4];
+				unsigned int Count;
+			};
+
+			VertexShaderEvaluator(const EffectTree &ast) : mAST(ast), mDepth(0), mReturned(false)
+			{
+			}
+
+			bool Evaluate(const EffectNodes::Function &function, unsigned int vertexId, std::unordered_map<std::string, Value> &outputs)
+			{
+				this->mVariables.clear();
+				this->mDepth = 0;
+				this->mReturned = false;
+
+				for (EffectTree::Index index = function.Parameters; index != EffectTree::Null; index = this->mAST[index].As<EffectNodes::Variable>().NextDeclaration)
+				{
+					const EffectNodes::Variable &parameter = this->mAST[index].As<EffectNodes::Variable>();
+
+					if (parameter.Semantic == nullptr || parameter.Type.IsStruct() || parameter.Type.IsArray() || parameter.Type.IsMatrix())
+					{
+						return false;
+					}
+
+					Value value = Zero(parameter.Type.Rows);
+
+					if (parameter.Type.HasQualifier(EffectNodes::Type::Qualifier::In) || !parameter.Type.HasQualifier(EffectNodes::Type::Qualifier::Out))
+					{
+						// The runtime draws without any vertex buffer, so the vertex ID is the only input
+						if (NormalizeSemantic(parameter.Semantic) != "SV_VERTEXID0")
+						{
+							return false;
+						}
+
+						value.Components[0] = static_cast<float>(vertexId);
+					}
+
+					this->mVariables[index] = value;
+				}
+
+				Value result = Zero(function.ReturnType.Rows);
+
+				if (!Execute(function.Definition, result))
+				{
+					return false;
+				}
+
+				for (EffectTree::Index index = function.Parameters; index != EffectTree::Null; index = this->mAST[index].As<EffectNodes::Variable>().NextDeclaration)
+				{
+					const EffectNodes::Variable &parameter = this->mAST[index].As<EffectNodes::Variable>();
+
+					if (parameter.Type.HasQualifier(EffectNodes::Type::Qualifier::Out))
+					{
+						outputs[NormalizeSemantic(parameter.Semantic)] = this->mVariables[index];
+					}
+				}
+
+				if (!function.ReturnType.IsVoid())
+				{
+					if (function.ReturnSemantic == nullptr)
+					{
+						return false;
+					}
+
+					outputs[NormalizeSemantic(function.ReturnSemantic)] = result;
+				}
+
+				return true;
+			}
+
+		private:
+			static Value Zero(unsigned int count)
+			{
+				Value value = { { 0.0f, 0.0f, 0.0f, 0.0f }, std::max(count, 1u) };
+
+				return value;
+			}
+			static bool Broadcast(Value &left, Value &right)
+			{
+				if (left.Count == 1)
+				{
+					std::fill(left.Components + 1, left.Components + 4, left.Components[0]), left.Count = right.Count;
+				}
+				if (right.Count == 1)
+				{
+					std::fill(right.Components + 1, right.Components + 4, right.Components[0]), right.Count = left.Count;
+				}
+
+				// Implicit truncation of the larger vector
+				left.Count = right.Count = std::min(left.Count, right.Count);
+
+				return true;
+			}
+
+			bool Execute(EffectTree::Index index, Value &result)
+			{
+				using namespace EffectNodes;
+
+				for (; index != EffectTree::Null && !this->mReturned; index = this->mAST[index].As<Statement>().NextStatement)
+				{
+					const EffectTree::Node &node = this->mAST[index];
+					Value value;
+
+					if (node.Is<StatementBlock>())
+					{
+						if (!Execute(node.As<StatementBlock>().Statements, result))
+						{
+							return false;
+						}
+					}
+					else if (node.Is<ExpressionStatement>())
+					{
+						if (node.As<ExpressionStatement>().Expression != EffectTree::Null && !Evaluate(node.As<ExpressionStatement>().Expression, value))
+						{
+							return false;
+						}
+					}
+					else if (node.Is<DeclarationStatement>())
+					{
+						for (EffectTree::Index declarator = node.As<DeclarationStatement>().Declaration; declarator != EffectTree::Null; declarator = this->mAST[declarator].As<Variable>().NextDeclarator)
+						{
+							const Variable &variable = this->mAST[declarator].As<Variable>();
+
+							if (variable.Type.IsStruct() || variable.Type.IsArray() || variable.Type.IsMatrix() || !variable.Type.IsNumeric())
+							{
+								return false;
+							}
+
+							value = Zero(variable.Type.Rows);
+
+							if (variable.Initializer != EffectTree::Null && !(Evaluate(variable.Initializer, value) && Convert(variable.Type, value)))
+							{
+								return false;
+							}
+
+							this->mVariables[declarator] = value;
+						}
+					}
+					else if (node.Is<If>())
+					{
+						if (!Evaluate(node.As<If>().Condition, value))
+						{
+							return false;
+						}
+
+						const EffectTree::Index branch = value.Components[0] != 0.0f ? node.As<If>().StatementOnTrue : node.As<If>().StatementOnFalse;
+
+						if (branch != EffectTree::Null && !Execute(branch, result))
+						{
+							return false;
+						}
+					}
+					else if (node.Is<Return>() && !node.As<Return>().Discard)
+					{
+						this->mReturned = true;
+
+						return node.As<Return>().Value == EffectTree::Null || Evaluate(node.As<Return>().Value, result);
+					}
+					else
+					{
+						return false;
+					}
+				}
+
+				return true;
+			}
+			bool Convert(const EffectNodes::Type &type, Value &value) const
+			{
+				if (!type.IsNumeric() || type.IsMatrix() || type.IsArray())
+				{
+					return false;
+				}
+
+				if (value.Count == 1 && type.Rows > 1)
+				{
+					std::fill(value.Components + 1, value.Components + 4, value.Components[0]);
+				}
+				else if (value.Count < type.Rows)
+				{
+					return false;
+				}
+
+				value.Count = type.Rows;
+
+				for (unsigned int i = 0; i < value.Count; ++i)
+				{
+					if (type.IsIntegral())
+					{
+						value.Components[i] = std::trunc(value.Components[i]);
+					}
+					else if (type.IsBoolean())
+					{
+						value.Components[i] = value.Components[i] != 0.0f ? 1.0f : 0.0f;
+					}
+				}
+
+				return true;
+			}
+			bool Store(EffectTree::Index target, const Value &value)
+			{
+				const EffectTree::Node &node = this->mAST[target];
+
+				if (node.Is<EffectNodes::LValue>())
+				{
+					const auto it = this->mVariables.find(node.As<EffectNodes::LValue>().Reference);
+
+					if (it == this->mVariables.end())
+					{
+						return false;
+					}
+
+					Value converted = value;
+
+					if (!Convert(this->mAST[it->first].As<EffectNodes::Variable>().Type, converted))
+					{
+						return false;
+					}
+
+					it->second = converted;
+
+					return true;
+				}
+				else if (node.Is<EffectNodes::Swizzle>())
+				{
+					const EffectNodes::Swizzle &swizzle = node.As<EffectNodes::Swizzle>();
+					Value current;
+
+					if (!Evaluate(swizzle.Operands[0], current))
+					{
+						return false;
+					}
+
+					for (unsigned int i = 0; i < 4 && swizzle.Mask[i] >= 0; ++i)
+					{
+						if (static_cast<unsigned int>(swizzle.Mask[i]) >= current.Count)
+						{
+							return false;
+						}
+
+						current.Components[swizzle.Mask[i]] = value.Components[value.Count == 1 ? 0 : std::min(i, value.Count - 1)];
+					}
+
+					return Store(swizzle.Operands[0], current);
+				}
+
+				return false;
+			}
+			bool Evaluate(EffectTree::Index index, Value &result)
+			{
+				using namespace EffectNodes;
+
+				const EffectTree::Node &node = this->mAST[index];
+
+				if (node.Is<Literal>())
+				{
+					const Literal &literal = node.As<Literal>();
+
+					if (!literal.Type.IsNumeric() || literal.Type.IsMatrix() || literal.Type.IsArray())
+					{
+						return false;
+					}
+
+					result = Zero(literal.Type.Rows);
+
+					for (unsigned int i = 0; i < result.Count; ++i)
+					{
+						result.Components[i] = literal.Type.IsFloatingPoint() ? literal.Value.Float[i] : literal.Type.Class == Type::Uint ? static_cast<float>(literal.Value.Uint[i]) : static_cast<float>(literal.Value.Int[i]);
+					}
+
+					return true;
+				}
+				else if (node.Is<LValue>())
+				{
+					const auto it = this->mVariables.find(node.As<LValue>().Reference);
+
+					if (it == this->mVariables.end())
+					{
+						return false;
+					}
+
+					result = it->second;
+
+					return true;
+				}
+				else if (node.Is<Swizzle>())
+				{
+					const Swizzle &swizzle = node.As<Swizzle>();
+					Value value;
+
+					if (!Evaluate(swizzle.Operands[0], value))
+					{
+						return false;
+					}
+
+					result = Zero(1);
+					result.Count = 0;
+
+					for (unsigned int i = 0; i < 4 && swizzle.Mask[i] >= 0; ++i)
+					{
+						if (value.Count == 1 && swizzle.Mask[i] == 0)
+						{
+							result.Components[result.Count++] = value.Components[0];
+						}
+						else if (static_cast<unsigned int>(swizzle.Mask[i]) < value.Count)
+						{
+							result.Components[result.Count++] = value.Components[swizzle.Mask[i]];
+						}
+						else
+						{
+							return false;
+						}
+					}
+
+					return result.Count != 0;
+				}
+				else if (node.Is<Constructor>())
+				{
+					result = Zero(1);
+					result.Count = 0;
+
+					for (EffectTree::Index argument = node.As<Constructor>().Arguments; argument != EffectTree::Null; argument = this->mAST[argument].As<RValue>().NextExpression)
+					{
+						Value value;
+
+						if (!Evaluate(argument, value) || result.Count + value.Count > 4)
+						{
+							return false;
+						}
+
+						std::copy(value.Components, value.Components + value.Count, result.Components + result.Count);
+						result.Count += value.Count;
+					}
+
+					return Convert(node.As<Constructor>().Type, result);
+				}
+				else if (node.Is<Sequence>())
+				{
+					for (EffectTree::Index expression = node.As<Sequence>().Expressions; expression != EffectTree::Null; expression = this->mAST[expression].As<RValue>().NextExpression)
+					{
+						if (!Evaluate(expression, result))
+						{
+							return false;
+						}
+					}
+
+					return true;
+				}
+				else if (node.Is<Assignment>())
+				{
+					const Assignment &assignment = node.As<Assignment>();
+
+					if (!Evaluate(assignment.Right, result))
+					{
+						return false;
+					}
+
+					if (assignment.Operator != Expression::None)
+					{
+						Value current;
+
+						if (!Evaluate(assignment.Left, current) || !Apply(assignment.Operator, current, result, result))
+						{
+							return false;
+						}
+					}
+
+					return Store(assignment.Left, result);
+				}
+				else if (node.Is<EffectNodes::Call>())
+				{
+					return EvaluateCall(node.As<EffectNodes::Call>(), result);
+				}
+				else if (node.Is<Expression>())
+				{
+					const Expression &expression = node.As<Expression>();
+					Value operands[3];
+
+					if (expression.Operator == Expression::Conditional)
+					{
+						if (!Evaluate(expression.Operands[0], operands[0]) || operands[0].Count != 1)
+						{
+							return false;
+						}
+
+						return Evaluate(expression.Operands[operands[0].Components[0] != 0.0f ? 1 : 2], result);
+					}
+
+					for (unsigned int i = 0; i < 3; ++i)
+					{
+						if (expression.Operands[i] != EffectTree::Null && !Evaluate(expression.Operands[i], operands[i]))
+						{
+							return false;
+						}
+					}
+
+					switch (expression.Operator)
+					{
+						case Expression::Negate:
+							result = operands[0];
+							std::transform(result.Components, result.Components + 4, result.Components, [](float value) { return -value; });
+							return true;
+						case Expression::LogicNot:
+							result = operands[0];
+							std::transform(result.Components, result.Components + 4, result.Components, [](float value) { return value == 0.0f ? 1.0f : 0.0f; });
+							return true;
+						case Expression::Cast:
+							result = operands[0];
+							return Convert(expression.Type, result);
+						case Expression::Mad:
+							return Apply(Expression::Multiply, operands[0], operands[1], result) && Apply(Expression::Add, result, operands[2], result);
+						default:
+							return expression.Operands[1] != EffectTree::Null && expression.Operands[2] == EffectTree::Null && Apply(expression.Operator, operands[0], operands[1], result) && (!expression.Type.IsIntegral() || Convert(expression.Type, result));
+					}
+				}
+
+				return false;
+			}
+			bool Apply(unsigned int op, Value left, Value right, Value &result) const
+			{
+				using EffectNodes::Expression;
+
+				Broadcast(left, right);
+
+				result = left;
+
+				for (unsigned int i = 0; i < result.Count; ++i)
+				{
+					const float a = left.Components[i], b = right.Components[i];
+					const int ia = static_cast<int>(a), ib = static_cast<int>(b);
+
+					switch (op)
+					{
+						case Expression::Add: result.Components[i] = a + b; break;
+						case Expression::Subtract: result.Components[i] = a - b; break;
+						case Expression::Multiply: result.Components[i] = a * b; break;
+						case Expression::Divide: if (b == 0.0f) return false; result.Components[i] = a / b; break;
+						case Expression::Modulo: if (b == 0.0f) return false; result.Components[i] = std::fmod(a, b); break;
+						case Expression::Less: result.Components[i] = a < b; break;
+						case Expression::Greater: result.Components[i] = a > b; break;
+						case Expression::LessOrEqual: result.Components[i] = a <= b; break;
+						case Expression::GreaterOrEqual: result.Components[i] = a >= b; break;
+						case Expression::Equal: result.Components[i] = a == b; break;
+						case Expression::NotEqual: result.Components[i] = a != b; break;
+						case Expression::LogicAnd: result.Components[i] = a != 0.0f && b != 0.0f; break;
+						case Expression::LogicOr: result.Components[i] = a != 0.0f || b != 0.0f; break;
+						case Expression::LeftShift: result.Components[i] = static_cast<float>(ia << ib); break;
+						case Expression::RightShift: result.Components[i] = static_cast<float>(ia >> ib); break;
+						case Expression::BitAnd: result.Components[i] = static_cast<float>(ia & ib); break;
+						case Expression::BitOr: result.Components[i] = static_cast<float>(ia | ib); break;
+						case Expression::BitXor: result.Components[i] = static_cast<float>(ia ^ ib); break;
+						case Expression::Min: result.Components[i] = std::min(a, b); break;
+						case Expression::Max: result.Components[i] = std::max(a, b); break;
+						default: return false;
+					}
+				}
+
+				return true;
+			}
+			bool EvaluateCall(const EffectNodes::Call &call, Value &result)
+			{
+				using namespace EffectNodes;
+
+				const Function &callee = this->mAST[call.Callee].As<Function>();
+
+				// Recursion is not allowed in shaders anyway, this only guards against malformed trees
+				if (callee.Definition == EffectTree::Null || ++this->mDepth > 16)
+				{
+					return false;
+				}
+
+				std::vector<std::pair<EffectTree::Index, EffectTree::Index>> outputs;
+
+				for (EffectTree::Index argument = call.Arguments, index = callee.Parameters; argument != EffectTree::Null && index != EffectTree::Null; argument = this->mAST[argument].As<RValue>().NextExpression, index = this->mAST[index].As<Variable>().NextDeclaration)
+				{
+					const Variable &parameter = this->mAST[index].As<Variable>();
+					Value value = Zero(parameter.Type.Rows);
+
+					if (parameter.Type.HasQualifier(Type::Qualifier::In) || !parameter.Type.HasQualifier(Type::Qualifier::Out))
+					{
+						if (!Evaluate(argument, value) || !Convert(parameter.Type, value))
+						{
+							return false;
+						}
+					}
+					if (parameter.Type.HasQualifier(Type::Qualifier::Out))
+					{
+						outputs.emplace_back(index, argument);
+					}
+
+					this->mVariables[index] = value;
+				}
+
+				result = Zero(callee.ReturnType.Rows);
+
+				if (!Execute(callee.Definition, result))
+				{
+					return false;
+				}
+
+				this->mReturned = false;
+
+				for (const auto &output : outputs)
+				{
+					if (!Store(output.second, this->mVariables[output.first]))
+					{
+						return false;
+					}
+				}
+
+				this->mDepth--;
+
+				return true;
+			}
+
+			const EffectTree &mAST;
+			std::unordered_map<EffectTree::Index, Value> mVariables;
+			unsigned int mDepth;
+			bool mReturned;
+		};
+
+		/*
+		 * Proves that the vertex shader hands the pixel shader the screen UV of each pixel through all the given texture coordinates.
+		 * The runtime draws every pass as a single triangle from vertex IDs 0 to 2 and both sides are affine across it, so agreeing at the three vertices means agreeing everywhere.
+		 */
+		bool HasScreenTexCoords(const EffectTree &ast, const EffectNodes::Function &function, const std::unordered_set<std::string> &semantics)
+		{
+			VertexShaderEvaluator evaluator(ast);
+			float ndc[3][2];
+
+			for (unsigned int id = 0; id < 3; ++id)
+			{
+				std::unordered_map<std::string, VertexShaderEvaluator::Value> outputs;
+
+				if (!evaluator.Evaluate(function, id, outputs))
+				{
+					return false;
+				}
+
+				auto position = outputs.find("SV_POSITION0");
+
+				if (position == outputs.end())
+				{
+					position = outputs.find("POSITION0");
+				}
+				if (position == outputs.end() || position->second.Count != 4 || position->second.Components[3] == 0.0f)
+				{
+					return false;
+				}
+
+				ndc[id][0] = position->second.Components[0] / position->second.Components[3];
+				ndc[id][1] = position->second.Components[1] / position->second.Components[3];
+
+				for (const std::string &semantic : semantics)
+				{
+					const auto texcoord = outputs.find(semantic);
+
+					if (texcoord == outputs.end() || texcoord->second.Count < 2 || std::abs(texcoord->second.Components[0] - (ndc[id][0] * 0.5f + 0.5f)) > 1e-5f || std::abs(texcoord->second.Components[1] - (0.5f - ndc[id][1] * 0.5f)) > 1e-5f)
+					{
+						return false;
+					}
+				}
+			}
+
+			// A degenerate triangle does not pin down the mapping
+			return std::abs((ndc[1][0] - ndc[0][0]) * (ndc[2][1] - ndc[0][1]) - (ndc[2][0] - ndc[0][0]) * (ndc[1][1] - ndc[0][1])) > 1e-5f;
+		}
+
+		bool GetUintAnnotation(const EffectTree &ast, EffectTree::Index annotations, const char *name, unsigned int &value)
+		{
+			for (EffectTree::Index index = annotations; index != EffectTree::Null; index = ast[index].As<EffectNodes::Annotation>().NextAnnotation)
+			{
+				const EffectNodes::Annotation &annotation = ast[index].As<EffectNodes::Annotation>();
+
+				if (!boost::equals(annotation.Name, name))
+				{
+					continue;
+				}
+
+				const EffectNodes::Literal &literal = ast[annotation.Value].As<EffectNodes::Literal>();
+
+				switch (literal.Type.Class)
+				{
+					case EffectNodes::Type::Bool:
+					case EffectNodes::Type::Int:
+						value = static_cast<unsigned int>(std::max(literal.Value.Int[0], 0));
+						return true;
+					case EffectNodes::Type::Uint:
+						value = literal.Value.Uint[0];
+						return true;
+					case EffectNodes::Type::Float:
+						value = static_cast<unsigned int>(std::max(literal.Value.Float[0], 0.0f));
+						return true;
+					default:
+						return false;
+				}
+			}
+
+			return false;
+		}
+		inline bool GetBoolState(const EffectTree &ast, const EffectNodes::Pass &pass, EffectNodes::Pass::State state)
+		{
+			return pass.States[state] != EffectTree::Null && ast[pass.States[state]].As<EffectNodes::Literal>().Value.Bool[0] != 0;
+		}
+		bool IsFullscreenBackBufferPass(const EffectTree &ast, const EffectNodes::Pass &pass)
+		{
+			if (pass.States[EffectNodes::Pass::VertexShader] == EffectTree::Null || pass.States[EffectNodes::Pass::PixelShader] == EffectTree::Null)
+			{
+				return false;
+			}
+
+			for (unsigned int i = 0; i < 8; ++i)
+			{
+				if (pass.States[EffectNodes::Pass::RenderTarget0 + i] != EffectTree::Null)
+				{
+					return false;
+				}
+			}
+
+			if (pass.States[EffectNodes::Pass::ColorWriteMask] != EffectTree::Null && (ast[pass.States[EffectNodes::Pass::ColorWriteMask]].As<EffectNodes::Literal>().Value.Uint[0] & 0xF) != 0xF)
+			{
+				return false;
+			}
+			if (GetBoolState(ast, pass, EffectNodes::Pass::BlendEnable) || GetBoolState(ast, pass, EffectNodes::Pass::DepthEnable) || GetBoolState(ast, pass, EffectNodes::Pass::StencilEnable))
+			{
+				return false;
+			}
+			if (pass.States[EffectNodes::Pass::RenderScale] != EffectTree::Null && ast[pass.States[EffectNodes::Pass::RenderScale]].As<EffectNodes::Literal>().Value.Float[0] != 1.0f)
+			{
+				return false;
+			}
+
+			const EffectNodes::Function &function = ast[pass.States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>();
+
+			if (!function.ReturnType.IsFloatingPoint() || function.ReturnType.Rows != 4 || function.ReturnType.Cols != 1 || function.ReturnSemantic == nullptr)
+			{
+				return false;
+			}
+			if (!(boost::equals(function.ReturnSemantic, "COLOR") || boost::equals(function.ReturnSemantic, "COLOR0") || boost::equals(function.ReturnSemantic, "SV_TARGET") || boost::equals(function.ReturnSemantic, "SV_TARGET0")))
+			{
+				return false;
+			}
+
+			for (EffectTree::Index parameter = function.Parameters; parameter != EffectTree::Null; parameter = ast[parameter].As<EffectNodes::Variable>().NextDeclaration)
+			{
+				if (ast[parameter].As<EffectNodes::Variable>().Type.HasQualifier(EffectNodes::Type::Qualifier::Out))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+		bool HasSameSignature(const EffectTree &ast, const EffectNodes::Function &left, const EffectNodes::Function &right)
+		{
+			if (left.ParameterCount != right.ParameterCount)
+			{
+				return false;
+			}
+
+			for (EffectTree::Index i = left.Parameters, j = right.Parameters; i != EffectTree::Null && j != EffectTree::Null; i = ast[i].As<EffectNodes::Variable>().NextDeclaration, j = ast[j].As<EffectNodes::Variable>().NextDeclaration)
+			{
+				const EffectNodes::Variable &parameter1 = ast[i].As<EffectNodes::Variable>(), &parameter2 = ast[j].As<EffectNodes::Variable>();
+
+				if (parameter1.Type.Class != parameter2.Type.Class || parameter1.Type.Rows != parameter2.Type.Rows || parameter1.Type.Cols != parameter2.Type.Cols || parameter1.Type.ArrayLength != parameter2.Type.ArrayLength || parameter1.Type.Definition != parameter2.Type.Definition || parameter1.Type.Qualifiers != parameter2.Type.Qualifiers)
+				{
+					return false;
+				}
+				if ((parameter1.Semantic == nullptr) != (parameter2.Semantic == nullptr) || (parameter1.Semantic != nullptr && !boost::equals(parameter1.Semantic, parameter2.Semantic)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	bool IsBackBufferTexture(const EffectTree &ast, const EffectNodes::Variable &texture)
+	{
+		return texture.Type.IsTexture() && texture.Semantic != nullptr && (boost::equals(texture.Semantic, "COLOR") || boost::equals(texture.Semantic, "SV_TARGET"));
+	}
+	bool IsBackBufferSampler(const EffectTree &ast, const EffectNodes::Variable &sampler)
+	{
+		return sampler.Type.IsSampler() && sampler.Properties[EffectNodes::Variable::Texture] != EffectTree::Null && IsBackBufferTexture(ast, ast[sampler.Properties[EffectNodes::Variable::Texture]].As<EffectNodes::Variable>());
+	}
+
+	EffectPassInfo::Access AnalyzeBackBufferAccess(const EffectTree &ast, const EffectNodes::Function &function)
+	{
+		BackBufferAccessAnalyzer analyzer(ast);
+		analyzer.Analyze(function);
+
+		return analyzer.GetAccess();
+	}
+	EffectPassInfo AnalyzePass(const EffectTree &ast, const EffectNodes::Pass &pass)
+	{
+		EffectPassInfo info;
+		info.Pass = pass.Index;
+		info.BackBufferAccess = EffectPassInfo::Access::None;
+		info.WritesBackBuffer = pass.States[EffectNodes::Pass::RenderTarget0] == EffectTree::Null;
+		info.Discards = false;
+		info.Fusable = false;
+		info.Interval = 1;
+		info.Phase = UINT_MAX;
+
+		if (GetUintAnnotation(ast, pass.Annotations, "interval", info.Interval))
+		{
+			GetUintAnnotation(ast, pass.Annotations, "phase", info.Phase);
+
+			info.Interval = std::max(info.Interval, 1u);
+		}
+
+		std::unordered_set<EffectTree::Index> samplers;
+
+		if (pass.States[EffectNodes::Pass::PixelShader] != EffectTree::Null)
+		{
+			BackBufferAccessAnalyzer analyzer(ast);
+			analyzer.Analyze(ast[pass.States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>());
+
+			info.BackBufferAccess = analyzer.GetAccess();
+			info.Discards = analyzer.Discards();
+
+			// A texture coordinate input only stands for the current pixel if the vertex shader actually passes the screen UV through it
+			if (info.BackBufferAccess == EffectPassInfo::Access::Pointwise && (pass.States[EffectNodes::Pass::VertexShader] == EffectTree::Null || !HasScreenTexCoords(ast, ast[pass.States[EffectNodes::Pass::VertexShader]].As<EffectNodes::Function>(), analyzer.GetSampledSemantics())))
+			{
+				info.BackBufferAccess = EffectPassInfo::Access::Neighbourhood;
+			}
+
+			samplers.insert(analyzer.GetSamplers().begin(), analyzer.GetSamplers().end());
+		}
+		if (pass.States[EffectNodes::Pass::VertexShader] != EffectTree::Null)
+		{
+			BackBufferAccessAnalyzer analyzer(ast);
+			analyzer.Analyze(ast[pass.States[EffectNodes::Pass::VertexShader]].As<EffectNodes::Function>());
+
+			// Vertex shader reads are never tied to a single pixel
+			if (analyzer.GetAccess() != EffectPassInfo::Access::None)
+			{
+				info.BackBufferAccess = EffectPassInfo::Access::Neighbourhood;
+			}
+
+			samplers.insert(analyzer.GetSamplers().begin(), analyzer.GetSamplers().end());
+		}
+
+		for (EffectTree::Index sampler : samplers)
+		{
+			const EffectTree::Index texture = ast[sampler].As<EffectNodes::Variable>().Properties[EffectNodes::Variable::Texture];
+
+			if (texture != EffectTree::Null && std::find(info.ReadTextures.begin(), info.ReadTextures.end(), texture) == info.ReadTextures.end())
+			{
+				info.ReadTextures.push_back(texture);
+			}
+		}
+		for (unsigned int i = 0; i < 8; ++i)
+		{
+			if (pass.States[EffectNodes::Pass::RenderTarget0 + i] != EffectTree::Null)
+			{
+				info.WrittenTextures.push_back(pass.States[EffectNodes::Pass::RenderTarget0 + i]);
+			}
+		}
+
+		return info;
+	}
+	std::vector<EffectPassInfo> AnalyzeTechnique(const EffectTree &ast, const EffectNodes::Technique &technique)
+	{
+		std::vector<EffectPassInfo> passes;
+		const EffectNodes::Pass *previous = nullptr;
+		unsigned int interval = 1, phase = UINT_MAX;
+
+		if (GetUintAnnotation(ast, technique.Annotations, "interval", interval))
+		{
+			GetUintAnnotation(ast, technique.Annotations, "phase", phase);
+		}
+
+		for (EffectTree::Index index = technique.Passes; index != EffectTree::Null; index = ast[index].As<EffectNodes::Pass>().NextPass)
+		{
+			const EffectNodes::Pass &pass = ast[index].As<EffectNodes::Pass>();
+			EffectPassInfo info = AnalyzePass(ast, pass);
+
+			// The back buffer does not keep its contents between frames, so passes drawing to it keep running every frame unless they request otherwise
+			if (!info.WritesBackBuffer && !GetUintAnnotation(ast, pass.Annotations, "interval", info.Interval))
+			{
+				info.Interval = interval;
+				info.Phase = phase;
+			}
+
+			info.Interval = std::max(info.Interval, 1u);
+
+			// Both passes have to cover the whole back buffer with the same vertex shader outputs and nothing but the previous color may flow between them
+			if (previous != nullptr && passes.back().Interval == info.Interval && passes.back().Phase == info.Phase && !passes.back().Discards && !info.Discards && info.BackBufferAccess != EffectPassInfo::Access::Neighbourhood && IsFullscreenBackBufferPass(ast, *previous) && IsFullscreenBackBufferPass(ast, pass))
+			{
+				info.Fusable = previous->States[EffectNodes::Pass::VertexShader] == pass.States[EffectNodes::Pass::VertexShader] && HasSameSignature(ast, ast[previous->States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>(), ast[pass.States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>());
+			}
+
+			passes.push_back(info);
+
+			previous = &pass;
+		}
+
+		return passes;
+	}
+	std::size_t GetTextureSize(const EffectTree &ast, const EffectNodes::Variable &texture)
+	{
+		const unsigned int width = (texture.Properties[EffectNodes::Variable::Width] != EffectTree::Null) ? ast[texture.Properties[EffectNodes::Variable::Width]].As<EffectNodes::Literal>().Value.Uint[0] : 1;
+		const unsigned int height = (texture.Properties[EffectNodes::Variable::Height] != EffectTree::Null) ? ast[texture.Properties[EffectNodes::Variable::Height]].As<EffectNodes::Literal>().Value.Uint[0] : 1;
+		const unsigned int format = (texture.Properties[EffectNodes::Variable::Format] != EffectTree::Null) ? ast[texture.Properties[EffectNodes::Variable::Format]].As<EffectNodes::Literal>().Value.Uint[0] : EffectNodes::Literal::RGBA8;
+		unsigned int levels = (texture.Properties[EffectNodes::Variable::MipLevels] != EffectTree::Null) ? ast[texture.Properties[EffectNodes::Variable::MipLevels]].As<EffectNodes::Literal>().Value.Uint[0] : 1;
+
+		if (levels == 0)
+		{
+			for (unsigned int size = std::max(width, height); size > 0; size >>= 1)
+			{
+				++levels;
+			}
+		}
+
+		std::size_t size = 0;
+
+		for (unsigned int level = 0; level < levels; ++level)
+		{
+			const std::size_t w = std::max(width >> level, 1u), h = std::max(height >> level, 1u);
+
+			switch (format)
+			{
+				case EffectNodes::Literal::R8:
+					size += w * h;
+					break;
+				case EffectNodes::Literal::RG8:
+					size += w * h * 2;
+					break;
+				default:
+				case EffectNodes::Literal::RGBA8:
+				case EffectNodes::Literal::R32F:
+					size += w * h * 4;
+					break;
+				case EffectNodes::Literal::RGBA16:
+				case EffectNodes::Literal::RGBA16F:
+					size += w * h * 8;
+					break;
+				case EffectNodes::Literal::RGBA32F:
+					size += w * h * 16;
+					break;
+				case EffectNodes::Literal::DXT1:
+				case EffectNodes::Literal::LATC1:
+					size += ((w + 3) / 4) * ((h + 3) / 4) * 8;
+					break;
+				case EffectNodes::Literal::DXT3:
+				case EffectNodes::Literal::DXT5:
+				case EffectNodes::Literal::LATC2:
+					size += ((w + 3) / 4) * ((h + 3) / 4) * 16;
+					break;
+			}
+		}
+
+		return size;
+	}
+	EffectTexturePlan PlanTextureMemory(const EffectTree &ast)
+	{
+		typedef std::pair<std::size_t, std::size_t> Range;
+
+		struct Allocation
+		{
+			EffectTree::Index Owner;
+			std::vector<Range> Ranges;
+		};
+
+		EffectTexturePlan plan;
+		plan.TotalBytes = plan.SavedBytes = 0;
+
+		std::vector<EffectTree::Index> textures;
+		std::unordered_map<EffectTree::Index, std::vector<Range>> ranges;
+		std::unordered_set<EffectTree::Index> pinned;
+		std::size_t position = 0;
+
+		for (EffectTree::Index index = EffectTree::Root; index != EffectTree::Null; index = ast[index].As<EffectNodes::Root>().NextDeclaration)
+		{
+			if (ast[index].Is<EffectNodes::Variable>())
+			{
+				for (EffectTree::Index declarator = index; declarator != EffectTree::Null; declarator = ast[declarator].As<EffectNodes::Variable>().NextDeclarator)
+				{
+					const EffectNodes::Variable &texture = ast[declarator].As<EffectNodes::Variable>();
+
+					if (!texture.Type.IsTexture() || texture.Semantic != nullptr)
+					{
+						continue;
+					}
+
+					textures.push_back(declarator);
+
+					plan.TotalBytes += GetTextureSize(ast, texture);
+
+					// Textures with annotations may be filled from outside the effect (e.g. loaded from a file), so their contents have to stay around
+					if (texture.Annotations != EffectTree::Null)
+					{
+						pinned.insert(declarator);
+					}
+				}
+			}
+			else if (ast[index].Is<EffectNodes::Technique>())
+			{
+				// Techniques never interleave, so a texture is only alive from its first write to its last use inside a single technique
+				std::unordered_map<EffectTree::Index, Range> live;
+
+				for (const EffectPassInfo &info : AnalyzeTechnique(ast, ast[index].As<EffectNodes::Technique>()))
+				{
+					for (EffectTree::Index texture : info.ReadTextures)
+					{
+						const auto it = live.find(texture);
+
+						if (it != live.end())
+						{
+							it->second.second = position;
+						}
+						else
+						{
+							// Read before it was written in this technique, so it carries contents over from elsewhere (another technique or the previous frame)
+							pinned.insert(texture);
+						}
+					}
+					for (EffectTree::Index texture : info.WrittenTextures)
+					{
+						// Passes that do not run every frame rely on their results staying around until they run again
+						if (info.Interval > 1)
+						{
+							pinned.insert(texture);
+						}
+
+						const auto it = live.find(texture);
+
+						if (it != live.end())
+						{
+							it->second.second = position;
+						}
+						else
+						{
+							live.emplace(texture, Range(position, position));
+						}
+					}
+
+					++position;
+				}
+
+				for (const auto &it : live)
+				{
+					ranges[it.first].push_back(it.second);
+				}
+			}
+		}
+
+		std::vector<EffectTree::Index> candidates;
+
+		for (EffectTree::Index texture : textures)
+		{
+			if (pinned.count(texture) == 0 && ranges.count(texture) != 0)
+			{
+				candidates.push_back(texture);
+			}
+		}
+
+		// Greedy interval coloring, visiting textures in the order they first become alive
+		std::sort(candidates.begin(), candidates.end(), [&ranges](EffectTree::Index left, EffectTree::Index right)
+		{
+			const auto compare = [](const Range &a, const Range &b) { return a.first < b.first; };
+
+			return std::min_element(ranges[left].begin(), ranges[left].end(), compare)->first < std::min_element(ranges[right].begin(), ranges[right].end(), compare)->first;
+		});
+
+		std::vector<Allocation> allocations;
+
+		for (EffectTree::Index texture : candidates)
+		{
+			const EffectNodes::Variable &variable = ast[texture].As<EffectNodes::Variable>();
+			Allocation *target = nullptr;
+
+			for (Allocation &allocation : allocations)
+			{
+				const EffectNodes::Variable &owner = ast[allocation.Owner].As<EffectNodes::Variable>();
+				bool compatible = true;
+
+				for (unsigned int property : { EffectNodes::Variable::Width, EffectNodes::Variable::Height, EffectNodes::Variable::MipLevels, EffectNodes::Variable::Format })
+				{
+					const EffectTree::Index a = variable.Properties[property], b = owner.Properties[property];
+
+					if ((a == EffectTree::Null) != (b == EffectTree::Null) || (a != EffectTree::Null && ast[a].As<EffectNodes::Literal>().Value.Uint[0] != ast[b].As<EffectNodes::Literal>().Value.Uint[0]))
+					{
+						compatible = false;
+						break;
+					}
+				}
+
+				for (const Range &a : ranges[texture])
+				{
+					for (const Range &b : allocation.Ranges)
+					{
+						if (a.first <= b.second && b.first <= a.second)
+						{
+							compatible = false;
+						}
+					}
+				}
+
+				if (compatible)
+				{
+					target = &allocation;
+					break;
+				}
+			}
+
+			if (target == nullptr)
+			{
+				Allocation allocation;
+				allocation.Owner = texture;
+				allocation.Ranges = ranges[texture];
+
+				allocations.push_back(std::move(allocation));
+				continue;
+			}
+
+			target->Ranges.insert(target->Ranges.end(), ranges[texture].begin(), ranges[texture].end());
+
+			// The allocation has to be created before any texture that shares it, so it belongs to the one declared first
+			if (texture < target->Owner)
+			{
+				for (auto &alias : plan.Aliases)
+				{
+					if (alias.second == target->Owner)
+					{
+						alias.second = texture;
+					}
+				}
+
+				plan.Aliases[target->Owner] = texture;
+				target->Owner = texture;
+			}
+			else
+			{
+				plan.Aliases[texture] = target->Owner;
+			}
+
+			plan.SavedBytes += GetTextureSize(ast, variable);
+		}
+
+		return plan;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "EffectParserTree.hpp"
+
+#include <vector>
+#include <climits>
+#include <unordered_map>
+
+namespace ReShade
+{
+	struct EffectPassInfo
+	{
+		enum class Access
+		{
+			None,
+			Pointwise,		// Only samples the back buffer at the interpolated texture coordinate of the current pixel
+			Neighbourhood	// Any other kind of back buffer access (offsets, gathers, fetches, computed coordinates, ...)
+		};
+
+		EffectTree::Index Pass;
+		Access BackBufferAccess;
+		bool WritesBackBuffer, Discards;
+		bool Fusable; // Pass can be merged into the pixel shader of the previous pass
+		unsigned int Interval, Phase; // Pass only runs on frames where 'frame % Interval == Phase', a phase of 'UINT_MAX' is chosen by the runtime
+		std::vector<EffectTree::Index> ReadTextures, WrittenTextures;
+	};
+	struct EffectTexturePlan
+	{
+		std::unordered_map<EffectTree::Index, EffectTree::Index> Aliases; // Texture -> earlier declared texture whose allocation it shares
+		std::size_t TotalBytes, SavedBytes;
+	};
+
+	bool IsBackBufferTexture(const EffectTree &ast, const EffectNodes::Variable &texture);
+	bool IsBackBufferSampler(const EffectTree &ast, const EffectNodes::Variable &sampler);
+
+	EffectPassInfo::Access AnalyzeBackBufferAccess(const EffectTree &ast, const EffectNodes::Function &function);
+	EffectPassInfo AnalyzePass(const EffectTree &ast, const EffectNodes::Pass &pass);
+	std::vector<EffectPassInfo> AnalyzeTechnique(const EffectTree &ast, const EffectNodes::Technique &technique);
+	std::size_t GetTextureSize(const EffectTree &ast, const EffectNodes::Variable &texture);
+	EffectTexturePlan PlanTextureMemory(const EffectTree &ast);
+}
\ No newline at end of file
@@ -3272,6 +3272,12 @@ RULE_PASSSTATE
 		const bool stateShaderAssignment = $1.Uint == EffectNodes::Pass::VertexShader || $1.Uint == EffectNodes::Pass::PixelShader;
 		const bool stateRenderTargetAssignment = $1.Uint >= EffectNodes::Pass::RenderTarget0 && $1.Uint <= EffectNodes::Pass::RenderTarget7;
 
+		if ($1.Uint == EffectNodes::Pass::RenderScale && (!parser.mAST[$4].Is<EffectNodes::Literal>() || !parser.mAST[$4].As<EffectNodes::Literal>().Type.IsScalar()))
+		{
+			parser.Error(@4, 3011, "render scale must be a literal scalar expression");
+			YYERROR;
+		}
+
 		if (parser.mAST[$4].Is<EffectNodes::LValue>())
 		{
 			$4 = parser.mAST[$4].As<EffectNodes::LValue>().Reference;
@@ -3297,6 +3303,20 @@ RULE_PASSSTATE
 
 			$4 = EffectTree::Null;
 		}
+		else if ($1.Uint == EffectNodes::Pass::RenderScale)
+		{
+			EffectNodes::Literal &literal = parser.mAST[$4].As<EffectNodes::Literal>();
+			const float scale = literal.Type.IsFloatingPoint() ? literal.Value.Float[0] : literal.Type.Class == EffectNodes::Type::Uint ? static_cast<float>(literal.Value.Uint[0]) : static_cast<float>(literal.Value.Int[0]);
+
+			if (!(scale > 0.0f && scale <= 1.0f))
+			{
+				parser.Error(@4, 3059, "render scale must be greater than 0 and at most 1");
+				YYERROR;
+			}
+
+			literal.Type.Class = EffectNodes::Type::Float;
+			literal.Value.Float[0] = scale;
+		}
 
 		@$ = @1, $$.States[$$.Index = $1.Uint] = $4;
 	}
@@ -678,6 +678,7 @@ namespace ReShade
 				StencilPass,
 				StencilFail,
 				StencilDepthFail,
+				RenderScale,
 
 				StateCount
 			};
@@ -0,0 +1,169 @@
+#include "FrameStatistics.hpp"
+
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+	const unsigned int sPercents[FrameStatistics::PercentileCount] = { 50, 95, 99 };
+}
+
+FrameStatistics::FrameStatistics()
+{
+	Clear();
+}
+
+void FrameStatistics::Record(const Frame &frame)
+{
+	if (this->mCount == Capacity)
+	{
+		Add(GetBucket(this->mFrames[this->mNext].FrameTime), -1);
+	}
+	else
+	{
+		this->mCount++;
+	}
+
+	this->mFrames[this->mNext] = frame;
+	this->mNext = (this->mNext + 1) % Capacity;
+	Add(GetBucket(frame.FrameTime), 1);
+
+	// The rank of each percentile changes by one at most, so the cursors only step over the buckets in between
+	for (unsigned int i = 0; i < PercentileCount; ++i)
+	{
+		Cursor &cursor = this->mPercentiles[i];
+		const std::size_t rank = GetRank(static_cast<Percentile>(i));
+
+		while (cursor.Below >= rank)
+		{
+			cursor.Below -= this->mHistogram[--cursor.Bucket];
+		}
+		while (cursor.Below + this->mHistogram[cursor.Bucket] < rank)
+		{
+			cursor.Below += this->mHistogram[cursor.Bucket++];
+		}
+	}
+
+	UpdateStutterThreshold();
+
+	// Drop maxima that left the window or are shadowed by the new frame
+	while (!this->mMaxima.empty() && this->mMaxima.front().first + Capacity <= this->mRecorded)
+	{
+		this->mMaxima.pop_front();
+	}
+	while (!this->mMaxima.empty() && this->mMaxima.back().second <= frame.FrameTime)
+	{
+		this->mMaxima.pop_back();
+	}
+
+	this->mMaxima.emplace_back(this->mRecorded++, frame.FrameTime);
+}
+void FrameStatistics::Clear()
+{
+	this->mNext = this->mCount = 0;
+	this->mRecorded = 0;
+	this->mMaxima.clear();
+
+	std::fill_n(this->mHistogram, BucketCount, 0);
+
+	for (Cursor &cursor : this->mPercentiles)
+	{
+		cursor.Bucket = 0;
+		cursor.Below = 0;
+	}
+
+	this->mStutterBucket = 0;
+	this->mStutterAbove = 0;
+}
+
+float FrameStatistics::GetPercentile(Percentile percentile) const
+{
+	if (this->mCount == 0)
+	{
+		return 0.0f;
+	}
+
+	return GetValue(this->mPercentiles[percentile], GetRank(percentile));
+}
+float FrameStatistics::GetMax() const
+{
+	return this->mMaxima.empty() ? 0.0f : this->mMaxima.front().second;
+}
+unsigned int FrameStatistics::GetStutterCount() const
+{
+	if (this->mCount == 0)
+	{
+		return 0;
+	}
+
+	// Only the part of the threshold bucket above twice the median counts
+	const float above = std::min(std::max(this->mStutterBucket + 1 - 20.0f * GetPercentile(Median), 0.0f), 1.0f);
+
+	return static_cast<unsigned int>(this->mStutterAbove + static_cast<unsigned int>(this->mHistogram[this->mStutterBucket] * above + 0.5f));
+}
+
+bool FrameStatistics::DumpToCSV(const boost::filesystem::path &path) const
+{
+	std::ofstream file(path.string());
+
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "Frame,FrameTime,PostProcessingTime,DrawCalls\n";
+
+	for (std::size_t i = 0; i < this->mCount; ++i)
+	{
+		const Frame &frame = this->mFrames[(this->mNext + Capacity - this->mCount + i) % Capacity];
+
+		file << (this->mRecorded - this->mCount + i) << ',' << frame.FrameTime << ',' << frame.PostProcessingTime << ',' << frame.DrawCalls << '\n';
+	}
+
+	return file.good();
+}
+
+unsigned int FrameStatistics::GetBucket(float frametime)
+{
+	return std::min(static_cast<unsigned int>(std::max(frametime, 0.0f) * 10.0f), BucketCount - 1);
+}
+
+void FrameStatistics::Add(unsigned int bucket, int difference)
+{
+	this->mHistogram[bucket] += difference;
+
+	for (Cursor &cursor : this->mPercentiles)
+	{
+		if (bucket < cursor.Bucket)
+		{
+			cursor.Below += difference;
+		}
+	}
+
+	if (bucket > this->mStutterBucket)
+	{
+		this->mStutterAbove += difference;
+	}
+}
+std::size_t FrameStatistics::GetRank(Percentile percentile) const
+{
+	return std::max((this->mCount * sPercents[percentile] + 99) / 100, static_cast<std::size_t>(1));
+}
+float FrameStatistics::GetValue(const Cursor &cursor, std::size_t rank) const
+{
+	// The frames in a bucket are assumed to be spread evenly over it, with the first and last half a step away from its edges
+	return (cursor.Bucket + (rank - cursor.Below - 0.5f) / this->mHistogram[cursor.Bucket]) * 0.1f;
+}
+void FrameStatistics::UpdateStutterThreshold()
+{
+	const unsigned int bucket = GetBucket(2 * GetPercentile(Median));
+
+	while (this->mStutterBucket < bucket)
+	{
+		this->mStutterAbove -= this->mHistogram[++this->mStutterBucket];
+	}
+	while (this->mStutterBucket > bucket)
+	{
+		this->mStutterAbove += this->mHistogram[this->mStutterBucket--];
+	}
+}
\ No newline at end of file
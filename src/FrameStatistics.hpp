@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+#include <boost/filesystem/path.hpp>
+
+/*
+ * Rolling frame time analytics over the last frames, updated in constant time per frame.
+ * Frame times are binned into a fixed histogram, the tracked percentiles and the stutter threshold keep a cursor into it that only moves by the few buckets a single frame can shift them.
+ * Within a bucket, values are interpolated as if the frames in it were spread evenly, which is accurate to well below the bucket width of 0.1ms.
+ */
+class FrameStatistics
+{
+public:
+	static const unsigned int Capacity = 1024;
+	static const unsigned int BucketCount = 2500; // 0.1ms buckets up to 250ms, the last one collects everything above
+
+	struct Frame
+	{
+		float FrameTime, PostProcessingTime; // Milliseconds
+		unsigned long DrawCalls;
+	};
+	enum Percentile
+	{
+		Median,
+		P95,
+		P99,
+		PercentileCount
+	};
+
+	FrameStatistics();
+
+	void Record(const Frame &frame);
+	void Clear();
+
+	inline std::size_t GetCount() const
+	{
+		return this->mCount;
+	}
+	float GetPercentile(Percentile percentile) const;
+	float GetMax() const;
+	unsigned int GetStutterCount() const;
+
+	bool DumpToCSV(const boost::filesystem::path &path) const;
+
+private:
+	struct Cursor
+	{
+		unsigned int Bucket;
+		std::size_t Below; // Frames in all buckets before 'Bucket'
+	};
+
+	static unsigned int GetBucket(float frametime);
+
+	void Add(unsigned int bucket, int difference);
+	std::size_t GetRank(Percentile percentile) const;
+	float GetValue(const Cursor &cursor, std::size_t rank) const;
+	void UpdateStutterThreshold();
+
+	Frame mFrames[Capacity];
+	std::size_t mNext, mCount;
+	unsigned int mHistogram[BucketCount];
+	std::deque<std::pair<unsigned long long, float>> mMaxima; // Decreasing frame times still in the window, to track the maximum without rescanning
+	unsigned long long mRecorded;
+	Cursor mPercentiles[PercentileCount];
+	unsigned int mStutterBucket; // Bucket holding twice the median
+	std::size_t mStutterAbove; // Frames in all buckets after 'mStutterBucket'
+};
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "GBufferDecode.hpp"
+
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <emmintrin.h>
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace ReShade
+{
+	namespace
+	{
+		inline __m128 Abs(__m128 value)
+		{
+			return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+		}
+		inline void Normalize(__m128 &x, __m128 &y, __m128 &z)
+		{
+			const __m128 length = _mm_sqrt_ps(_mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_set1_ps(1e-20f)));
+
+			x = _mm_div_ps(x, length);
+			y = _mm_div_ps(y, length);
+			z = _mm_div_ps(z, length);
+		}
+		inline __m128 ToUnorm(__m128 value)
+		{
+			return _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+		}
+
+		// Runs a kernel on four texels at a time, with the channels transposed into separate registers
+		template <typename T>
+		void Run(float *data, std::size_t count, T kernel)
+		{
+			std::size_t i = 0;
+
+			const auto run = [&kernel](float *texels)
+			{
+				__m128 r = _mm_loadu_ps(texels + 0), g = _mm_loadu_ps(texels + 4), b = _mm_loadu_ps(texels + 8), a = _mm_loadu_ps(texels + 12);
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+
+				kernel(r, g, b, a);
+
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+				_mm_storeu_ps(texels + 0, r);
+				_mm_storeu_ps(texels + 4, g);
+				_mm_storeu_ps(texels + 8, b);
+				_mm_storeu_ps(texels + 12, a);
+			};
+
+			for (; i + 4 <= count; i += 4)
+			{
+				run(data + i * 4);
+			}
+
+			if (i < count)
+			{
+				float tail[16] = { };
+				std::memcpy(tail, data + i * 4, (count - i) * 16);
+
+				run(tail);
+
+				std::memcpy(data + i * 4, tail, (count - i) * 16);
+			}
+		}
+	}
+
+	bool ParseGBufferProfile(const std::string &arguments, GBufferProfile &profile)
+	{
+		std::istringstream stream(arguments);
+		std::string target, kernel;
+
+		if (!(stream >> target >> kernel))
+		{
+			return false;
+		}
+
+		const std::size_t separator = target.find(':');
+		profile.SourceFormat = std::strtoul(target.c_str(), nullptr, 10);
+		profile.Name = separator != std::string::npos ? target.substr(separator + 1) : std::string();
+		profile.Near = 0.1f;
+		profile.Far = 1000.0f;
+		profile.ReverseZ = false;
+		profile.Exposure = 0.0f;
+		profile.Channel = 0;
+		profile.Scale = 1.0f;
+
+		if (profile.SourceFormat == 0)
+		{
+			return false;
+		}
+
+		if (boost::iequals(kernel, "octahedral"))
+		{
+			profile.Decode = GBufferProfile::Kernel::OctahedralNormal;
+		}
+		else if (boost::iequals(kernel, "spheremap"))
+		{
+			profile.Decode = GBufferProfile::Kernel::SpheremapNormal;
+		}
+		else if (boost::iequals(kernel, "depth"))
+		{
+			// depth <near> <far> [reverse]
+			std::string reverse;
+			profile.Decode = GBufferProfile::Kernel::LinearDepth;
+
+			if (!(stream >> profile.Near >> profile.Far) || profile.Near <= 0.0f || profile.Far <= profile.Near)
+			{
+				return false;
+			}
+
+			profile.ReverseZ = (stream >> reverse) && boost::iequals(reverse, "reverse");
+		}
+		else if (boost::iequals(kernel, "tonemap"))
+		{
+			// tonemap [exposure]
+			profile.Decode = GBufferProfile::Kernel::Tonemap;
+
+			if (!(stream >> profile.Exposure))
+			{
+				profile.Exposure = 0.0f;
+			}
+		}
+		else if (boost::iequals(kernel, "channel"))
+		{
+			// channel r|g|b|a [scale]
+			std::string channel;
+			profile.Decode = GBufferProfile::Kernel::Channel;
+
+			if (!(stream >> channel) || channel.size() != 1 || std::strchr("rgbaRGBA", channel[0]) == nullptr)
+			{
+				return false;
+			}
+
+			profile.Channel = static_cast<unsigned int>(std::strchr("rgba", std::tolower(channel[0])) - "rgba");
+
+			if (!(stream >> profile.Scale))
+			{
+				profile.Scale = 1.0f;
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+	const GBufferProfile *FindGBufferProfile(const std::vector<GBufferProfile> &profiles, unsigned int format, const std::string &name)
+	{
+		// Later profiles override earlier ones
+		for (auto it = profiles.rbegin(); it != profiles.rend(); ++it)
+		{
+			if (it->SourceFormat == format && boost::starts_with(name, it->Name))
+			{
+				return &*it;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void DecodeGBuffer(const GBufferProfile &profile, float *data, std::size_t count)
+	{
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), sign = _mm_set1_ps(-0.0f);
+
+		switch (profile.Decode)
+		{
+			case GBufferProfile::Kernel::OctahedralNormal:
+				Run(data, count, [=](__m128 &r, __m128 &g, __m128 &b, __m128 &a)
+				{
+					__m128 x = _mm_sub_ps(_mm_add_ps(r, r), one), y = _mm_sub_ps(_mm_add_ps(g, g), one);
+					__m128 z = _mm_sub_ps(_mm_sub_ps(one, Abs(x)), Abs(y));
+
+					// Unfold the lower hemisphere, moving x and y towards zero by the distance below the equator
+					const __m128 fold = _mm_max_ps(_mm_sub_ps(zero, z), zero);
+					x = _mm_sub_ps(x, _mm_or_ps(fold, _mm_and_ps(x, sign)));
+					y = _mm_sub_ps(y, _mm_or_ps(fold, _mm_and_ps(y, sign)));
+
+					Normalize(x, y, z);
+
+					r = ToUnorm(x), g = ToUnorm(y), b = ToUnorm(z), a = one;
+				});
+				break;
+			case GBufferProfile::Kernel::SpheremapNormal:
+				Run(data, count, [=](__m128 &r, __m128 &g, __m128 &b, __m128 &a)
+				{
+					const __m128 x = _mm_sub_ps(_mm_mul_ps(r, _mm_set1_ps(4.0f)), _mm_set1_ps(2.0f)), y = _mm_sub_ps(_mm_mul_ps(g, _mm_set1_ps(4.0f)), _mm_set1_ps(2.0f));
+					const __m128 f = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+					const __m128 scale = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(f, _mm_set1_ps(0.25f))), zero));
+
+					r = ToUnorm(_mm_mul_ps(x, scale));
+					g = ToUnorm(_mm_mul_ps(y, scale));
+					b = ToUnorm(_mm_sub_ps(one, _mm_mul_ps(f, _mm_set1_ps(0.5f))));
+					a = one;
+				});
+				break;
+			case GBufferProfile::Kernel::LinearDepth:
+			{
+				// View depth is 'near * far / (far - d * (far - near))', or with 'near' and 'far' swapped for reverse Z, which is then mapped back to [0, 1] linearly
+				const float range = profile.Far - profile.Near;
+				const __m128 product = _mm_set1_ps(profile.Near * profile.Far), offset = _mm_set1_ps(profile.ReverseZ ? profile.Near : profile.Far), slope = _mm_set1_ps(profile.ReverseZ ? range : -range);
+				const __m128 nearPlane = _mm_set1_ps(profile.Near), inverseRange = _mm_set1_ps(1.0f / range);
+
+				Run(data, count, [=](__m128 &r, __m128 &g, __m128 &b, __m128 &a)
+				{
+					const __m128 depth = _mm_div_ps(product, _mm_add_ps(offset, _mm_mul_ps(r, slope)));
+
+					r = g = b = _mm_mul_ps(_mm_sub_ps(depth, nearPlane), inverseRange);
+					a = one;
+				});
+				break;
+			}
+			case GBufferProfile::Kernel::Tonemap:
+			{
+				const __m128 exposure = _mm_set1_ps(std::pow(2.0f, profile.Exposure));
+
+				// Gamma 2 instead of the sRGB curve, since a square root is cheap
+				const auto tonemap = [=](__m128 value)
+				{
+					value = _mm_max_ps(_mm_mul_ps(value, exposure), zero);
+
+					return _mm_sqrt_ps(_mm_div_ps(value, _mm_add_ps(value, one)));
+				};
+
+				Run(data, count, [=](__m128 &r, __m128 &g, __m128 &b, __m128 &a)
+				{
+					r = tonemap(r), g = tonemap(g), b = tonemap(b), a = one;
+				});
+				break;
+			}
+			case GBufferProfile::Kernel::Channel:
+			{
+				const unsigned int channel = profile.Channel;
+				const __m128 scale = _mm_set1_ps(profile.Scale);
+
+				Run(data, count, [=](__m128 &r, __m128 &g, __m128 &b, __m128 &a)
+				{
+					const __m128 channels[4] = { r, g, b, a };
+
+					r = g = b = _mm_mul_ps(channels[channel], scale);
+					a = one;
+				});
+				break;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ReShade
+{
+	/*
+	 * How to turn a packed G-buffer target into something viewable, dumps of matching targets get a decoded companion image next to the raw one.
+	 * Set up with '#pragma reshade decode <DXGI format>[:<name prefix>] <kernel> [parameters]', see 'ParseGBufferProfile' for the kernels.
+	 * Only targets dumped in their own format are matched: Snapshots taken while recording command lists go through the 8-bit scratch pool and are never decoded.
+	 */
+	struct GBufferProfile
+	{
+		enum class Kernel
+		{
+			OctahedralNormal,	// Normal folded onto an octahedron in red and green
+			SpheremapNormal,	// Lambert azimuthal projection of the normal in red and green
+			LinearDepth,		// Hyperbolic depth in red, linearized between the near and far plane and shown as grey
+			Tonemap,			// HDR color scaled by the exposure, Reinhard tone mapped and gamma corrected
+			Channel				// Single channel scaled and shown as grey, for roughness, material IDs and the like
+		};
+
+		unsigned int SourceFormat;
+		std::string Name; // Only dumps whose file name starts with this match, empty for all targets with the format
+		Kernel Decode;
+		float Near, Far;
+		bool ReverseZ;
+		float Exposure; // In stops
+		unsigned int Channel;
+		float Scale;
+	};
+
+	bool ParseGBufferProfile(const std::string &arguments, GBufferProfile &profile);
+	const GBufferProfile *FindGBufferProfile(const std::vector<GBufferProfile> &profiles, unsigned int format, const std::string &name);
+
+	/*
+	 * Decodes tightly packed RGBA float texels in place, into values between zero and one that can be converted to 8-bit.
+	 */
+	void DecodeGBuffer(const GBufferProfile &profile, float *data, std::size_t count);
+}
\ No newline at end of file
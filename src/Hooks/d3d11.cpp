@@ -5,6 +5,9 @@
 #include <d3d11.h>
 #include <set>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <sstream>
 #include <boost/unordered_set.hpp>
 #include <boost/filesystem.hpp>
 
@@ -38,8 +41,6 @@ extern float BandageCurrent;
 
 std::vector<ID3D11Texture2D*> Pool_RGB8_Typeless_720p;
 
-std::mutex deferredDrawMutex;
-
 HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_FinishCommandList(ID3D11DeviceContext *pDeviceContext, BOOL RestoreDeferredContextState,
 	ID3D11CommandList **ppCommandList);
 
@@ -65,17 +66,6 @@ std::set<void*> AllCLs;
 std::set<void*> RecentCLErrors;
 static std::mutex AllCLsMutex;
 
-//TODO make local to device
-static ID3D11DeviceContext* AllDeferredContexts[20]; //Usually 8 in MGSV
-static UINT AllDeferredContextsCount = 0;
-
-static bool IsContextDeferred(ID3D11DeviceContext* ctx) {
-	for (int i = 0; i < AllDeferredContextsCount; i++) {
-		if (AllDeferredContexts[i] == ctx) return true;
-	}
-	return false;
-}
-
 class DefEvent {
 public:
 	std::string label;
@@ -93,8 +83,11 @@ public:
 	std::set<ID3D11RenderTargetView*> RTsTouched; // Any RT touched by this draw call
 	std::vector<ID3D11RenderTargetView*> copiedViews;
 
+	// Recorded draws, added to the statistics of the runtime each time the command list is executed
+	UINT drawCalls;
+	UINT drawVertices;
 
-	MetaCL() {}
+	MetaCL() : drawCalls(0), drawVertices(0) {}
 
 	void OnDraw(UINT count) {
 
@@ -149,6 +142,7 @@ public:
 					texture->GetDesc(&desc);
 
 					// We could dump all the tracked RTs but that's a lot, limit to the most interesting formats and resolution
+					// The scratch pool only holds 8-bit targets, so G-buffer decode profiles never apply to these snapshots
 					if (desc.Width != BACK_BUFFER_WIDTH || desc.Height != BACK_BUFFER_HEIGHT) continue;
 
 					if (
@@ -169,7 +163,7 @@ public:
 		//}
 	}
 
-	void DumpToDisk(boost::filesystem::path rootPathNoExt, ReShade::Runtimes::D3D11Runtime* runtime) { // path
+	void DumpToDisk(boost::filesystem::path rootPathNoExt, unsigned int bucket, ReShade::Runtimes::D3D11Runtime* runtime) { // path
 
 		if (events.size() == 0 && copiedViews.size() == 0) return;
 
@@ -178,20 +172,32 @@ public:
 		//Write event log
 		boost::filesystem::path logPath = rootPathNoExt / "BucketLog.txt";
 
-		//Make sure parent folder exists
-		boost::system::error_code returnedError;
-		boost::filesystem::create_directories(logPath.parent_path(), returnedError);
+		std::ostringstream log;
+		log << "(Events: " << events.size() << " RT Snapshots: " << copiedViews.size() << ")" << std::endl;
+		for (auto event : events) {
+			log << event.label << std::endl;
+		}
+
+		if (runtime->mTraceBundle) {
+			ReShade::TraceBundle::Record record = { };
+			record.Type = ReShade::TraceBundle::RecordType::Events;
+			record.Bucket = bucket;
 
-		std::ofstream outfile(logPath.string());
-		if (!outfile.is_open()) {
-			LOG(ERROR)<< "Couldn't open text file to write" << logPath.string();
+			const std::string text = log.str();
+			runtime->mTraceBundle->Add(record, runtime->GetTraceName(logPath), text.data(), text.size());
 		} else {
-			LOG(INFO) << "Writing event log: " << logPath.string();
-			outfile << "(Events: " << events.size() << " RT Snapshots: " << copiedViews.size() << ")" << std::endl;
-			for (auto event : events) {
-				outfile << event.label << std::endl;
+			//Make sure parent folder exists
+			boost::system::error_code returnedError;
+			boost::filesystem::create_directories(logPath.parent_path(), returnedError);
+
+			std::ofstream outfile(logPath.string());
+			if (!outfile.is_open()) {
+				LOG(ERROR)<< "Couldn't open text file to write" << logPath.string();
+			} else {
+				LOG(INFO) << "Writing event log: " << logPath.string();
+				outfile << log.str();
+				outfile.close();
 			}
-			outfile.close();
 		}
 
 		//Write images
@@ -201,7 +207,7 @@ public:
 			snprintf(tempChar, 260, "RT_%p_%04d", rt, i);
 			boost::filesystem::path imgPath = rootPathNoExt / std::string(tempChar);
 
-			runtime->DumpReadableTexture2D(imgPath, Pool_RGB8_Typeless_720p.at(i));
+			runtime->DumpReadableTexture2D(imgPath, Pool_RGB8_Typeless_720p.at(i), bucket, i, rt);
 		}
 	}
 
@@ -311,6 +317,7 @@ public:
 	MetaCL* metaCL;
 
 	DefContext(ID3D11DeviceContext* c) : ctx(c), metaCL(nullptr) {}
+	~DefContext() { delete metaCL; }
 
 	void BeginRecording() {
 		if (metaCL) LOG(ERROR) << "Recording a new command list but some metaCL is already present!";
@@ -337,62 +344,95 @@ public:
 };
 
 
-//Hashmap context pointer -> DefContext pointer
-std::unordered_map< ID3D11DeviceContext*, DefContext* > AllDefContexts;
-static DefContext* AllDefContexts_Get(ID3D11DeviceContext* ctx)
+//Registry deferred context pointer -> DefContext pointer, filled when contexts are created and read on every draw
+//Slots are only ever appended, so lookups scan them without taking any lock
+struct DefContextSlot
 {
-	//AllMetaCLsMutex.lock();
-	// Check it's not already present
-	auto item = AllDefContexts.find(ctx);
-	if (item == AllDefContexts.end()) {
-		//AllMetaCLsMutex.unlock();
-		return nullptr;
+	std::atomic<ID3D11DeviceContext*> ctx;
+	std::atomic<DefContext*> defCtx;
+};
+static DefContextSlot AllDefContexts[20]; //Usually 8 in MGSV
+static std::atomic<UINT> AllDefContextsCount(0);
+
+static void AllDefContexts_Add(ID3D11DeviceContext* ctx, DefContext* defCtx)
+{
+	const UINT count = std::min<UINT>(AllDefContextsCount.load(std::memory_order_acquire), ARRAYSIZE(AllDefContexts));
+
+	// A context created at the address of a released one takes over its slot, nothing records the released one anymore
+	for (UINT i = 0; i < count; i++) {
+		if (AllDefContexts[i].ctx.load(std::memory_order_acquire) == ctx) {
+			DefContext* previous = AllDefContexts[i].defCtx.exchange(defCtx, std::memory_order_acq_rel);
+			LOG(INFO) << "Deferred context " << ctx << " reuses the address of a released one, dropping its recording state";
+			delete previous;
+			return;
+		}
 	}
-	else {
-		DefContext* ct = item->second;
-		//AllMetaCLsMutex.unlock();
-		return ct;
+
+	const UINT slot = AllDefContextsCount.fetch_add(1);
+	if (slot >= ARRAYSIZE(AllDefContexts)) {
+		LOG(ERROR) << "Too many deferred contexts, not tracking " << ctx;
+		return;
 	}
-}
 
+	// Publish the context last, so readers finding it also see its recording state
+	AllDefContexts[slot].defCtx.store(defCtx, std::memory_order_relaxed);
+	AllDefContexts[slot].ctx.store(ctx, std::memory_order_release);
+}
 
-static DefContext* GetDefContextIfExists(ID3D11DeviceContext* ctx)
+static DefContext* AllDefContexts_Get(ID3D11DeviceContext* ctx)
 {
-	bool isDeferred = IsContextDeferred(ctx);
-	if (!isDeferred) return nullptr;
-	auto it = AllDefContexts.find(ctx);
-	if (it == AllDefContexts.end()) 
-	{
-		LOG(ERROR) << "Draw call on a context we are not tracking! Ctx: " << ctx;
-		return nullptr;
+	// Games usually record each deferred context on the same worker thread, so remembering the last slot per thread skips the scan
+	static thread_local DefContextSlot* lastSlot = nullptr;
+
+	if (lastSlot && lastSlot->ctx.load(std::memory_order_relaxed) == ctx) {
+		return lastSlot->defCtx.load(std::memory_order_acquire);
 	}
-	DefContext* defCtx = it->second;
-	return defCtx;
+
+	const UINT count = std::min<UINT>(AllDefContextsCount.load(std::memory_order_acquire), ARRAYSIZE(AllDefContexts));
+
+	for (UINT i = 0; i < count; i++) {
+		if (AllDefContexts[i].ctx.load(std::memory_order_acquire) == ctx) {
+			lastSlot = &AllDefContexts[i];
+			return lastSlot->defCtx.load(std::memory_order_acquire);
+		}
+	}
+
+	// The immediate context, or a deferred one which did not fit
+	return nullptr;
 }
 
-static void OnDeferredDraw(ID3D11DeviceContext* ctx, UINT vertCount)
+static void OnDeferredDraw(DefContext* defCtx, UINT vertCount, bool record = true)
 {
-	deferredDrawMutex.lock();
-
-	// Find the defContext
-	// TODO lock this. Might still work since the usual pattern is only concurrent reads. Ok for now
-	auto it = AllDefContexts.find(ctx);
-	if (it == AllDefContexts.end()) 
+	// No locking needed, a deferred context is only ever recorded by one thread at a time
+	if (!defCtx->metaCL) 
 	{
-		LOG(ERROR) << "Draw call on a context we are not tracking! Ctx: " << ctx;
+		LOG(ERROR) << "This deferred context was not recording! Ctx: " << defCtx->ctx;
 		return;
 	}
-	DefContext* defCtx = it->second;
 
-	// Don't need locking here, usually one thread reserved to one deferred context
-	if (!defCtx->metaCL) 
+	defCtx->metaCL->drawCalls++;
+	defCtx->metaCL->drawVertices += vertCount;
+
+	if (record) defCtx->metaCL->OnDraw(vertCount); // todo pass context so we can finish too
+}
+
+// Draws on deferred contexts are counted when their command list is executed instead, so recording threads never take the runtime lock
+static void OnImmediateDraw(ID3D11DeviceContext* pDeviceContext, UINT vertCount)
+{
+	ID3D11Device *device = nullptr;
+	pDeviceContext->GetDevice(&device);
+
+	assert(device != nullptr);
+
+	ReShade::Runtimes::D3D11Runtime *runtime = nullptr;
+	UINT size = sizeof(runtime);
+
+	if (SUCCEEDED(device->GetPrivateData(sRuntimeGUID, &size, reinterpret_cast<void *>(&runtime))))
 	{
-		LOG(ERROR) << "This deferred context was not recording! Ctx: " << ctx;
-		return;
+		runtime->OnDrawInternal(pDeviceContext, vertCount);
 	}
 
-	defCtx->metaCL->OnDraw(vertCount); // todo pass context so we can finish too
-	deferredDrawMutex.unlock();
+	device->Release();
 }
 
 // ID3D11DepthStencilView
@@ -533,6 +573,11 @@ BOOL RestoreContextState)
 	MetaCL* metaCL = AllMetaCLs_SafeGet(pCommandList);
 	if (metaCL) {
 		int clsCount = metaCL->cls.size();
+
+		if (runtime) {
+			runtime->OnDrawCommandList(metaCL->drawVertices, metaCL->drawCalls);
+		}
+
 		//LOG(INFO) << "Will run metadata for CL " << pCommandList << " CLs: " << (clsCount);
 
 		// Run it!
@@ -547,7 +592,7 @@ BOOL RestoreContextState)
 				snprintf(tmp, 260, "%s/%03d_Bucket", runtime->DumpRootPath.string().c_str(), executedCLCount);
 				boost::filesystem::path dumpRoot = tmp;
 				LOG(INFO) << "Dumping metaCL " << metaCL << " into " << dumpRoot.string();
-				metaCL->DumpToDisk(dumpRoot, runtime);
+				metaCL->DumpToDisk(dumpRoot, executedCLCount, runtime);
 			}
 		}
 		else {
@@ -576,7 +621,7 @@ void STDMETHODCALLTYPE ID3D11DeviceDeferredContext_DrawIndexed(ID3D11DeviceConte
 void STDMETHODCALLTYPE ID3D11DeviceContext_DrawIndexed(ID3D11DeviceContext *pDeviceContext, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
 {
 	static const auto trampoline = ReShade::Hooks::Call(&ID3D11DeviceContext_DrawIndexed);
-	bool IsDeffered = IsContextDeferred(pDeviceContext);
+	DefContext* defCtx = AllDefContexts_Get(pDeviceContext);
 	
 	// These are the draw calls corresponding to Ishmael's bandage, just mess with the total triangle count
 	if (IndexCount == 1425 && StartIndexLocation == 61449) {
@@ -587,27 +632,16 @@ void STDMETHODCALLTYPE ID3D11DeviceContext_DrawIndexed(ID3D11DeviceContext *pDev
 		if (IndexCount == 0) return;
 	}
 	
-	//LOG(INFO) << "DrawIndexed." << (IsDeffered? "DEF" : "IM") << " Vertices: " << IndexCount << IndexCount << " Thread: " << GetCurrentThreadId() << " device context: " << pDeviceContext;
-
-	ID3D11Device *device = nullptr;
-	pDeviceContext->GetDevice(&device);
-
-	assert(device != nullptr);
+	//LOG(INFO) << "DrawIndexed." << (defCtx? "DEF" : "IM") << " Vertices: " << IndexCount << IndexCount << " Thread: " << GetCurrentThreadId() << " device context: " << pDeviceContext;
 
-	ReShade::Runtimes::D3D11Runtime *runtime = nullptr;
-	UINT size = sizeof(runtime);
-
-	if (SUCCEEDED(device->GetPrivateData(sRuntimeGUID, &size, reinterpret_cast<void *>(&runtime))))
-	{
-		runtime->OnDrawInternal(pDeviceContext, IndexCount);
+	if (!defCtx) {
+		OnImmediateDraw(pDeviceContext, IndexCount);
 	}
 
-	device->Release();
-
 	trampoline(pDeviceContext, IndexCount, StartIndexLocation, BaseVertexLocation);
 
-	if (IsDeffered) {
-		OnDeferredDraw(pDeviceContext, IndexCount);
+	if (defCtx) {
+		OnDeferredDraw(defCtx, IndexCount);
 	}
 	
 }
@@ -615,85 +649,54 @@ void STDMETHODCALLTYPE ID3D11DeviceContext_Draw(ID3D11DeviceContext *pDeviceCont
 {
 	static const auto trampoline = ReShade::Hooks::Call(&ID3D11DeviceContext_Draw);
 
-	bool IsDeffered = IsContextDeferred(pDeviceContext);
-
-	ID3D11Device *device = nullptr;
-	pDeviceContext->GetDevice(&device);
-
-	assert(device != nullptr);
-
-	ReShade::Runtimes::D3D11Runtime *runtime = nullptr;
-	UINT size = sizeof(runtime);
+	DefContext* defCtx = AllDefContexts_Get(pDeviceContext);
 
-	if (SUCCEEDED(device->GetPrivateData(sRuntimeGUID, &size, reinterpret_cast<void *>(&runtime))))
-	{
-		runtime->OnDrawInternal(pDeviceContext, VertexCount);
+	if (!defCtx) {
+		OnImmediateDraw(pDeviceContext, VertexCount);
 	}
 
-	device->Release();
-
 	trampoline(pDeviceContext, VertexCount, StartVertexLocation);
 
-	if (IsDeffered) {
-		OnDeferredDraw(pDeviceContext, VertexCount);
+	if (defCtx) {
+		OnDeferredDraw(defCtx, VertexCount);
 	}
 }
 void STDMETHODCALLTYPE ID3D11DeviceContext_DrawIndexedInstanced(ID3D11DeviceContext *pDeviceContext, UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
 {
 	static const auto trampoline = ReShade::Hooks::Call(&ID3D11DeviceContext_DrawIndexedInstanced);
 
-	ID3D11Device *device = nullptr;
-	pDeviceContext->GetDevice(&device);
-
-	assert(device != nullptr);
-
-	ReShade::Runtimes::D3D11Runtime *runtime = nullptr;
-	UINT size = sizeof(runtime);
+	DefContext* defCtx = AllDefContexts_Get(pDeviceContext);
 
-	if (SUCCEEDED(device->GetPrivateData(sRuntimeGUID, &size, reinterpret_cast<void *>(&runtime))))
-	{
-		runtime->OnDrawInternal(pDeviceContext, IndexCountPerInstance * InstanceCount);
+	if (defCtx) {
+		OnDeferredDraw(defCtx, IndexCountPerInstance * InstanceCount, false);
+	} else {
+		OnImmediateDraw(pDeviceContext, IndexCountPerInstance * InstanceCount);
 	}
 
-	device->Release();
-
 	trampoline(pDeviceContext, IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 }
 void STDMETHODCALLTYPE ID3D11DeviceContext_DrawInstanced(ID3D11DeviceContext *pDeviceContext, UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
 {
 	static const auto trampoline = ReShade::Hooks::Call(&ID3D11DeviceContext_DrawInstanced);
 
-	ID3D11Device *device = nullptr;
-	pDeviceContext->GetDevice(&device);
-
-	assert(device != nullptr);
+	DefContext* defCtx = AllDefContexts_Get(pDeviceContext);
 
-	ReShade::Runtimes::D3D11Runtime *runtime = nullptr;
-	UINT size = sizeof(runtime);
-
-	if (SUCCEEDED(device->GetPrivateData(sRuntimeGUID, &size, reinterpret_cast<void *>(&runtime))))
-	{
-		runtime->OnDrawInternal(pDeviceContext, VertexCountPerInstance * InstanceCount);
+	if (defCtx) {
+		OnDeferredDraw(defCtx, VertexCountPerInstance * InstanceCount, false);
+	} else {
+		OnImmediateDraw(pDeviceContext, VertexCountPerInstance * InstanceCount);
 	}
 
-	device->Release();
-
 	trampoline(pDeviceContext, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
 }
 void STDMETHODCALLTYPE ID3D11DeviceContext_OMSetRenderTargets(ID3D11DeviceContext *pDeviceContext, UINT NumViews, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView)
 {
 	static const auto trampoline = ReShade::Hooks::Call(&ID3D11DeviceContext_OMSetRenderTargets);
 
-	DefContext* defCtx = GetDefContextIfExists(pDeviceContext);
+	DefContext* defCtx = AllDefContexts_Get(pDeviceContext);
 
 	//LOG(INFO) << "Set RTs. Count: " << NumViews << " DefCtx: " << defCtx << " ctx: " << pDeviceContext;
 
-	for (int i = 0; i < NumViews; i++) {
-		ID3D11RenderTargetView* rt = ppRenderTargetViews[i];
-		if (!rt) continue;
-		defCtx->metaCL->onSetRT(rt);
-	}
-
 	if (defCtx) {
 		for (int i = 0; i < NumViews; i++) {
 			defCtx->metaCL->onSetRT(ppRenderTargetViews[i]);
@@ -726,7 +729,7 @@ void STDMETHODCALLTYPE ID3D11DeviceContext_OMSetRenderTargetsAndUnorderedAccessV
 
 	static const auto trampoline = ReShade::Hooks::Call(&ID3D11DeviceContext_OMSetRenderTargetsAndUnorderedAccessViews);
 
-	DefContext* defCtx = GetDefContextIfExists(pDeviceContext);
+	DefContext* defCtx = AllDefContexts_Get(pDeviceContext);
 
 	if (defCtx) {
 		for (int i = 0; i < NumRTVs; i++) {
@@ -999,16 +1002,14 @@ HRESULT STDMETHODCALLTYPE ID3D11Device_CreateDeferredContext(
 #if 1
 	const HRESULT hr = trampoline(pDevice, ContextFlags, ppDeferredContext);
 
-	//TODO sync this? Expecting deferred context to be created from a single thread... -> single threaded fine for now
-	LOG(INFO) << "Create deferred context. Pointer: " << *ppDeferredContext << " So far seen: " << AllDeferredContextsCount << " On thread: " << GetCurrentThreadId();
+	if (FAILED(hr) || ppDeferredContext == nullptr) return hr;
 
-	AllDeferredContexts[AllDeferredContextsCount] = *ppDeferredContext;
-	AllDeferredContextsCount++;
+	LOG(INFO) << "Create deferred context. Pointer: " << *ppDeferredContext << " So far seen: " << AllDefContextsCount.load() << " On thread: " << GetCurrentThreadId();
 
-	// Also add them to our tracking of CLs
+	// Also add them to our tracking of CLs, recording has to start before the context becomes visible to the draw hooks
 	DefContext* defCtx = new DefContext(*ppDeferredContext);
-	AllDefContexts[*ppDeferredContext] = defCtx;
 	defCtx->BeginRecording();
+	AllDefContexts_Add(*ppDeferredContext, defCtx);
 
 	// TODO handle release/free, but app doesn't use that many contexts
 	//ReShade::Hooks::Register(VTABLE(ppDeferredContext)[12], reinterpret_cast<ReShade::Hook::Function>(&ID3D11DeviceDeferredContext_DrawIndexed));
@@ -1126,11 +1127,7 @@ HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_FinishCommandList(ID3D11DeviceCont
 	
 	//LOG(INFO) << "Request to finish CL on context: " << pDeviceContext << " Restore: " << RestoreDeferredContextState ;
 
-	deferredDrawMutex.lock();
-
-	AllCLsMutex.lock();
-
-	// Tell our metaCL we are done
+	// Tell our metaCL we are done, only the thread recording this context gets here so that needs no lock
 	DefContext* ctx = AllDefContexts_Get(pDeviceContext);
 	MetaCL* metaCL = nullptr;
 	if (!ctx) LOG(ERROR) << "Deferred context not tracked when finishing a command list!";
@@ -1146,6 +1143,8 @@ HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_FinishCommandList(ID3D11DeviceCont
 
 	//LOG(INFO) << "Finish CL. Thread:  " << GetCurrentThreadId() << " Pointer: " << *ppCommandList;
 
+	AllCLsMutex.lock();
+
 	if (*ppCommandList) {
 
 		ReShade::Hooks::Register(VTABLE(*ppCommandList)[2], reinterpret_cast<ReShade::Hook::Function>(&ID3D11CommandList_Release));
@@ -1168,8 +1167,6 @@ HRESULT STDMETHODCALLTYPE ID3D11DeviceContext_FinishCommandList(ID3D11DeviceCont
 	}
 	AllCLsMutex.unlock();
 
-	deferredDrawMutex.unlock();
-
 	return hr;
 }
 
@@ -0,0 +1,736 @@
+#include "ImageEncoder.hpp"
+#include "WorkerThreads.hpp"
+
+#include <thread>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace ReShade
+{
+	namespace
+	{
+		const unsigned int MinRowsPerStrip = 64;
+		const unsigned int ScanlinesPerBlock = 16; // Fixed for ZIP compression of OpenEXR
+
+		const unsigned short LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const unsigned char LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const unsigned short DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const unsigned char DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		class BitWriter
+		{
+		public:
+			explicit BitWriter(std::vector<unsigned char> &output) : mOutput(output), mBuffer(0), mCount(0)
+			{
+			}
+
+			inline void Write(std::uint32_t bits, unsigned int count)
+			{
+				this->mBuffer |= static_cast<std::uint64_t>(bits) << this->mCount;
+				this->mCount += count;
+
+				while (this->mCount >= 8)
+				{
+					this->mOutput.push_back(static_cast<unsigned char>(this->mBuffer));
+					this->mBuffer >>= 8;
+					this->mCount -= 8;
+				}
+			}
+			inline void Align()
+			{
+				if (this->mCount != 0)
+				{
+					Write(0, 8 - this->mCount);
+				}
+			}
+
+		private:
+			std::vector<unsigned char> &mOutput;
+			std::uint64_t mBuffer;
+			unsigned int mCount;
+		};
+
+		// Codes of the fixed Huffman table of deflate, already bit reversed since deflate packs Huffman codes starting at their most significant bit
+		struct FixedCodes
+		{
+			FixedCodes()
+			{
+				for (unsigned int symbol = 0; symbol < 288; ++symbol)
+				{
+					unsigned int code, length;
+
+					if (symbol < 144)
+					{
+						code = 0x30 + symbol, length = 8;
+					}
+					else if (symbol < 256)
+					{
+						code = 0x190 + symbol - 144, length = 9;
+					}
+					else if (symbol < 280)
+					{
+						code = symbol - 256, length = 7;
+					}
+					else
+					{
+						code = 0xC0 + symbol - 280, length = 8;
+					}
+
+					Literals[symbol] = static_cast<unsigned short>(Reverse(code, length));
+					LiteralLengths[symbol] = static_cast<unsigned char>(length);
+				}
+				for (unsigned int symbol = 0; symbol < 30; ++symbol)
+				{
+					Distances[symbol] = static_cast<unsigned char>(Reverse(symbol, 5));
+				}
+				for (unsigned int length = 3, code = 0; length <= 258; ++length)
+				{
+					while (code < 28 && LengthBase[code + 1] <= length)
+					{
+						code++;
+					}
+
+					LengthCodes[length] = static_cast<unsigned char>(code);
+				}
+			}
+
+			static unsigned int Reverse(unsigned int code, unsigned int length)
+			{
+				unsigned int result = 0;
+
+				for (unsigned int i = 0; i < length; ++i)
+				{
+					result = (result << 1) | ((code >> i) & 1);
+				}
+
+				return result;
+			}
+
+			unsigned short Literals[288];
+			unsigned char LiteralLengths[288], Distances[30], LengthCodes[259];
+		};
+
+		const FixedCodes &GetFixedCodes()
+		{
+			static const FixedCodes codes;
+
+			return codes;
+		}
+
+		// Greedy LZ77 with a single hash probe, compressed as one fixed Huffman block, which trades ratio for speed
+		void Deflate(const unsigned char *data, std::size_t size, bool last, std::vector<unsigned char> &output)
+		{
+			const FixedCodes &codes = GetFixedCodes();
+			const unsigned int HashBits = 15, WindowSize = 32768;
+			std::vector<std::uint32_t> table(1 << HashBits, UINT32_MAX);
+
+			BitWriter writer(output);
+			writer.Write(last ? 1 : 0, 1);
+			writer.Write(1, 2);
+
+			std::size_t position = 0;
+
+			while (position < size)
+			{
+				unsigned int length = 0, distance = 0;
+
+				if (position + 4 <= size)
+				{
+					std::uint32_t sequence;
+					std::memcpy(&sequence, data + position, 4);
+
+					const std::uint32_t hash = (sequence * 2654435761u) >> (32 - HashBits);
+					const std::uint32_t candidate = table[hash];
+					table[hash] = static_cast<std::uint32_t>(position);
+
+					if (candidate != UINT32_MAX && position - candidate <= WindowSize && std::memcmp(data + candidate, data + position, 4) == 0)
+					{
+						const std::size_t limit = std::min<std::size_t>(258, size - position);
+
+						length = 4;
+
+						while (length < limit && data[candidate + length] == data[position + length])
+						{
+							length++;
+						}
+
+						distance = static_cast<unsigned int>(position - candidate);
+					}
+				}
+
+				if (length == 0)
+				{
+					writer.Write(codes.Literals[data[position]], codes.LiteralLengths[data[position]]);
+					position++;
+					continue;
+				}
+
+				const unsigned int lengthCode = codes.LengthCodes[length];
+				const unsigned int distanceCode = static_cast<unsigned int>(std::upper_bound(DistanceBase, DistanceBase + 30, distance) - DistanceBase - 1);
+
+				writer.Write(codes.Literals[257 + lengthCode], codes.LiteralLengths[257 + lengthCode]);
+				writer.Write(length - LengthBase[lengthCode], LengthExtra[lengthCode]);
+				writer.Write(codes.Distances[distanceCode], 5);
+				writer.Write(distance - DistanceBase[distanceCode], DistanceExtra[distanceCode]);
+
+				position += length;
+			}
+
+			writer.Write(codes.Literals[256], codes.LiteralLengths[256]);
+
+			// End strips with an empty stored block, so the next one starts on a byte boundary and they can simply be concatenated
+			if (!last)
+			{
+				writer.Write(0, 3);
+				writer.Align();
+				writer.Write(0xFFFF0000, 32);
+			}
+
+			writer.Align();
+		}
+
+		std::uint32_t Adler32(const unsigned char *data, std::size_t size)
+		{
+			std::uint32_t a = 1, b = 0;
+
+			while (size != 0)
+			{
+				// Largest block for which 'b' cannot overflow before the modulo
+				const std::size_t block = std::min<std::size_t>(size, 5552);
+
+				for (std::size_t i = 0; i < block; ++i)
+				{
+					a += data[i];
+					b += a;
+				}
+
+				a %= 65521;
+				b %= 65521;
+				data += block;
+				size -= block;
+			}
+
+			return (b << 16) | a;
+		}
+		std::uint32_t CRC32(const unsigned char *data, std::size_t size, std::uint32_t crc = 0)
+		{
+			static const struct Table
+			{
+				Table()
+				{
+					for (std::uint32_t i = 0; i < 256; ++i)
+					{
+						std::uint32_t value = i;
+
+						for (unsigned int k = 0; k < 8; ++k)
+						{
+							value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+						}
+
+						Values[i] = value;
+					}
+				}
+
+				std::uint32_t Values[256];
+			} table;
+
+			crc = ~crc;
+
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				crc = table.Values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+
+			return ~crc;
+		}
+
+		inline void WriteBigEndian(std::vector<unsigned char> &output, std::uint32_t value)
+		{
+			output.push_back(static_cast<unsigned char>(value >> 24));
+			output.push_back(static_cast<unsigned char>(value >> 16));
+			output.push_back(static_cast<unsigned char>(value >> 8));
+			output.push_back(static_cast<unsigned char>(value));
+		}
+		inline void WriteLittleEndian(std::vector<unsigned char> &output, std::uint64_t value, unsigned int size)
+		{
+			for (unsigned int i = 0; i < size; ++i)
+			{
+				output.push_back(static_cast<unsigned char>(value >> (i * 8)));
+			}
+		}
+		inline std::uint32_t ReadBigEndian(const unsigned char *data)
+		{
+			return (static_cast<std::uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+		}
+		void WriteChunk(std::vector<unsigned char> &output, const char type[4], const unsigned char *data, std::size_t size)
+		{
+			WriteBigEndian(output, static_cast<std::uint32_t>(size));
+
+			const std::size_t start = output.size();
+			output.insert(output.end(), type, type + 4);
+			output.insert(output.end(), data, data + size);
+
+			WriteBigEndian(output, CRC32(output.data() + start, size + 4));
+		}
+	}
+
+	const char *GetImageExtension(ImageFormat format)
+	{
+		switch (format)
+		{
+			case ImageFormat::QOI:
+				return ".qoi";
+			case ImageFormat::EXR:
+				return ".exr";
+			case ImageFormat::PFM:
+				return ".pfm";
+			default:
+				return ".png";
+		}
+	}
+
+	void EncodeFastPNG(const unsigned char *data, unsigned int width, unsigned int height, std::vector<unsigned char> &output)
+	{
+		const std::size_t pitch = width * 4, filteredPitch = pitch + 1;
+		std::vector<unsigned char> filtered(filteredPitch * height);
+
+		// Every row uses the "Sub" filter, subtracting the pixel to the left, 16 bytes at a time
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			const unsigned char *const row = data + y * pitch;
+			unsigned char *const out = filtered.data() + y * filteredPitch;
+
+			out[0] = 1;
+			std::memcpy(out + 1, row, std::min<std::size_t>(4, pitch));
+
+			std::size_t x = 4;
+
+			for (; x + 16 <= pitch; x += 16)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 1 + x), _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x - 4))));
+			}
+			for (; x < pitch; ++x)
+			{
+				out[1 + x] = static_cast<unsigned char>(row[x] - row[x - 4]);
+			}
+		}
+
+		// Compress strips of rows in parallel, each on its own and without references into the previous strip
+		const unsigned int stripCount = GetParallelThreadCount(height / MinRowsPerStrip);
+		std::vector<std::vector<unsigned char>> strips(stripCount);
+		std::vector<std::thread> threads;
+
+		for (unsigned int i = 0; i < stripCount; ++i)
+		{
+			const std::size_t begin = filteredPitch * (height * i / stripCount), end = filteredPitch * (height * (i + 1) / stripCount);
+			const auto compress = [&filtered, &strips, begin, end, i, stripCount]() { Deflate(filtered.data() + begin, end - begin, i + 1 == stripCount, strips[i]); };
+
+			if (i + 1 == stripCount)
+			{
+				compress();
+			}
+			else
+			{
+				threads.emplace_back(compress);
+			}
+		}
+
+		const std::uint32_t adler = Adler32(filtered.data(), filtered.size());
+
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+
+		std::vector<unsigned char> stream;
+		stream.push_back(0x78);
+		stream.push_back(0x01);
+
+		for (const std::vector<unsigned char> &strip : strips)
+		{
+			stream.insert(stream.end(), strip.begin(), strip.end());
+		}
+
+		WriteBigEndian(stream, adler);
+
+		unsigned char header[13] = { };
+		header[0] = static_cast<unsigned char>(width >> 24), header[1] = static_cast<unsigned char>(width >> 16), header[2] = static_cast<unsigned char>(width >> 8), header[3] = static_cast<unsigned char>(width);
+		header[4] = static_cast<unsigned char>(height >> 24), header[5] = static_cast<unsigned char>(height >> 16), header[6] = static_cast<unsigned char>(height >> 8), header[7] = static_cast<unsigned char>(height);
+		header[8] = 8; // Bit depth
+		header[9] = 6; // RGBA
+
+		static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		output.assign(signature, signature + 8);
+		output.reserve(stream.size() + 64);
+
+		WriteChunk(output, "IHDR", header, sizeof(header));
+		WriteChunk(output, "IDAT", stream.data(), stream.size());
+		WriteChunk(output, "IEND", nullptr, 0);
+	}
+	void EncodeQOI(const unsigned char *data, unsigned int width, unsigned int height, std::vector<unsigned char> &output, std::size_t pitch)
+	{
+		if (pitch == 0)
+		{
+			pitch = width * 4;
+		}
+
+		output.clear();
+		output.reserve(14 + width * height * 5 + 8);
+		output.insert(output.end(), { 'q', 'o', 'i', 'f' });
+
+		WriteBigEndian(output, width);
+		WriteBigEndian(output, height);
+
+		output.push_back(4); // RGBA
+		output.push_back(0); // sRGB with linear alpha
+
+		std::uint32_t index[64] = { }, previous = 0xFF000000; // Pixels are read as little-endian, so this is opaque black
+		unsigned int run = 0;
+		const std::size_t count = static_cast<std::size_t>(width) * height;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::uint32_t pixel;
+			std::memcpy(&pixel, data + (i / width) * pitch + (i % width) * 4, 4);
+
+			if (pixel == previous)
+			{
+				if (++run == 62 || i + 1 == count)
+				{
+					output.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+					run = 0;
+				}
+
+				continue;
+			}
+
+			if (run != 0)
+			{
+				output.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			const unsigned char r = pixel & 0xFF, g = (pixel >> 8) & 0xFF, b = (pixel >> 16) & 0xFF, a = pixel >> 24;
+			const unsigned int hash = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+
+			if (index[hash] == pixel)
+			{
+				output.push_back(static_cast<unsigned char>(hash));
+			}
+			else
+			{
+				index[hash] = pixel;
+
+				if (a == (previous >> 24))
+				{
+					const signed char dr = static_cast<signed char>(r - (previous & 0xFF)), dg = static_cast<signed char>(g - ((previous >> 8) & 0xFF)), db = static_cast<signed char>(b - ((previous >> 16) & 0xFF));
+					const int dgr = dr - dg, dgb = db - dg;
+
+					if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					{
+						output.push_back(static_cast<unsigned char>(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+					}
+					else if (dgr >= -8 && dgr <= 7 && dg >= -32 && dg <= 31 && dgb >= -8 && dgb <= 7)
+					{
+						output.push_back(static_cast<unsigned char>(0x80 | (dg + 32)));
+						output.push_back(static_cast<unsigned char>(((dgr + 8) << 4) | (dgb + 8)));
+					}
+					else
+					{
+						output.insert(output.end(), { 0xFE, r, g, b });
+					}
+				}
+				else
+				{
+					output.insert(output.end(), { 0xFF, r, g, b, a });
+				}
+			}
+
+			previous = pixel;
+		}
+
+		output.insert(output.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	}
+
+	bool DecodeQOI(const unsigned char *data, std::size_t size, unsigned int width, unsigned int height, unsigned char *output, std::size_t pitch)
+	{
+		if (pitch == 0)
+		{
+			pitch = width * 4;
+		}
+
+		if (size < 14 + 8 || std::memcmp(data, "qoif", 4) != 0 || ReadBigEndian(data + 4) != width || ReadBigEndian(data + 8) != height)
+		{
+			return false;
+		}
+
+		unsigned char index[64][4] = { }, pixel[4] = { 0, 0, 0, 0xFF };
+		unsigned int run = 0;
+		std::size_t position = 14;
+		const std::size_t count = static_cast<std::size_t>(width) * height, end = size - 8;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (run != 0)
+			{
+				run--;
+			}
+			else
+			{
+				if (position >= end)
+				{
+					return false;
+				}
+
+				const unsigned char tag = data[position++];
+
+				if (tag == 0xFE || tag == 0xFF)
+				{
+					const std::size_t length = tag == 0xFE ? 3 : 4;
+
+					if (position + length > end)
+					{
+						return false;
+					}
+
+					std::memcpy(pixel, data + position, length);
+					position += length;
+				}
+				else if ((tag >> 6) == 0)
+				{
+					std::memcpy(pixel, index[tag], 4);
+				}
+				else if ((tag >> 6) == 1)
+				{
+					pixel[0] += ((tag >> 4) & 3) - 2;
+					pixel[1] += ((tag >> 2) & 3) - 2;
+					pixel[2] += (tag & 3) - 2;
+				}
+				else if ((tag >> 6) == 2)
+				{
+					if (position >= end)
+					{
+						return false;
+					}
+
+					const int dg = (tag & 0x3F) - 32, extra = data[position++];
+
+					pixel[0] += dg - 8 + (extra >> 4);
+					pixel[1] += dg;
+					pixel[2] += dg - 8 + (extra & 0xF);
+				}
+				else
+				{
+					run = tag & 0x3F;
+				}
+
+				std::memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+			}
+
+			std::memcpy(output + (i / width) * pitch + (i % width) * 4, pixel, 4);
+		}
+
+		return true;
+	}
+	void EncodeEXR(const void *data, unsigned int width, unsigned int height, unsigned int channels, bool half, std::vector<unsigned char> &output)
+	{
+		const std::size_t componentSize = half ? 2 : 4;
+		const unsigned int blockCount = (height + ScanlinesPerBlock - 1) / ScanlinesPerBlock;
+		std::vector<std::vector<unsigned char>> blocks(blockCount);
+
+		// Channels are stored in alphabetical order of their names, which is the reverse of RGBA
+		const auto compress = [data, width, height, channels, componentSize, &blocks](unsigned int begin, unsigned int end)
+		{
+			std::vector<unsigned char> raw, split;
+
+			for (unsigned int block = begin; block < end; ++block)
+			{
+				const unsigned int top = block * ScanlinesPerBlock, rows = std::min(ScanlinesPerBlock, height - top);
+				raw.resize(rows * width * channels * componentSize);
+
+				unsigned char *out = raw.data();
+
+				for (unsigned int y = top; y < top + rows; ++y)
+				{
+					const unsigned char *const row = static_cast<const unsigned char *>(data) + y * width * 4 * componentSize;
+
+					for (unsigned int channel = channels; channel-- > 0; )
+					{
+						for (unsigned int x = 0; x < width; ++x, out += componentSize)
+						{
+							std::memcpy(out, row + (x * 4 + channel) * componentSize, componentSize);
+						}
+					}
+				}
+
+				// Separate low and high bytes and store the difference to the previous byte, like the reference implementation does before deflating
+				const std::size_t size = raw.size(), halfSize = (size + 1) / 2;
+				split.resize(size);
+
+				for (std::size_t i = 0; i < size; ++i)
+				{
+					split[(i & 1) ? halfSize + i / 2 : i / 2] = raw[i];
+				}
+				for (std::size_t i = size; i-- > 1; )
+				{
+					split[i] = static_cast<unsigned char>(split[i] - split[i - 1] + 128);
+				}
+
+				std::vector<unsigned char> &encoded = blocks[block];
+				encoded.push_back(0x78);
+				encoded.push_back(0x01);
+				Deflate(split.data(), size, true, encoded);
+				WriteBigEndian(encoded, Adler32(split.data(), size));
+
+				// Blocks that do not get smaller are stored uncompressed, readers detect that from the size
+				if (encoded.size() >= size)
+				{
+					encoded = raw;
+				}
+			}
+		};
+
+		const unsigned int threadCount = GetParallelThreadCount(height / MinRowsPerStrip);
+		std::vector<std::thread> threads;
+
+		for (unsigned int i = 0; i < threadCount; ++i)
+		{
+			const unsigned int begin = blockCount * i / threadCount, end = blockCount * (i + 1) / threadCount;
+
+			if (i + 1 == threadCount)
+			{
+				compress(begin, end);
+			}
+			else
+			{
+				threads.emplace_back(compress, begin, end);
+			}
+		}
+
+		static const char *const names[4] = { "R", "G", "B", "A" };
+
+		std::vector<unsigned char> channelList;
+
+		for (unsigned int channel = channels; channel-- > 0; )
+		{
+			const char *const name = channels == 1 ? "Y" : names[channel];
+
+			channelList.insert(channelList.end(), name, name + std::strlen(name) + 1);
+			WriteLittleEndian(channelList, half ? 1 : 2, 4); // Pixel type
+			WriteLittleEndian(channelList, 0, 4); // Linear flag and reserved bytes
+			WriteLittleEndian(channelList, 1, 4); // X sampling
+			WriteLittleEndian(channelList, 1, 4); // Y sampling
+		}
+
+		channelList.push_back(0);
+
+		const auto writeAttribute = [&output](const char *name, const char *type, const std::vector<unsigned char> &value)
+		{
+			output.insert(output.end(), name, name + std::strlen(name) + 1);
+			output.insert(output.end(), type, type + std::strlen(type) + 1);
+			WriteLittleEndian(output, value.size(), 4);
+			output.insert(output.end(), value.begin(), value.end());
+		};
+
+		std::vector<unsigned char> window;
+		WriteLittleEndian(window, 0, 4);
+		WriteLittleEndian(window, 0, 4);
+		WriteLittleEndian(window, width - 1, 4);
+		WriteLittleEndian(window, height - 1, 4);
+
+		const std::vector<unsigned char> compression(1, 3), lineOrder(1, 0), one = { 0x00, 0x00, 0x80, 0x3F }, center(8, 0);
+
+		output.assign({ 0x76, 0x2F, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00 });
+
+		writeAttribute("channels", "chlist", channelList);
+		writeAttribute("compression", "compression", compression);
+		writeAttribute("dataWindow", "box2i", window);
+		writeAttribute("displayWindow", "box2i", window);
+		writeAttribute("lineOrder", "lineOrder", lineOrder);
+		writeAttribute("pixelAspectRatio", "float", one);
+		writeAttribute("screenWindowCenter", "v2f", center);
+		writeAttribute("screenWindowWidth", "float", one);
+		output.push_back(0);
+
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+
+		// Offset table of all blocks, followed by the blocks themselves
+		std::uint64_t offset = output.size() + blockCount * 8;
+
+		for (const std::vector<unsigned char> &block : blocks)
+		{
+			WriteLittleEndian(output, offset, 8);
+			offset += 8 + block.size();
+		}
+
+		output.reserve(offset);
+
+		for (unsigned int block = 0; block < blockCount; ++block)
+		{
+			WriteLittleEndian(output, block * ScanlinesPerBlock, 4);
+			WriteLittleEndian(output, blocks[block].size(), 4);
+			output.insert(output.end(), blocks[block].begin(), blocks[block].end());
+		}
+	}
+	void EncodePFM(const float *data, unsigned int width, unsigned int height, unsigned int channels, std::vector<unsigned char> &output)
+	{
+		const unsigned int components = channels == 1 ? 1 : 3;
+
+		// A negative scale marks little-endian data
+		const std::string header = std::string(components == 1 ? "Pf" : "PF") + '\n' + std::to_string(width) + ' ' + std::to_string(height) + "\n-1.0\n";
+
+		output.assign(header.begin(), header.end());
+		output.resize(header.size() + width * height * components * 4);
+
+		unsigned char *out = output.data() + header.size();
+
+		// Rows are stored from bottom to top
+		for (unsigned int y = height; y-- > 0; )
+		{
+			const float *const row = data + y * width * 4;
+
+			for (unsigned int x = 0; x < width; ++x, out += components * 4)
+			{
+				std::memcpy(out, row + x * 4, components * 4);
+			}
+		}
+	}
+
+	void ComputeDelta(const unsigned char *current, unsigned char *previous, unsigned char *delta, std::size_t size)
+	{
+		std::size_t i = 0;
+
+		for (; i + 16 <= size; i += 16)
+		{
+			const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(current + i));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(delta + i), _mm_sub_epi8(value, _mm_loadu_si128(reinterpret_cast<const __m128i *>(previous + i))));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(previous + i), value);
+		}
+		for (; i < size; ++i)
+		{
+			delta[i] = static_cast<unsigned char>(current[i] - previous[i]);
+			previous[i] = current[i];
+		}
+	}
+	void ApplyDelta(unsigned char *data, const unsigned char *delta, std::size_t size)
+	{
+		std::size_t i = 0;
+
+		for (; i + 16 <= size; i += 16)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(delta + i))));
+		}
+		for (; i < size; ++i)
+		{
+			data[i] += delta[i];
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+namespace ReShade
+{
+	enum class ImageFormat
+	{
+		PNG,		// Reference PNG encoder of stb, smallest files
+		FastPNG,	// PNG with a fixed filter and a greedy deflate running on row strips in parallel
+		QOI,		// "Quite OK Image" format, a few times faster than even the fast PNG path at similar sizes
+		EXR,		// OpenEXR with ZIP compression, keeps the values of float render targets
+		PFM			// Portable float map, uncompressed 32-bit float
+	};
+
+	/*
+	 * Lossless encoders for 8-bit RGBA images, used for dumps where encoding speed matters more than file size.
+	 * The pitch is the distance between rows in bytes, zero means they are tightly packed.
+	 */
+	const char *GetImageExtension(ImageFormat format);
+	void EncodeFastPNG(const unsigned char *data, unsigned int width, unsigned int height, std::vector<unsigned char> &output);
+	void EncodeQOI(const unsigned char *data, unsigned int width, unsigned int height, std::vector<unsigned char> &output, std::size_t pitch = 0);
+	bool DecodeQOI(const unsigned char *data, std::size_t size, unsigned int width, unsigned int height, unsigned char *output, std::size_t pitch = 0);
+
+	/*
+	 * Lossless encoders for float images with tightly packed rows of RGBA texels, of which only the first channels are written (a single channel is stored as luminance).
+	 * 'EncodeEXR' takes half precision data if 'half' is set and 32-bit float otherwise, blocks of scanlines are compressed in parallel.
+	 */
+	void EncodeEXR(const void *data, unsigned int width, unsigned int height, unsigned int channels, bool half, std::vector<unsigned char> &output);
+	void EncodePFM(const float *data, unsigned int width, unsigned int height, unsigned int channels, std::vector<unsigned char> &output);
+
+	/*
+	 * Byte-wise difference between successive frames of a stream, which is mostly zero and therefore compresses into long QOI runs.
+	 * 'ComputeDelta' also replaces 'previous' with 'current', 'ApplyDelta' turns the previous frame into the current one.
+	 */
+	void ComputeDelta(const unsigned char *current, unsigned char *previous, unsigned char *delta, std::size_t size);
+	void ApplyDelta(unsigned char *data, const unsigned char *delta, std::size_t size);
+}
\ No newline at end of file
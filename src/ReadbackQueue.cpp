@@ -0,0 +1,152 @@
+#include "ReadbackQueue.hpp"
+
+#include <algorithm>
+
+namespace ReShade
+{
+	ReadbackQueue::ReadbackQueue(Backend &backend, unsigned int latency, std::size_t capacity) : mBackend(backend), mLatency(latency), mCapacity(std::max<std::size_t>(capacity, 1)), mStagingCount(0), mFrame(0), mStalls(0), mDrops(0)
+	{
+	}
+	ReadbackQueue::~ReadbackQueue()
+	{
+		Clear();
+	}
+
+	bool ReadbackQueue::Enqueue(void *source, const Description &desc, Callback callback)
+	{
+		Staging staging = { nullptr, desc };
+
+		while (true)
+		{
+			const auto it = std::find_if(this->mFree.begin(), this->mFree.end(), [&desc](const Staging &free) { return free.Desc == desc; });
+
+			if (it != this->mFree.end())
+			{
+				staging = *it;
+				this->mFree.erase(it);
+				break;
+			}
+
+			// Exceed the capacity rather than dead lock when a completion callback enqueues while everything else is in use
+			if (this->mStagingCount < this->mCapacity || (this->mPending.empty() && this->mFree.empty()))
+			{
+				staging.Resource = this->mBackend.CreateStaging(desc);
+
+				if (staging.Resource == nullptr)
+				{
+					return false;
+				}
+
+				this->mStagingCount++;
+				break;
+			}
+
+			// The pool is full, make room by finishing the oldest request if the GPU is done with it or by dropping an unused resource of another size
+			if (!this->mPending.empty() && CompleteFront(false))
+			{
+				continue;
+			}
+
+			if (this->mFree.empty())
+			{
+				// Waiting here could stall on a copy made earlier in this very frame
+				this->mDrops++;
+				return false;
+			}
+
+			this->mBackend.DestroyStaging(this->mFree.front().Resource);
+			this->mFree.erase(this->mFree.begin());
+			this->mStagingCount--;
+		}
+
+		this->mBackend.Copy(staging.Resource, source);
+
+		Request request;
+		request.Target = staging;
+		request.Frame = this->mFrame;
+		request.Complete = std::move(callback);
+
+		this->mPending.push_back(std::move(request));
+
+		return true;
+	}
+	void ReadbackQueue::Update()
+	{
+		this->mFrame++;
+
+		// The GPU finishes copies in order, so the first one still pending means the ones after it are too
+		while (!this->mPending.empty())
+		{
+			if (!CompleteFront(this->mFrame - this->mPending.front().Frame >= this->mLatency))
+			{
+				break;
+			}
+		}
+	}
+	void ReadbackQueue::Flush()
+	{
+		while (!this->mPending.empty())
+		{
+			CompleteFront(true);
+		}
+	}
+	void ReadbackQueue::Clear()
+	{
+		for (Request &request : this->mPending)
+		{
+			this->mFree.push_back(request.Target);
+
+			request.Complete(nullptr, 0);
+		}
+
+		this->mPending.clear();
+
+		for (const Staging &staging : this->mFree)
+		{
+			this->mBackend.DestroyStaging(staging.Resource);
+		}
+
+		this->mFree.clear();
+		this->mStagingCount = 0;
+	}
+
+	bool ReadbackQueue::CompleteFront(bool wait)
+	{
+		Request &request = this->mPending.front();
+
+		const unsigned char *data = nullptr;
+		std::size_t pitch = 0;
+		Backend::MapResult result = this->mBackend.Map(request.Target.Resource, false, data, pitch);
+
+		if (result == Backend::MapResult::Pending)
+		{
+			if (!wait)
+			{
+				return false;
+			}
+
+			this->mStalls++;
+
+			result = this->mBackend.Map(request.Target.Resource, true, data, pitch);
+		}
+
+		// Take the request out of the queue first, so callbacks may enqueue new ones
+		Request completed = std::move(request);
+		this->mPending.pop_front();
+
+		if (result == Backend::MapResult::Ready)
+		{
+			completed.Complete(data, pitch);
+
+			this->mBackend.Unmap(completed.Target.Resource);
+		}
+		else
+		{
+			completed.Complete(nullptr, 0);
+		}
+
+		this->mFree.push_back(completed.Target);
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <functional>
+
+namespace ReShade
+{
+	/*
+	 * Reads resources back from the GPU without stalling: Copies go into a pool of staging resources and are only mapped once the GPU finished them, which is polled every frame.
+	 * Requests complete in the order they were made, a request still pending after 'latency' frames is waited for.
+	 * Enqueuing never waits for the GPU: When all staging resources are in use by copies that did not finish yet, the request is dropped and 'Enqueue' fails.
+	 * All graphics API calls go through 'Backend', so the scheduling does not depend on a device and runs entirely on the render thread.
+	 */
+	class ReadbackQueue
+	{
+	public:
+		struct Description
+		{
+			unsigned int Width, Height, Format;
+
+			inline bool operator==(const Description &other) const
+			{
+				return this->Width == other.Width && this->Height == other.Height && this->Format == other.Format;
+			}
+		};
+
+		typedef std::function<void(const unsigned char *data, std::size_t pitch)> Callback; // 'data' is null when the readback failed
+
+		class Backend
+		{
+		public:
+			enum class MapResult
+			{
+				Ready,
+				Pending, // GPU did not finish the copy yet, only returned when not waiting
+				Failed
+			};
+
+			virtual ~Backend() { }
+
+			virtual void *CreateStaging(const Description &desc) = 0;
+			virtual void DestroyStaging(void *staging) = 0;
+			virtual void Copy(void *staging, void *source) = 0;
+			virtual MapResult Map(void *staging, bool wait, const unsigned char *&data, std::size_t &pitch) = 0;
+			virtual void Unmap(void *staging) = 0;
+		};
+
+		ReadbackQueue(Backend &backend, unsigned int latency, std::size_t capacity);
+		~ReadbackQueue();
+
+		inline std::size_t GetPendingCount() const
+		{
+			return this->mPending.size();
+		}
+		inline unsigned long long GetStallCount() const
+		{
+			return this->mStalls;
+		}
+		inline unsigned long long GetDropCount() const
+		{
+			return this->mDrops;
+		}
+
+		bool Enqueue(void *source, const Description &desc, Callback callback);
+		void Update(); // Once per frame
+		void Flush(); // Completes all requests, waiting for the GPU
+		void Clear(); // Completes all requests as failed and destroys all staging resources
+
+	private:
+		struct Staging
+		{
+			void *Resource;
+			Description Desc;
+		};
+		struct Request
+		{
+			Staging Target;
+			unsigned long long Frame;
+			Callback Complete;
+		};
+
+		bool CompleteFront(bool wait);
+
+		Backend &mBackend;
+		unsigned int mLatency;
+		std::size_t mCapacity, mStagingCount;
+		unsigned long long mFrame, mStalls, mDrops;
+		std::deque<Request> mPending;
+		std::vector<Staging> mFree;
+	};
+}
\ No newline at end of file
@@ -5,11 +5,12 @@
 #include "EffectParser.hpp"
 #include "EffectLexer.h"
 #include "FileWatcher.hpp"
+#include "StatisticsPage.hpp"
+#include "TraceProfiler.hpp"
 
-#include <stb_dxt.h>
 #include <stb_image.h>
 #include <stb_image_write.h>
-#include <stb_image_resize.h>
+#include <boost\algorithm\string\trim.hpp>
 #include <boost\algorithm\string\replace.hpp>
 #include <boost\algorithm\string\predicate.hpp>
 #include <boost\filesystem\path.hpp>
@@ -62,11 +63,14 @@ namespace ReShade
 			}
 		};
 
+		static KeyMgt F7Key(VK_F7);
+		static KeyMgt F8Key(VK_F8);
 		static KeyMgt F9Key(VK_F9);
 		static KeyMgt F10Key(VK_F10);
 		static KeyMgt F11Key(VK_F11);
 		static KeyMgt F12Key(VK_F12);
 		static KeyMgt SnapshotKey(VK_SNAPSHOT);
+		static KeyMgt StreamKey(VK_SCROLL);
 
 		boost::filesystem::path ObfuscatePath(const boost::filesystem::path &path)
 		{
@@ -92,6 +96,27 @@ namespace ReShade
 			return path;
 		}
 
+		inline bool IsScheduled(const Effect::Technique::Schedule &schedule, unsigned long long frame)
+		{
+			return frame % schedule.Interval == schedule.Phase;
+		}
+		inline bool IsScheduled(const Effect::Technique::Schedule &schedule, unsigned long long frame, unsigned int demotion)
+		{
+			// Only passes that are amortized already keep their results around between runs, so only those can be stretched any further
+			return schedule.Interval == 1 ? IsScheduled(schedule, frame) : frame % (schedule.Interval * demotion) == schedule.Phase;
+		}
+		unsigned int GreatestCommonDivisor(unsigned int a, unsigned int b)
+		{
+			while (b != 0)
+			{
+				const unsigned int t = a % b;
+				a = b;
+				b = t;
+			}
+
+			return a;
+		}
+
 		FileWatcher *sEffectWatcher = nullptr;
 		boost::filesystem::path sExecutablePath, sInjectorPath, sEffectPath;
 	}
@@ -163,10 +188,49 @@ namespace ReShade
 
 	// -----------------------------------------------------------------------------------------------------
 
-	Runtime::Runtime() : mWidth(0), mHeight(0), mVendorId(0), mDeviceId(0), mRendererId(0), mLastFrameCount(0), mLastDrawCalls(0), mLastDrawCallVertices(0), mDate(), mCompileStep(0), mNVG(nullptr), mShowStatistics(false)
+	bool Runtime::TechniqueInfo::IsDemotable() const
+	{
+		return this->Demotion < MaxDemotion && std::any_of(this->Schedules.begin(), this->Schedules.end(), [](const Effect::Technique::Schedule &schedule) { return schedule.Interval > 1; });
+	}
+	float Runtime::TechniqueInfo::GetAverageCost() const
+	{
+		// CPU and GPU work of a technique overlap, so whichever side takes longer is what it adds to the frame
+		return std::max(GetAverageCPUCost(), GetAverageGPUCost());
+	}
+	float Runtime::TechniqueInfo::GetAverageCPUCost() const
+	{
+		float total = 0.0f;
+
+		for (float cost : this->Costs)
+		{
+			total += cost;
+		}
+
+		return total / CostWindow;
+	}
+	float Runtime::TechniqueInfo::GetAverageGPUCost() const
+	{
+		float total = 0.0f;
+
+		for (float cost : this->GPUCosts)
+		{
+			total += cost;
+		}
+
+		return total / CostWindow;
+	}
+
+	Runtime::Runtime() : mWidth(0), mHeight(0), mVendorId(0), mDeviceId(0), mRendererId(0), mLastFrameCount(0), mLastBudgetChange(0), mBudget(0.0f), mTraceFrames(60), mStreamFrameCount(300), mStreamFrameInterval(1), mDumpFormat(ImageFormat::FastPNG), mDumpBundle(false), mDumpTiles(false), mLastDrawCalls(0), mLastDrawCallVertices(0), mDate(), mCompileStep(0), mNVG(nullptr), mShowStatistics(false)
 	{
 		this->mStatus = "Initializing ...";
 		this->mStartTime = boost::chrono::high_resolution_clock::now();
+
+		this->mStatisticsPage.reset(new StatisticsPage(::GetCurrentProcessId()));
+
+		if (!this->mStatisticsPage->IsValid())
+		{
+			this->mStatisticsPage.reset();
+		}
 	}
 	Runtime::~Runtime()
 	{
@@ -206,20 +270,24 @@ namespace ReShade
 		}
 
 		this->mTechniques.clear();
+		this->mTextureLoader.Cancel();
 
 		this->mEffect.reset();
 
 		LOG(INFO) << "Destroyed effect environment on context " << this << ".";
 	}
-	void Runtime::OnDraw(unsigned int vertices)
+	void Runtime::OnDraw(unsigned int vertices, unsigned int drawCalls)
 	{
-		this->mLastDrawCalls++;
+		this->mLastDrawCalls += drawCalls;
 		this->mLastDrawCallVertices += vertices;
 	}
 	void Runtime::OnPostProcess()
 	{
+		const TraceProfiler::Scope scope("Runtime::OnPostProcess");
 		const auto timePostProcessingStarted = boost::chrono::high_resolution_clock::now();
 
+		this->mEffect->BeginTimings(this->mLastFrameCount);
+
 		for (TechniqueInfo &info : this->mTechniques)
 		{
 			if (info.ToggleTime != 0 && info.ToggleTime == static_cast<int>(this->mDate[3]))
@@ -227,12 +295,16 @@ namespace ReShade
 				info.Enabled = !info.Enabled;
 				info.Timeleft = info.Timeout;
 				info.ToggleTime = 0;
+
+				this->mSpikeRecorder.AddEvent(SpikeRecorder::TechniqueToggled);
 			}
 			else if ((info.Toggle > 0 && info.Toggle < 256) && ::GetKeyState(info.Toggle) & 0x8000)
 			{
 				info.Enabled = !info.Enabled;
 				info.Timeleft = info.Timeout;
 
+				this->mSpikeRecorder.AddEvent(SpikeRecorder::TechniqueToggled);
+
 				BYTE keys[256];
 				::GetKeyboardState(keys);
 				keys[info.Toggle] = FALSE;
@@ -247,18 +319,44 @@ namespace ReShade
 				{
 					info.Enabled = !info.Enabled;
 					info.Timeleft = 0;
+
+					this->mSpikeRecorder.AddEvent(SpikeRecorder::TechniqueToggled);
 				}
 			}
 
+			const unsigned long long frame = this->mLastFrameCount;
+
+			// Techniques shed by the budget governor keep their last measured cost, so it can decide when they fit again
+			if (info.Shed)
+			{
+				continue;
+			}
+
+			info.Costs[frame % TechniqueInfo::CostWindow] = 0.0f;
+
 			if (!info.Enabled)
 			{
 				continue;
 			}
 
+			// Amortized techniques keep the results of their previous run on frames where nothing is due
+			if (std::none_of(info.Schedules.begin(), info.Schedules.end(), [frame, &info](const Effect::Technique::Schedule &schedule) { return IsScheduled(schedule, frame, info.Demotion); }))
+			{
+				continue;
+			}
+
+			const TraceProfiler::Scope techniqueScope("Technique", info.Name.c_str());
+			const auto timeTechniqueStarted = boost::chrono::high_resolution_clock::now();
+
 			this->mEffect->Begin();
 
 			for (unsigned int i = 0, passes = info.Technique->GetDescription().Passes; i < passes; ++i)
 			{
+				if (!IsScheduled(info.Schedules[i], frame, info.Demotion))
+				{
+					continue;
+				}
+
 				#pragma region Update Constants
 				for (const std::string &name : this->mEffect->GetConstants())
 				{
@@ -349,13 +447,116 @@ namespace ReShade
 				}
 				#pragma endregion
 
+				const TraceProfiler::Scope passScope("Pass", info.Name.c_str(), i);
+
 				info.Technique->RenderPass(i);
+
+				this->mEffect->TimePass(static_cast<unsigned int>(&info - this->mTechniques.data()), i);
 			}
 
 			this->mEffect->End();
+
+			info.Costs[frame % TechniqueInfo::CostWindow] = boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::high_resolution_clock::now() - timeTechniqueStarted).count() * 1e-6f;
 		}
 
 		this->mLastPostProcessingDuration = boost::chrono::high_resolution_clock::now() - timePostProcessingStarted;
+
+		this->mEffect->EndTimings();
+
+		unsigned long long timedFrame;
+		std::vector<Effect::PassTiming> timings;
+
+		while (this->mEffect->GetTimings(timedFrame, timings))
+		{
+			for (TechniqueInfo &info : this->mTechniques)
+			{
+				if (!info.Shed)
+				{
+					info.GPUCosts[timedFrame % TechniqueInfo::CostWindow] = 0.0f;
+				}
+			}
+			for (const Effect::PassTiming &timing : timings)
+			{
+				if (timing.Technique < this->mTechniques.size())
+				{
+					this->mTechniques[timing.Technique].GPUCosts[timedFrame % TechniqueInfo::CostWindow] += timing.Duration;
+				}
+			}
+		}
+
+		UpdateBudget();
+	}
+	void Runtime::UpdateBudget()
+	{
+		// Wait for a full window of measurements after every change, so the averages reflect the new set of techniques before deciding again
+		if (this->mBudget <= 0.0f || this->mLastFrameCount - this->mLastBudgetChange < TechniqueInfo::CostWindow)
+		{
+			return;
+		}
+
+		float total = 0.0f;
+		TechniqueInfo *shed = nullptr, *restore = nullptr;
+
+		for (TechniqueInfo &info : this->mTechniques)
+		{
+			// Shed techniques come back first, then demoted ones get their full rate back
+			if (info.Shed || info.Demotion > 1)
+			{
+				if (restore == nullptr || info.Shed > restore->Shed || (info.Shed == restore->Shed && info.Priority > restore->Priority))
+				{
+					restore = &info;
+				}
+			}
+
+			if (!info.Shed && info.Enabled)
+			{
+				total += info.GetAverageCost();
+
+				if (shed == nullptr || info.Priority < shed->Priority || (info.Priority == shed->Priority && info.GetAverageCost() > shed->GetAverageCost()))
+				{
+					shed = &info;
+				}
+			}
+		}
+
+		// A technique is demoted by running its amortized passes less often for as long as possible, and only skipped entirely after that
+		if (total > this->mBudget && shed != nullptr)
+		{
+			if (shed->IsDemotable())
+			{
+				shed->Demotion *= 2;
+
+				LOG(INFO) << "Post-processing took " << total << "ms, exceeding the budget of " << this->mBudget << "ms. Demoting technique '" << shed->Name << "' to a " << shed->Demotion << "x longer interval ...";
+			}
+			else
+			{
+				shed->Shed = true;
+
+				LOG(INFO) << "Post-processing took " << total << "ms, exceeding the budget of " << this->mBudget << "ms. Shedding technique '" << shed->Name << "' ...";
+			}
+
+			this->mSpikeRecorder.AddEvent(SpikeRecorder::TechniqueShed);
+			this->mLastBudgetChange = this->mLastFrameCount;
+		}
+		// Only bring a technique back with some headroom left, or it would be shed again right away (halving the demotion at most doubles the amortized cost)
+		else if (restore != nullptr && total + restore->GetAverageCost() < this->mBudget * 0.8f)
+		{
+			if (restore->Shed)
+			{
+				restore->Shed = false;
+
+				LOG(INFO) << "Post-processing is back within the budget of " << this->mBudget << "ms. Restoring technique '" << restore->Name << "' ...";
+			}
+			else
+			{
+				restore->Demotion /= 2;
+
+				LOG(INFO) << "Post-processing is back within the budget of " << this->mBudget << "ms. Promoting technique '" << restore->Name << "' to a " << restore->Demotion << "x interval ...";
+			}
+
+			this->mSpikeRecorder.AddEvent(SpikeRecorder::TechniqueRestored);
+			this->mLastBudgetChange = this->mLastFrameCount;
+		}
 	}
 	void Runtime::OnPresent()
 	{
@@ -366,10 +567,36 @@ namespace ReShade
 		tm tm;
 		::localtime_s(&tm, &time);
 
+		// Finishing a running trace capture, this happens before any new events of the current frame are recorded
+		if (TraceProfiler::EndFrame())
+		{
+			char timeString[128];
+			std::strftime(timeString, 128, "%Y-%m-%d %H-%M-%S", &tm);
+			const boost::filesystem::path path = sExecutablePath.parent_path() / (sExecutablePath.stem().string() + " trace " + timeString + ".json");
+
+			if (TraceProfiler::Save(path))
+			{
+				LOG(INFO) << "Saved trace of " << this->mTraceFrames << " frames to " << ObfuscatePath(path) << ".";
+			}
+			else
+			{
+				LOG(ERROR) << "Failed to save trace to " << ObfuscatePath(path) << "!";
+			}
+		}
+
+		const TraceProfiler::Scope scope("Runtime::OnPresent");
+
 		// Check for file modifications
 		std::vector<boost::filesystem::path> modifications;
+		bool modified;
 
-		if (sEffectWatcher->GetModifications(modifications))
+		{
+			const TraceProfiler::Scope watchScope("FileWatcher::GetModifications");
+
+			modified = sEffectWatcher->GetModifications(modifications);
+		}
+
+		if (modified)
 		{
 			for (const auto &path : modifications)
 			{
@@ -380,6 +607,7 @@ namespace ReShade
 					LOG(INFO) << "Detected modification to " << ObfuscatePath(path) << ". Reloading ...";
 
 					this->mCompileStep = 1;
+					this->mSpikeRecorder.AddEvent(SpikeRecorder::FileModified);
 					break;
 				}
 			}
@@ -387,6 +615,8 @@ namespace ReShade
 
 		if (this->mCompileStep != 0)
 		{
+			const TraceProfiler::Scope compileScope("Runtime::CompileStep", this->mCompileStep == 2 ? "LoadEffect" : this->mCompileStep == 4 ? "CompileEffect" : this->mCompileStep == 5 ? "ProcessEffect" : nullptr);
+
 			this->mLastCreate = timePresent;
 
 			switch (this->mCompileStep)
@@ -397,6 +627,7 @@ namespace ReShade
 					break;
 				case 2:
 					this->mCompileStep = LoadEffect() ? 3 : 0;
+					this->mSpikeRecorder.AddEvent(SpikeRecorder::EffectLoaded);
 					break;
 				case 3:
 					this->mStatus = "Compiling effect ...";
@@ -404,17 +635,29 @@ namespace ReShade
 					break;
 				case 4:
 					this->mCompileStep = CompileEffect() ? 5 : 0;
+					this->mSpikeRecorder.AddEvent(SpikeRecorder::EffectCompiled);
 					break;
 				case 5:
 					ProcessEffect();
 					this->mCompileStep = 0;
+					this->mSpikeRecorder.AddEvent(SpikeRecorder::EffectProcessed);
 					break;
 			}
 		}
 
+		// Upload source textures that finished loading
+		if (this->mTextureLoader.IsBusy())
+		{
+			const TraceProfiler::Scope textureScope("TextureLoader::Update");
+
+			this->mSpikeRecorder.AddTextureUploads(this->mTextureLoader.Update());
+		}
+
 		// Draw overlay
 		if (this->mNVG != nullptr)
 		{
+			const TraceProfiler::Scope overlayScope("Runtime::DrawOverlay");
+
 			nvgBeginFrame(this->mNVG, this->mWidth, this->mHeight, 1);
 
 			const boost::chrono::seconds timeSinceCreate = boost::chrono::duration_cast<boost::chrono::seconds>(timePresent - this->mLastCreate);
@@ -457,6 +700,39 @@ namespace ReShade
 
 				nvgTextBox(this->mNVG, 0, static_cast<float>(this->mHeight) / 2 - bounds[3] / 2, static_cast<float>(this->mWidth), this->mMessage.c_str(), nullptr);
 			}
+
+			// Show progress of image dumps until a few seconds after the last one was written
+			const DumpWriter::Progress dumps = this->mDumpWriter.GetProgress();
+
+			if (dumps.Written + dumps.Failed < dumps.Submitted)
+			{
+				this->mLastDumpActivity = timePresent;
+			}
+
+			if (dumps.Submitted != 0 && timePresent - this->mLastDumpActivity < boost::chrono::seconds(5))
+			{
+				std::string progress;
+
+				if (dumps.Written + dumps.Failed < dumps.Submitted)
+				{
+					progress = "Dumping images: " + std::to_string(dumps.Written + dumps.Failed) + " / " + std::to_string(dumps.Submitted) + " (" + std::to_string(dumps.QueuedBytes / (1024 * 1024)) + " MB queued)";
+				}
+				else
+				{
+					progress = "Dumped " + std::to_string(dumps.Written) + " images";
+				}
+
+				if (dumps.Failed != 0)
+				{
+					progress += ", " + std::to_string(dumps.Failed) + " failed";
+				}
+
+				nvgFillColor(this->mNVG, dumps.Failed != 0 ? nvgRGB(255, 255, 0) : nvgRGB(255, 255, 255));
+				nvgTextAlign(this->mNVG, NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+				nvgFontSize(this->mNVG, 16);
+				nvgText(this->mNVG, 0, static_cast<float>(this->mHeight), progress.c_str(), nullptr);
+			}
+
 			if (this->mShowStatistics)
 			{
 				std::string stats = "Statistics\n";
@@ -465,9 +741,28 @@ namespace ReShade
 				stats += "Draw Calls: " + std::to_string(this->mLastDrawCalls) + " (" + std::to_string(this->mLastDrawCallVertices) + " vertices)" + '\n';
 				stats += "Frame " + std::to_string(this->mLastFrameCount + 1) + ": " + std::to_string(frametime.count() * 1e-6f) + "ms" + '\n';
 				stats += "PostProcessing: " + std::to_string(boost::chrono::duration_cast<boost::chrono::nanoseconds>(this->mLastPostProcessingDuration).count() * 1e-6f) + "ms" + '\n';
+				stats += "Frame Times: " + std::to_string(this->mFrameStatistics.GetPercentile(FrameStatistics::Median)) + " / " + std::to_string(this->mFrameStatistics.GetPercentile(FrameStatistics::P95)) + " / " + std::to_string(this->mFrameStatistics.GetPercentile(FrameStatistics::P99)) + " / " + std::to_string(this->mFrameStatistics.GetMax()) + "ms (p50 / p95 / p99 / max)" + '\n';
+				stats += "Stutters: " + std::to_string(this->mFrameStatistics.GetStutterCount()) + " of the last " + std::to_string(this->mFrameStatistics.GetCount()) + " frames" + '\n';
 				stats += "Timer: " + std::to_string(std::fmod(boost::chrono::duration_cast<boost::chrono::nanoseconds>(this->mLastPresent - this->mStartTime).count() * 1e-6f, 16777216.0f)) + "ms" + '\n';
 				stats += "Network: " + std::to_string(sNetworkUpload) + " bytes up / " + std::to_string(sNetworkDownload) + " bytes down" + '\n';
 
+				if (this->mBudget > 0.0f)
+				{
+					stats += "Budget: " + std::to_string(this->mBudget) + "ms" + '\n';
+
+					for (const TechniqueInfo &info : this->mTechniques)
+					{
+						if (info.Shed)
+						{
+							stats += "Shed: " + info.Name + " (" + std::to_string(info.GetAverageCPUCost()) + "ms CPU / " + std::to_string(info.GetAverageGPUCost()) + "ms GPU)" + '\n';
+						}
+						else if (info.Demotion > 1)
+						{
+							stats += "Demoted: " + info.Name + " (" + std::to_string(info.Demotion) + "x interval, " + std::to_string(info.GetAverageCPUCost()) + "ms CPU / " + std::to_string(info.GetAverageGPUCost()) + "ms GPU)" + '\n';
+						}
+					}
+				}
+
 				nvgFillColor(this->mNVG, nvgRGB(255, 255, 255));
 				nvgTextAlign(this->mNVG, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
 				nvgFontSize(this->mNVG, 16);
@@ -489,6 +784,69 @@ namespace ReShade
 		this->mDate[2] = static_cast<float>(tm.tm_mday);
 		this->mDate[3] = static_cast<float>(tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec + 1);
 
+		FrameStatistics::Frame frame;
+		frame.FrameTime = frametime.count() * 1e-6f;
+		frame.PostProcessingTime = boost::chrono::duration_cast<boost::chrono::nanoseconds>(this->mLastPostProcessingDuration).count() * 1e-6f;
+		frame.DrawCalls = this->mLastDrawCalls;
+		this->mFrameStatistics.Record(frame);
+
+		// Capturing the frames around a spike
+		SpikeRecorder::Frame spike;
+		spike.Index = this->mLastFrameCount;
+		spike.FrameTime = frame.FrameTime;
+		spike.PostProcessingTime = frame.PostProcessingTime;
+		spike.DrawCalls = this->mLastDrawCalls;
+		spike.DrawCallVertices = this->mLastDrawCallVertices;
+		spike.Events = 0;
+
+		if (this->mSpikeRecorder.Record(spike))
+		{
+			char timeString[128];
+			std::strftime(timeString, 128, "%Y-%m-%d %H-%M-%S", &tm);
+			const boost::filesystem::path path = sExecutablePath.parent_path() / (sExecutablePath.stem().string() + " spike " + timeString + ".bin");
+
+			if (this->mSpikeRecorder.Save(path))
+			{
+				LOG(INFO) << "Saved frames around a spike exceeding " << this->mSpikeRecorder.GetThreshold() << "ms to " << ObfuscatePath(path) << ".";
+			}
+			else
+			{
+				LOG(ERROR) << "Failed to save frames around a spike to " << ObfuscatePath(path) << "!";
+			}
+		}
+
+		// Publish statistics for external monitoring tools
+		if (this->mStatisticsPage != nullptr)
+		{
+			StatisticsData &data = this->mStatisticsPage->BeginUpdate();
+			data.FrameCount = this->mLastFrameCount + 1;
+			data.FrameTime = frametime.count() * 1e-6f;
+			data.PostProcessingTime = boost::chrono::duration_cast<boost::chrono::nanoseconds>(this->mLastPostProcessingDuration).count() * 1e-6f;
+			data.DrawCalls = this->mLastDrawCalls;
+			data.DrawCallVertices = this->mLastDrawCallVertices;
+			data.NetworkUpload = sNetworkUpload;
+			data.NetworkDownload = sNetworkDownload;
+			data.CompileStep = this->mCompileStep;
+			data.EffectLoaded = this->mEffect != nullptr;
+			data.EffectErrors = !this->mErrors.empty();
+			data.TechniqueCount = static_cast<unsigned int>(std::min(this->mTechniques.size(), static_cast<std::size_t>(StatisticsData::MaxTechniques)));
+
+			for (unsigned int i = 0; i < data.TechniqueCount; ++i)
+			{
+				const TechniqueInfo &info = this->mTechniques[i];
+
+				strncpy_s(data.Techniques[i].Name, info.Name.c_str(), _TRUNCATE);
+				data.Techniques[i].Cost = info.GetAverageCost();
+				data.Techniques[i].CPUCost = info.GetAverageCPUCost();
+				data.Techniques[i].GPUCost = info.GetAverageGPUCost();
+				data.Techniques[i].Enabled = info.Enabled;
+				data.Techniques[i].Shed = info.Shed;
+				data.Techniques[i].Demotion = info.Demotion;
+			}
+
+			this->mStatisticsPage->EndUpdate();
+		}
+
 		sNetworkUpload = sNetworkDownload = 0;
 		this->mLastPresent = timePresent;
 		this->mLastFrameDuration = frametime;
@@ -496,15 +854,43 @@ namespace ReShade
 		this->mLastDrawCalls = this->mLastDrawCallVertices = 0;
 
 		{
+			F7Key.Update();
+			F8Key.Update();
 			F9Key.Update();
 			F10Key.Update();
 			F11Key.Update();
 			F12Key.Update();
 			SnapshotKey.Update();
+			StreamKey.Update();
 
 			// Overwriting the backbuffer with one of the render targets
 			ToggleDebugView(F10Key.WasPressed(), F11Key.WasPressed(), F12Key.WasPressed());
 
+			// Tracing the runtime phases of the next frames
+			if (F7Key.WasPressed() && !TraceProfiler::IsCapturing())
+			{
+				LOG(INFO) << "Tracing the next " << this->mTraceFrames << " frames ...";
+
+				TraceProfiler::Begin(this->mTraceFrames);
+			}
+
+			// Dumping the recorded frame times
+			if (F8Key.WasPressed())
+			{
+				char timeString[128];
+				std::strftime(timeString, 128, "%Y-%m-%d %H-%M-%S", &tm);
+				const boost::filesystem::path path = sExecutablePath.parent_path() / (sExecutablePath.stem().string() + " frametimes " + timeString + ".csv");
+
+				if (this->mFrameStatistics.DumpToCSV(path))
+				{
+					LOG(INFO) << "Saved frame times of the last " << this->mFrameStatistics.GetCount() << " frames to " << ObfuscatePath(path) << ".";
+				}
+				else
+				{
+					LOG(ERROR) << "Failed to save frame times to " << ObfuscatePath(path) << "!";
+				}
+			}
+
 			// Ishmael's bandage on/off toggle
 			if (F9Key.WasPressed()) {
 				// Invert target
@@ -521,6 +907,13 @@ namespace ReShade
 				std::strftime(timeString, 128, "%Y-%m-%d %H-%M-%S", &tm);
 				DumpFrameTrace(sExecutablePath.parent_path() / (sExecutablePath.stem().string() + ' ' + timeString));
 			}
+
+			// Starting or stopping a capture of the same render targets over many frames
+			if (StreamKey.WasPressed()) {
+				char timeString[128];
+				std::strftime(timeString, 128, "%Y-%m-%d %H-%M-%S", &tm);
+				ToggleFrameStream(sExecutablePath.parent_path() / (sExecutablePath.stem().string() + " stream " + timeString + ".rstb"));
+			}
 		}
 	}
 
@@ -528,6 +921,16 @@ namespace ReShade
 	{
 		this->mMessage.clear();
 		this->mShowStatistics = false;
+		this->mBudget = 0.0f;
+		this->mTraceFrames = 60;
+		this->mStreamFrameCount = 300;
+		this->mStreamFrameInterval = 1;
+		this->mSpikeRecorder.SetThreshold(0.0f);
+		this->mDumpWriter.SetMemoryLimit(512 * 1024 * 1024);
+		this->mDumpFormat = ImageFormat::FastPNG;
+		this->mDumpBundle = false;
+		this->mDumpTiles = false;
+		this->mDecodeProfiles.clear();
 
 		boost::filesystem::path path = sEffectPath;
 
@@ -614,6 +1017,74 @@ namespace ReShade
 			{
 				this->mShowStatistics = true;
 			}
+			else if (boost::istarts_with(command, "budget "))
+			{
+				this->mBudget = std::strtof(command.c_str() + 7, nullptr);
+			}
+			else if (boost::istarts_with(command, "dumpmemory "))
+			{
+				this->mDumpWriter.SetMemoryLimit(static_cast<std::size_t>(std::max(std::strtoul(command.c_str() + 11, nullptr, 10), 1ul)) * 1024 * 1024);
+			}
+			else if (boost::iequals(command, "dumpbundle"))
+			{
+				this->mDumpBundle = true;
+			}
+			else if (boost::iequals(command, "dumptiles"))
+			{
+				this->mDumpBundle = this->mDumpTiles = true;
+			}
+			else if (boost::istarts_with(command, "dumpformat "))
+			{
+				const std::string format = boost::trim_copy(command.substr(11));
+
+				if (boost::iequals(format, "png"))
+				{
+					this->mDumpFormat = ImageFormat::PNG;
+				}
+				else if (boost::iequals(format, "fastpng"))
+				{
+					this->mDumpFormat = ImageFormat::FastPNG;
+				}
+				else if (boost::iequals(format, "qoi"))
+				{
+					this->mDumpFormat = ImageFormat::QOI;
+				}
+				else if (boost::iequals(format, "exr"))
+				{
+					this->mDumpFormat = ImageFormat::EXR;
+				}
+				else if (boost::iequals(format, "pfm"))
+				{
+					this->mDumpFormat = ImageFormat::PFM;
+				}
+			}
+			else if (boost::istarts_with(command, "decode "))
+			{
+				GBufferProfile profile;
+
+				if (ParseGBufferProfile(command.substr(7), profile))
+				{
+					this->mDecodeProfiles.push_back(profile);
+				}
+				else
+				{
+					LOG(WARNING) << "Ignoring invalid decode profile '" << command.substr(7) << "'.";
+				}
+			}
+			else if (boost::istarts_with(command, "spike "))
+			{
+				this->mSpikeRecorder.SetThreshold(std::strtof(command.c_str() + 6, nullptr));
+			}
+			else if (boost::istarts_with(command, "trace "))
+			{
+				this->mTraceFrames = std::max(std::strtoul(command.c_str() + 6, nullptr, 10), 1ul);
+			}
+			else if (boost::istarts_with(command, "stream "))
+			{
+				char *end = nullptr;
+				this->mStreamFrameCount = std::max(std::strtoul(command.c_str() + 7, &end, 10), 1ul);
+				this->mStreamFrameInterval = std::max(std::strtoul(end, nullptr, 10), 1ul);
+			}
 		}
 
 		if (!this->mMessage.empty())
@@ -628,6 +1099,7 @@ namespace ReShade
 	bool Runtime::CompileEffect()
 	{
 		this->mTechniques.clear();
+		this->mTextureLoader.Cancel();
 		this->mEffect.reset();
 
 		EffectTree ast;
@@ -690,18 +1162,117 @@ namespace ReShade
 			const Effect::Technique *technique = this->mEffect->GetTechnique(name);
 				
 			TechniqueInfo info;
+			info.Name = name;
 			info.Technique = technique;
+			info.Shed = false;
+			info.Demotion = 1;
+			std::fill_n(info.Costs, TechniqueInfo::CostWindow, 0.0f);
+			std::fill_n(info.GPUCosts, TechniqueInfo::CostWindow, 0.0f);
 
 			info.Enabled = technique->GetAnnotation("enabled").As<bool>();
 			info.Timeleft = info.Timeout = technique->GetAnnotation("timeout").As<int>();
 			info.Toggle = technique->GetAnnotation("toggle").As<int>();
 			info.ToggleTime = technique->GetAnnotation("toggletime").As<int>();
+			info.Priority = technique->GetAnnotation("priority").As<int>();
+
+			for (unsigned int i = 0, passes = technique->GetDescription().Passes; i < passes; ++i)
+			{
+				info.Schedules.push_back(technique->GetPassSchedule(i));
+			}
 
 			this->mTechniques.push_back(std::move(info));
 		}
 
+		#pragma region Balance Schedules
+		// Count how many amortized passes run on each frame of the combined schedule period
+		unsigned int period = 1;
+
+		for (const TechniqueInfo &info : this->mTechniques)
+		{
+			for (const Effect::Technique::Schedule &schedule : info.Schedules)
+			{
+				period = static_cast<unsigned int>(std::min(static_cast<unsigned long long>(period / GreatestCommonDivisor(period, schedule.Interval)) * schedule.Interval, 1024ull));
+			}
+		}
+
+		std::vector<unsigned int> load(period, 0);
+
+		for (TechniqueInfo &info : this->mTechniques)
+		{
+			for (Effect::Technique::Schedule &schedule : info.Schedules)
+			{
+				if (schedule.Phase == UINT_MAX)
+				{
+					continue;
+				}
+
+				schedule.Phase %= schedule.Interval;
+
+				for (unsigned int frame = schedule.Phase; schedule.Interval > 1 && frame < period; frame += schedule.Interval)
+				{
+					load[frame]++;
+				}
+			}
+		}
+
+		// Then place the remaining passes on the least busy frames, keeping all passes of a technique on the same phase so they still see each others results
+		for (TechniqueInfo &info : this->mTechniques)
+		{
+			unsigned int interval = 1, phase = 0, cost = UINT_MAX;
+
+			for (const Effect::Technique::Schedule &schedule : info.Schedules)
+			{
+				if (schedule.Phase == UINT_MAX)
+				{
+					interval = std::max(interval, schedule.Interval);
+				}
+			}
+
+			for (unsigned int candidate = 0; interval > 1 && candidate < interval; ++candidate)
+			{
+				unsigned int candidateCost = 0;
+
+				for (const Effect::Technique::Schedule &schedule : info.Schedules)
+				{
+					for (unsigned int frame = candidate % schedule.Interval; schedule.Phase == UINT_MAX && schedule.Interval > 1 && frame < period; frame += schedule.Interval)
+					{
+						candidateCost += load[frame];
+					}
+				}
+
+				if (candidateCost < cost)
+				{
+					phase = candidate;
+					cost = candidateCost;
+				}
+			}
+
+			for (Effect::Technique::Schedule &schedule : info.Schedules)
+			{
+				if (schedule.Phase != UINT_MAX)
+				{
+					continue;
+				}
+
+				schedule.Phase = phase % schedule.Interval;
+
+				for (unsigned int frame = schedule.Phase; schedule.Interval > 1 && frame < period; frame += schedule.Interval)
+				{
+					load[frame]++;
+				}
+			}
+
+			if (interval > 1)
+			{
+				LOG(INFO) << "> Running amortized technique passes every " << interval << " frames at phase " << phase << ".";
+			}
+		}
+		#pragma endregion
+
 		const auto textures = this->mEffect->GetTextures();
 
+		this->mTextureLoader.SetCacheDirectory(sEffectPath.parent_path() / "ReShade.cache");
+
 		for (const std::string &name : textures)
 		{
 			Effect::Texture *texture = this->mEffect->GetTexture(name);
@@ -711,74 +1282,37 @@ namespace ReShade
 			if (!source.empty())
 			{
 				const boost::filesystem::path path = boost::filesystem::absolute(source, sEffectPath.parent_path());
-				int widthFile = 0, heightFile = 0, channelsFile = 0, channels = STBI_default;
+				int channels = STBI_default;
 
 				switch (desc.Format)
 				{
 					case Effect::Texture::Format::R8:
+					case Effect::Texture::Format::R32F:
+					case Effect::Texture::Format::LATC1:
 						channels = STBI_r;
 						break;
 					case Effect::Texture::Format::RG8:
+					case Effect::Texture::Format::LATC2:
 						channels = STBI_rg;
 						break;
-					case Effect::Texture::Format::DXT1:
-						channels = STBI_rgb;
-						break;
 					case Effect::Texture::Format::RGBA8:
-					case Effect::Texture::Format::DXT5:
-						channels = STBI_rgba;
-						break;
-					case Effect::Texture::Format::R32F:
 					case Effect::Texture::Format::RGBA16:
 					case Effect::Texture::Format::RGBA16F:
 					case Effect::Texture::Format::RGBA32F:
+					case Effect::Texture::Format::DXT1:
+					case Effect::Texture::Format::DXT5:
+						channels = STBI_rgba;
+						break;
 					case Effect::Texture::Format::DXT3:
-					case Effect::Texture::Format::LATC1:
-					case Effect::Texture::Format::LATC2:
-						LOG(ERROR) << "> Texture " << name << " uses unsupported format ('R32F'/'RGBA16'/'RGBA16F'/'RGBA32F'/'DXT3'/'LATC1'/'LATC2') for image loading.";
+						LOG(ERROR) << "> Texture " << name << " uses unsupported format ('DXT3') for image loading.";
 						continue;
 				}
 
-				std::size_t dataSize = desc.Width * desc.Height * channels;
-				unsigned char *dataFile = stbi_load(path.string().c_str(), &widthFile, &heightFile, &channelsFile, channels), *data = new unsigned char[dataSize];
-					
-				if (dataFile != nullptr)
-				{
-					if (desc.Width != static_cast<unsigned int>(widthFile) || desc.Height != static_cast<unsigned int>(heightFile))
-					{
-						LOG(INFO) << "> Resizing image data for texture '" << name << "' from " << widthFile << "x" << heightFile << " to " << desc.Width << "x" << desc.Height << " ...";
-
-						stbir_resize_uint8(dataFile, widthFile, heightFile, 0, data, desc.Width, desc.Height, 0, channels);
-					}
-					else
-					{
-						std::memcpy(data, dataFile, dataSize);
-					}
-
-					stbi_image_free(dataFile);
-
-					switch (desc.Format)
-					{
-						case Effect::Texture::Format::DXT1:
-							stb_compress_dxt_block(data, data, FALSE, STB_DXT_NORMAL);
-							dataSize = ((desc.Width + 3) >> 2) * ((desc.Height + 3) >> 2) * 8;
-							break;
-						case Effect::Texture::Format::DXT5:
-							stb_compress_dxt_block(data, data, TRUE, STB_DXT_NORMAL);
-							dataSize = ((desc.Width + 3) >> 2) * ((desc.Height + 3) >> 2) * 16;
-							break;
-					}
-
-					texture->Update(0, data, dataSize);
-				}
-				else
-				{
-					LOG(ERROR) << "> Source " << ObfuscatePath(path) << " for texture '" << name << "' could not be loaded! Make sure it exists and of a compatible format.";
-				}
-
-				delete[] data;
+				this->mTextureLoader.Enqueue(texture, name, path, channels);
 			}
 		}
+
+		this->mTextureLoader.Submit();
 	}
 
 	void Runtime::CreateScreenshot(const boost::filesystem::path &path)
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Effect.hpp"
+#include "FrameStatistics.hpp"
+#include "SpikeRecorder.hpp"
+#include "TextureLoader.hpp"
+#include "DumpWriter.hpp"
 
 #include <algorithm>
 #include <memory>
@@ -12,6 +16,8 @@ struct NVGcontext;
 
 namespace ReShade
 {
+	class StatisticsPage;
+
 	static std::string CurrentGameFolder;
 
 	class Runtime abstract
@@ -19,10 +25,22 @@ namespace ReShade
 	public:
 		struct TechniqueInfo
 		{
-			bool Enabled;
+			static const unsigned int CostWindow = 32, MaxDemotion = 8;
+
+			std::string Name;
+			bool Enabled, Shed;
 			int Timeout, Timeleft;
 			int Toggle, ToggleTime;
+			int Priority;
+			unsigned int Demotion; // Factor the budget governor stretched the intervals of amortized passes by
+			float Costs[CostWindow], GPUCosts[CostWindow]; // Milliseconds spent on the CPU and GPU in each of the last frames
+			std::vector<Effect::Technique::Schedule> Schedules;
 			const Effect::Technique *Technique;
+
+			bool IsDemotable() const;
+			float GetAverageCost() const;
+			float GetAverageCPUCost() const;
+			float GetAverageGPUCost() const;
 		};
 
 	public:
@@ -39,7 +57,7 @@ namespace ReShade
 	protected:
 		void OnCreate(unsigned int width, unsigned int height);
 		void OnDelete();
-		void OnDraw(unsigned int vertices);
+		void OnDraw(unsigned int vertices, unsigned int drawCalls = 1);
 		void OnPostProcess();
 		void OnPresent();
 
@@ -47,10 +65,12 @@ namespace ReShade
 		bool CompileEffect();
 		virtual std::unique_ptr<Effect> CompileEffect(const struct EffectTree &ast, std::string &errors) const = 0;
 		void ProcessEffect();
+		void UpdateBudget();
 
 		void CreateScreenshot(const boost::filesystem::path &path);
 		virtual void CreateScreenshot(unsigned char *buffer, std::size_t size) const = 0;
 		virtual void DumpFrameTrace(const boost::filesystem::path &path) {}
+		virtual void ToggleFrameStream(const boost::filesystem::path &path) {}
 		virtual void ToggleDebugView(bool saveCurrent, bool playSave, bool playNext) {}
 
 	protected:
@@ -58,11 +78,21 @@ namespace ReShade
 		unsigned int mVendorId, mDeviceId, mRendererId;
 		unsigned long mLastDrawCalls, mLastDrawCallVertices;
 		NVGcontext *mNVG;
+		std::unique_ptr<StatisticsPage> mStatisticsPage;
 		std::unique_ptr<Effect> mEffect;
 		std::vector<TechniqueInfo> mTechniques;
-		boost::chrono::high_resolution_clock::time_point mStartTime, mLastCreate, mLastPresent;
+		FrameStatistics mFrameStatistics;
+		SpikeRecorder mSpikeRecorder;
+		TextureLoader mTextureLoader;
+		DumpWriter mDumpWriter;
+		boost::chrono::high_resolution_clock::time_point mStartTime, mLastCreate, mLastPresent, mLastDumpActivity;
 		boost::chrono::high_resolution_clock::duration mLastFrameDuration, mLastPostProcessingDuration;
-		unsigned long long mLastFrameCount;
+		unsigned long long mLastFrameCount, mLastBudgetChange;
+		float mBudget;
+		unsigned int mTraceFrames, mStreamFrameCount, mStreamFrameInterval;
+		ImageFormat mDumpFormat;
+		std::vector<GBufferProfile> mDecodeProfiles;
+		bool mDumpBundle, mDumpTiles;
 		unsigned int mCompileStep;
 		float mDate[4];
 		std::string mStatus, mErrors, mMessage, mEffectSource;
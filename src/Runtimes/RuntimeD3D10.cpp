@@ -1,6 +1,8 @@
 #include "Log.hpp"
 #include "RuntimeD3D10.hpp"
 #include "EffectParserTree.hpp"
+#include "EffectAnalysis.hpp"
+#include "TraceProfiler.hpp"
 
 #include <d3dcompiler.h>
 #include <nanovg_d3d10.h>
@@ -30,6 +32,14 @@ namespace ReShade { namespace Runtimes
 				this->mEffect->mConstantBuffers.push_back(nullptr);
 				this->mEffect->mConstantStorages.push_back(nullptr);
 
+				// Textures only used in disjoint pass ranges can share a single allocation
+				this->mTexturePlan = PlanTextureMemory(this->mAST);
+
+				if (!this->mTexturePlan.Aliases.empty())
+				{
+					LOG(INFO) << "> Aliasing " << this->mTexturePlan.Aliases.size() << " effect textures with disjoint lifetimes, saving " << this->mTexturePlan.SavedBytes << " of " << this->mTexturePlan.TotalBytes << " bytes.";
+				}
+
 				const EffectNodes::Root *node = &this->mAST[EffectTree::Root].As<EffectNodes::Root>();
 
 				do
@@ -1682,6 +1692,21 @@ namespace ReShade { namespace Runtimes
 						this->mErrors += PrintLocation(node.Location) + "warning: texture property on backbuffer textures are ignored.\n";
 					}
 				}
+				else if (this->mTexturePlan.Aliases.count(node.Index) != 0)
+				{
+					const D3D10Texture *owner = static_cast<const D3D10Texture *>(this->mEffect->GetTexture(this->mAST[this->mTexturePlan.Aliases.at(node.Index)].As<EffectNodes::Variable>().Name));
+
+					obj->mTexture = owner->mTexture;
+					obj->mTexture->AddRef();
+					obj->mShaderResourceView[0] = owner->mShaderResourceView[0];
+					obj->mShaderResourceView[0]->AddRef();
+					obj->mShaderResourceView[1] = owner->mShaderResourceView[1];
+
+					if (obj->mShaderResourceView[1] != nullptr)
+					{
+						obj->mShaderResourceView[1]->AddRef();
+					}
+				}
 				else
 				{
 					HRESULT hr = this->mEffect->mRuntime->mDevice->CreateTexture2D(&texdesc, nullptr, &obj->mTexture);
@@ -2126,6 +2151,7 @@ namespace ReShade { namespace Runtimes
 			void Visit(const EffectNodes::Technique &node)
 			{
 				std::vector<D3D10Technique::Pass> passes;
+				const std::vector<EffectPassInfo> infos = AnalyzeTechnique(this->mAST, node);
 				const EffectNodes::Pass *pass = &this->mAST[node.Passes].As<EffectNodes::Pass>();
 
 				do
@@ -2149,6 +2175,11 @@ namespace ReShade { namespace Runtimes
 				D3D10Technique *obj = new D3D10Technique(this->mEffect, objdesc);
 				obj->mPasses = std::move(passes);
 
+				for (const EffectPassInfo &info : infos)
+				{
+					obj->AddPassSchedule(info.Interval, info.Phase);
+				}
+
 				if (node.Annotations != EffectTree::Null)
 				{
 					Visit(this->mAST[node.Annotations].As<EffectNodes::Annotation>(), *obj);
@@ -2169,7 +2200,11 @@ namespace ReShade { namespace Runtimes
 				pass.Viewport.MaxDepth = 1.0f;
 				ZeroMemory(pass.RT, sizeof(pass.RT));
 				ZeroMemory(pass.RTSRV, sizeof(pass.RTSRV));
+				ZeroMemory(pass.ScaledRT, sizeof(pass.ScaledRT));
+				ZeroMemory(pass.ScaledRTSRV, sizeof(pass.ScaledRTSRV));
 				pass.SRV = this->mEffect->mShaderResources;
+				pass.SamplesBackBuffer = AnalyzePass(this->mAST, node).BackBufferAccess != EffectPassInfo::Access::None;
+				pass.WritesBackBuffer = node.States[EffectNodes::Pass::RenderTarget0] == 0;
 
 				if (node.States[EffectNodes::Pass::VertexShader] != 0)
 				{
@@ -2244,6 +2279,18 @@ namespace ReShade { namespace Runtimes
 					pass.Viewport.Height = this->mEffect->mRuntime->mSwapChainDesc.BufferDesc.Height;
 				}
 
+				pass.ScaledViewport = pass.Viewport;
+
+				if (node.States[EffectNodes::Pass::RenderScale] != 0 && this->mAST[node.States[EffectNodes::Pass::RenderScale]].As<EffectNodes::Literal>().Value.Float[0] != 1.0f)
+				{
+					VisitScaledTargets(node, this->mAST[node.States[EffectNodes::Pass::RenderScale]].As<EffectNodes::Literal>().Value.Float[0], pass);
+
+					if (this->mFatal)
+					{
+						return;
+					}
+				}
+
 				D3D10_DEPTH_STENCIL_DESC ddesc;
 				ddesc.DepthEnable = node.States[EffectNodes::Pass::DepthEnable] != 0 && this->mAST[node.States[EffectNodes::Pass::DepthEnable]].As<EffectNodes::Literal>().Value.Bool[0];
 				ddesc.DepthWriteMask = (node.States[EffectNodes::Pass::DepthWriteMask] == 0 || this->mAST[node.States[EffectNodes::Pass::DepthWriteMask]].As<EffectNodes::Literal>().Value.Bool[0]) ? D3D10_DEPTH_WRITE_MASK_ALL : D3D10_DEPTH_WRITE_MASK_ZERO;
@@ -2321,6 +2368,122 @@ namespace ReShade { namespace Runtimes
 
 				passes.push_back(std::move(pass));
 			}
+			void VisitScaledTargets(const EffectNodes::Pass &node, float scale, D3D10Technique::Pass &pass)
+			{
+				if (!VisitUpsampleShader())
+				{
+					return;
+				}
+
+				pass.ScaledViewport.Width = std::max(static_cast<UINT>(pass.Viewport.Width * scale), 1u);
+				pass.ScaledViewport.Height = std::max(static_cast<UINT>(pass.Viewport.Height * scale), 1u);
+
+				// Draw into reduced resolution copies of all render targets, which are then upsampled into the actual targets after the pass
+				for (unsigned int i = 0; i < 8; ++i)
+				{
+					if (pass.RT[i] == nullptr)
+					{
+						continue;
+					}
+
+					D3D10_RENDER_TARGET_VIEW_DESC rtvdesc;
+					pass.RT[i]->GetDesc(&rtvdesc);
+
+					const CD3D10_TEXTURE2D_DESC texdesc(rtvdesc.Format, pass.ScaledViewport.Width, pass.ScaledViewport.Height, 1, 1, D3D10_BIND_SHADER_RESOURCE | D3D10_BIND_RENDER_TARGET);
+					ID3D10Texture2D *texture = nullptr;
+
+					HRESULT hr = this->mEffect->mRuntime->mDevice->CreateTexture2D(&texdesc, nullptr, &texture);
+
+					if (FAILED(hr))
+					{
+						this->mErrors += PrintLocation(node.Location) + "error: 'CreateTexture2D' failed!\n";
+						this->mFatal = true;
+						return;
+					}
+
+					hr = this->mEffect->mRuntime->mDevice->CreateRenderTargetView(texture, nullptr, &pass.ScaledRT[i]);
+
+					if (SUCCEEDED(hr))
+					{
+						hr = this->mEffect->mRuntime->mDevice->CreateShaderResourceView(texture, nullptr, &pass.ScaledRTSRV[i]);
+					}
+
+					texture->Release();
+
+					if (FAILED(hr))
+					{
+						this->mErrors += PrintLocation(node.Location) + "error: 'CreateRenderTargetView' failed!\n";
+						this->mFatal = true;
+						return;
+					}
+				}
+
+				LOG(INFO) << "> Rendering pass at " << pass.ScaledViewport.Width << "x" << pass.ScaledViewport.Height << " instead of " << pass.Viewport.Width << "x" << pass.Viewport.Height << ".";
+			}
+			bool VisitUpsampleShader()
+			{
+				if (this->mEffect->mUpsamplePS != nullptr)
+				{
+					return true;
+				}
+
+				const std::string source =
+					"Texture2D __upsampleTexture : register(t0);\n"
+					"SamplerState __upsampleSampler : register(s0);\n"
+					"void __upsampleVS(uint id : SV_VERTEXID, out float4 position : SV_POSITION, out float2 texcoord : TEXCOORD0)\n{\n"
+					"texcoord = float2(id == 2 ? 2.0 : 0.0, id == 1 ? 2.0 : 0.0);\n"
+					"position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n"
+					"float4 __upsamplePS(float4 position : SV_POSITION, float2 texcoord : TEXCOORD0) : SV_TARGET\n{\n"
+					"return __upsampleTexture.Sample(__upsampleSampler, texcoord);\n}\n";
+
+				LOG(TRACE) << "> Compiling upsample shader:\n\n" << source.c_str() << "\n";
+
+				ID3DBlob *compiled[2] = { nullptr, nullptr }, *errors = nullptr;
+
+				HRESULT hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, "__upsampleVS", "vs_4_0", D3DCOMPILE_ENABLE_STRICTNESS, 0, &compiled[0], &errors);
+
+				if (SUCCEEDED(hr))
+				{
+					hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, "__upsamplePS", "ps_4_0", D3DCOMPILE_ENABLE_STRICTNESS, 0, &compiled[1], &errors);
+				}
+				if (errors != nullptr)
+				{
+					this->mErrors += std::string(static_cast<const char *>(errors->GetBufferPointer()), errors->GetBufferSize());
+
+					errors->Release();
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = this->mEffect->mRuntime->mDevice->CreateVertexShader(compiled[0]->GetBufferPointer(), compiled[0]->GetBufferSize(), &this->mEffect->mUpsampleVS);
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = this->mEffect->mRuntime->mDevice->CreatePixelShader(compiled[1]->GetBufferPointer(), compiled[1]->GetBufferSize(), &this->mEffect->mUpsamplePS);
+				}
+				if (SUCCEEDED(hr))
+				{
+					const CD3D10_SAMPLER_DESC desc(D3D10_DEFAULT);
+
+					hr = this->mEffect->mRuntime->mDevice->CreateSamplerState(&desc, &this->mEffect->mUpsampleSampler);
+				}
+
+				for (ID3DBlob *blob : compiled)
+				{
+					if (blob != nullptr)
+					{
+						blob->Release();
+					}
+				}
+
+				if (FAILED(hr))
+				{
+					this->mErrors += "error: failed to create upsample shader!\n";
+					this->mFatal = true;
+					return false;
+				}
+
+				return true;
+			}
 			void VisitShader(const EffectNodes::Function &node, unsigned int shadertype, D3D10Technique::Pass &pass)
 			{
 				const char *profile = nullptr;
@@ -2409,6 +2572,7 @@ namespace ReShade { namespace Runtimes
 			std::unordered_map<std::size_t, std::size_t> mSamplerDescs;
 			std::string mCurrentGlobalConstants;
 			UINT mCurrentGlobalSize, mCurrentGlobalStorageSize;
+			EffectTexturePlan mTexturePlan;
 			std::string mCurrentBlockName;
 			bool mCurrentInParameterBlock, mCurrentInFunctionBlock, mCurrentInDeclaratorList;
 		};
@@ -2610,7 +2774,11 @@ namespace ReShade { namespace Runtimes
 		DetectDepthSource();
 
 		// Capture device state
-		this->mStateBlock->Capture();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Capture");
+
+			this->mStateBlock->Capture();
+		}
 
 		ID3D10RenderTargetView *stateblockTargets[D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT] = { nullptr };
 		ID3D10DepthStencilView *stateblockDepthStencil = nullptr;
@@ -2644,7 +2812,11 @@ namespace ReShade { namespace Runtimes
 		}
 
 		// Apply previous device state
-		this->mStateBlock->Apply();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Apply");
+
+			this->mStateBlock->Apply();
+		}
 
 		this->mDevice->OMSetRenderTargets(D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT, stateblockTargets, stateblockDepthStencil);
 
@@ -3171,12 +3343,15 @@ namespace ReShade { namespace Runtimes
 		textureStaging->Release();
 	}
 
-	D3D10Effect::D3D10Effect(std::shared_ptr<const D3D10Runtime> runtime) : mRuntime(runtime), mRasterizerState(nullptr), mConstantsDirty(true)
+	D3D10Effect::D3D10Effect(std::shared_ptr<const D3D10Runtime> runtime) : mRuntime(runtime), mRasterizerState(nullptr), mUpsampleVS(nullptr), mUpsamplePS(nullptr), mUpsampleSampler(nullptr), mConstantsDirty(true), mBackBufferTextureDirty(true)
 	{
 	}
 	D3D10Effect::~D3D10Effect()
 	{
 		SAFE_RELEASE(this->mRasterizerState);
+		SAFE_RELEASE(this->mUpsampleVS);
+		SAFE_RELEASE(this->mUpsamplePS);
+		SAFE_RELEASE(this->mUpsampleSampler);
 
 		for (auto &it : this->mSamplerStates)
 		{
@@ -3220,6 +3395,9 @@ namespace ReShade { namespace Runtimes
 		assert(this->mRuntime->mDefaultDepthStencil != nullptr);
 
 		device->ClearDepthStencilView(this->mRuntime->mDefaultDepthStencil, D3D10_CLEAR_DEPTH | D3D10_CLEAR_STENCIL, 1.0f, 0);
+
+		// Back buffer may have changed since the last technique
+		this->mBackBufferTextureDirty = true;
 	}
 	void D3D10Effect::End() const
 	{
@@ -3238,7 +3416,7 @@ namespace ReShade { namespace Runtimes
 		SAFE_RELEASE(this->mTexture);
 	}
 
-	bool D3D10Texture::Update(unsigned int level, const unsigned char *data, std::size_t size)
+	bool D3D10Texture::Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps)
 	{
 		if (data == nullptr || size == 0 || level > this->mDesc.Levels || this->mSource != Source::Memory)
 		{
@@ -3249,9 +3427,13 @@ namespace ReShade { namespace Runtimes
 
 		ID3D10Device *device = this->mEffect->mRuntime->mDevice;
 
-		device->UpdateSubresource(this->mTexture, level, nullptr, data, static_cast<UINT>(size / this->mDesc.Height), static_cast<UINT>(size));
+		// Compressed formats are laid out in rows of 4x4 blocks
+		const UINT height = std::max(this->mDesc.Height >> level, 1u);
+		const UINT rows = this->mDesc.Format >= Format::DXT1 && this->mDesc.Format <= Format::LATC2 ? (height + 3) / 4 : height;
+
+		device->UpdateSubresource(this->mTexture, level, nullptr, data, static_cast<UINT>(size / rows), static_cast<UINT>(size));
 
-		if (level == 0 && this->mDesc.Levels > 1)
+		if (generateMipmaps && level == 0 && this->mDesc.Levels > 1)
 		{
 			device->GenerateMips(this->mShaderResourceView[0]);
 		}
@@ -3362,6 +3544,12 @@ namespace ReShade { namespace Runtimes
 			{
 				pass.DSS->Release();
 			}
+
+			for (unsigned int i = 0; i < D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+			{
+				SAFE_RELEASE(pass.ScaledRT[i]);
+				SAFE_RELEASE(pass.ScaledRTSRV[i]);
+			}
 		}
 	}
 
@@ -3411,42 +3599,55 @@ namespace ReShade { namespace Runtimes
 		device->GSSetShader(nullptr);
 		device->PSSetShader(pass.PS);
 
+		// Passes at a reduced resolution draw unblended into intermediate targets, their blend state only applies when those are upsampled into the actual ones
+		const bool scaled = pass.ScaledViewport.Width != pass.Viewport.Width || pass.ScaledViewport.Height != pass.Viewport.Height;
 		const FLOAT blendfactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-		device->OMSetBlendState(pass.BS, blendfactor, D3D10_DEFAULT_SAMPLE_MASK);
+		device->OMSetBlendState(scaled ? nullptr : pass.BS, blendfactor, D3D10_DEFAULT_SAMPLE_MASK);
 		device->OMSetDepthStencilState(pass.DSS, pass.StencilRef);
 
-		// Save backbuffer of previous pass
-		device->CopyResource(runtime->mBackBufferTexture, runtime->mBackBuffer);
+		// Save backbuffer of previous pass, but only if this pass reads it and it was drawn to since the last copy
+		if (pass.SamplesBackBuffer && this->mEffect->mBackBufferTextureDirty)
+		{
+			device->CopyResource(runtime->mBackBufferTexture, runtime->mBackBuffer);
+
+			this->mEffect->mBackBufferTextureDirty = false;
+		}
 
 		// Setup shader resources
 		device->VSSetShaderResources(0, static_cast<UINT>(pass.SRV.size()), pass.SRV.data());
 		device->PSSetShaderResources(0, static_cast<UINT>(pass.SRV.size()), pass.SRV.data());
 
 		// Setup rendertargets
+		ID3D10RenderTargetView *const *targets = scaled ? pass.ScaledRT : pass.RT;
 		ID3D10DepthStencilView *depthstencil = runtime->mDefaultDepthStencil;
 
-		if (pass.Viewport.Width != runtime->mSwapChainDesc.BufferDesc.Width || pass.Viewport.Height != runtime->mSwapChainDesc.BufferDesc.Height)
+		if (pass.ScaledViewport.Width != runtime->mSwapChainDesc.BufferDesc.Width || pass.ScaledViewport.Height != runtime->mSwapChainDesc.BufferDesc.Height)
 		{
 			depthstencil = nullptr;
 		}
 
-		device->OMSetRenderTargets(D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT, pass.RT, depthstencil);
-		device->RSSetViewports(1, &pass.Viewport);
+		device->OMSetRenderTargets(D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT, targets, depthstencil);
+		device->RSSetViewports(1, &pass.ScaledViewport);
 
 		for (UINT target = 0; target < D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT; ++target)
 		{
-			if (pass.RT[target] == nullptr)
+			if (targets[target] == nullptr)
 			{
 				continue;
 			}
 
 			const FLOAT color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-			device->ClearRenderTargetView(pass.RT[target], color);
+			device->ClearRenderTargetView(targets[target], color);
 		}
 
 		// Draw triangle
 		device->Draw(3, 0);
 
+		if (pass.WritesBackBuffer)
+		{
+			this->mEffect->mBackBufferTextureDirty = true;
+		}
+
 		// Reset shader resources
 		ID3D10ShaderResourceView *null[D3D10_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = { nullptr };
 		device->VSSetShaderResources(0, static_cast<UINT>(pass.SRV.size()), null);
@@ -3455,6 +3656,37 @@ namespace ReShade { namespace Runtimes
 		// Reset rendertargets
 		device->OMSetRenderTargets(0, nullptr, nullptr);
 
+		// Upsample the reduced resolution results into the actual rendertargets
+		if (scaled)
+		{
+			device->VSSetShader(this->mEffect->mUpsampleVS);
+			device->PSSetShader(this->mEffect->mUpsamplePS);
+			device->PSSetSamplers(0, 1, &this->mEffect->mUpsampleSampler);
+			device->OMSetBlendState(pass.BS, blendfactor, D3D10_DEFAULT_SAMPLE_MASK);
+			device->OMSetDepthStencilState(nullptr, 0);
+			device->RSSetViewports(1, &pass.Viewport);
+
+			for (UINT target = 0; target < D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT; ++target)
+			{
+				if (pass.ScaledRTSRV[target] == nullptr)
+				{
+					continue;
+				}
+
+				device->OMSetRenderTargets(1, &pass.RT[target], nullptr);
+				device->PSSetShaderResources(0, 1, &pass.ScaledRTSRV[target]);
+				device->Draw(3, 0);
+			}
+
+			device->PSSetShaderResources(0, 1, null);
+			device->OMSetRenderTargets(0, nullptr, nullptr);
+
+			if (!this->mEffect->mSamplerStates.empty())
+			{
+				device->PSSetSamplers(0, 1, this->mEffect->mSamplerStates.data());
+			}
+		}
+
 		// Update shader resources
 		for (ID3D10ShaderResourceView *srv : pass.RTSRV)
 		{
@@ -82,7 +82,10 @@ namespace ReShade { namespace Runtimes
 		std::vector<ID3D10ShaderResourceView *> mShaderResources;
 		std::vector<ID3D10Buffer *> mConstantBuffers;
 		std::vector<unsigned char *> mConstantStorages;
-		mutable bool mConstantsDirty;
+		ID3D10VertexShader *mUpsampleVS;
+		ID3D10PixelShader *mUpsamplePS;
+		ID3D10SamplerState *mUpsampleSampler;
+		mutable bool mConstantsDirty, mBackBufferTextureDirty;
 	};
 	struct D3D10Texture : public Effect::Texture
 	{
@@ -101,7 +104,7 @@ namespace ReShade { namespace Runtimes
 			return this->mAnnotations.emplace(name, value).second;
 		}
 
-		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size) override;
+		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps) override;
 		void ChangeSource(ID3D10ShaderResourceView *srv, ID3D10ShaderResourceView *srvSRGB);
 
 		D3D10Effect *mEffect;
@@ -138,8 +141,11 @@ namespace ReShade { namespace Runtimes
 			UINT StencilRef;
 			ID3D10RenderTargetView *RT[D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT];
 			ID3D10ShaderResourceView *RTSRV[D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT];
-			D3D10_VIEWPORT Viewport;
+			ID3D10RenderTargetView *ScaledRT[D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			ID3D10ShaderResourceView *ScaledRTSRV[D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			D3D10_VIEWPORT Viewport, ScaledViewport;
 			std::vector<ID3D10ShaderResourceView *> SRV;
+			bool SamplesBackBuffer, WritesBackBuffer;
 		};
 
 		D3D10Technique(D3D10Effect *effect, const Description &desc);
@@ -153,6 +159,12 @@ namespace ReShade { namespace Runtimes
 		{
 			this->mPasses.push_back(pass);
 		}
+		inline void AddPassSchedule(unsigned int interval, unsigned int phase)
+		{
+			const Schedule schedule = { interval, phase };
+
+			this->mPassSchedules.push_back(schedule);
+		}
 
 		virtual void RenderPass(unsigned int index) const override;
 
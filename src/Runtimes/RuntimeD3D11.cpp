@@ -1,6 +1,8 @@
 #include "Log.hpp"
 #include "RuntimeD3D11.hpp"
 #include "EffectParserTree.hpp"
+#include "EffectAnalysis.hpp"
+#include "TraceProfiler.hpp"
 
 #include <d3dcompiler.h>
 #include <nanovg_d3d11.h>
@@ -47,10 +49,154 @@ namespace ReShade { namespace Runtimes
 			CRITICAL_SECTION &mCS;
 		};
 
+		// Formats the dump writers can convert, everything else is skipped
+		bool GetTexelFormat(DXGI_FORMAT format, TexelFormat &texelFormat)
+		{
+			switch (format)
+			{
+				case DXGI_FORMAT_R8_TYPELESS:
+				case DXGI_FORMAT_R8_UNORM:
+					texelFormat = TexelFormat::R8;
+					return true;
+				case DXGI_FORMAT_R8G8_TYPELESS:
+				case DXGI_FORMAT_R8G8_UNORM:
+					texelFormat = TexelFormat::RG8;
+					return true;
+				case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+				case DXGI_FORMAT_R8G8B8A8_UNORM:
+				case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+					texelFormat = TexelFormat::RGBA8;
+					return true;
+				case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+				case DXGI_FORMAT_B8G8R8A8_UNORM:
+				case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+				case DXGI_FORMAT_B8G8R8X8_UNORM:
+				case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+					texelFormat = TexelFormat::BGRA8;
+					return true;
+				case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+				case DXGI_FORMAT_R10G10B10A2_UNORM:
+					texelFormat = TexelFormat::RGB10A2;
+					return true;
+				case DXGI_FORMAT_R11G11B10_FLOAT:
+					texelFormat = TexelFormat::RG11B10F;
+					return true;
+				case DXGI_FORMAT_R16_FLOAT:
+					texelFormat = TexelFormat::R16F;
+					return true;
+				case DXGI_FORMAT_R16G16_FLOAT:
+					texelFormat = TexelFormat::RG16F;
+					return true;
+				case DXGI_FORMAT_R16G16B16A16_UNORM:
+					texelFormat = TexelFormat::RGBA16;
+					return true;
+				case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+				case DXGI_FORMAT_R16G16B16A16_FLOAT:
+					texelFormat = TexelFormat::RGBA16F;
+					return true;
+				case DXGI_FORMAT_R32_TYPELESS:
+				case DXGI_FORMAT_R32_FLOAT:
+				case DXGI_FORMAT_D32_FLOAT:
+					texelFormat = TexelFormat::R32F;
+					return true;
+				case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+				case DXGI_FORMAT_R32G32B32A32_FLOAT:
+					texelFormat = TexelFormat::RGBA32F;
+					return true;
+				case DXGI_FORMAT_R24G8_TYPELESS:
+				case DXGI_FORMAT_D24_UNORM_S8_UINT:
+				case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+					texelFormat = TexelFormat::D24S8;
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		class D3D11ReadbackBackend : public ReadbackQueue::Backend
+		{
+		public:
+			D3D11ReadbackBackend(ID3D11Device *device, ID3D11DeviceContext *context) : mDevice(device), mContext(context)
+			{
+			}
+
+			virtual void *CreateStaging(const ReadbackQueue::Description &desc) override
+			{
+				D3D11_TEXTURE2D_DESC texdesc;
+				ZeroMemory(&texdesc, sizeof(D3D11_TEXTURE2D_DESC));
+				texdesc.Width = desc.Width;
+				texdesc.Height = desc.Height;
+				texdesc.ArraySize = 1;
+				texdesc.MipLevels = 1;
+				texdesc.Format = static_cast<DXGI_FORMAT>(desc.Format);
+				texdesc.SampleDesc.Count = 1;
+				texdesc.Usage = D3D11_USAGE_STAGING;
+				texdesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+				ID3D11Texture2D *texture = nullptr;
+				const HRESULT hr = this->mDevice->CreateTexture2D(&texdesc, nullptr, &texture);
+
+				if (FAILED(hr))
+				{
+					LOG(TRACE) << "Failed to create staging resource for readback! HRESULT is '" << hr << "'.";
+					return nullptr;
+				}
+
+				return texture;
+			}
+			virtual void DestroyStaging(void *staging) override
+			{
+				static_cast<ID3D11Texture2D *>(staging)->Release();
+			}
+			virtual void Copy(void *staging, void *source) override
+			{
+				this->mContext->CopyResource(static_cast<ID3D11Texture2D *>(staging), static_cast<ID3D11Texture2D *>(source));
+			}
+			virtual MapResult Map(void *staging, bool wait, const unsigned char *&data, std::size_t &pitch) override
+			{
+				D3D11_MAPPED_SUBRESOURCE mapped;
+				HRESULT hr;
+
+				if (wait)
+				{
+					// The queue only waits for copies it found pending before, so this is where the render thread stalls
+					const TraceProfiler::Scope scope("ReadbackQueue::Stall");
+
+					hr = this->mContext->Map(static_cast<ID3D11Texture2D *>(staging), 0, D3D11_MAP_READ, 0, &mapped);
+				}
+				else
+				{
+					hr = this->mContext->Map(static_cast<ID3D11Texture2D *>(staging), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+				}
+
+				if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+				{
+					return MapResult::Pending;
+				}
+				if (FAILED(hr))
+				{
+					return MapResult::Failed;
+				}
+
+				data = static_cast<const unsigned char *>(mapped.pData);
+				pitch = mapped.RowPitch;
+
+				return MapResult::Ready;
+			}
+			virtual void Unmap(void *staging) override
+			{
+				this->mContext->Unmap(static_cast<ID3D11Texture2D *>(staging), 0);
+			}
+
+		private:
+			ID3D11Device *const mDevice;
+			ID3D11DeviceContext *const mContext;
+		};
+
 		class D3D11EffectCompiler : private boost::noncopyable
 		{
 		public:
-			D3D11EffectCompiler(const EffectTree &ast) : mAST(ast), mEffect(nullptr), mCurrentInParameterBlock(false), mCurrentInFunctionBlock(false), mCurrentInDeclaratorList(false), mCurrentGlobalSize(0), mCurrentGlobalStorageSize(0), mFatal(false)
+			D3D11EffectCompiler(const EffectTree &ast) : mAST(ast), mEffect(nullptr), mCurrentInParameterBlock(false), mCurrentInFunctionBlock(false), mCurrentInDeclaratorList(false), mCurrentInFusedShader(false), mCurrentGlobalSize(0), mCurrentGlobalStorageSize(0), mFatal(false)
 			{
 			}
 
@@ -65,6 +211,14 @@ namespace ReShade { namespace Runtimes
 				this->mEffect->mConstantBuffers.push_back(nullptr);
 				this->mEffect->mConstantStorages.push_back(nullptr);
 
+				// Textures only used in disjoint pass ranges can share a single allocation
+				this->mTexturePlan = PlanTextureMemory(this->mAST);
+
+				if (!this->mTexturePlan.Aliases.empty())
+				{
+					LOG(INFO) << "> Aliasing " << this->mTexturePlan.Aliases.size() << " effect textures with disjoint lifetimes, saving " << this->mTexturePlan.SavedBytes << " of " << this->mTexturePlan.TotalBytes << " bytes.";
+				}
+
 				const EffectNodes::Root *node = &this->mAST[EffectTree::Root].As<EffectNodes::Root>();
 
 				do
@@ -300,6 +454,12 @@ namespace ReShade { namespace Runtimes
 						return format;
 				}
 			}
+			bool HasSRGBBackBuffer() const
+			{
+				const DXGI_FORMAT format = this->mEffect->mRuntime->mSwapChainDesc.BufferDesc.Format;
+
+				return MakeSRGBFormat(format) != MakeNonSRBFormat(format);
+			}
 			static std::size_t D3D11_SAMPLER_DESC_HASH(const D3D11_SAMPLER_DESC &s) 
 			{
 				const unsigned char *p = reinterpret_cast<const unsigned char *>(&s);
@@ -557,6 +717,20 @@ namespace ReShade { namespace Runtimes
 			{
 				std::string part1, part2, part3, part4;
 
+				if (this->mCurrentInFusedShader && node.Operator == EffectNodes::Expression::Tex && this->mAST[node.Operands[0]].Is<EffectNodes::LValue>())
+				{
+					const EffectNodes::Variable &sampler = this->mAST[this->mAST[node.Operands[0]].As<EffectNodes::LValue>().Reference].As<EffectNodes::Variable>();
+
+					// The color of the previous pass in the chain is kept in a register instead of going through the back buffer
+					if (IsBackBufferSampler(this->mAST, sampler))
+					{
+						const bool srgb = sampler.Properties[EffectNodes::Variable::SRGBTexture] != 0 && this->mAST[sampler.Properties[EffectNodes::Variable::SRGBTexture]].As<EffectNodes::Literal>().Value.Bool[0] != 0;
+
+						this->mCurrentSource += (srgb && HasSRGBBackBuffer()) ? "__fusedColor[1]" : "__fusedColor[0]";
+						return;
+					}
+				}
+
 				switch (node.Operator)
 				{
 					case EffectNodes::Expression::Negate:
@@ -1717,6 +1891,21 @@ namespace ReShade { namespace Runtimes
 						this->mErrors += PrintLocation(node.Location) + "warning: texture property on backbuffer textures are ignored.\n";
 					}
 				}
+				else if (this->mTexturePlan.Aliases.count(node.Index) != 0)
+				{
+					const D3D11Texture *owner = static_cast<const D3D11Texture *>(this->mEffect->GetTexture(this->mAST[this->mTexturePlan.Aliases.at(node.Index)].As<EffectNodes::Variable>().Name));
+
+					obj->mTexture = owner->mTexture;
+					obj->mTexture->AddRef();
+					obj->mShaderResourceView[0] = owner->mShaderResourceView[0];
+					obj->mShaderResourceView[0]->AddRef();
+					obj->mShaderResourceView[1] = owner->mShaderResourceView[1];
+
+					if (obj->mShaderResourceView[1] != nullptr)
+					{
+						obj->mShaderResourceView[1]->AddRef();
+					}
+				}
 				else
 				{
 					HRESULT hr = this->mEffect->mRuntime->mDevice->CreateTexture2D(&texdesc, nullptr, &obj->mTexture);
@@ -2104,11 +2293,11 @@ namespace ReShade { namespace Runtimes
 					this->mEffect->mConstantStorages.push_back(storage);
 				}
 			}
-			void Visit(const EffectNodes::Function &node)
+			void Visit(const EffectNodes::Function &node, const char *name = nullptr)
 			{
 				this->mCurrentSource += PrintType(node.ReturnType);
 				this->mCurrentSource += ' ';
-				this->mCurrentSource += node.Name;
+				this->mCurrentSource += (name != nullptr) ? name : node.Name;
 				this->mCurrentSource += '(';
 
 				if (node.Parameters != EffectTree::Null)
@@ -2162,22 +2351,27 @@ namespace ReShade { namespace Runtimes
 			void Visit(const EffectNodes::Technique &node)
 			{
 				std::vector<D3D11Technique::Pass> passes;
-				const EffectNodes::Pass *pass = &this->mAST[node.Passes].As<EffectNodes::Pass>();
+				const std::vector<EffectPassInfo> infos = AnalyzeTechnique(this->mAST, node);
 
-				do
+				for (std::size_t i = 0; i < infos.size(); ++i)
 				{
-					Visit(*pass, passes);
+					this->mCurrentFusedPasses.push_back(&this->mAST[infos[i].Pass].As<EffectNodes::Pass>());
 
-					if (pass->NextPass != EffectTree::Null)
+					// Keep collecting passes as long as the next one only reads the back buffer at the current pixel, so the whole chain is evaluated in a single draw
+					if (i + 1 < infos.size() && infos[i + 1].Fusable)
 					{
-						pass = &this->mAST[pass->NextPass].As<EffectNodes::Pass>();
+						continue;
 					}
-					else
+
+					if (this->mCurrentFusedPasses.size() > 1)
 					{
-						pass = nullptr;
+						LOG(INFO) << "> Fusing " << this->mCurrentFusedPasses.size() << " passes of technique '" << node.Name << "' into a single draw.";
 					}
+
+					Visit(*this->mCurrentFusedPasses.back(), passes);
+
+					this->mCurrentFusedPasses.clear();
 				}
-				while (pass != nullptr);
 
 				D3D11Technique::Description objdesc;
 				objdesc.Passes = static_cast<unsigned int>(passes.size());
@@ -2185,6 +2379,15 @@ namespace ReShade { namespace Runtimes
 				D3D11Technique *obj = new D3D11Technique(this->mEffect, objdesc);
 				obj->mPasses = std::move(passes);
 
+				// Fused passes share the same schedule, so only the last one of each chain counts
+				for (std::size_t i = 0; i < infos.size(); ++i)
+				{
+					if (i + 1 == infos.size() || !infos[i + 1].Fusable)
+					{
+						obj->AddPassSchedule(infos[i].Interval, infos[i].Phase);
+					}
+				}
+
 				if (node.Annotations != EffectTree::Null)
 				{
 					Visit(this->mAST[node.Annotations].As<EffectNodes::Annotation>(), *obj);
@@ -2205,7 +2408,11 @@ namespace ReShade { namespace Runtimes
 				pass.Viewport.MaxDepth = 1.0f;
 				ZeroMemory(pass.RT, sizeof(pass.RT));
 				ZeroMemory(pass.RTSRV, sizeof(pass.RTSRV));
+				ZeroMemory(pass.ScaledRT, sizeof(pass.ScaledRT));
+				ZeroMemory(pass.ScaledRTSRV, sizeof(pass.ScaledRTSRV));
 				pass.SRV = this->mEffect->mShaderResources;
+				pass.SamplesBackBuffer = AnalyzePass(this->mAST, *this->mCurrentFusedPasses.front()).BackBufferAccess != EffectPassInfo::Access::None;
+				pass.WritesBackBuffer = node.States[EffectNodes::Pass::RenderTarget0] == 0;
 
 				if (node.States[EffectNodes::Pass::VertexShader] != 0)
 				{
@@ -2213,7 +2420,14 @@ namespace ReShade { namespace Runtimes
 				}
 				if (node.States[EffectNodes::Pass::PixelShader] != 0)
 				{
-					VisitShader(this->mAST[node.States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>(), EffectNodes::Pass::PixelShader, pass);
+					if (this->mCurrentFusedPasses.size() > 1)
+					{
+						VisitFusedShader(pass);
+					}
+					else
+					{
+						VisitShader(this->mAST[node.States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>(), EffectNodes::Pass::PixelShader, pass);
+					}
 				}
 
 				int srgb = 0;
@@ -2280,6 +2494,18 @@ namespace ReShade { namespace Runtimes
 					pass.Viewport.Height = static_cast<FLOAT>(this->mEffect->mRuntime->mSwapChainDesc.BufferDesc.Height);
 				}
 
+				pass.ScaledViewport = pass.Viewport;
+
+				if (node.States[EffectNodes::Pass::RenderScale] != 0 && this->mAST[node.States[EffectNodes::Pass::RenderScale]].As<EffectNodes::Literal>().Value.Float[0] != 1.0f)
+				{
+					VisitScaledTargets(node, this->mAST[node.States[EffectNodes::Pass::RenderScale]].As<EffectNodes::Literal>().Value.Float[0], pass);
+
+					if (this->mFatal)
+					{
+						return;
+					}
+				}
+
 				D3D11_DEPTH_STENCIL_DESC ddesc;
 				ddesc.DepthEnable = node.States[EffectNodes::Pass::DepthEnable] != 0 && this->mAST[node.States[EffectNodes::Pass::DepthEnable]].As<EffectNodes::Literal>().Value.Bool[0];
 				ddesc.DepthWriteMask = (node.States[EffectNodes::Pass::DepthWriteMask] == 0 || this->mAST[node.States[EffectNodes::Pass::DepthWriteMask]].As<EffectNodes::Literal>().Value.Bool[0]) ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
@@ -2352,30 +2578,218 @@ namespace ReShade { namespace Runtimes
 
 				passes.push_back(std::move(pass));
 			}
-			void VisitShader(const EffectNodes::Function &node, unsigned int shadertype, D3D11Technique::Pass &pass)
+			void VisitScaledTargets(const EffectNodes::Pass &node, FLOAT scale, D3D11Technique::Pass &pass)
+			{
+				if (!VisitUpsampleShader())
+				{
+					return;
+				}
+
+				pass.ScaledViewport.Width = std::max(std::floor(pass.Viewport.Width * scale), 1.0f);
+				pass.ScaledViewport.Height = std::max(std::floor(pass.Viewport.Height * scale), 1.0f);
+
+				// Draw into reduced resolution copies of all render targets, which are then upsampled into the actual targets after the pass
+				for (unsigned int i = 0; i < 8; ++i)
+				{
+					if (pass.RT[i] == nullptr)
+					{
+						continue;
+					}
+
+					D3D11_RENDER_TARGET_VIEW_DESC rtvdesc;
+					pass.RT[i]->GetDesc(&rtvdesc);
+
+					const CD3D11_TEXTURE2D_DESC texdesc(rtvdesc.Format, static_cast<UINT>(pass.ScaledViewport.Width), static_cast<UINT>(pass.ScaledViewport.Height), 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
+					ID3D11Texture2D *texture = nullptr;
+
+					HRESULT hr = this->mEffect->mRuntime->mDevice->CreateTexture2D(&texdesc, nullptr, &texture);
+
+					if (FAILED(hr))
+					{
+						this->mErrors += PrintLocation(node.Location) + "error: 'CreateTexture2D' failed!\n";
+						this->mFatal = true;
+						return;
+					}
+
+					hr = this->mEffect->mRuntime->mDevice->CreateRenderTargetView(texture, nullptr, &pass.ScaledRT[i]);
+
+					if (SUCCEEDED(hr))
+					{
+						hr = this->mEffect->mRuntime->mDevice->CreateShaderResourceView(texture, nullptr, &pass.ScaledRTSRV[i]);
+					}
+
+					texture->Release();
+
+					if (FAILED(hr))
+					{
+						this->mErrors += PrintLocation(node.Location) + "error: 'CreateRenderTargetView' failed!\n";
+						this->mFatal = true;
+						return;
+					}
+				}
+
+				LOG(INFO) << "> Rendering pass at " << static_cast<UINT>(pass.ScaledViewport.Width) << "x" << static_cast<UINT>(pass.ScaledViewport.Height) << " instead of " << static_cast<UINT>(pass.Viewport.Width) << "x" << static_cast<UINT>(pass.Viewport.Height) << ".";
+			}
+			bool VisitUpsampleShader()
 			{
-				std::string profile;
+				if (this->mEffect->mUpsamplePS != nullptr)
+				{
+					return true;
+				}
+
+				const std::string source =
+					"Texture2D __upsampleTexture : register(t0);\n"
+					"SamplerState __upsampleSampler : register(s0);\n"
+					"void __upsampleVS(uint id : SV_VERTEXID, out float4 position : SV_POSITION, out float2 texcoord : TEXCOORD0)\n{\n"
+					"texcoord = float2(id == 2 ? 2.0 : 0.0, id == 1 ? 2.0 : 0.0);\n"
+					"position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n"
+					"float4 __upsamplePS(float4 position : SV_POSITION, float2 texcoord : TEXCOORD0) : SV_TARGET\n{\n"
+					"return __upsampleTexture.Sample(__upsampleSampler, texcoord);\n}\n";
+
+				LOG(TRACE) << "> Compiling upsample shader:\n\n" << source.c_str() << "\n";
+
+				ID3DBlob *compiled[2] = { nullptr, nullptr }, *errors = nullptr;
+
+				HRESULT hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, "__upsampleVS", ("vs_" + GetShaderProfile()).c_str(), D3DCOMPILE_ENABLE_STRICTNESS, 0, &compiled[0], &errors);
+
+				if (SUCCEEDED(hr))
+				{
+					hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, "__upsamplePS", ("ps_" + GetShaderProfile()).c_str(), D3DCOMPILE_ENABLE_STRICTNESS, 0, &compiled[1], &errors);
+				}
+				if (errors != nullptr)
+				{
+					this->mErrors += std::string(static_cast<const char *>(errors->GetBufferPointer()), errors->GetBufferSize());
+
+					errors->Release();
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = this->mEffect->mRuntime->mDevice->CreateVertexShader(compiled[0]->GetBufferPointer(), compiled[0]->GetBufferSize(), nullptr, &this->mEffect->mUpsampleVS);
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = this->mEffect->mRuntime->mDevice->CreatePixelShader(compiled[1]->GetBufferPointer(), compiled[1]->GetBufferSize(), nullptr, &this->mEffect->mUpsamplePS);
+				}
+				if (SUCCEEDED(hr))
+				{
+					const CD3D11_SAMPLER_DESC desc(D3D11_DEFAULT);
+
+					hr = this->mEffect->mRuntime->mDevice->CreateSamplerState(&desc, &this->mEffect->mUpsampleSampler);
+				}
+
+				for (ID3DBlob *blob : compiled)
+				{
+					if (blob != nullptr)
+					{
+						blob->Release();
+					}
+				}
+
+				if (FAILED(hr))
+				{
+					this->mErrors += "error: failed to create upsample shader!\n";
+					this->mFatal = true;
+					return false;
+				}
+
+				return true;
+			}
+			void VisitFusedShader(D3D11Technique::Pass &pass)
+			{
+				const std::size_t length = this->mCurrentSource.length();
+				const bool saturate = this->mEffect->mRuntime->mSwapChainDesc.BufferDesc.Format != DXGI_FORMAT_R16G16B16A16_FLOAT;
+				const EffectNodes::Function &entry = this->mAST[this->mCurrentFusedPasses[0]->States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>();
+				const std::string name = "__" + std::string(entry.Name) + "_Fused";
+
+				this->mCurrentSource += "static float4 __fusedColor[2];\n";
+				this->mCurrentSource += "float4 __fusedToSRGB(float4 c) { return float4(c.rgb <= 0.0031308 ? c.rgb * 12.92 : 1.055 * pow(abs(c.rgb), 1.0 / 2.4) - 0.055, c.a); }\n";
+				this->mCurrentSource += "float4 __fusedToLinear(float4 c) { return float4(c.rgb <= 0.04045 ? c.rgb / 12.92 : pow(abs((c.rgb + 0.055) / 1.055), 2.4), c.a); }\n";
+
+				this->mCurrentInFusedShader = true;
+
+				for (std::size_t i = 1; i < this->mCurrentFusedPasses.size(); ++i)
+				{
+					Visit(this->mAST[this->mCurrentFusedPasses[i]->States[EffectNodes::Pass::PixelShader]].As<EffectNodes::Function>(), (name + std::to_string(i)).c_str());
+				}
+
+				this->mCurrentInFusedShader = false;
+
+				std::string parameters, arguments;
+				unsigned int index = 0;
+
+				for (EffectTree::Index parameter = entry.Parameters; parameter != EffectTree::Null; parameter = this->mAST[parameter].As<EffectNodes::Variable>().NextDeclaration, ++index)
+				{
+					const EffectNodes::Variable &variable = this->mAST[parameter].As<EffectNodes::Variable>();
 
+					if (index != 0)
+					{
+						parameters += ", ";
+						arguments += ", ";
+					}
+
+					parameters += PrintTypeWithQualifiers(variable.Type) + " __p" + std::to_string(index);
+
+					if (variable.Type.IsArray())
+					{
+						parameters += '[' + std::to_string(variable.Type.ArrayLength) + ']';
+					}
+					if (variable.Semantic != nullptr)
+					{
+						parameters += " : " + ConvertSemantic(variable.Semantic);
+					}
+
+					arguments += "__p" + std::to_string(index);
+				}
+
+				this->mCurrentSource += "float4 " + name + "(" + parameters + ") : SV_TARGET\n{\n";
+				this->mCurrentSource += "float4 __color = " + std::string(entry.Name) + "(" + arguments + ");\n";
+
+				for (std::size_t i = 1; i < this->mCurrentFusedPasses.size(); ++i)
+				{
+					const EffectNodes::Pass &previous = *this->mCurrentFusedPasses[i - 1];
+					const bool srgb = previous.States[EffectNodes::Pass::SRGBWriteEnable] != 0 && this->mAST[previous.States[EffectNodes::Pass::SRGBWriteEnable]].As<EffectNodes::Literal>().Value.Bool[0] != 0 && HasSRGBBackBuffer();
+					const std::string color = saturate ? "saturate(__color)" : "__color";
+
+					// Emulate the round trip through the back buffer, so both gamma and linear samplers see the same values as before
+					if (srgb)
+					{
+						this->mCurrentSource += "__fusedColor[1] = " + color + ";\n__fusedColor[0] = __fusedToSRGB(__fusedColor[1]);\n";
+					}
+					else
+					{
+						this->mCurrentSource += "__fusedColor[0] = " + color + ";\n__fusedColor[1] = __fusedToLinear(__fusedColor[0]);\n";
+					}
+
+					this->mCurrentSource += "__color = " + name + std::to_string(i) + "(" + arguments + ");\n";
+				}
+
+				this->mCurrentSource += "return __color;\n}\n";
+
+				VisitShader(entry, EffectNodes::Pass::PixelShader, pass, name.c_str());
+
+				this->mCurrentSource.resize(length);
+			}
+			std::string GetShaderProfile() const
+			{
 				switch (this->mEffect->mRuntime->mDevice->GetFeatureLevel())
 				{
 					default:
 					case D3D_FEATURE_LEVEL_11_0:
-						profile = "5_0";
-						break;
+						return "5_0";
 					case D3D_FEATURE_LEVEL_10_1:
-						profile = "4_1";
-						break;
+						return "4_1";
 					case D3D_FEATURE_LEVEL_10_0:
-						profile = "4_0";
-						break;
+						return "4_0";
 					case D3D_FEATURE_LEVEL_9_1:
 					case D3D_FEATURE_LEVEL_9_2:
-						profile = "4_0_level_9_1";
-						break;
+						return "4_0_level_9_1";
 					case D3D_FEATURE_LEVEL_9_3:
-						profile = "4_0_level_9_3";
-						break;
+						return "4_0_level_9_3";
 				}
+			}
+			void VisitShader(const EffectNodes::Function &node, unsigned int shadertype, D3D11Technique::Pass &pass, const char *entrypoint = nullptr)
+			{
+				std::string profile = GetShaderProfile();
 
 				switch (shadertype)
 				{
@@ -2413,11 +2827,16 @@ namespace ReShade { namespace Runtimes
 
 				source += this->mCurrentSource;
 
-				LOG(TRACE) << "> Compiling shader '" << node.Name << "':\n\n" << source.c_str() << "\n";
+				if (entrypoint == nullptr)
+				{
+					entrypoint = node.Name;
+				}
+
+				LOG(TRACE) << "> Compiling shader '" << entrypoint << "':\n\n" << source.c_str() << "\n";
 
 				ID3DBlob *compiled = nullptr, *errors = nullptr;
 
-				HRESULT hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, node.Name, profile.c_str(), flags, 0, &compiled, &errors);
+				HRESULT hr = D3DCompile(source.c_str(), source.length(), nullptr, nullptr, nullptr, entrypoint, profile.c_str(), flags, 0, &compiled, &errors);
 
 				if (errors != nullptr)
 				{
@@ -2461,8 +2880,10 @@ namespace ReShade { namespace Runtimes
 			std::unordered_map<std::size_t, std::size_t> mSamplerDescs;
 			std::string mCurrentGlobalConstants;
 			UINT mCurrentGlobalSize, mCurrentGlobalStorageSize;
+			EffectTexturePlan mTexturePlan;
 			std::string mCurrentBlockName;
-			bool mCurrentInParameterBlock, mCurrentInFunctionBlock, mCurrentInDeclaratorList;
+			bool mCurrentInParameterBlock, mCurrentInFunctionBlock, mCurrentInDeclaratorList, mCurrentInFusedShader;
+			std::vector<const EffectNodes::Pass *> mCurrentFusedPasses;
 		};
 
 		template <typename T>
@@ -2727,7 +3148,7 @@ namespace ReShade { namespace Runtimes
 
 	D3D11Runtime::D3D11Runtime(ID3D11Device *device, IDXGISwapChain *swapchain) : mDevice(device), mSwapChain(swapchain), mImmediateContext(nullptr), mStateBlock(new D3D11StateBlock(device)), mBackBuffer(nullptr), mBackBufferReplacement(nullptr), mBackBufferTexture(nullptr), mBackBufferTextureSRV(), mBackBufferTargets(), mDepthStencil(nullptr), 
 		mDepthStencilReplacement(nullptr), mDepthStencilTexture(nullptr), mDepthStencilTextureSRV(nullptr), 
-		mLost(true), lastMRTsCount(0)
+		mLost(true), mTraceFormat(ImageFormat::FastPNG), mStreamFrame(0), mStreamLength(0), mStreamInterval(1), mStreamCaptures(0), lastMRTsCount(0)
 	{
 		mIsDumpingTrace = false;
 		mToggleDebugViewID = -1;
@@ -2743,6 +3164,9 @@ namespace ReShade { namespace Runtimes
 
 		assert(this->mImmediateContext != nullptr);
 
+		this->mReadbackBackend.reset(new D3D11ReadbackBackend(this->mDevice, this->mImmediateContext));
+		this->mReadbackQueue.reset(new ReadbackQueue(*this->mReadbackBackend, 2, 32));
+
 		ZeroMemory(&this->mSwapChainDesc, sizeof(DXGI_SWAP_CHAIN_DESC));
 
 		IDXGIDevice *dxgidevice = nullptr;
@@ -2775,6 +3199,8 @@ namespace ReShade { namespace Runtimes
 
 		assert(this->mLost);
 
+		this->mReadbackQueue.reset();
+
 		this->mImmediateContext->Release();
 		this->mDevice->Release();
 		this->mSwapChain->Release();
@@ -2853,6 +3279,12 @@ namespace ReShade { namespace Runtimes
 	}
 	void D3D11Runtime::OnDeleteInternal()
 	{
+		EndFrameStream();
+
+		// Finish all dumps still in flight before the device objects go away
+		this->mReadbackQueue->Flush();
+		this->mReadbackQueue->Clear();
+
 		Runtime::OnDelete();
 
 		nvgDeleteD3D11(this->mNVG);
@@ -2914,6 +3346,12 @@ namespace ReShade { namespace Runtimes
 			}
 		}
 	}
+	void D3D11Runtime::OnDrawCommandList(unsigned int vertices, unsigned int drawCalls)
+	{
+		CSLock lock(this->mCS);
+
+		Runtime::OnDraw(vertices, drawCalls);
+	}
 
 	void D3D11Runtime::OnExecuteCommandList(ID3D11DeviceContext *context, ID3D11CommandList *pCommandList, BOOL RestoreContextState) {
 		
@@ -2964,7 +3402,7 @@ namespace ReShade { namespace Runtimes
 						continue;
 					}
 
-					DumpTexture2D( DumpRootPath / drawEventString / (std::string("RT") + std::to_string(RTCount - 1)),  texture);
+					DumpTexture2D( DumpRootPath / drawEventString / (std::string("RT") + std::to_string(RTCount - 1)),  texture, 0, drawCounter, RT);
 
 					SAFE_RELEASE(texture);
 
@@ -2979,121 +3417,83 @@ namespace ReShade { namespace Runtimes
 		}
 	}
 
-	void D3D11Runtime::DumpReadableTexture2D(boost::filesystem::path rootPathNoExt, ID3D11Texture2D* texture)
+	void D3D11Runtime::DumpReadableTexture2D(boost::filesystem::path rootPathNoExt, ID3D11Texture2D* texture, unsigned int bucket, unsigned int draw, const void *target)
 	{
 		D3D11_TEXTURE2D_DESC desc;
 		texture->GetDesc(&desc);
 
 		LOG(INFO) << "Texture info: " << desc.Width << "x" << desc.Height << " format: " << desc.Format << " Dumping to: " << rootPathNoExt.string();
 
-		ID3D11Texture2D* textureStaging = texture;
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		HRESULT hr = this->mImmediateContext->Map(textureStaging, 0, D3D11_MAP_READ, 0, &mapped);
+		TexelFormat format;
 
-		if (FAILED(hr))
+		if (!GetTexelFormat(desc.Format, format))
 		{
-			LOG(TRACE) << "Failed to map staging resource for texture dump! HRESULT is '" << hr << "'.";
 			return;
 		}
 
-		BYTE *pMapped = static_cast<BYTE *>(mapped.pData);
-
-		// Time to save to disk
-		if (desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM
-			|| desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
-			|| desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM
-			|| desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
-			|| desc.Format == DXGI_FORMAT_B8G8R8A8_TYPELESS)
-
+		const auto image = std::make_shared<DumpWriter::Image>();
+		image->Path = rootPathNoExt;
+		image->Format = this->mTraceFormat;
+		image->Bundle = this->mTraceBundle;
+		image->Type = TraceBundle::RecordType::Image;
+		image->Bucket = bucket;
+		image->Draw = draw;
+		image->Target = target;
+		image->Width = desc.Width;
+		image->Height = desc.Height;
+		image->SourceFormat = format;
+
+		const GBufferProfile *const profile = FindGBufferProfile(this->mDecodeProfiles, desc.Format, rootPathNoExt.filename().string());
+
+		if (profile != nullptr)
 		{
-			const std::size_t dataSize = desc.Width * desc.Height * 4;
-
-			if (dataSize > 0)
-			{
-				unsigned char* pMem = new unsigned char[dataSize];
-				::memset(pMem, 0, dataSize);
-
-				int* data = (int*)mapped.pData;
-
-				unsigned char* pMemPoint = pMem;
-				unsigned char* pMappedPoint = pMapped;
+			image->Decode = std::make_shared<const GBufferProfile>(*profile);
+		}
 
-				// Will save as LDR PNG file
-				const UINT pitch = desc.Width * 4;
+		if (image->Bundle)
+		{
+			image->Path = GetTraceName(rootPathNoExt);
+		}
 
-				for (UINT y = 0; y < desc.Height; ++y)
-				{
-					CopyMemory(pMemPoint, pMappedPoint, std::min(pitch, static_cast<UINT>(mapped.RowPitch)));
+		// Only copy the rows once the GPU finished the copy, converting and encoding happens on the dump writer threads
+		const ReadbackQueue::Description readback = { desc.Width, desc.Height, static_cast<unsigned int>(desc.Format) };
 
-					for (UINT x = 0; x < pitch; x += 4)
-					{
-						pMemPoint[x + 3] = 0xFF;
+		const ReadbackQueue::Callback complete = [this, image](const unsigned char *data, std::size_t pitch)
+		{
+			if (data == nullptr)
+			{
+				LOG(TRACE) << "Failed to map staging resource for texture dump of " << image->Path.string() << "!";
+				return;
+			}
 
-						if (desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM
-							|| desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
-							|| desc.Format == DXGI_FORMAT_B8G8R8A8_TYPELESS)
-						{
-							std::swap(pMemPoint[x + 0], pMemPoint[x + 2]);
-						}
-					}
+			const std::size_t size = image->Width * GetTexelSize(image->SourceFormat);
+			image->Data.resize(size * image->Height);
 
-					pMemPoint += pitch;
-					pMappedPoint += mapped.RowPitch;
-				}
+			for (UINT y = 0; y < image->Height; ++y)
+			{
+				CopyMemory(image->Data.data() + y * size, data + y * pitch, std::min(size, pitch));
+			}
 
+			// May block until the writers caught up
+			this->mDumpWriter.Submit(std::move(*image));
+		};
 
-				boost::filesystem::path imagePath = rootPathNoExt.string() + ".png";
-				//Make sure parent folder exists
-				boost::system::error_code returnedError;
-				boost::filesystem::create_directories(imagePath.parent_path(), returnedError);
-				//LOG(INFO) << "Dumping image to: " << imagePath.string();
-				//LOG(INFO) << "Width: " << desc.Width << " Height: " << desc.Height;
-				// Dump to disk
-				if (!stbi_write_png(imagePath.string().c_str(), desc.Width, desc.Height, 4, pMem, 0))
-				{
-					LOG(ERROR) << "Failed to write screenshot to " << imagePath.string() << "!";
-				}
+		// The queue drops requests rather than waiting once all staging resources are in flight, but a trace has to contain every draw, so wait for them here instead
+		if (!this->mReadbackQueue->Enqueue(texture, readback, complete))
+		{
+			this->mReadbackQueue->Flush();
 
-				delete[] pMem;
+			if (!this->mReadbackQueue->Enqueue(texture, readback, complete))
+			{
+				LOG(TRACE) << "Failed to create staging resource for texture dump of " << image->Path.string() << "!";
 			}
-
 		}
-
-		this->mImmediateContext->Unmap(textureStaging, 0);
 	}
 
-	void D3D11Runtime::DumpTexture2D(boost::filesystem::path rootPathNoExt,ID3D11Texture2D* texture)
+	void D3D11Runtime::DumpTexture2D(boost::filesystem::path rootPathNoExt,ID3D11Texture2D* texture, unsigned int bucket, unsigned int draw, const void *target)
 	{
-		D3D11_TEXTURE2D_DESC desc;
-		texture->GetDesc(&desc);
-
-		//-
-		D3D11_TEXTURE2D_DESC copydesc;
-		ZeroMemory(&copydesc, sizeof(D3D11_TEXTURE2D_DESC));
-		copydesc.Width = desc.Width;
-		copydesc.Height = desc.Height;
-		copydesc.ArraySize = 1;
-		copydesc.MipLevels = 1;
-		copydesc.Format = desc.Format;
-		copydesc.SampleDesc.Count = 1;
-		copydesc.SampleDesc.Quality = 0;
-		copydesc.Usage = D3D11_USAGE_STAGING;
-		copydesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-
-		ID3D11Texture2D *textureStaging = nullptr;
-		HRESULT hr = this->mDevice->CreateTexture2D(&copydesc, nullptr, &textureStaging); 
-
-		if (FAILED(hr))
-		{
-			LOG(TRACE) << "Failed to create staging resource for texture dump! HRESULT is '" << hr << "'.";
-			return;
-		}
-
-		this->mImmediateContext->CopyResource(textureStaging, texture);
-
-		DumpReadableTexture2D(rootPathNoExt, textureStaging);
-
-		textureStaging->Release();
+		// The readback queue copies into a staging resource of its own already
+		DumpReadableTexture2D(rootPathNoExt, texture, bucket, draw, target);
 	}
 
 	void D3D11Runtime::OnSetMRT(UINT NumViews, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView) 
@@ -3116,7 +3516,10 @@ namespace ReShade { namespace Runtimes
 		{
 			LOG(INFO) << "Trace dump completed.";
 			swapBufferCount--;
-			if (swapBufferCount == 0) mIsDumpingTrace = false;
+			if (swapBufferCount == 0) {
+				mIsDumpingTrace = false;
+				mTraceBundle.reset();
+			}
 		}
 
 		if (this->mLost)
@@ -3125,10 +3528,16 @@ namespace ReShade { namespace Runtimes
 			return;
 		}
 
+		this->mReadbackQueue->Update();
+
 		DetectDepthSource();
 
 		// Capture device state
-		this->mStateBlock->Capture();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Capture");
+
+			this->mStateBlock->Capture();
+		}
 
 		// Resolve backbuffer
 		if (this->mBackBufferReplacement != this->mBackBuffer)
@@ -3136,6 +3545,12 @@ namespace ReShade { namespace Runtimes
 			this->mImmediateContext->ResolveSubresource(this->mBackBuffer, 0, this->mBackBufferReplacement, 0, this->mSwapChainDesc.BufferDesc.Format);
 		}
 
+		// Capture streamed render targets before post processing changes the back buffer
+		if (this->mStreamBundle != nullptr)
+		{
+			UpdateFrameStream();
+		}
+
 		// Setup real backbuffer
 		this->mImmediateContext->OMSetRenderTargets(1, &this->mBackBufferTargets[0], nullptr);
 
@@ -3157,7 +3572,11 @@ namespace ReShade { namespace Runtimes
 		}
 
 		// Apply previous device state
-		this->mStateBlock->Apply();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Apply");
+
+			this->mStateBlock->Apply();
+		}
 	}
 	void D3D11Runtime::OnGetBackBuffer(ID3D11Texture2D *&buffer)
 	{
@@ -3688,10 +4107,213 @@ namespace ReShade { namespace Runtimes
 	{
 		LOG(INFO) << "D3D11 - Beginning to dump frame into " << path.string().c_str();
 		DumpRootPath = path;
+		mTraceFormat = this->mDumpFormat;
+		mTraceBundle.reset();
+
+		if (this->mDumpBundle)
+		{
+			mTraceBundle = std::make_shared<TraceBundleWriter>(path.string() + ".rstb", this->mDumpTiles);
+
+			if (!mTraceBundle->IsOpen())
+			{
+				LOG(ERROR) << "Failed to create frame trace bundle, falling back to a folder.";
+				mTraceBundle.reset();
+			}
+		}
+
 		mIsDumpingTrace = true;
 		swapBufferCount = 2;
 	}
 
+	void D3D11Runtime::ToggleFrameStream(const boost::filesystem::path &path)
+	{
+		if (this->mStreamBundle != nullptr)
+		{
+			LOG(INFO) << "D3D11 - Stopping frame stream after " << this->mStreamCaptures << " captured frames.";
+
+			EndFrameStream();
+			return;
+		}
+
+		this->mStreamFrame = this->mStreamCaptures = 0;
+
+		std::vector<ID3D11RenderTargetView *> views;
+
+		for (int index : SavedViews)
+		{
+			if (index >= 0 && static_cast<std::size_t>(index) < WatchedRTs.size())
+			{
+				views.push_back(WatchedRTs[index]);
+			}
+		}
+
+		if (views.empty() && mToggleDebugViewID >= 0 && static_cast<std::size_t>(mToggleDebugViewID) < WatchedRTs.size())
+		{
+			views.push_back(WatchedRTs[mToggleDebugViewID]);
+		}
+
+		// Without any render target picked in the debug view, stream the back buffer
+		if (views.empty())
+		{
+			views.push_back(nullptr);
+		}
+
+		for (ID3D11RenderTargetView *view : views)
+		{
+			StreamTarget target = { };
+			target.View = view;
+
+			if (view != nullptr)
+			{
+				ID3D11Resource *resource = nullptr;
+				view->GetResource(&resource);
+
+				const HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void **>(&target.Source));
+
+				resource->Release();
+
+				if (FAILED(hr))
+				{
+					continue;
+				}
+			}
+			else
+			{
+				target.Source = this->mBackBuffer;
+				target.Source->AddRef();
+			}
+
+			target.Source->GetDesc(&target.Desc);
+
+			// Deltas are computed on the raw texels, so only 8-bit formats can be streamed
+			if (!GetTexelFormat(target.Desc.Format, target.Format) || (target.Format != TexelFormat::RGBA8 && target.Format != TexelFormat::BGRA8) || target.Desc.SampleDesc.Count > 1)
+			{
+				LOG(WARNING) << "Skipping render target " << view << " with format " << target.Desc.Format << " for frame stream.";
+
+				target.Source->Release();
+				continue;
+			}
+
+			target.Previous.resize(target.Desc.Width * target.Desc.Height * 4);
+
+			this->mStreamTargets.push_back(std::move(target));
+		}
+
+		this->mStreamBundle = std::make_shared<TraceBundleWriter>(path.string(), false);
+
+		if (this->mStreamTargets.empty() || !this->mStreamBundle->IsOpen())
+		{
+			LOG(ERROR) << "Failed to start frame stream into " << path.string() << "!";
+
+			EndFrameStream();
+			return;
+		}
+
+		this->mStreamInterval = std::max(this->mStreamFrameInterval, 1u);
+		this->mStreamLength = this->mStreamFrameCount * this->mStreamInterval;
+
+		LOG(INFO) << "D3D11 - Streaming " << this->mStreamTargets.size() << " render targets for " << this->mStreamFrameCount << " frames into " << path.string() << " ...";
+	}
+	void D3D11Runtime::UpdateFrameStream()
+	{
+		if (this->mStreamFrame % this->mStreamInterval == 0)
+		{
+			const unsigned int capture = this->mStreamCaptures++, frame = this->mStreamFrame;
+			const std::shared_ptr<TraceBundleWriter> bundle = this->mStreamBundle;
+
+			char name[16];
+			snprintf(name, 16, "%05u", frame);
+
+			for (std::size_t slot = 0; slot < this->mStreamTargets.size(); ++slot)
+			{
+				const StreamTarget &target = this->mStreamTargets[slot];
+				const ReadbackQueue::Description readback = { target.Desc.Width, target.Desc.Height, static_cast<unsigned int>(target.Desc.Format) };
+				const std::string path = (target.View != nullptr ? "RT" + std::to_string(slot) : std::string("BackBuffer")) + '/' + name;
+
+				// Completions run in order, so each one sees the previous capture of its slot
+				// Streaming must not stall the game, so a capture is skipped when the GPU is behind, deltas are relative to the last stored one anyway
+				this->mReadbackQueue->Enqueue(target.Source, readback, [this, bundle, slot, capture, frame, path](const unsigned char *data, std::size_t pitch)
+				{
+					StreamTarget &target = this->mStreamTargets[slot];
+
+					if (data == nullptr)
+					{
+						// The next delta would be relative to a frame missing from the stream
+						target.Restart = true;
+						return;
+					}
+
+					const bool key = capture % StreamKeyFrameInterval == 0 || target.Restart;
+					target.Restart = false;
+
+					DumpWriter::Image image;
+					image.Path = path;
+					image.Format = ImageFormat::QOI;
+					image.Bundle = bundle;
+					image.Type = key ? TraceBundle::RecordType::KeyFrame : TraceBundle::RecordType::DeltaFrame;
+					image.Bucket = frame;
+					image.Draw = static_cast<unsigned int>(slot);
+					image.Target = target.View;
+					image.Width = target.Desc.Width;
+					image.Height = target.Desc.Height;
+					image.SourceFormat = target.Format;
+					image.Data.resize(target.Desc.Width * target.Desc.Height * 4);
+
+					// Key frames are stored as is, all others as difference to the previous capture, which is kept around for that
+					const UINT size = target.Desc.Width * 4;
+
+					for (UINT y = 0; y < target.Desc.Height; ++y)
+					{
+						const unsigned char *const row = data + y * pitch;
+
+						if (key)
+						{
+							CopyMemory(image.Data.data() + y * size, row, size);
+							CopyMemory(target.Previous.data() + y * size, row, size);
+						}
+						else
+						{
+							ComputeDelta(row, target.Previous.data() + y * size, image.Data.data() + y * size, size);
+						}
+					}
+
+					this->mDumpWriter.Submit(std::move(image));
+				});
+			}
+		}
+
+		if (++this->mStreamFrame >= this->mStreamLength)
+		{
+			LOG(INFO) << "D3D11 - Frame stream completed.";
+
+			EndFrameStream();
+		}
+	}
+	void D3D11Runtime::EndFrameStream()
+	{
+		// Completions of captures still in flight refer to the targets
+		if (this->mStreamBundle != nullptr)
+		{
+			this->mReadbackQueue->Flush();
+		}
+
+		for (StreamTarget &target : this->mStreamTargets)
+		{
+			SAFE_RELEASE(target.Source);
+		}
+
+		this->mStreamTargets.clear();
+		this->mStreamBundle.reset();
+	}
+
+	std::string D3D11Runtime::GetTraceName(const boost::filesystem::path &path) const
+	{
+		// Names in a bundle are relative to the dump root, like the paths of the folder layout
+		const std::string root = DumpRootPath.generic_string(), name = path.generic_string();
+
+		return name.compare(0, root.size(), root) == 0 ? name.substr(std::min(root.size() + 1, name.size())) : name;
+	}
+
 	void D3D11Runtime::ToggleDebugView(bool saveCurrent, bool playSave, bool playNext)
 	{
 		//LOG(INFO) << "D3D11 - Entering debug view.";
@@ -3727,12 +4349,31 @@ namespace ReShade { namespace Runtimes
 
 	}
 
-	D3D11Effect::D3D11Effect(std::shared_ptr<const D3D11Runtime> runtime) : mRuntime(runtime), mRasterizerState(nullptr), mConstantsDirty(true)
+	D3D11Effect::D3D11Effect(std::shared_ptr<const D3D11Runtime> runtime) : mRuntime(runtime), mRasterizerState(nullptr), mUpsampleVS(nullptr), mUpsamplePS(nullptr), mUpsampleSampler(nullptr), mTimingIndex(0), mTimingActive(false), mConstantsDirty(true), mBackBufferTextureDirty(true)
 	{
+		for (TimingQueries &queries : this->mTimings)
+		{
+			queries.Frame = 0;
+			queries.Pending = false;
+			queries.Disjoint = nullptr;
+		}
 	}
 	D3D11Effect::~D3D11Effect()
 	{
 		SAFE_RELEASE(this->mRasterizerState);
+		SAFE_RELEASE(this->mUpsampleVS);
+		SAFE_RELEASE(this->mUpsamplePS);
+		SAFE_RELEASE(this->mUpsampleSampler);
+
+		for (TimingQueries &queries : this->mTimings)
+		{
+			SAFE_RELEASE(queries.Disjoint);
+
+			for (ID3D11Query *query : queries.Timestamps)
+			{
+				query->Release();
+			}
+		}
 
 		for (auto &it : this->mSamplerStates)
 		{
@@ -3776,10 +4417,133 @@ namespace ReShade { namespace Runtimes
 		assert(this->mRuntime->mDefaultDepthStencil != nullptr);
 
 		devicecontext->ClearDepthStencilView(this->mRuntime->mDefaultDepthStencil, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+		// Back buffer may have changed since the last technique
+		this->mBackBufferTextureDirty = true;
 	}
 	void D3D11Effect::End() const
 	{
 	}
+	void D3D11Effect::BeginTimings(unsigned long long frame)
+	{
+		TimingQueries &queries = this->mTimings[this->mTimingIndex];
+
+		// Every query set is still in flight, so this frame goes untimed instead of waiting on the GPU
+		if (queries.Pending)
+		{
+			this->mTimingActive = false;
+			return;
+		}
+
+		if (queries.Disjoint == nullptr)
+		{
+			const D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+
+			if (FAILED(this->mRuntime->mDevice->CreateQuery(&desc, &queries.Disjoint)))
+			{
+				this->mTimingActive = false;
+				return;
+			}
+		}
+
+		queries.Frame = frame;
+		queries.Passes.clear();
+
+		this->mTimingActive = true;
+		this->mRuntime->mImmediateContext->Begin(queries.Disjoint);
+
+		// First timestamp marks the start of post-processing and does not end any pass
+		TimePass(UINT_MAX, UINT_MAX);
+	}
+	void D3D11Effect::TimePass(unsigned int technique, unsigned int pass)
+	{
+		if (!this->mTimingActive)
+		{
+			return;
+		}
+
+		TimingQueries &queries = this->mTimings[this->mTimingIndex];
+
+		if (queries.Passes.size() == queries.Timestamps.size())
+		{
+			const D3D11_QUERY_DESC desc = { D3D11_QUERY_TIMESTAMP, 0 };
+			ID3D11Query *query = nullptr;
+
+			// Without a timestamp here the pass is simply counted towards the next one
+			if (FAILED(this->mRuntime->mDevice->CreateQuery(&desc, &query)))
+			{
+				return;
+			}
+
+			queries.Timestamps.push_back(query);
+		}
+
+		this->mRuntime->mImmediateContext->End(queries.Timestamps[queries.Passes.size()]);
+
+		queries.Passes.emplace_back(technique, pass);
+	}
+	void D3D11Effect::EndTimings()
+	{
+		if (!this->mTimingActive)
+		{
+			return;
+		}
+
+		this->mRuntime->mImmediateContext->End(this->mTimings[this->mTimingIndex].Disjoint);
+
+		this->mTimings[this->mTimingIndex].Pending = true;
+		this->mTimingIndex = (this->mTimingIndex + 1) % ARRAYSIZE(this->mTimings);
+		this->mTimingActive = false;
+	}
+	bool D3D11Effect::GetTimings(unsigned long long &frame, std::vector<PassTiming> &timings)
+	{
+		TimingQueries *oldest = nullptr;
+
+		for (TimingQueries &queries : this->mTimings)
+		{
+			if (queries.Pending && (oldest == nullptr || queries.Frame < oldest->Frame))
+			{
+				oldest = &queries;
+			}
+		}
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+
+		if (oldest == nullptr || this->mRuntime->mImmediateContext->GetData(oldest->Disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			return false;
+		}
+
+		oldest->Pending = false;
+
+		// Timestamps are meaningless if the GPU clock changed in between (e.g. power state transitions)
+		if (disjoint.Disjoint)
+		{
+			return false;
+		}
+
+		std::vector<UINT64> timestamps(oldest->Passes.size());
+
+		for (std::size_t i = 0; i < timestamps.size(); ++i)
+		{
+			if (this->mRuntime->mImmediateContext->GetData(oldest->Timestamps[i], &timestamps[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			{
+				return false;
+			}
+		}
+
+		frame = oldest->Frame;
+		timings.clear();
+
+		for (std::size_t i = 1; i < timestamps.size(); ++i)
+		{
+			const PassTiming timing = { oldest->Passes[i].first, oldest->Passes[i].second, static_cast<float>((timestamps[i] - timestamps[i - 1]) * 1000.0 / disjoint.Frequency) };
+
+			timings.push_back(timing);
+		}
+
+		return true;
+	}
 
 	D3D11Texture::D3D11Texture(D3D11Effect *effect, const Description &desc) : Texture(desc), mEffect(effect), mSource(Source::Memory), mTexture(nullptr), mShaderResourceView(), mRenderTargetView(), mRegister(0)
 	{
@@ -3794,7 +4558,7 @@ namespace ReShade { namespace Runtimes
 		SAFE_RELEASE(this->mTexture);
 	}
 
-	bool D3D11Texture::Update(unsigned int level, const unsigned char *data, std::size_t size)
+	bool D3D11Texture::Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps)
 	{
 		if (data == nullptr || size == 0 || level > this->mDesc.Levels || this->mSource != Source::Memory)
 		{
@@ -3805,9 +4569,13 @@ namespace ReShade { namespace Runtimes
 
 		ID3D11DeviceContext *context = this->mEffect->mRuntime->mImmediateContext;
 
-		context->UpdateSubresource(this->mTexture, level, nullptr, data, static_cast<UINT>(size / this->mDesc.Height), static_cast<UINT>(size));
+		// Compressed formats are laid out in rows of 4x4 blocks
+		const UINT height = std::max(this->mDesc.Height >> level, 1u);
+		const UINT rows = this->mDesc.Format >= Format::DXT1 && this->mDesc.Format <= Format::LATC2 ? (height + 3) / 4 : height;
 
-		if (level == 0 && this->mDesc.Levels > 1)
+		context->UpdateSubresource(this->mTexture, level, nullptr, data, static_cast<UINT>(size / rows), static_cast<UINT>(size));
+
+		if (generateMipmaps && level == 0 && this->mDesc.Levels > 1)
 		{
 			context->GenerateMips(this->mShaderResourceView[0]);
 		}
@@ -3918,6 +4686,12 @@ namespace ReShade { namespace Runtimes
 			{
 				pass.DSS->Release();
 			}
+
+			for (unsigned int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+			{
+				SAFE_RELEASE(pass.ScaledRT[i]);
+				SAFE_RELEASE(pass.ScaledRTSRV[i]);
+			}
 		}
 	}
 
@@ -3965,12 +4739,19 @@ namespace ReShade { namespace Runtimes
 		devicecontext->GSSetShader(nullptr, nullptr, 0);
 		devicecontext->PSSetShader(pass.PS, nullptr, 0);
 
+		// Passes at a reduced resolution draw unblended into intermediate targets, their blend state only applies when those are upsampled into the actual ones
+		const bool scaled = pass.ScaledViewport.Width != pass.Viewport.Width || pass.ScaledViewport.Height != pass.Viewport.Height;
 		const FLOAT blendfactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-		devicecontext->OMSetBlendState(pass.BS, blendfactor, D3D11_DEFAULT_SAMPLE_MASK);
+		devicecontext->OMSetBlendState(scaled ? nullptr : pass.BS, blendfactor, D3D11_DEFAULT_SAMPLE_MASK);
 		devicecontext->OMSetDepthStencilState(pass.DSS, pass.StencilRef);
 
-		// Save backbuffer of previous pass
-		devicecontext->CopyResource(runtime->mBackBufferTexture, runtime->mBackBuffer);
+		// Save backbuffer of previous pass, but only if this pass reads it and it was drawn to since the last copy
+		if (pass.SamplesBackBuffer && this->mEffect->mBackBufferTextureDirty)
+		{
+			devicecontext->CopyResource(runtime->mBackBufferTexture, runtime->mBackBuffer);
+
+			this->mEffect->mBackBufferTextureDirty = false;
+		}
 
 		// Setup shader resources
 		devicecontext->VSSetShaderResources(0, static_cast<UINT>(pass.SRV.size()), pass.SRV.data());
@@ -4044,18 +4825,21 @@ namespace ReShade { namespace Runtimes
 		}
 
 		// Setup rendertargets
+		ID3D11RenderTargetView *const *targets = scaled ? pass.ScaledRT : pass.RT;
 		ID3D11DepthStencilView *depthstencil = runtime->mDefaultDepthStencil;
 
-		if (pass.Viewport.Width != runtime->mSwapChainDesc.BufferDesc.Width || pass.Viewport.Height != runtime->mSwapChainDesc.BufferDesc.Height)
+		if (pass.ScaledViewport.Width != runtime->mSwapChainDesc.BufferDesc.Width || pass.ScaledViewport.Height != runtime->mSwapChainDesc.BufferDesc.Height)
 		{
 			depthstencil = nullptr;
 		}
 
-		devicecontext->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, pass.RT, depthstencil);
-		devicecontext->RSSetViewports(1, &pass.Viewport);
+		devicecontext->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, targets, depthstencil);
+		devicecontext->RSSetViewports(1, &pass.ScaledViewport);
 
-		for (ID3D11RenderTargetView *rtv : pass.RT)
+		for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
 		{
+			ID3D11RenderTargetView *const rtv = targets[i];
+
 			if (rtv == nullptr)
 			{
 				continue;
@@ -4068,6 +4852,11 @@ namespace ReShade { namespace Runtimes
 		// Draw triangle
 		devicecontext->Draw(3, 0);
 
+		if (pass.WritesBackBuffer)
+		{
+			this->mEffect->mBackBufferTextureDirty = true;
+		}
+
 		// Reset shader resources
 		ID3D11ShaderResourceView *null[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = { nullptr };
 		devicecontext->VSSetShaderResources(0, static_cast<UINT>(pass.SRV.size()), null);
@@ -4076,6 +4865,37 @@ namespace ReShade { namespace Runtimes
 		// Reset rendertargets
 		devicecontext->OMSetRenderTargets(0, nullptr, nullptr);
 
+		// Upsample the reduced resolution results into the actual rendertargets
+		if (scaled)
+		{
+			devicecontext->VSSetShader(this->mEffect->mUpsampleVS, nullptr, 0);
+			devicecontext->PSSetShader(this->mEffect->mUpsamplePS, nullptr, 0);
+			devicecontext->PSSetSamplers(0, 1, &this->mEffect->mUpsampleSampler);
+			devicecontext->OMSetBlendState(pass.BS, blendfactor, D3D11_DEFAULT_SAMPLE_MASK);
+			devicecontext->OMSetDepthStencilState(nullptr, 0);
+			devicecontext->RSSetViewports(1, &pass.Viewport);
+
+			for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+			{
+				if (pass.ScaledRTSRV[i] == nullptr)
+				{
+					continue;
+				}
+
+				devicecontext->OMSetRenderTargets(1, &pass.RT[i], nullptr);
+				devicecontext->PSSetShaderResources(0, 1, &pass.ScaledRTSRV[i]);
+				devicecontext->Draw(3, 0);
+			}
+
+			devicecontext->PSSetShaderResources(0, 1, null);
+			devicecontext->OMSetRenderTargets(0, nullptr, nullptr);
+
+			if (!this->mEffect->mSamplerStates.empty())
+			{
+				devicecontext->PSSetSamplers(0, 1, this->mEffect->mSamplerStates.data());
+			}
+		}
+
 		// Update shader resources
 		for (ID3D11ShaderResourceView *srv : pass.RTSRV)
 		{
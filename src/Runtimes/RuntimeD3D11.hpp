@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Runtime.hpp"
+#include "ReadbackQueue.hpp"
 
 #include <d3d11_1.h>
 #include <set>
@@ -21,6 +22,7 @@ namespace ReShade { namespace Runtimes
 		bool OnCreateInternal(const DXGI_SWAP_CHAIN_DESC &desc);
 		void OnDeleteInternal();
 		void OnDrawInternal(ID3D11DeviceContext *context, unsigned int vertices);
+		void OnDrawCommandList(unsigned int vertices, unsigned int drawCalls);
 		void OnPresentInternal();
 		void OnGetBackBuffer(ID3D11Texture2D *&buffer);
 		void OnCreateDepthStencilView(ID3D11Resource *resource, ID3D11DepthStencilView *depthstencil);
@@ -37,12 +39,36 @@ namespace ReShade { namespace Runtimes
 		virtual std::unique_ptr<Effect> CompileEffect(const EffectTree &ast, std::string &errors) const override;
 		virtual void CreateScreenshot(unsigned char *buffer, std::size_t size) const override;
 		virtual void DumpFrameTrace(const boost::filesystem::path &path) override;
+		virtual void ToggleFrameStream(const boost::filesystem::path &path) override;
+		void UpdateFrameStream();
+		void EndFrameStream();
 		virtual void ToggleDebugView(bool saveCurrent, bool playSave, bool playNext) override;
 		static bool mIsDumpingTrace;
 		static int mToggleDebugViewID;
 		boost::filesystem::path DumpRootPath;
-		void DumpTexture2D(boost::filesystem::path rootPathNoExt, ID3D11Texture2D* texture);
-		void DumpReadableTexture2D(boost::filesystem::path rootPathNoExt, ID3D11Texture2D* texture);
+		ImageFormat mTraceFormat;
+		std::shared_ptr<TraceBundleWriter> mTraceBundle; // Only set while a capture goes into a bundle, images still being encoded keep it alive
+		std::string GetTraceName(const boost::filesystem::path &path) const;
+
+		// Readbacks of dumps and frame streams complete a few frames after the copy was issued, so the GPU never has to be waited for
+		std::unique_ptr<ReadbackQueue::Backend> mReadbackBackend;
+		std::unique_ptr<ReadbackQueue> mReadbackQueue;
+
+		struct StreamTarget
+		{
+			ID3D11RenderTargetView *View; // Null for the back buffer
+			ID3D11Texture2D *Source;
+			D3D11_TEXTURE2D_DESC Desc;
+			TexelFormat Format;
+			std::vector<unsigned char> Previous; // Last captured frame, deltas are computed against it
+			bool Restart; // Store a key frame next, after a frame could not be read back
+		};
+		static const unsigned int StreamKeyFrameInterval = 30;
+		std::vector<StreamTarget> mStreamTargets;
+		std::shared_ptr<TraceBundleWriter> mStreamBundle;
+		unsigned int mStreamFrame, mStreamLength, mStreamInterval, mStreamCaptures;
+		void DumpTexture2D(boost::filesystem::path rootPathNoExt, ID3D11Texture2D* texture, unsigned int bucket = 0, unsigned int draw = 0, const void *target = nullptr);
+		void DumpReadableTexture2D(boost::filesystem::path rootPathNoExt, ID3D11Texture2D* texture, unsigned int bucket = 0, unsigned int draw = 0, const void *target = nullptr);
 		void OnSetMRT(UINT NumViews, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView);
 		void OnExecuteCommandList(ID3D11DeviceContext *context, ID3D11CommandList *pCommandList, BOOL RestoreContextState);
 
@@ -105,6 +131,19 @@ namespace ReShade { namespace Runtimes
 
 		virtual void Begin() const override;
 		virtual void End() const override;
+		virtual void BeginTimings(unsigned long long frame) override;
+		virtual void TimePass(unsigned int technique, unsigned int pass) override;
+		virtual void EndTimings() override;
+		virtual bool GetTimings(unsigned long long &frame, std::vector<PassTiming> &timings) override;
+
+		struct TimingQueries
+		{
+			unsigned long long Frame;
+			bool Pending;
+			ID3D11Query *Disjoint;
+			std::vector<ID3D11Query *> Timestamps;
+			std::vector<std::pair<unsigned int, unsigned int>> Passes; // Technique and pass that ended at the timestamp with the same index
+		};
 
 		std::shared_ptr<const D3D11Runtime> mRuntime;
 		ID3D11RasterizerState *mRasterizerState;
@@ -112,7 +151,13 @@ namespace ReShade { namespace Runtimes
 		std::vector<ID3D11ShaderResourceView *> mShaderResources;
 		std::vector<ID3D11Buffer *> mConstantBuffers;
 		std::vector<unsigned char *> mConstantStorages;
-		mutable bool mConstantsDirty;
+		ID3D11VertexShader *mUpsampleVS;
+		ID3D11PixelShader *mUpsamplePS;
+		ID3D11SamplerState *mUpsampleSampler;
+		TimingQueries mTimings[4];
+		unsigned int mTimingIndex;
+		bool mTimingActive;
+		mutable bool mConstantsDirty, mBackBufferTextureDirty;
 	};
 	struct D3D11Texture : public Effect::Texture
 	{
@@ -131,7 +176,7 @@ namespace ReShade { namespace Runtimes
 			return this->mAnnotations.emplace(name, value).second;
 		}
 
-		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size) override;
+		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps) override;
 		void ChangeSource(ID3D11ShaderResourceView *srv, ID3D11ShaderResourceView *srvSRGB);
 
 		D3D11Effect *mEffect;
@@ -168,8 +213,11 @@ namespace ReShade { namespace Runtimes
 			UINT StencilRef;
 			ID3D11RenderTargetView *RT[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
 			ID3D11ShaderResourceView *RTSRV[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
-			D3D11_VIEWPORT Viewport;
+			ID3D11RenderTargetView *ScaledRT[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			ID3D11ShaderResourceView *ScaledRTSRV[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			D3D11_VIEWPORT Viewport, ScaledViewport;
 			std::vector<ID3D11ShaderResourceView *> SRV;
+			bool SamplesBackBuffer, WritesBackBuffer;
 		};
 
 		D3D11Technique(D3D11Effect *effect, const Description &desc);
@@ -183,6 +231,12 @@ namespace ReShade { namespace Runtimes
 		{
 			this->mPasses.push_back(pass);
 		}
+		inline void AddPassSchedule(unsigned int interval, unsigned int phase)
+		{
+			const Schedule schedule = { interval, phase };
+
+			this->mPassSchedules.push_back(schedule);
+		}
 
 		virtual void RenderPass(unsigned int index) const override;
 
@@ -1,6 +1,8 @@
 #include "Log.hpp"
 #include "RuntimeD3D9.hpp"
 #include "EffectParserTree.hpp"
+#include "EffectAnalysis.hpp"
+#include "TraceProfiler.hpp"
 
 #include <d3dx9math.h>
 #include <d3dcompiler.h>
@@ -1905,6 +1907,7 @@ namespace ReShade { namespace Runtimes
 			void Visit(const EffectNodes::Technique &node)
 			{
 				std::vector<D3D9Technique::Pass> passes;
+				const std::vector<EffectPassInfo> infos = AnalyzeTechnique(this->mAST, node);
 				const EffectNodes::Pass *pass = &this->mAST[node.Passes].As<EffectNodes::Pass>();
 
 				do
@@ -1928,6 +1931,11 @@ namespace ReShade { namespace Runtimes
 				D3D9Technique *obj = new D3D9Technique(this->mEffect, objdesc);
 				obj->mPasses = std::move(passes);
 
+				for (const EffectPassInfo &info : infos)
+				{
+					obj->AddPassSchedule(info.Interval, info.Phase);
+				}
+
 				if (node.Annotations != EffectTree::Null)
 				{
 					Visit(this->mAST[node.Annotations].As<EffectNodes::Annotation>(), *obj);
@@ -1940,6 +1948,13 @@ namespace ReShade { namespace Runtimes
 				D3D9Technique::Pass pass;
 				ZeroMemory(&pass, sizeof(D3D9Technique::Pass));
 				pass.RT[0] = this->mEffect->mRuntime->mBackBufferResolved;
+				pass.SamplesBackBuffer = AnalyzePass(this->mAST, node).BackBufferAccess != EffectPassInfo::Access::None;
+				pass.WritesBackBuffer = node.States[EffectNodes::Pass::RenderTarget0] == 0;
+
+				if (node.States[EffectNodes::Pass::RenderScale] != 0)
+				{
+					this->mErrors += PrintLocation(node.Location) + "warning: pass render scale is not supported on this renderer and is ignored.\n";
+				}
 
 				if (node.States[EffectNodes::Pass::VertexShader] != 0)
 				{
@@ -2595,7 +2610,11 @@ namespace ReShade { namespace Runtimes
 		}
 
 		// Capture device state
-		this->mStateBlock->Capture();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Capture");
+
+			this->mStateBlock->Capture();
+		}
 
 		IDirect3DSurface9 *stateblockTargets[8] = { nullptr };
 		IDirect3DSurface9 *stateblockDepthStencil = nullptr;
@@ -2639,7 +2658,11 @@ namespace ReShade { namespace Runtimes
 		}
 
 		// Apply previous device state
-		this->mStateBlock->Apply();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Apply");
+
+			this->mStateBlock->Apply();
+		}
 
 		for (DWORD target = 0, targetCount = std::min(this->mDeviceCaps.NumSimultaneousRTs, static_cast<DWORD>(8)); target < targetCount; ++target)
 		{
@@ -2938,7 +2961,7 @@ namespace ReShade { namespace Runtimes
 		screenshotSurface->Release();
 	}
 
-	D3D9Effect::D3D9Effect(std::shared_ptr<const D3D9Runtime> runtime) : mRuntime(runtime), mVertexBuffer(nullptr), mVertexDeclaration(nullptr), mConstantRegisterCount(0), mConstantStorage(nullptr)
+	D3D9Effect::D3D9Effect(std::shared_ptr<const D3D9Runtime> runtime) : mRuntime(runtime), mVertexBuffer(nullptr), mVertexDeclaration(nullptr), mConstantRegisterCount(0), mConstantStorage(nullptr), mBackBufferTextureDirty(true)
 	{
 	}
 	D3D9Effect::~D3D9Effect()
@@ -2971,6 +2994,9 @@ namespace ReShade { namespace Runtimes
 
 		device->SetDepthStencilSurface(this->mRuntime->mDefaultDepthStencil);
 		device->Clear(0, nullptr, D3DCLEAR_ZBUFFER | D3DCLEAR_STENCIL, 0, 1.0f, 0);
+
+		// Back buffer may have changed since the last technique
+		this->mBackBufferTextureDirty = true;
 	}
 	void D3D9Effect::End() const
 	{
@@ -2985,7 +3011,7 @@ namespace ReShade { namespace Runtimes
 		SAFE_RELEASE(this->mTextureSurface);
 	}
 
-	bool D3D9Texture::Update(unsigned int level, const unsigned char *data, std::size_t size)
+	bool D3D9Texture::Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps)
 	{
 		if (data == nullptr || size == 0 || level > this->mDesc.Levels || this->mSource != Source::Memory)
 		{
@@ -3057,8 +3083,17 @@ namespace ReShade { namespace Runtimes
 				}
 				break;
 			default:
-				CopyMemory(pLocked, data, size);
+			{
+				// Copy row by row, since the locked surface may pad its rows (compressed formats have one row per 4x4 blocks)
+				const UINT rows = this->mDesc.Format >= Format::DXT1 && this->mDesc.Format <= Format::LATC2 ? (desc.Height + 3) / 4 : desc.Height;
+				const std::size_t rowSize = size / rows;
+
+				for (UINT y = 0; y < rows; ++y)
+				{
+					CopyMemory(pLocked + y * memLock.Pitch, data + y * rowSize, std::min<std::size_t>(rowSize, memLock.Pitch));
+				}
 				break;
+			}
 		}
 
 		memSurface->UnlockRect();
@@ -3164,8 +3199,13 @@ namespace ReShade { namespace Runtimes
 		// Setup states
 		pass.Stateblock->Apply();
 
-		// Save backbuffer of previous pass
-		device->StretchRect(runtime->mBackBufferResolved, nullptr, runtime->mBackBufferTextureSurface, nullptr, D3DTEXF_NONE);
+		// Save backbuffer of previous pass, but only if this pass reads it and it was drawn to since the last copy
+		if (pass.SamplesBackBuffer && this->mEffect->mBackBufferTextureDirty)
+		{
+			device->StretchRect(runtime->mBackBufferResolved, nullptr, runtime->mBackBufferTextureSurface, nullptr, D3DTEXF_NONE);
+
+			this->mEffect->mBackBufferTextureDirty = false;
+		}
 
 		// Setup rendertargets
 		for (DWORD target = 0, targetCount = std::min(runtime->mDeviceCaps.NumSimultaneousRTs, static_cast<DWORD>(8)); target < targetCount; ++target)
@@ -3189,6 +3229,11 @@ namespace ReShade { namespace Runtimes
 		// Draw triangle
 		device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, 1);
 
+		if (pass.WritesBackBuffer)
+		{
+			this->mEffect->mBackBufferTextureDirty = true;
+		}
+
 		const_cast<D3D9Runtime *>(runtime.get())->Runtime::OnDraw(3);
 
 		// Update shader resources
@@ -76,6 +76,7 @@ namespace ReShade { namespace Runtimes
 		IDirect3DVertexDeclaration9 *mVertexDeclaration;
 		float *mConstantStorage;
 		UINT mConstantRegisterCount;
+		mutable bool mBackBufferTextureDirty;
 	};
 	struct D3D9Texture : public Effect::Texture
 	{
@@ -94,7 +95,7 @@ namespace ReShade { namespace Runtimes
 			return this->mAnnotations.emplace(name, value).second;
 		}
 
-		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size) override;
+		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps) override;
 		void ChangeSource(IDirect3DTexture9 *texture);
 
 		D3D9Effect *mEffect;
@@ -131,6 +132,7 @@ namespace ReShade { namespace Runtimes
 			IDirect3DPixelShader9 *PS;
 			IDirect3DStateBlock9 *Stateblock;
 			IDirect3DSurface9 *RT[8];
+			bool SamplesBackBuffer, WritesBackBuffer;
 		};
 
 		D3D9Technique(D3D9Effect *effect, const Description &desc);
@@ -144,6 +146,12 @@ namespace ReShade { namespace Runtimes
 		{
 			this->mPasses.push_back(pass);
 		}
+		inline void AddPassSchedule(unsigned int interval, unsigned int phase)
+		{
+			const Schedule schedule = { interval, phase };
+
+			this->mPassSchedules.push_back(schedule);
+		}
 
 		virtual void RenderPass(unsigned int index) const override;
 
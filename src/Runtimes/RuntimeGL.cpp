@@ -1,6 +1,8 @@
 #include "Log.hpp"
 #include "RuntimeGL.hpp"
 #include "EffectParserTree.hpp"
+#include "EffectAnalysis.hpp"
+#include "TraceProfiler.hpp"
 
 #include <nanovg_gl.h>
 #include <boost\algorithm\string.hpp>
@@ -2336,6 +2338,7 @@ namespace ReShade { namespace Runtimes
 			void Visit(const EffectNodes::Technique &node)
 			{
 				std::vector<GLTechnique::Pass> passes;
+				const std::vector<EffectPassInfo> infos = AnalyzeTechnique(this->mAST, node);
 				const EffectNodes::Pass *pass = &this->mAST[node.Passes].As<EffectNodes::Pass>();
 
 				do
@@ -2359,6 +2362,11 @@ namespace ReShade { namespace Runtimes
 				GLTechnique *obj = new GLTechnique(this->mEffect, objdesc);
 				obj->mPasses = std::move(passes);
 
+				for (const EffectPassInfo &info : infos)
+				{
+					obj->AddPassSchedule(info.Interval, info.Phase);
+				}
+
 				if (node.Annotations != EffectTree::Null)
 				{
 					Visit(this->mAST[node.Annotations].As<EffectNodes::Annotation>(), *obj);
@@ -2370,6 +2378,13 @@ namespace ReShade { namespace Runtimes
 			{
 				GLTechnique::Pass pass;
 				ZeroMemory(&pass, sizeof(GLTechnique::Pass));
+				pass.SamplesBackBuffer = AnalyzePass(this->mAST, node).BackBufferAccess != EffectPassInfo::Access::None;
+				pass.WritesBackBuffer = node.States[EffectNodes::Pass::RenderTarget0] == 0;
+
+				if (node.States[EffectNodes::Pass::RenderScale] != 0)
+				{
+					this->mErrors += PrintLocation(node.Location) + "warning: pass render scale is not supported on this renderer and is ignored.\n";
+				}
 
 				if (node.States[EffectNodes::Pass::ColorWriteMask] != 0)
 				{
@@ -3383,7 +3398,11 @@ namespace ReShade { namespace Runtimes
 		DetectDepthSource();
 
 		// Capture states
-		this->mStateBlock->Capture();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Capture");
+
+			this->mStateBlock->Capture();
+		}
 
 		// Copy backbuffer
 		GLCHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
@@ -3419,7 +3438,11 @@ namespace ReShade { namespace Runtimes
 		}
 
 		// Apply states
-		this->mStateBlock->Apply();
+		{
+			const TraceProfiler::Scope scope("StateBlock::Apply");
+
+			this->mStateBlock->Apply();
+		}
 	}
 	void GLRuntime::OnFramebufferAttachment(GLenum target, GLenum attachment, GLenum objecttarget, GLuint object, GLint level)
 	{
@@ -3673,7 +3696,7 @@ namespace ReShade { namespace Runtimes
 		}
 	}
 
-	GLEffect::GLEffect(std::shared_ptr<const GLRuntime> runtime) : mRuntime(runtime), mDefaultVAO(0), mDefaultVBO(0), mUniformDirty(true)
+	GLEffect::GLEffect(std::shared_ptr<const GLRuntime> runtime) : mRuntime(runtime), mDefaultVAO(0), mDefaultVBO(0), mUniformDirty(true), mBackBufferTextureDirty(true)
 	{
 		GLCHECK(glGenVertexArrays(1, &this->mDefaultVAO));
 		GLCHECK(glGenBuffers(1, &this->mDefaultVBO));
@@ -3713,6 +3736,9 @@ namespace ReShade { namespace Runtimes
 		{
 			GLCHECK(glBindBufferBase(GL_UNIFORM_BUFFER, buffer, this->mUniformBuffers[buffer]));
 		}
+
+		// Back buffer may have changed since the last technique
+		this->mBackBufferTextureDirty = true;
 	}
 	void GLEffect::End() const
 	{
@@ -3731,7 +3757,7 @@ namespace ReShade { namespace Runtimes
 		}
 	}
 
-	bool GLTexture::Update(unsigned int level, const unsigned char *data, std::size_t size)
+	bool GLTexture::Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps)
 	{
 		if (data == nullptr || size == 0 || level > this->mDesc.Levels || this->mSource != Source::Memory)
 		{
@@ -3751,12 +3777,16 @@ namespace ReShade { namespace Runtimes
 		const std::unique_ptr<unsigned char[]> dataFlipped(new unsigned char[size]);
 		std::memcpy(dataFlipped.get(), data, size);
 
+		Description levelDesc = this->mDesc;
+		levelDesc.Width = std::max(levelDesc.Width >> level, 1u);
+		levelDesc.Height = std::max(levelDesc.Height >> level, 1u);
+
 		// Flip image vertically
-		FlipImageData(this->mDesc, dataFlipped.get());
+		FlipImageData(levelDesc, dataFlipped.get());
 
 		if (this->mDesc.Format >= Texture::Format::DXT1 && this->mDesc.Format <= Texture::Format::LATC2)
 		{
-			GLCHECK(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, this->mDesc.Width, this->mDesc.Height, GL_UNSIGNED_BYTE, static_cast<GLsizei>(size), dataFlipped.get()));
+			GLCHECK(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelDesc.Width, levelDesc.Height, GL_UNSIGNED_BYTE, static_cast<GLsizei>(size), dataFlipped.get()));
 		}
 		else
 		{
@@ -3778,21 +3808,24 @@ namespace ReShade { namespace Runtimes
 					dataAlignment = 2;
 					break;
 				case Texture::Format::RGBA16:
-				case Texture::Format::RGBA16F:
 					dataType = GL_UNSIGNED_SHORT;
 					dataAlignment = 2;
 					break;
+				case Texture::Format::RGBA16F:
+					dataType = GL_HALF_FLOAT;
+					dataAlignment = 2;
+					break;
 				case Texture::Format::RGBA32F:
 					dataType = GL_FLOAT;
 					break;
 			}
 
 			GLCHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, dataAlignment));
-			GLCHECK(glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, this->mDesc.Width, this->mDesc.Height, dataFormat, dataType, dataFlipped.get()));
+			GLCHECK(glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelDesc.Width, levelDesc.Height, dataFormat, dataType, dataFlipped.get()));
 			GLCHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
 		}
 
-		if (level == 0 && this->mDesc.Levels > 1)
+		if (generateMipmaps && level == 0 && this->mDesc.Levels > 1)
 		{
 			GLCHECK(glGenerateMipmap(GL_TEXTURE_2D));
 		}
@@ -3904,12 +3937,17 @@ namespace ReShade { namespace Runtimes
 		GLCHECK(glStencilOp(pass.StencilOpFail, pass.StencilOpZFail, pass.StencilOpZPass));
 		GLCHECK(glStencilMask(pass.StencilMask));
 
-		// Save backbuffer of previous pass
-		GLCHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, runtime->mDefaultBackBufferFBO));
-		GLCHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, runtime->mBlitFBO));
-		GLCHECK(glReadBuffer(GL_COLOR_ATTACHMENT0));
-		GLCHECK(glDrawBuffer(GL_COLOR_ATTACHMENT0));
-		GLCHECK(glBlitFramebuffer(0, 0, runtime->mWidth, runtime->mHeight, 0, 0, runtime->mWidth, runtime->mHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+		// Save backbuffer of previous pass, but only if this pass reads it and it was drawn to since the last copy
+		if (pass.SamplesBackBuffer && this->mEffect->mBackBufferTextureDirty)
+		{
+			GLCHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, runtime->mDefaultBackBufferFBO));
+			GLCHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, runtime->mBlitFBO));
+			GLCHECK(glReadBuffer(GL_COLOR_ATTACHMENT0));
+			GLCHECK(glDrawBuffer(GL_COLOR_ATTACHMENT0));
+			GLCHECK(glBlitFramebuffer(0, 0, runtime->mWidth, runtime->mHeight, 0, 0, runtime->mWidth, runtime->mHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+
+			this->mEffect->mBackBufferTextureDirty = false;
+		}
 
 		// Setup rendertargets
 		GLCHECK(glBindFramebuffer(GL_FRAMEBUFFER, pass.Framebuffer));
@@ -3930,6 +3968,11 @@ namespace ReShade { namespace Runtimes
 		// Draw triangle
 		GLCHECK(glDrawArrays(GL_TRIANGLES, 0, 3));
 
+		if (pass.WritesBackBuffer)
+		{
+			this->mEffect->mBackBufferTextureDirty = true;
+		}
+
 		// Update shader resources
 		for (GLuint id : pass.DrawTextures)
 		{
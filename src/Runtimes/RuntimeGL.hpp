@@ -68,7 +68,7 @@ namespace ReShade { namespace Runtimes
 		GLuint mDefaultVAO, mDefaultVBO;
 		std::vector<GLuint> mUniformBuffers;
 		std::vector<std::pair<unsigned char *, std::size_t>> mUniformStorages;
-		mutable bool mUniformDirty;
+		mutable bool mUniformDirty, mBackBufferTextureDirty;
 	};
 	struct GLTexture : public Effect::Texture
 	{
@@ -87,7 +87,7 @@ namespace ReShade { namespace Runtimes
 			return this->mAnnotations.emplace(name, value).second;
 		}
 
-		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size) override;
+		virtual bool Update(unsigned int level, const unsigned char *data, std::size_t size, bool generateMipmaps) override;
 		void ChangeSource(GLuint texture, GLuint textureSRGB);
 
 		GLEffect *mEffect;
@@ -127,6 +127,7 @@ namespace ReShade { namespace Runtimes
 			GLsizei ViewportWidth, ViewportHeight;
 			GLenum DrawBuffers[8], BlendEqColor, BlendEqAlpha, BlendFuncSrc, BlendFuncDest, DepthFunc, StencilFunc, StencilOpFail, StencilOpZFail, StencilOpZPass;
 			GLboolean FramebufferSRGB, Blend, DepthMask, DepthTest, StencilTest, ColorMaskR, ColorMaskG, ColorMaskB, ColorMaskA;
+			bool SamplesBackBuffer, WritesBackBuffer;
 		};
 
 		GLTechnique(GLEffect *effect, const Description &desc);
@@ -140,6 +141,12 @@ namespace ReShade { namespace Runtimes
 		{
 			this->mPasses.push_back(pass);
 		}
+		inline void AddPassSchedule(unsigned int interval, unsigned int phase)
+		{
+			const Schedule schedule = { interval, phase };
+
+			this->mPassSchedules.push_back(schedule);
+		}
 
 		virtual void RenderPass(unsigned int index) const override;
 
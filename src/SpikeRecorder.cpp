@@ -0,0 +1,73 @@
+#include "SpikeRecorder.hpp"
+
+#include <fstream>
+#include <algorithm>
+
+static_assert(sizeof(SpikeRecorder::Header) == 24 && sizeof(SpikeRecorder::Frame) == 32, "capture file layout changed");
+
+SpikeRecorder::SpikeRecorder() : mNext(0), mCount(0), mTriggerFrame(0), mFollowupLeft(0), mEvents(0), mTextureUploads(0), mThreshold(0.0f)
+{
+}
+
+void SpikeRecorder::SetThreshold(float threshold)
+{
+	this->mThreshold = threshold;
+}
+
+bool SpikeRecorder::Record(Frame frame)
+{
+	frame.Events |= this->mEvents;
+	frame.TextureUploads = this->mTextureUploads;
+	this->mEvents = 0;
+	this->mTextureUploads = 0;
+
+	bool complete = false;
+
+	if (this->mFollowupLeft != 0)
+	{
+		// Spikes during a running capture simply become part of it
+		this->mCapture.push_back(frame);
+
+		complete = --this->mFollowupLeft == 0;
+	}
+	else if (this->mThreshold > 0.0f && frame.FrameTime > this->mThreshold && this->mCount != 0 && this->mCapture.empty())
+	{
+		// Snapshot the history in chronological order, so later frames cannot overwrite it before it is saved
+		this->mCapture.reserve(this->mCount + 1 + FollowupFrames);
+
+		for (std::size_t i = 0; i < this->mCount; ++i)
+		{
+			this->mCapture.push_back(this->mHistory[(this->mNext + HistoryCapacity - this->mCount + i) % HistoryCapacity]);
+		}
+
+		this->mTriggerFrame = this->mCapture.size();
+		this->mCapture.push_back(frame);
+		this->mFollowupLeft = FollowupFrames;
+	}
+
+	this->mHistory[this->mNext] = frame;
+	this->mNext = (this->mNext + 1) % HistoryCapacity;
+	this->mCount = std::min(this->mCount + 1, static_cast<std::size_t>(HistoryCapacity));
+
+	return complete;
+}
+
+bool SpikeRecorder::Save(const boost::filesystem::path &path)
+{
+	Header header;
+	header.Signature = Signature;
+	header.Version = Version;
+	header.FrameCount = static_cast<std::uint32_t>(this->mCapture.size());
+	header.TriggerFrame = static_cast<std::uint32_t>(this->mTriggerFrame);
+	header.Threshold = this->mThreshold;
+	header.Reserved = 0;
+
+	std::ofstream file(path.string(), std::ios::binary);
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(this->mCapture.data()), this->mCapture.size() * sizeof(Frame));
+
+	this->mCapture.clear();
+
+	return file.good();
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <boost/filesystem/path.hpp>
+
+/*
+ * Keeps lightweight telemetry of the last frames and, once a frame exceeds the threshold, captures them together with the following frames.
+ *
+ * Capture files are little-endian and consist of a 'Header' followed by 'Header::FrameCount' tightly packed 'Frame' records (32 bytes each).
+ * The record at 'Header::TriggerFrame' is the one exceeding the threshold, everything before it is history leading up to the spike.
+ * Work done while presenting a frame (compiling, uploading textures) only shows up in the frame time of the record following it.
+ * Source textures are decoded on worker threads, so only the frames uploading their results are flagged with 'TexturesUploaded'.
+ */
+class SpikeRecorder
+{
+public:
+	static const std::uint32_t Signature = 0x4B505352; // "RSPK"
+	static const std::uint32_t Version = 2;
+	static const unsigned int HistoryCapacity = 256, FollowupFrames = 64;
+
+	enum Event : std::uint32_t
+	{
+		FileModified = 1 << 0,
+		EffectLoaded = 1 << 1,
+		EffectCompiled = 1 << 2,
+		EffectProcessed = 1 << 3, // Includes queuing all source textures for loading
+		TechniqueToggled = 1 << 4,
+		TechniqueShed = 1 << 5,
+		TechniqueRestored = 1 << 6,
+		TexturesUploaded = 1 << 7 // 'Frame::TextureUploads' holds how many
+	};
+
+	struct Header
+	{
+		std::uint32_t Signature, Version;
+		std::uint32_t FrameCount, TriggerFrame;
+		float Threshold; // Milliseconds
+		std::uint32_t Reserved;
+	};
+	struct Frame
+	{
+		std::uint64_t Index;
+		float FrameTime, PostProcessingTime; // Milliseconds
+		std::uint32_t DrawCalls, DrawCallVertices;
+		std::uint32_t Events; // Combination of 'Event' flags raised during the frame
+		std::uint32_t TextureUploads; // Number of source textures uploaded during the frame
+	};
+
+	SpikeRecorder();
+
+	inline float GetThreshold() const
+	{
+		return this->mThreshold;
+	}
+	void SetThreshold(float threshold);
+
+	inline void AddEvent(Event event)
+	{
+		this->mEvents |= event;
+	}
+	inline void AddTextureUploads(unsigned int count)
+	{
+		if (count != 0)
+		{
+			this->mEvents |= TexturesUploaded;
+			this->mTextureUploads += count;
+		}
+	}
+	bool Record(Frame frame);
+
+	bool Save(const boost::filesystem::path &path);
+
+private:
+	Frame mHistory[HistoryCapacity];
+	std::size_t mNext, mCount;
+	std::vector<Frame> mCapture;
+	std::size_t mTriggerFrame, mFollowupLeft;
+	std::uint32_t mEvents, mTextureUploads;
+	float mThreshold;
+};
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "StatisticsPage.hpp"
+
+#ifndef _WIN32
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace ReShade
+{
+#ifdef _WIN32
+	StatisticsPage::StatisticsPage(unsigned long processId) : mMapping(nullptr), mData(nullptr)
+	{
+		this->mMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(StatisticsData), GetStatisticsPageName(processId).c_str());
+
+		if (this->mMapping == nullptr)
+		{
+			return;
+		}
+
+		// Another runtime in this process already publishes its statistics there
+		if (GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			CloseHandle(this->mMapping);
+			this->mMapping = nullptr;
+			return;
+		}
+
+		this->mData = static_cast<StatisticsData *>(MapViewOfFile(this->mMapping, FILE_MAP_WRITE, 0, 0, sizeof(StatisticsData)));
+
+		if (this->mData == nullptr)
+		{
+			CloseHandle(this->mMapping);
+			this->mMapping = nullptr;
+			return;
+		}
+
+		ZeroMemory(this->mData, sizeof(StatisticsData));
+
+		this->mData->PageVersion = StatisticsData::Version;
+		this->mData->PageSize = sizeof(StatisticsData);
+
+		// Write the signature last, so readers never pick up a half initialized page
+		MemoryBarrier();
+
+		this->mData->PageSignature = StatisticsData::Signature;
+	}
+	StatisticsPage::~StatisticsPage()
+	{
+		if (this->mData != nullptr)
+		{
+			UnmapViewOfFile(this->mData);
+		}
+		if (this->mMapping != nullptr)
+		{
+			CloseHandle(this->mMapping);
+		}
+	}
+
+	StatisticsData &StatisticsPage::BeginUpdate()
+	{
+		// Odd sequence numbers mark the page as being written to
+		InterlockedIncrement(reinterpret_cast<volatile LONG *>(&this->mData->Sequence));
+
+		return *this->mData;
+	}
+	void StatisticsPage::EndUpdate()
+	{
+		InterlockedIncrement(reinterpret_cast<volatile LONG *>(&this->mData->Sequence));
+	}
+#else
+	StatisticsPage::StatisticsPage(unsigned long processId) : mData(nullptr)
+	{
+		const std::string name = GetStatisticsPageName(processId);
+
+		// Another runtime in this process already publishes its statistics there (or one of a process that had the same identifier did not clean up)
+		const int file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+		if (file < 0)
+		{
+			return;
+		}
+
+		// A new object is filled with zeros when it is resized
+		void *const data = ftruncate(file, sizeof(StatisticsData)) == 0 ? mmap(nullptr, sizeof(StatisticsData), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+
+		close(file);
+
+		if (data == MAP_FAILED)
+		{
+			shm_unlink(name.c_str());
+			return;
+		}
+
+		this->mName = name;
+		this->mData = static_cast<StatisticsData *>(data);
+		this->mData->PageVersion = StatisticsData::Version;
+		this->mData->PageSize = sizeof(StatisticsData);
+
+		// Write the signature last, so readers never pick up a half initialized page
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		this->mData->PageSignature = StatisticsData::Signature;
+	}
+	StatisticsPage::~StatisticsPage()
+	{
+		if (this->mData != nullptr)
+		{
+			munmap(this->mData, sizeof(StatisticsData));
+			shm_unlink(this->mName.c_str());
+		}
+	}
+
+	StatisticsData &StatisticsPage::BeginUpdate()
+	{
+		// Odd sequence numbers mark the page as being written to
+		__atomic_fetch_add(&this->mData->Sequence, 1, __ATOMIC_SEQ_CST);
+
+		return *this->mData;
+	}
+	void StatisticsPage::EndUpdate()
+	{
+		__atomic_fetch_add(&this->mData->Sequence, 1, __ATOMIC_SEQ_CST);
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace ReShade
+{
+	/*
+	 * Statistics published to a named shared memory segment (see 'GetStatisticsPageName'), so external tools can monitor the runtime without touching the render thread.
+	 * The page is guarded by a sequence lock: Readers copy it and retry whenever 'Sequence' was odd or changed in between.
+	 * Only fixed size types are used, so the layout is the same for readers built on other platforms (see 'tools/StatisticsReader.cpp').
+	 */
+	struct StatisticsData
+	{
+		static const std::uint32_t Signature = 0x54535352; // "RSST"
+		static const std::uint32_t Version = 2;
+		static const std::uint32_t MaxTechniques = 64;
+
+		struct Technique
+		{
+			char Name[64];
+			float Cost, CPUCost, GPUCost; // Milliseconds averaged over the last frames, 'Cost' is the larger of both
+			std::uint32_t Enabled, Shed, Demotion;
+		};
+
+		std::uint32_t PageSignature, PageVersion, PageSize;
+		volatile std::int32_t Sequence;
+
+		std::uint64_t FrameCount;
+		float FrameTime, PostProcessingTime; // Milliseconds
+		std::uint32_t DrawCalls, DrawCallVertices;
+		std::uint32_t NetworkUpload, NetworkDownload;
+		std::uint32_t CompileStep, EffectLoaded, EffectErrors;
+		std::uint32_t TechniqueCount;
+		Technique Techniques[MaxTechniques];
+	};
+
+	static_assert(sizeof(StatisticsData::Technique) == 88 && sizeof(StatisticsData) == 64 + 64 * 88, "statistics page layout has to match across platforms");
+
+	/*
+	 * Name of the page a process publishes: A file mapping on Windows, a POSIX shared memory object (found under /dev/shm on Linux) everywhere else.
+	 */
+#ifdef _WIN32
+	inline std::wstring GetStatisticsPageName(unsigned long processId)
+	{
+		return L"Local\\ReShadeStatistics" + std::to_wstring(processId);
+	}
+#else
+	inline std::string GetStatisticsPageName(unsigned long processId)
+	{
+		return "/ReShadeStatistics" + std::to_string(processId);
+	}
+#endif
+
+	class StatisticsPage
+	{
+	public:
+		explicit StatisticsPage(unsigned long processId);
+		~StatisticsPage();
+
+		inline bool IsValid() const
+		{
+			return this->mData != nullptr;
+		}
+
+		StatisticsData &BeginUpdate();
+		void EndUpdate();
+
+	private:
+#ifdef _WIN32
+		HANDLE mMapping;
+#else
+		std::string mName; // Unlinked again when the page is destroyed
+#endif
+		StatisticsData *mData;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "TextureCache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <boost\filesystem\operations.hpp>
+
+namespace ReShade
+{
+	namespace
+	{
+		inline std::uint64_t HashBytes(std::uint64_t hash, const void *data, std::size_t size)
+		{
+			// 64-bit FNV-1a
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				hash = (hash ^ static_cast<const unsigned char *>(data)[i]) * 0x100000001B3ull;
+			}
+
+			return hash;
+		}
+	}
+
+	TextureCache::Entry::Entry(HANDLE file, HANDLE mapping, const unsigned char *view, std::uint64_t size) : mFile(file), mMapping(mapping), mView(view), mSize(size)
+	{
+	}
+	TextureCache::Entry::~Entry()
+	{
+		UnmapViewOfFile(this->mView);
+		CloseHandle(this->mMapping);
+		CloseHandle(this->mFile);
+	}
+
+	unsigned int TextureCache::Entry::GetLevelCount() const
+	{
+		return reinterpret_cast<const Header *>(this->mView)->LevelCount;
+	}
+	const unsigned char *TextureCache::Entry::GetLevel(unsigned int level, std::size_t &size) const
+	{
+		const std::uint64_t *const table = reinterpret_cast<const std::uint64_t *>(this->mView + sizeof(Header));
+
+		size = static_cast<std::size_t>(table[level * 2 + 1]);
+
+		return this->mView + table[level * 2];
+	}
+
+	TextureCache::TextureCache(const boost::filesystem::path &directory) : mDirectory(directory)
+	{
+	}
+
+	bool TextureCache::MakeKey(const boost::filesystem::path &path, Key &key)
+	{
+		boost::system::error_code ec;
+		const std::time_t time = boost::filesystem::last_write_time(path, ec);
+
+		if (ec)
+		{
+			return false;
+		}
+
+		const boost::uintmax_t size = boost::filesystem::file_size(path, ec);
+
+		if (ec)
+		{
+			return false;
+		}
+
+		key.Path = path;
+		key.WriteTime = static_cast<std::uint64_t>(time);
+		key.FileSize = static_cast<std::uint64_t>(size);
+
+		return true;
+	}
+
+	std::unique_ptr<TextureCache::Entry> TextureCache::Find(const Key &key) const
+	{
+		const std::uint64_t hash = Hash(key);
+		const HANDLE file = CreateFileW(GetEntryPath(hash).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER size;
+
+		if (!GetFileSizeEx(file, &size) || static_cast<std::uint64_t>(size.QuadPart) < sizeof(Header))
+		{
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mapping == nullptr)
+		{
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		const unsigned char *const view = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (view == nullptr)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		std::unique_ptr<Entry> entry(new Entry(file, mapping, view, size.QuadPart));
+
+		// Validate the whole key and the level table, so truncated or foreign files are treated as a miss
+		const Header &header = *reinterpret_cast<const Header *>(view);
+		const std::string path = key.Path.string();
+
+		if (header.Signature != Signature || header.Version != Version || header.Hash != hash || header.WriteTime != key.WriteTime || header.FileSize != key.FileSize || header.Width != key.Width || header.Height != key.Height || header.Levels != key.Levels || header.Format != key.Format || header.Channels != key.Channels || header.LevelCount == 0 || header.PathLength != path.size() || sizeof(Header) + header.LevelCount * 16ull + header.PathLength > static_cast<std::uint64_t>(size.QuadPart))
+		{
+			return nullptr;
+		}
+
+		const std::uint64_t *const table = reinterpret_cast<const std::uint64_t *>(view + sizeof(Header));
+
+		// Different sources whose keys hash to the same value only differ in their path
+		if (path.compare(0, path.size(), reinterpret_cast<const char *>(table + header.LevelCount * 2), header.PathLength) != 0)
+		{
+			return nullptr;
+		}
+
+		for (std::uint32_t level = 0; level < header.LevelCount; ++level)
+		{
+			if (table[level * 2] > static_cast<std::uint64_t>(size.QuadPart) || table[level * 2 + 1] > static_cast<std::uint64_t>(size.QuadPart) - table[level * 2])
+			{
+				return nullptr;
+			}
+		}
+
+		return entry;
+	}
+	bool TextureCache::Store(const Key &key, const std::vector<std::vector<unsigned char>> &levels) const
+	{
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(this->mDirectory, ec);
+
+		Header header;
+		header.Signature = Signature;
+		header.Version = Version;
+		header.Hash = Hash(key);
+		header.WriteTime = key.WriteTime;
+		header.FileSize = key.FileSize;
+		header.Width = key.Width;
+		header.Height = key.Height;
+		header.Levels = key.Levels;
+		header.Format = key.Format;
+		header.Channels = key.Channels;
+		header.LevelCount = static_cast<std::uint32_t>(levels.size());
+
+		const std::string source = key.Path.string();
+		header.PathLength = static_cast<std::uint32_t>(source.size());
+
+		std::vector<std::uint64_t> table;
+		std::uint64_t offset = sizeof(Header) + levels.size() * 16 + source.size();
+
+		for (const std::vector<unsigned char> &level : levels)
+		{
+			table.push_back(offset);
+			table.push_back(level.size());
+
+			offset += level.size();
+		}
+
+		// Write to a temporary file first, so other processes never map a partially written entry
+		const boost::filesystem::path path = GetEntryPath(header.Hash), temporary = path.string() + '.' + std::to_string(GetCurrentThreadId());
+
+		{
+			std::ofstream file(temporary.string(), std::ios::binary);
+
+			file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(std::uint64_t));
+			file.write(source.data(), source.size());
+
+			for (const std::vector<unsigned char> &level : levels)
+			{
+				file.write(reinterpret_cast<const char *>(level.data()), level.size());
+			}
+
+			if (!file.good())
+			{
+				file.close();
+				boost::filesystem::remove(temporary, ec);
+				return false;
+			}
+		}
+
+		if (!MoveFileExW(temporary.wstring().c_str(), path.wstring().c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			boost::filesystem::remove(temporary, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+	std::uint64_t TextureCache::Hash(const Key &key)
+	{
+		const std::string path = key.Path.string();
+		std::uint64_t hash = 0xCBF29CE484222325ull;
+
+		hash = HashBytes(hash, path.data(), path.size());
+		hash = HashBytes(hash, &key.WriteTime, sizeof(key.WriteTime));
+		hash = HashBytes(hash, &key.FileSize, sizeof(key.FileSize));
+		hash = HashBytes(hash, &key.Width, sizeof(key.Width));
+		hash = HashBytes(hash, &key.Height, sizeof(key.Height));
+		hash = HashBytes(hash, &key.Levels, sizeof(key.Levels));
+		hash = HashBytes(hash, &key.Format, sizeof(key.Format));
+		hash = HashBytes(hash, &key.Channels, sizeof(key.Channels));
+		const std::uint32_t version = Version;
+		hash = HashBytes(hash, &version, sizeof(version));
+
+		return hash;
+	}
+	boost::filesystem::path TextureCache::GetEntryPath(std::uint64_t hash) const
+	{
+		char name[32];
+		sprintf_s(name, "%016llx.rstc", static_cast<unsigned long long>(hash));
+
+		return this->mDirectory / name;
+	}
+}
\ No newline at end of file
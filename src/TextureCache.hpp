@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <windows.h>
+#include <boost\filesystem\path.hpp>
+
+namespace ReShade
+{
+	/*
+	 * Disk cache of processed source textures, storing every mipmap level in the final texture format so a hit only needs to map the file and upload it.
+	 * Entries are named after a hash of their key and repeat the whole key (including the source path) in them, so stale or colliding files are detected and rewritten.
+	 */
+	class TextureCache
+	{
+	public:
+		static const std::uint32_t Signature = 0x43545352; // "RSTC"
+		static const std::uint32_t Version = 2; // Has to be increased whenever decoding, mipmap generation or compression changes their output
+
+		struct Key
+		{
+			boost::filesystem::path Path;
+			std::uint64_t WriteTime, FileSize;
+			std::uint32_t Width, Height, Levels, Format, Channels;
+		};
+		struct Header
+		{
+			std::uint32_t Signature, Version;
+			std::uint64_t Hash, WriteTime, FileSize;
+			std::uint32_t Width, Height, Levels, Format, Channels;
+			std::uint32_t LevelCount; // Followed by 'LevelCount' pairs of 64-bit offset and size of each level, relative to the start of the file
+			std::uint32_t PathLength; // Followed by the source path after the level table, without a terminating zero
+		};
+
+		class Entry
+		{
+		public:
+			Entry(HANDLE file, HANDLE mapping, const unsigned char *view, std::uint64_t size);
+			~Entry();
+
+			unsigned int GetLevelCount() const;
+			const unsigned char *GetLevel(unsigned int level, std::size_t &size) const;
+
+		private:
+			Entry(const Entry &);
+			Entry &operator=(const Entry &);
+
+			HANDLE mFile, mMapping;
+			const unsigned char *mView;
+			std::uint64_t mSize;
+		};
+
+		explicit TextureCache(const boost::filesystem::path &directory);
+
+		static bool MakeKey(const boost::filesystem::path &path, Key &key);
+
+		std::unique_ptr<Entry> Find(const Key &key) const;
+		bool Store(const Key &key, const std::vector<std::vector<unsigned char>> &levels) const;
+
+	private:
+		static std::uint64_t Hash(const Key &key);
+		boost::filesystem::path GetEntryPath(std::uint64_t hash) const;
+
+		boost::filesystem::path mDirectory;
+	};
+}
\ No newline at end of file
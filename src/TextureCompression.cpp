@@ -0,0 +1,113 @@
+#include "TextureCompression.hpp"
+#include "BlockCompression.hpp"
+#include "WorkerThreads.hpp"
+
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace ReShade
+{
+	namespace
+	{
+		const unsigned int MinBlockRowsPerThread = 16;
+
+		// Gathers the pixels of a 4x4 block, repeating the last row and column of the image for partial blocks
+		void GatherBlock(const unsigned char *source, unsigned int width, unsigned int height, unsigned int channels, unsigned int bx, unsigned int by, unsigned char block[64])
+		{
+			for (unsigned int y = 0; y < 4; ++y)
+			{
+				const unsigned char *const row = source + std::min(by * 4 + y, height - 1) * width * channels;
+
+				for (unsigned int x = 0; x < 4; ++x)
+				{
+					std::memcpy(block + (y * 4 + x) * channels, row + std::min(bx * 4 + x, width - 1) * channels, channels);
+				}
+			}
+		}
+
+		void CompressBlockRows(Effect::Texture::Format format, unsigned int width, unsigned int height, const unsigned char *source, unsigned char *destination, unsigned int first, unsigned int last)
+		{
+			const unsigned int blocksX = (width + 3) / 4;
+			const std::size_t blockSize = GetCompressedSize(format, 4, 4);
+			unsigned char block[64];
+
+			for (unsigned int by = first; by < last; ++by)
+			{
+				unsigned char *output = destination + by * blocksX * blockSize;
+
+				for (unsigned int bx = 0; bx < blocksX; ++bx, output += blockSize)
+				{
+					switch (format)
+					{
+						case Effect::Texture::Format::DXT1:
+							GatherBlock(source, width, height, 4, bx, by, block);
+							CompressBC1Block(block, output);
+							break;
+						case Effect::Texture::Format::DXT5:
+							GatherBlock(source, width, height, 4, bx, by, block);
+							CompressBC3Block(block, output);
+							break;
+						case Effect::Texture::Format::LATC1:
+							GatherBlock(source, width, height, 1, bx, by, block);
+							CompressBC4Block(block, output);
+							break;
+						case Effect::Texture::Format::LATC2:
+							GatherBlock(source, width, height, 2, bx, by, block);
+							CompressBC5Block(block, output);
+							break;
+					}
+				}
+			}
+		}
+	}
+
+	bool IsCompressedFormat(Effect::Texture::Format format)
+	{
+		return format >= Effect::Texture::Format::DXT1 && format <= Effect::Texture::Format::LATC2;
+	}
+	std::size_t GetCompressedSize(Effect::Texture::Format format, unsigned int width, unsigned int height)
+	{
+		const std::size_t blocks = static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4);
+
+		switch (format)
+		{
+			case Effect::Texture::Format::DXT1:
+			case Effect::Texture::Format::LATC1:
+				return blocks * 8;
+			case Effect::Texture::Format::DXT3:
+			case Effect::Texture::Format::DXT5:
+			case Effect::Texture::Format::LATC2:
+				return blocks * 16;
+			default:
+				return 0;
+		}
+	}
+	bool CompressImage(Effect::Texture::Format format, unsigned int width, unsigned int height, const unsigned char *source, unsigned char *destination)
+	{
+		if (width == 0 || height == 0 || !IsCompressedFormat(format) || format == Effect::Texture::Format::DXT3)
+		{
+			return false;
+		}
+
+		// Split the block rows evenly between threads, small images are not worth the thread creation
+		const unsigned int blocksY = (height + 3) / 4;
+		const unsigned int threadCount = GetParallelThreadCount(blocksY / MinBlockRowsPerThread);
+		std::vector<std::thread> threads;
+
+		for (unsigned int i = 1; i < threadCount; ++i)
+		{
+			threads.emplace_back(&CompressBlockRows, format, width, height, source, destination, blocksY * i / threadCount, blocksY * (i + 1) / threadCount);
+		}
+
+		CompressBlockRows(format, width, height, source, destination, 0, blocksY / threadCount);
+
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Effect.hpp"
+
+namespace ReShade
+{
+	/*
+	 * Block compression of whole images, encoding 4x4 blocks in parallel. Partial blocks at the right and bottom edges are padded by repeating the last pixel.
+	 * The source data has to have 4 channels for 'DXT1' and 'DXT5', 1 channel for 'LATC1' and 2 channels for 'LATC2'.
+	 */
+	bool IsCompressedFormat(Effect::Texture::Format format);
+	std::size_t GetCompressedSize(Effect::Texture::Format format, unsigned int width, unsigned int height);
+	bool CompressImage(Effect::Texture::Format format, unsigned int width, unsigned int height, const unsigned char *source, unsigned char *destination);
+}
\ No newline at end of file
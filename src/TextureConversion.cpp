@@ -0,0 +1,546 @@
+#include "TextureConversion.hpp"
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace ReShade
+{
+	namespace
+	{
+		bool HasF16C()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 1);
+#else
+			unsigned int info[4] = { };
+			__get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+#endif
+
+			// F16C instructions are VEX encoded, so the operating system has to save the AVX state too
+			const bool f16c = (info[2] & (1 << 29)) != 0, avx = (info[2] & (1 << 28)) != 0, osxsave = (info[2] & (1 << 27)) != 0;
+
+			if (!f16c || !avx || !osxsave)
+			{
+				return false;
+			}
+
+#ifdef _MSC_VER
+			const unsigned long long xcr0 = _xgetbv(0);
+#else
+			unsigned int low, high;
+			__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			const unsigned long long xcr0 = (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+
+			return (xcr0 & 0x6) == 0x6;
+		}
+
+		// Other compilers only emit F16C instructions in functions marked for it, MSVC in any function
+#ifdef _MSC_VER
+		std::size_t ConvertFloatToHalfF16C(const float *source, std::uint16_t *destination, std::size_t count)
+#else
+		__attribute__((target("f16c"))) std::size_t ConvertFloatToHalfF16C(const float *source, std::uint16_t *destination, std::size_t count)
+#endif
+		{
+			std::size_t i = 0;
+
+			for (; i + 4 <= count; i += 4)
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i *>(destination + i), _mm_cvtps_ph(_mm_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT));
+			}
+
+			return i;
+		}
+
+		std::uint16_t FloatToHalf(float value)
+		{
+			std::uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+
+			const std::uint32_t sign = (bits >> 16) & 0x8000;
+			bits &= 0x7FFFFFFF;
+
+			if (bits >= 0x47800000)
+			{
+				// Too large for half precision, infinity or NaN
+				return static_cast<std::uint16_t>(sign | (bits > 0x7F800000 ? 0x7E00 : 0x7C00));
+			}
+			else if (bits < 0x38800000)
+			{
+				// Denormalized result, adding 0.5 lets the floating-point unit shift and round the mantissa into place
+				float denormalized;
+				std::memcpy(&denormalized, &bits, sizeof(bits));
+				denormalized += 0.5f;
+				std::memcpy(&bits, &denormalized, sizeof(bits));
+
+				return static_cast<std::uint16_t>(sign | (bits - 0x3F000000));
+			}
+			else
+			{
+				// Rebias the exponent and round to nearest even
+				bits += 0xC8000FFF + ((bits >> 13) & 1);
+
+				return static_cast<std::uint16_t>(sign | (bits >> 13));
+			}
+		}
+
+		const unsigned int FloatBlock = 256; // Pixels converted through the float path at a time, small enough to stay in the L1 cache
+
+		// Small floats with fewer exponent bits (but the same bias as half precision) become float32 by moving their bits into place and adding the exponent bias difference
+		// Denormals are converted as integers instead, which avoids slow floating-point arithmetic on denormal inputs, values with all exponent bits set are infinity or NaN
+		inline __m128 DecodeSmallFloat(__m128i bits, int shift, int maximum)
+		{
+			const int mantissaBits = 23 - shift;
+
+			const __m128i normal = _mm_add_epi32(_mm_slli_epi32(bits, shift), _mm_set1_epi32(112 << 23));
+			const __m128i special = _mm_and_si128(_mm_cmpgt_epi32(bits, _mm_set1_epi32(maximum)), _mm_set1_epi32(0x7F800000));
+			const __m128i denormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(1 << mantissaBits));
+			const __m128 denormalValue = _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_castsi128_ps(_mm_set1_epi32((127 - 14 - mantissaBits) << 23)));
+
+			return _mm_or_ps(_mm_castsi128_ps(_mm_or_si128(_mm_andnot_si128(denormal, normal), special)), _mm_and_ps(_mm_castsi128_ps(denormal), denormalValue));
+		}
+		inline __m128 DecodeHalf(__m128i bits)
+		{
+			const __m128i sign = _mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x8000)), 16);
+
+			return _mm_or_ps(DecodeSmallFloat(_mm_and_si128(bits, _mm_set1_epi32(0x7FFF)), 13, 0x7BFF), _mm_castsi128_ps(sign));
+		}
+		inline float DecodeHalf(std::uint16_t bits)
+		{
+			float value;
+			_mm_store_ss(&value, DecodeHalf(_mm_cvtsi32_si128(bits)));
+
+			return value;
+		}
+
+		// Transposes four pixels of separate channels into interleaved RGBA and stores them
+		inline void StoreRGBA(float *destination, __m128 r, __m128 g, __m128 b, __m128 a)
+		{
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			_mm_storeu_ps(destination + 0, r);
+			_mm_storeu_ps(destination + 4, g);
+			_mm_storeu_ps(destination + 8, b);
+			_mm_storeu_ps(destination + 12, a);
+		}
+
+		void DecodeRow(TexelFormat format, const unsigned char *source, float *destination, unsigned int width)
+		{
+			const __m128 one = _mm_set1_ps(1.0f);
+			unsigned int x = 0;
+
+			switch (format)
+			{
+				case TexelFormat::RGBA8:
+				case TexelFormat::BGRA8:
+				{
+					const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+					const __m128i zero = _mm_setzero_si128();
+
+					for (; x + 4 <= width; x += 4)
+					{
+						const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 4));
+						const __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+
+						_mm_storeu_ps(destination + x * 4 + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+						_mm_storeu_ps(destination + x * 4 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+						_mm_storeu_ps(destination + x * 4 + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+						_mm_storeu_ps(destination + x * 4 + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+					}
+					for (; x < width; ++x)
+					{
+						for (unsigned int c = 0; c < 4; ++c)
+						{
+							destination[x * 4 + c] = source[x * 4 + c] / 255.0f;
+						}
+					}
+
+					if (format == TexelFormat::BGRA8)
+					{
+						for (x = 0; x < width; ++x)
+						{
+							std::swap(destination[x * 4 + 0], destination[x * 4 + 2]);
+						}
+					}
+					break;
+				}
+				case TexelFormat::RGB10A2:
+				{
+					const __m128i mask = _mm_set1_epi32(0x3FF);
+					const __m128 scale = _mm_set1_ps(1.0f / 1023.0f), scaleAlpha = _mm_set1_ps(1.0f / 3.0f);
+
+					for (; x + 4 <= width; x += 4)
+					{
+						const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 4));
+
+						StoreRGBA(destination + x * 4,
+							_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(texels, mask)), scale),
+							_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 10), mask)), scale),
+							_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 20), mask)), scale),
+							_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(texels, 30)), scaleAlpha));
+					}
+					for (; x < width; ++x)
+					{
+						std::uint32_t texel;
+						std::memcpy(&texel, source + x * 4, 4);
+
+						destination[x * 4 + 0] = (texel & 0x3FF) / 1023.0f;
+						destination[x * 4 + 1] = ((texel >> 10) & 0x3FF) / 1023.0f;
+						destination[x * 4 + 2] = ((texel >> 20) & 0x3FF) / 1023.0f;
+						destination[x * 4 + 3] = (texel >> 30) / 3.0f;
+					}
+					break;
+				}
+				case TexelFormat::RG11B10F:
+				{
+					const __m128i mask11 = _mm_set1_epi32(0x7FF);
+
+					for (; x + 4 <= width; x += 4)
+					{
+						const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 4));
+
+						// 6 and 5 bit mantissas without sign, the exponents have the same bias as half precision
+						StoreRGBA(destination + x * 4,
+							DecodeSmallFloat(_mm_and_si128(texels, mask11), 17, 0x7BF),
+							DecodeSmallFloat(_mm_and_si128(_mm_srli_epi32(texels, 11), mask11), 17, 0x7BF),
+							DecodeSmallFloat(_mm_srli_epi32(texels, 22), 18, 0x3DF),
+							one);
+					}
+					for (; x < width; ++x)
+					{
+						std::uint32_t texel;
+						std::memcpy(&texel, source + x * 4, 4);
+
+						const __m128i bits = _mm_set_epi32(0, texel >> 22, (texel >> 11) & 0x7FF, texel & 0x7FF);
+						const __m128 rg = DecodeSmallFloat(bits, 17, 0x7BF), b = DecodeSmallFloat(bits, 18, 0x3DF);
+
+						float values[4];
+						_mm_storeu_ps(values, rg);
+						destination[x * 4 + 0] = values[0];
+						destination[x * 4 + 1] = values[1];
+						_mm_storeu_ps(values, b);
+						destination[x * 4 + 2] = values[2];
+						destination[x * 4 + 3] = 1.0f;
+					}
+					break;
+				}
+				case TexelFormat::RGBA16F:
+				{
+					const __m128i zero = _mm_setzero_si128();
+
+					for (; x + 2 <= width; x += 2)
+					{
+						const __m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 8));
+
+						_mm_storeu_ps(destination + x * 4 + 0, DecodeHalf(_mm_unpacklo_epi16(halfs, zero)));
+						_mm_storeu_ps(destination + x * 4 + 4, DecodeHalf(_mm_unpackhi_epi16(halfs, zero)));
+					}
+					for (; x < width; ++x)
+					{
+						_mm_storeu_ps(destination + x * 4, DecodeHalf(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + x * 8)), zero)));
+					}
+					break;
+				}
+				case TexelFormat::RGBA16:
+				{
+					const __m128i zero = _mm_setzero_si128();
+					const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+
+					for (; x + 2 <= width; x += 2)
+					{
+						const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 8));
+
+						_mm_storeu_ps(destination + x * 4 + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)), scale));
+						_mm_storeu_ps(destination + x * 4 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)), scale));
+					}
+					for (; x < width; ++x)
+					{
+						_mm_storeu_ps(destination + x * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + x * 8)), zero)), scale));
+					}
+					break;
+				}
+				case TexelFormat::R32F:
+				{
+					for (; x + 4 <= width; x += 4)
+					{
+						const __m128 value = _mm_loadu_ps(reinterpret_cast<const float *>(source + x * 4));
+
+						StoreRGBA(destination + x * 4, value, value, value, one);
+					}
+					for (; x < width; ++x)
+					{
+						float value;
+						std::memcpy(&value, source + x * 4, 4);
+
+						destination[x * 4 + 0] = destination[x * 4 + 1] = destination[x * 4 + 2] = value;
+						destination[x * 4 + 3] = 1.0f;
+					}
+					break;
+				}
+				case TexelFormat::RGBA32F:
+				{
+					std::memcpy(destination, source, width * 16);
+					break;
+				}
+				// Less common formats are mostly converted one texel at a time
+				case TexelFormat::R8:
+				case TexelFormat::RG8:
+				case TexelFormat::R16F:
+				case TexelFormat::RG16F:
+				case TexelFormat::D24S8:
+				{
+					if (format == TexelFormat::R16F)
+					{
+						for (; x + 4 <= width; x += 4)
+						{
+							const __m128 value = DecodeHalf(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + x * 2)), _mm_setzero_si128()));
+
+							StoreRGBA(destination + x * 4, value, value, value, one);
+						}
+					}
+					else if (format == TexelFormat::RG16F)
+					{
+						for (; x + 4 <= width; x += 4)
+						{
+							const __m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 4));
+
+							StoreRGBA(destination + x * 4, DecodeHalf(_mm_and_si128(halfs, _mm_set1_epi32(0xFFFF))), DecodeHalf(_mm_srli_epi32(halfs, 16)), _mm_setzero_ps(), one);
+						}
+					}
+
+					for (; x < width; ++x)
+					{
+						float *const texel = destination + x * 4;
+						texel[2] = 0.0f;
+						texel[3] = 1.0f;
+
+						if (format == TexelFormat::R8 || format == TexelFormat::RG8)
+						{
+							const std::size_t size = format == TexelFormat::R8 ? 1 : 2;
+
+							texel[0] = source[x * size] / 255.0f;
+							texel[1] = format == TexelFormat::R8 ? texel[0] : source[x * size + 1] / 255.0f;
+						}
+						else if (format == TexelFormat::R16F || format == TexelFormat::RG16F)
+						{
+							const std::size_t size = format == TexelFormat::R16F ? 2 : 4;
+							std::uint16_t halfs[2];
+							std::memcpy(halfs, source + x * size, size);
+
+							texel[0] = DecodeHalf(halfs[0]);
+							texel[1] = format == TexelFormat::R16F ? texel[0] : DecodeHalf(halfs[1]);
+						}
+						else
+						{
+							std::uint32_t depth;
+							std::memcpy(&depth, source + x * 4, 4);
+
+							texel[0] = texel[1] = (depth & 0xFFFFFF) / 16777215.0f;
+						}
+
+						if (format == TexelFormat::R8 || format == TexelFormat::R16F || format == TexelFormat::D24S8)
+						{
+							texel[2] = texel[0];
+						}
+					}
+					break;
+				}
+			}
+		}
+		void EncodeRowRGBA8(const float *source, unsigned char *destination, unsigned int width)
+		{
+			const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+			unsigned int x = 0;
+
+			for (; x + 4 <= width; x += 4)
+			{
+				__m128i values[4];
+
+				for (unsigned int i = 0; i < 4; ++i)
+				{
+					// Maximum with zero first also turns NaN into zero
+					values[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + (x + i) * 4), zero), one), scale), half));
+				}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4), _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]), _mm_packs_epi32(values[2], values[3])));
+			}
+			for (x *= 4; x < width * 4; ++x)
+			{
+				const float value = source[x] > 0.0f ? std::min(source[x], 1.0f) : 0.0f;
+
+				destination[x] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	void ConvertFloatToHalf(const float *source, std::uint16_t *destination, std::size_t count)
+	{
+		static const bool f16c = HasF16C();
+		std::size_t i = f16c ? ConvertFloatToHalfF16C(source, destination, count) : 0;
+
+		for (; i < count; ++i)
+		{
+			destination[i] = FloatToHalf(source[i]);
+		}
+	}
+	void ConvertFloatToUnorm16(const float *source, std::uint16_t *destination, std::size_t count)
+	{
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(65535.0f), half = _mm_set1_ps(0.5f);
+		const __m128i bias = _mm_set1_epi32(32768), flip = _mm_set1_epi16(static_cast<short>(0x8000));
+		std::size_t i = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i low = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), zero), one), scale), half));
+			const __m128i high = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i + 4), zero), one), scale), half));
+
+			// There is no unsigned saturating pack in SSE2, so shift into the signed range and flip the sign bit back afterwards
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(low, bias), _mm_sub_epi32(high, bias)), flip));
+		}
+
+		for (; i < count; ++i)
+		{
+			const float value = source[i] < 0.0f ? 0.0f : source[i] > 1.0f ? 1.0f : source[i];
+
+			destination[i] = static_cast<std::uint16_t>(value * 65535.0f + 0.5f);
+		}
+	}
+
+	std::size_t GetTexelSize(TexelFormat format)
+	{
+		switch (format)
+		{
+			case TexelFormat::R8:
+				return 1;
+			case TexelFormat::RG8:
+			case TexelFormat::R16F:
+				return 2;
+			case TexelFormat::RGBA16:
+			case TexelFormat::RGBA16F:
+				return 8;
+			case TexelFormat::RGBA32F:
+				return 16;
+			default:
+				return 4;
+		}
+	}
+
+	unsigned int GetTexelChannels(TexelFormat format)
+	{
+		switch (format)
+		{
+			case TexelFormat::R8:
+			case TexelFormat::R16F:
+			case TexelFormat::R32F:
+			case TexelFormat::D24S8:
+				return 1;
+			case TexelFormat::RG8:
+			case TexelFormat::RG16F:
+				return 2;
+			case TexelFormat::RG11B10F:
+				return 3;
+			default:
+				return 4;
+		}
+	}
+
+	void ConvertToRGBA8(TexelFormat format, const unsigned char *source, std::size_t sourcePitch, unsigned int width, unsigned int height, unsigned char *destination, std::size_t destinationPitch)
+	{
+		std::vector<float> block;
+
+		for (unsigned int y = 0; y < height; ++y, source += sourcePitch, destination += destinationPitch)
+		{
+			// 8-bit formats are converted directly, everything else goes through float
+			if (format == TexelFormat::RGBA8)
+			{
+				std::memcpy(destination, source, width * 4);
+			}
+			else if (format == TexelFormat::BGRA8)
+			{
+				const __m128i maskRB = _mm_set1_epi32(0x00FF00FF), maskGA = _mm_set1_epi32(0xFF00FF00);
+				unsigned int x = 0;
+
+				for (; x + 4 <= width; x += 4)
+				{
+					const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 4));
+					const __m128i rb = _mm_and_si128(texels, maskRB);
+
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4), _mm_or_si128(_mm_and_si128(texels, maskGA), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16))));
+				}
+				for (; x < width; ++x)
+				{
+					destination[x * 4 + 0] = source[x * 4 + 2];
+					destination[x * 4 + 1] = source[x * 4 + 1];
+					destination[x * 4 + 2] = source[x * 4 + 0];
+					destination[x * 4 + 3] = source[x * 4 + 3];
+				}
+			}
+			else if (format == TexelFormat::R8 || format == TexelFormat::RG8)
+			{
+				const __m128i alpha = _mm_set1_epi32(0xFF000000), zero = _mm_setzero_si128();
+				unsigned int x = 0;
+
+				if (format == TexelFormat::R8)
+				{
+					for (; x + 16 <= width; x += 16)
+					{
+						const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x));
+						const __m128i low = _mm_unpacklo_epi8(values, values), high = _mm_unpackhi_epi8(values, values);
+
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4 + 0), _mm_or_si128(_mm_unpacklo_epi16(low, low), alpha));
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(low, low), alpha));
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4 + 32), _mm_or_si128(_mm_unpacklo_epi16(high, high), alpha));
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4 + 48), _mm_or_si128(_mm_unpackhi_epi16(high, high), alpha));
+					}
+				}
+				else
+				{
+					for (; x + 8 <= width; x += 8)
+					{
+						const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x * 2));
+
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4 + 0), _mm_or_si128(_mm_unpacklo_epi16(values, zero), alpha));
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(values, zero), alpha));
+					}
+				}
+
+				for (; x < width; ++x)
+				{
+					const unsigned char r = source[x * (format == TexelFormat::R8 ? 1 : 2)], g = format == TexelFormat::R8 ? r : source[x * 2 + 1];
+
+					destination[x * 4 + 0] = r;
+					destination[x * 4 + 1] = g;
+					destination[x * 4 + 2] = format == TexelFormat::R8 ? r : 0;
+					destination[x * 4 + 3] = 0xFF;
+				}
+			}
+			else
+			{
+				block.resize(FloatBlock * 4);
+
+				for (unsigned int x = 0; x < width; x += FloatBlock)
+				{
+					const unsigned int count = std::min(FloatBlock, width - x);
+
+					DecodeRow(format, source + x * GetTexelSize(format), block.data(), count);
+					EncodeRowRGBA8(block.data(), destination + x * 4, count);
+				}
+			}
+		}
+	}
+	void ConvertToRGBA32F(TexelFormat format, const unsigned char *source, std::size_t sourcePitch, unsigned int width, unsigned int height, float *destination, std::size_t destinationPitch)
+	{
+		for (unsigned int y = 0; y < height; ++y, source += sourcePitch)
+		{
+			DecodeRow(format, source, reinterpret_cast<float *>(reinterpret_cast<unsigned char *>(destination) + y * destinationPitch), width);
+		}
+	}
+}
\ No newline at end of file
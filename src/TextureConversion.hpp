@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace ReShade
+{
+	/*
+	 * Conversions of float image data into the other formats textures can be stored in.
+	 * Half precision values are rounded to nearest even, with F16C used when the processor supports it.
+	 */
+	void ConvertFloatToHalf(const float *source, std::uint16_t *destination, std::size_t count);
+	void ConvertFloatToUnorm16(const float *source, std::uint16_t *destination, std::size_t count);
+
+	/*
+	 * Texel layouts of render targets, in memory order of their components.
+	 * Single channel formats are expanded to grey, two channel formats to red and green, missing alpha is opaque.
+	 */
+	enum class TexelFormat
+	{
+		R8,
+		RG8,
+		RGBA8,
+		BGRA8,
+		RGB10A2,
+		RG11B10F,
+		R16F,
+		RG16F,
+		RGBA16,
+		RGBA16F,
+		R32F,
+		RGBA32F,
+		D24S8 // Depth in the lower 24 bits, stencil is dropped
+	};
+
+	std::size_t GetTexelSize(TexelFormat format);
+	unsigned int GetTexelChannels(TexelFormat format);
+
+	/*
+	 * Convert rows of texels into tightly packed 8-bit RGBA or 32-bit float RGBA, the pitches are the distance between rows in bytes.
+	 * Values outside of [0, 1] are clamped when converting to 8-bit, float formats are not tone mapped.
+	 */
+	void ConvertToRGBA8(TexelFormat format, const unsigned char *source, std::size_t sourcePitch, unsigned int width, unsigned int height, unsigned char *destination, std::size_t destinationPitch);
+	void ConvertToRGBA32F(TexelFormat format, const unsigned char *source, std::size_t sourcePitch, unsigned int width, unsigned int height, float *destination, std::size_t destinationPitch);
+}
\ No newline at end of file
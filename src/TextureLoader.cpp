@@ -0,0 +1,388 @@
+#include "Log.hpp"
+#include "TextureLoader.hpp"
+#include "TextureCompression.hpp"
+#include "TextureMipmaps.hpp"
+#include "TextureConversion.hpp"
+#include "WorkerThreads.hpp"
+
+#include <stb_image.h>
+#include <stb_image_resize.h>
+
+namespace ReShade
+{
+	namespace
+	{
+		bool IsFloatFormat(Effect::Texture::Format format)
+		{
+			return format >= Effect::Texture::Format::R32F && format <= Effect::Texture::Format::RGBA32F;
+		}
+		std::size_t GetDataSize(Effect::Texture::Format format, unsigned int width, unsigned int height, int channels)
+		{
+			switch (format)
+			{
+				case Effect::Texture::Format::R32F:
+				case Effect::Texture::Format::RGBA32F:
+					return width * height * channels * 4;
+				case Effect::Texture::Format::RGBA16:
+				case Effect::Texture::Format::RGBA16F:
+					return width * height * channels * 2;
+				default:
+					return IsCompressedFormat(format) ? GetCompressedSize(format, width, height) : width * height * channels;
+			}
+		}
+	}
+
+	TextureLoader::TextureLoader() : mExit(false)
+	{
+		const unsigned int count = std::max(std::min(std::thread::hardware_concurrency() / 2, 4u), 1u);
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			this->mThreads.emplace_back(&TextureLoader::WorkerMain, this);
+		}
+	}
+	TextureLoader::~TextureLoader()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(this->mMutex);
+
+			this->mExit = true;
+			this->mQueue.clear();
+		}
+
+		this->mCondition.notify_all();
+
+		for (std::thread &thread : this->mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	void TextureLoader::SetCacheDirectory(const boost::filesystem::path &directory)
+	{
+		this->mCache = std::make_shared<TextureCache>(directory);
+	}
+	void TextureLoader::Enqueue(Effect::Texture *texture, const std::string &name, const boost::filesystem::path &path, int channels)
+	{
+		const bool hdr = IsFloatFormat(texture->GetDescription().Format);
+		std::shared_ptr<Job> &job = this->mBatch[std::make_tuple(path.string(), channels, hdr)];
+
+		if (job == nullptr)
+		{
+			job = std::make_shared<Job>();
+			job->Path = path;
+			job->Channels = channels;
+			job->Float = hdr;
+			job->Cache = this->mCache;
+			job->Width = job->Height = 0;
+			job->Loaded = false;
+			job->Done = false;
+		}
+
+		Target target;
+		target.Texture = texture;
+		target.Name = name;
+		target.Desc = texture->GetDescription();
+
+		// Clear the texture until the image is ready, so effects never sample undefined memory
+		const std::vector<unsigned char> placeholder(GetDataSize(target.Desc.Format, target.Desc.Width, target.Desc.Height, channels), 0);
+		texture->Update(0, placeholder.data(), placeholder.size(), true);
+
+		job->Targets.push_back(std::move(target));
+	}
+	void TextureLoader::Submit()
+	{
+		if (this->mBatch.empty())
+		{
+			return;
+		}
+
+		{
+			const std::lock_guard<std::mutex> lock(this->mMutex);
+
+			for (const auto &it : this->mBatch)
+			{
+				this->mQueue.push_back(it.second);
+				this->mPending.push_back(it.second);
+			}
+		}
+
+		this->mBatch.clear();
+		this->mCondition.notify_all();
+	}
+	void TextureLoader::Cancel()
+	{
+		// Jobs already running finish in the background, but their results are never uploaded to the textures that are about to be destroyed
+		const std::lock_guard<std::mutex> lock(this->mMutex);
+
+		this->mQueue.clear();
+		this->mPending.clear();
+		this->mBatch.clear();
+	}
+	unsigned int TextureLoader::Update()
+	{
+		unsigned int uploaded = 0;
+
+		for (auto it = this->mPending.begin(); it != this->mPending.end();)
+		{
+			Job &job = **it;
+
+			if (!job.Done.load(std::memory_order_acquire))
+			{
+				++it;
+				continue;
+			}
+
+			for (const Target &target : job.Targets)
+			{
+				if (!job.Loaded)
+				{
+					LOG(ERROR) << "> Source " << job.Path.filename() << " for texture '" << target.Name << "' could not be loaded! Make sure it exists and of a compatible format.";
+					continue;
+				}
+
+				if (target.Cached != nullptr)
+				{
+					for (unsigned int level = 0, levels = target.Cached->GetLevelCount(); level < levels; ++level)
+					{
+						std::size_t size = 0;
+						const unsigned char *const data = target.Cached->GetLevel(level, size);
+
+						target.Texture->Update(level, data, size, levels == 1);
+					}
+
+					uploaded++;
+					continue;
+				}
+
+				if (target.Desc.Width != static_cast<unsigned int>(job.Width) || target.Desc.Height != static_cast<unsigned int>(job.Height))
+				{
+					LOG(INFO) << "> Resized image data for texture '" << target.Name << "' from " << job.Width << "x" << job.Height << " to " << target.Desc.Width << "x" << target.Desc.Height << ".";
+				}
+
+				// Mipmaps are only generated on the GPU if the image did not come with its own (like float images)
+				for (unsigned int level = 0; level < target.Levels.size(); ++level)
+				{
+					target.Texture->Update(level, target.Levels[level].data(), target.Levels[level].size(), target.Levels.size() == 1);
+				}
+
+				uploaded++;
+			}
+
+			it = this->mPending.erase(it);
+		}
+
+		return uploaded;
+	}
+
+	void TextureLoader::WorkerMain()
+	{
+		const WorkerThreadScope scope;
+
+		while (true)
+		{
+			std::shared_ptr<Job> job;
+
+			{
+				std::unique_lock<std::mutex> lock(this->mMutex);
+
+				this->mCondition.wait(lock, [this]() { return this->mExit || !this->mQueue.empty(); });
+
+				if (this->mExit)
+				{
+					return;
+				}
+
+				job = this->mQueue.front();
+				this->mQueue.pop_front();
+			}
+
+			Process(*job);
+
+			job->Done.store(true, std::memory_order_release);
+		}
+	}
+	void TextureLoader::Process(Job &job)
+	{
+		bool missing = job.Cache == nullptr;
+
+		// Look up every target in the cache first, the image only has to be decoded if any of them is missing
+		for (Target &target : job.Targets)
+		{
+			if (job.Cache == nullptr || !TextureCache::MakeKey(job.Path, target.Key))
+			{
+				missing = true;
+				continue;
+			}
+
+			target.Key.Width = target.Desc.Width;
+			target.Key.Height = target.Desc.Height;
+			target.Key.Levels = target.Desc.Levels;
+			target.Key.Format = static_cast<std::uint32_t>(target.Desc.Format);
+			target.Key.Channels = job.Channels;
+			target.Cached = job.Cache->Find(target.Key);
+
+			missing |= target.Cached == nullptr;
+		}
+
+		if (!missing)
+		{
+			job.Loaded = true;
+			return;
+		}
+
+		if (job.Float)
+		{
+			ProcessFloat(job);
+		}
+		else
+		{
+			ProcessImage(job);
+		}
+
+		if (!job.Loaded || job.Cache == nullptr)
+		{
+			return;
+		}
+
+		for (Target &target : job.Targets)
+		{
+			if (target.Cached == nullptr && !target.Key.Path.empty())
+			{
+				job.Cache->Store(target.Key, target.Levels);
+			}
+		}
+	}
+	void TextureLoader::ProcessImage(Job &job)
+	{
+		int channelsFile = 0;
+		unsigned char *const dataFile = stbi_load(job.Path.string().c_str(), &job.Width, &job.Height, &channelsFile, job.Channels);
+
+		if (dataFile == nullptr)
+		{
+			return;
+		}
+
+		for (Target &target : job.Targets)
+		{
+			if (target.Cached != nullptr)
+			{
+				continue;
+			}
+
+			const Effect::Texture::Description &desc = target.Desc;
+
+			std::vector<unsigned char> data(desc.Width * desc.Height * job.Channels);
+
+			if (desc.Width != static_cast<unsigned int>(job.Width) || desc.Height != static_cast<unsigned int>(job.Height))
+			{
+				stbir_resize_uint8(dataFile, job.Width, job.Height, 0, data.data(), desc.Width, desc.Height, 0, job.Channels);
+			}
+			else
+			{
+				std::memcpy(data.data(), dataFile, data.size());
+			}
+
+			// A mipmap count of zero requests the full chain
+			target.Levels = GenerateMipmaps(data.data(), desc.Width, desc.Height, job.Channels, desc.Levels != 0 ? desc.Levels : GetMipmapCount(desc.Width, desc.Height));
+			target.Levels.insert(target.Levels.begin(), std::move(data));
+
+			if (IsCompressedFormat(desc.Format))
+			{
+				for (unsigned int level = 0; level < target.Levels.size(); ++level)
+				{
+					const unsigned int width = std::max(desc.Width >> level, 1u), height = std::max(desc.Height >> level, 1u);
+
+					std::vector<unsigned char> compressed(GetDataSize(desc.Format, width, height, job.Channels));
+					CompressImage(desc.Format, width, height, target.Levels[level].data(), compressed.data());
+
+					target.Levels[level].swap(compressed);
+				}
+			}
+		}
+
+		stbi_image_free(dataFile);
+
+		job.Loaded = true;
+	}
+	void TextureLoader::ProcessFloat(Job &job)
+	{
+		const std::string path = job.Path.string();
+		int channelsFile = 0;
+		std::vector<float> image;
+
+		// Only actual HDR files are loaded as float, since 'stbi_loadf' would apply a gamma curve to other images, which breaks lookup tables
+		if (stbi_is_hdr(path.c_str()))
+		{
+			float *const dataFile = stbi_loadf(path.c_str(), &job.Width, &job.Height, &channelsFile, job.Channels);
+
+			if (dataFile == nullptr)
+			{
+				return;
+			}
+
+			image.assign(dataFile, dataFile + job.Width * job.Height * job.Channels);
+
+			stbi_image_free(dataFile);
+		}
+		else
+		{
+			unsigned char *const dataFile = stbi_load(path.c_str(), &job.Width, &job.Height, &channelsFile, job.Channels);
+
+			if (dataFile == nullptr)
+			{
+				return;
+			}
+
+			image.resize(job.Width * job.Height * job.Channels);
+
+			for (std::size_t i = 0; i < image.size(); ++i)
+			{
+				image[i] = dataFile[i] / 255.0f;
+			}
+
+			stbi_image_free(dataFile);
+		}
+
+		for (Target &target : job.Targets)
+		{
+			if (target.Cached != nullptr)
+			{
+				continue;
+			}
+
+			const Effect::Texture::Description &desc = target.Desc;
+
+			std::vector<float> data(desc.Width * desc.Height * job.Channels);
+
+			if (desc.Width != static_cast<unsigned int>(job.Width) || desc.Height != static_cast<unsigned int>(job.Height))
+			{
+				stbir_resize_float(image.data(), job.Width, job.Height, 0, data.data(), desc.Width, desc.Height, 0, job.Channels);
+			}
+			else
+			{
+				data = image;
+			}
+
+			std::vector<unsigned char> output(GetDataSize(desc.Format, desc.Width, desc.Height, job.Channels));
+
+			switch (desc.Format)
+			{
+				case Effect::Texture::Format::RGBA16:
+					ConvertFloatToUnorm16(data.data(), reinterpret_cast<std::uint16_t *>(output.data()), data.size());
+					break;
+				case Effect::Texture::Format::RGBA16F:
+					ConvertFloatToHalf(data.data(), reinterpret_cast<std::uint16_t *>(output.data()), data.size());
+					break;
+				default:
+					std::memcpy(output.data(), data.data(), output.size());
+					break;
+			}
+
+			// Float textures only get their base level, the backends generate the remaining mipmaps
+			target.Levels.push_back(std::move(output));
+		}
+
+		job.Loaded = true;
+	}
+}
\ No newline at end of file
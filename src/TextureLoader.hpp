@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Effect.hpp"
+#include "TextureCache.hpp"
+
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <boost\filesystem\path.hpp>
+
+namespace ReShade
+{
+	/*
+	 * Decodes, resizes, mipmaps and compresses texture source images on worker threads, so large images do not stall the present thread.
+	 * Textures sourcing the same image are grouped into one job, which only decodes the file once.
+	 */
+	class TextureLoader
+	{
+	public:
+		TextureLoader();
+		~TextureLoader();
+
+		void SetCacheDirectory(const boost::filesystem::path &directory);
+		void Enqueue(Effect::Texture *texture, const std::string &name, const boost::filesystem::path &path, int channels);
+		void Submit();
+		void Cancel();
+		unsigned int Update();
+
+		inline bool IsBusy() const
+		{
+			return !this->mPending.empty();
+		}
+
+	private:
+		struct Target
+		{
+			Effect::Texture *Texture;
+			std::string Name;
+			Effect::Texture::Description Desc;
+			std::vector<std::vector<unsigned char>> Levels;
+			TextureCache::Key Key;
+			std::unique_ptr<TextureCache::Entry> Cached;
+		};
+		struct Job
+		{
+			boost::filesystem::path Path;
+			int Channels, Width, Height;
+			bool Float, Loaded;
+			std::vector<Target> Targets;
+			std::shared_ptr<const TextureCache> Cache;
+			std::atomic<bool> Done;
+		};
+
+		void WorkerMain();
+		static void Process(Job &job);
+		static void ProcessImage(Job &job);
+		static void ProcessFloat(Job &job);
+
+		std::vector<std::thread> mThreads;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::deque<std::shared_ptr<Job>> mQueue;
+		std::vector<std::shared_ptr<Job>> mPending;
+		std::map<std::tuple<std::string, int, bool>, std::shared_ptr<Job>> mBatch;
+		std::shared_ptr<const TextureCache> mCache;
+		bool mExit;
+	};
+}
\ No newline at end of file
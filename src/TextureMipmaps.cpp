@@ -0,0 +1,195 @@
+#include "TextureMipmaps.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <xmmintrin.h>
+
+namespace ReShade
+{
+	namespace
+	{
+		struct Tap
+		{
+			unsigned int First, Count;
+			float Weights[4];
+		};
+
+		struct GammaTables
+		{
+			GammaTables()
+			{
+				for (unsigned int i = 0; i < 256; ++i)
+				{
+					const float value = i / 255.0f;
+
+					ToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+				}
+				for (unsigned int i = 0; i < 4096; ++i)
+				{
+					const float value = i / 4095.0f;
+
+					ToGamma[i] = static_cast<unsigned char>(std::min((value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f) * 255.0f + 0.5f, 255.0f));
+				}
+			}
+
+			float ToLinear[256];
+			unsigned char ToGamma[4096];
+		};
+
+		const GammaTables &GetGammaTables()
+		{
+			static const GammaTables tables;
+
+			return tables;
+		}
+
+		// A destination texel covers 'source / destination' source texels, which is at most 3 when halving, so no more than 4 of them overlap it
+		std::vector<Tap> ComputeTaps(unsigned int source, unsigned int destination)
+		{
+			std::vector<Tap> taps(destination);
+			const float scale = static_cast<float>(source) / destination;
+
+			for (unsigned int i = 0; i < destination; ++i)
+			{
+				const float begin = i * scale, end = (i + 1) * scale;
+				Tap &tap = taps[i];
+				tap.First = static_cast<unsigned int>(begin);
+				tap.Count = 0;
+
+				for (unsigned int x = tap.First; x < source && x < end && tap.Count < 4; ++x)
+				{
+					tap.Weights[tap.Count++] = (std::min(end, x + 1.0f) - std::max(begin, static_cast<float>(x))) / scale;
+				}
+			}
+
+			return taps;
+		}
+
+		void Downsample(const float *source, unsigned int width, unsigned int height, unsigned int channels, float *destination, unsigned int targetWidth, unsigned int targetHeight)
+		{
+			const std::vector<Tap> tapsX = ComputeTaps(width, targetWidth), tapsY = ComputeTaps(height, targetHeight);
+			std::vector<float> row(targetWidth * channels);
+
+			for (unsigned int y = 0; y < targetHeight; ++y)
+			{
+				const Tap &tapY = tapsY[y];
+				float *const output = destination + y * targetWidth * channels;
+
+				std::fill(output, output + targetWidth * channels, 0.0f);
+
+				for (unsigned int i = 0; i < tapY.Count; ++i)
+				{
+					const float *const input = source + (tapY.First + i) * width * channels;
+
+					// Horizontal pass into a temporary row, four channel images filter a whole texel per SSE register
+					if (channels == 4)
+					{
+						for (unsigned int x = 0; x < targetWidth; ++x)
+						{
+							const Tap &tapX = tapsX[x];
+							__m128 sum = _mm_setzero_ps();
+
+							for (unsigned int k = 0; k < tapX.Count; ++k)
+							{
+								sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(input + (tapX.First + k) * 4), _mm_set1_ps(tapX.Weights[k])));
+							}
+
+							_mm_storeu_ps(row.data() + x * 4, sum);
+						}
+					}
+					else
+					{
+						for (unsigned int x = 0; x < targetWidth; ++x)
+						{
+							const Tap &tapX = tapsX[x];
+
+							for (unsigned int c = 0; c < channels; ++c)
+							{
+								float sum = 0.0f;
+
+								for (unsigned int k = 0; k < tapX.Count; ++k)
+								{
+									sum += input[(tapX.First + k) * channels + c] * tapX.Weights[k];
+								}
+
+								row[x * channels + c] = sum;
+							}
+						}
+					}
+
+					// Vertical accumulation works on the flat row, so it is vectorized independent of the channel count
+					const __m128 weight = _mm_set1_ps(tapY.Weights[i]);
+					const unsigned int count = targetWidth * channels;
+					unsigned int j = 0;
+
+					for (; j + 4 <= count; j += 4)
+					{
+						_mm_storeu_ps(output + j, _mm_add_ps(_mm_loadu_ps(output + j), _mm_mul_ps(_mm_loadu_ps(row.data() + j), weight)));
+					}
+					for (; j < count; ++j)
+					{
+						output[j] += row[j] * tapY.Weights[i];
+					}
+				}
+			}
+		}
+	}
+
+	unsigned int GetMipmapCount(unsigned int width, unsigned int height)
+	{
+		unsigned int count = 1;
+
+		for (unsigned int size = std::max(width, height); size > 1; size >>= 1)
+		{
+			count++;
+		}
+
+		return count;
+	}
+	std::vector<std::vector<unsigned char>> GenerateMipmaps(const unsigned char *data, unsigned int width, unsigned int height, unsigned int channels, unsigned int levels)
+	{
+		std::vector<std::vector<unsigned char>> result;
+
+		if (data == nullptr || width == 0 || height == 0 || channels == 0 || channels > 4)
+		{
+			return result;
+		}
+
+		const GammaTables &tables = GetGammaTables();
+		const bool gamma = channels == 4;
+		levels = std::min(levels, GetMipmapCount(width, height));
+
+		std::vector<float> current(width * height * channels), next;
+
+		for (std::size_t i = 0; i < current.size(); ++i)
+		{
+			current[i] = gamma && (i % 4) != 3 ? tables.ToLinear[data[i]] : data[i] / 255.0f;
+		}
+
+		// Every level is filtered from the previous one, which matches a box filter over the whole footprint for power-of-two sizes
+		for (unsigned int level = 1; level < levels; ++level)
+		{
+			const unsigned int targetWidth = std::max(width >> 1, 1u), targetHeight = std::max(height >> 1, 1u);
+
+			next.resize(targetWidth * targetHeight * channels);
+			Downsample(current.data(), width, height, channels, next.data(), targetWidth, targetHeight);
+
+			std::vector<unsigned char> output(next.size());
+
+			for (std::size_t i = 0; i < next.size(); ++i)
+			{
+				const float value = std::min(std::max(next[i], 0.0f), 1.0f);
+
+				output[i] = gamma && (i % 4) != 3 ? tables.ToGamma[static_cast<unsigned int>(value * 4095.0f + 0.5f)] : static_cast<unsigned char>(value * 255.0f + 0.5f);
+			}
+
+			result.push_back(std::move(output));
+
+			current.swap(next);
+			width = targetWidth;
+			height = targetHeight;
+		}
+
+		return result;
+	}
+}
\ No newline at end of file
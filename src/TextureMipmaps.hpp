@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+namespace ReShade
+{
+	/*
+	 * Builds the mipmap chain of an 8-bit image with an exact box filter, so non-power-of-two sizes are weighted by how much of each source texel a destination texel covers.
+	 * Four channel images are filtered in linear space (with alpha kept linear), one and two channel images are assumed to hold data and are filtered as is.
+	 * The returned list starts with level 1, level 0 is the input image itself.
+	 */
+	std::vector<std::vector<unsigned char>> GenerateMipmaps(const unsigned char *data, unsigned int width, unsigned int height, unsigned int channels, unsigned int levels);
+	unsigned int GetMipmapCount(unsigned int width, unsigned int height);
+}
\ No newline at end of file
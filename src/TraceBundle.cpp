@@ -0,0 +1,435 @@
+#include "TraceBundle.hpp"
+#include "ImageEncoder.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace ReShade
+{
+	namespace
+	{
+		inline std::uint64_t GetPadding(std::uint64_t size)
+		{
+			return (8 - (size & 7)) & 7;
+		}
+		inline std::uint64_t Mix(std::uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xFF51AFD7ED558CCDull;
+			value ^= value >> 33;
+			value *= 0xC4CEB9FE1A85EC53ull;
+			value ^= value >> 33;
+
+			return value;
+		}
+	}
+
+	namespace TraceBundle
+	{
+		TileHash HashTile(const unsigned char *data, std::size_t pitch, unsigned int width, unsigned int height)
+		{
+			// Two independent accumulators of 32x32 bit products, with keys that change every 16 bytes so moving content around changes the hash
+			const __m128i key0 = _mm_set_epi32(0x7C01812C, 0xF721AD1C, 0xDED46DE9, 0x839097D7), key1 = _mm_set_epi32(0x1F67B3B7, 0xA4DE07A7, 0x6CB5ED29, 0x5851F42D);
+			const __m128i step = _mm_set1_epi32(0x9E3779B9);
+			__m128i acc0 = _mm_set_epi32(0, height, 0, width), acc1 = _mm_set_epi32(0, width, 0, height), position = _mm_setzero_si128();
+
+			const std::size_t rowSize = width * 4;
+
+			for (unsigned int y = 0; y < height; ++y)
+			{
+				const unsigned char *const row = data + y * pitch;
+
+				for (std::size_t x = 0; x < rowSize; x += 16)
+				{
+					__m128i value;
+
+					if (x + 16 <= rowSize)
+					{
+						value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+					}
+					else
+					{
+						unsigned char tail[16] = { };
+						std::memcpy(tail, row + x, rowSize - x);
+						value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail));
+					}
+
+					position = _mm_add_epi32(position, step);
+
+					const __m128i keyed0 = _mm_xor_si128(value, _mm_add_epi32(key0, position)), keyed1 = _mm_xor_si128(value, _mm_sub_epi32(key1, position));
+
+					acc0 = _mm_add_epi64(acc0, _mm_mul_epu32(keyed0, _mm_shuffle_epi32(keyed0, _MM_SHUFFLE(3, 3, 1, 1))));
+					acc0 = _mm_add_epi64(acc0, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+					acc1 = _mm_add_epi64(acc1, _mm_mul_epu32(keyed1, _mm_shuffle_epi32(keyed1, _MM_SHUFFLE(2, 3, 0, 1))));
+					acc1 = _mm_xor_si128(acc1, value);
+				}
+			}
+
+			std::uint64_t lanes[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc0);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes + 2), acc1);
+
+			TileHash hash;
+			hash.Low = Mix(lanes[0] ^ Mix(lanes[1] + 0x9E3779B97F4A7C15ull) ^ Mix(lanes[2]));
+			hash.High = Mix(lanes[3] ^ Mix(lanes[1] ^ lanes[2]) ^ Mix(lanes[0] + 0xC2B2AE3D27D4EB4Full));
+
+			return hash;
+		}
+	}
+
+	TraceBundleWriter::TraceBundleWriter(const std::string &path, bool tiled) : mFile(path, std::ios::binary | std::ios::trunc), mOffset(0), mTiled(tiled)
+	{
+		TraceBundle::Header header = { };
+		header.Signature = TraceBundle::Signature;
+		header.Version = TraceBundle::Version;
+
+		this->mFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		this->mOffset = sizeof(header);
+	}
+	TraceBundleWriter::~TraceBundleWriter()
+	{
+		if (!this->mFile.is_open())
+		{
+			return;
+		}
+
+		TraceBundle::Record record = { };
+		record.Type = TraceBundle::RecordType::Index;
+
+		TraceBundle::Footer footer;
+		footer.IndexOffset = this->mOffset;
+		footer.Count = static_cast<std::uint32_t>(this->mIndex.size());
+		footer.Signature = TraceBundle::FooterSignature;
+
+		const std::vector<TraceBundle::IndexEntry> index = std::move(this->mIndex);
+
+		if (Add(record, std::string(), index.data(), index.size() * sizeof(TraceBundle::IndexEntry)))
+		{
+			this->mFile.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+		}
+	}
+
+	bool TraceBundleWriter::Add(TraceBundle::Record record, const std::string &name, const void *data, std::size_t size)
+	{
+		static const char zeros[8] = { };
+
+		record.NameLength = static_cast<std::uint32_t>(name.size());
+		record.DataSize = size;
+
+		const std::uint64_t padding = GetPadding(record.NameLength + record.DataSize);
+
+		const std::lock_guard<std::mutex> lock(this->mMutex);
+
+		if (!this->mFile.good())
+		{
+			return false;
+		}
+
+		if (record.Type != TraceBundle::RecordType::Index)
+		{
+			TraceBundle::IndexEntry entry = { };
+			entry.Type = record.Type;
+			entry.Bucket = record.Bucket;
+			entry.Draw = record.Draw;
+			entry.Target = record.Target;
+			entry.Offset = this->mOffset;
+
+			this->mIndex.push_back(entry);
+		}
+
+		this->mFile.write(reinterpret_cast<const char *>(&record), sizeof(record));
+		this->mFile.write(name.data(), name.size());
+		this->mFile.write(static_cast<const char *>(data), size);
+		this->mFile.write(zeros, padding);
+
+		this->mOffset += sizeof(record) + record.NameLength + record.DataSize + padding;
+
+		// Flush every record, so whatever was captured before a crash is on disk
+		this->mFile.flush();
+
+		return this->mFile.good();
+	}
+	bool TraceBundleWriter::AddTiled(TraceBundle::Record record, const std::string &name, const unsigned char *data, unsigned int width, unsigned int height)
+	{
+		using namespace TraceBundle;
+
+		const unsigned int columns = (width + TileSize - 1) / TileSize, rows = (height + TileSize - 1) / TileSize;
+		const std::size_t pitch = width * 4;
+
+		std::vector<TileHash> map(columns * rows);
+		std::vector<bool> added(map.size());
+
+		for (unsigned int row = 0; row < rows; ++row)
+		{
+			for (unsigned int column = 0; column < columns; ++column)
+			{
+				map[row * columns + column] = HashTile(data + row * TileSize * pitch + column * TileSize * 4, pitch, std::min(TileSize, width - column * TileSize), std::min(TileSize, height - row * TileSize));
+			}
+		}
+
+		// Claim the new tiles in one go, so tiles shared by images encoded at the same time are still only stored once
+		{
+			const std::lock_guard<std::mutex> lock(this->mMutex);
+
+			for (std::size_t i = 0; i < map.size(); ++i)
+			{
+				added[i] = this->mTiles.insert(map[i]).second;
+			}
+		}
+
+		std::vector<unsigned char> encoded;
+
+		for (std::size_t i = 0; i < map.size(); ++i)
+		{
+			if (!added[i])
+			{
+				continue;
+			}
+
+			const unsigned int column = static_cast<unsigned int>(i % columns), row = static_cast<unsigned int>(i / columns);
+
+			Record tile = { };
+			tile.Type = RecordType::Tile;
+			tile.Format = static_cast<std::uint32_t>(ImageFormat::QOI);
+			tile.Width = std::min(TileSize, width - column * TileSize);
+			tile.Height = std::min(TileSize, height - row * TileSize);
+
+			EncodeQOI(data + row * TileSize * pitch + column * TileSize * 4, tile.Width, tile.Height, encoded, pitch);
+			encoded.insert(encoded.begin(), reinterpret_cast<const unsigned char *>(&map[i]), reinterpret_cast<const unsigned char *>(&map[i] + 1));
+
+			if (!Add(tile, std::string(), encoded.data(), encoded.size()))
+			{
+				return false;
+			}
+		}
+
+		record.Type = RecordType::TiledImage;
+		record.Format = static_cast<std::uint32_t>(ImageFormat::QOI);
+		record.Width = width;
+		record.Height = height;
+
+		return Add(record, name, map.data(), map.size() * sizeof(TileHash));
+	}
+
+	TraceBundleReader::TraceBundleReader(const unsigned char *data, std::size_t size) : mData(data), mSize(size), mValid(false), mComplete(false)
+	{
+		TraceBundle::Header header;
+
+		if (size < sizeof(header))
+		{
+			return;
+		}
+
+		std::memcpy(&header, data, sizeof(header));
+
+		if (header.Signature != TraceBundle::Signature || header.Version != TraceBundle::Version)
+		{
+			return;
+		}
+
+		this->mValid = true;
+
+		TraceBundle::Footer footer;
+
+		if (size >= sizeof(header) + sizeof(footer))
+		{
+			std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+
+			Entry index;
+			std::uint64_t next;
+
+			if (footer.Signature == TraceBundle::FooterSignature && ReadEntry(footer.IndexOffset, index, next) && index.Record->Type == TraceBundle::RecordType::Index && index.Record->DataSize == footer.Count * sizeof(TraceBundle::IndexEntry))
+			{
+				this->mEntries.reserve(footer.Count);
+
+				for (std::uint32_t i = 0; i < footer.Count; ++i)
+				{
+					TraceBundle::IndexEntry indexEntry;
+					std::memcpy(&indexEntry, index.Data + i * sizeof(indexEntry), sizeof(indexEntry));
+
+					Entry entry;
+
+					if (!ReadEntry(indexEntry.Offset, entry, next))
+					{
+						this->mEntries.clear();
+						break;
+					}
+
+					this->mEntries.push_back(entry);
+				}
+
+				this->mComplete = this->mEntries.size() == footer.Count;
+			}
+		}
+
+		if (!this->mComplete)
+		{
+			// No usable index, recover all records that were written completely
+			Entry entry;
+
+			for (std::uint64_t offset = sizeof(header), next; ReadEntry(offset, entry, next); offset = next)
+			{
+				if (entry.Record->Type != TraceBundle::RecordType::Index)
+				{
+					this->mEntries.push_back(entry);
+				}
+			}
+		}
+
+		for (const Entry &entry : this->mEntries)
+		{
+			if (entry.Record->Type == TraceBundle::RecordType::Tile && entry.Record->DataSize >= sizeof(TraceBundle::TileHash))
+			{
+				TraceBundle::TileHash hash;
+				std::memcpy(&hash, entry.Data, sizeof(hash));
+
+				this->mTiles.emplace(hash, &entry);
+			}
+			else if (entry.Record->Type == TraceBundle::RecordType::KeyFrame || entry.Record->Type == TraceBundle::RecordType::DeltaFrame)
+			{
+				this->mFrames.emplace(std::make_pair(entry.Record->Draw, entry.Record->Bucket), &entry);
+			}
+		}
+	}
+
+	const TraceBundleReader::Entry *TraceBundleReader::FindImage(std::uint32_t bucket, std::uint32_t draw, std::uint64_t target) const
+	{
+		for (const Entry &entry : this->mEntries)
+		{
+			if ((entry.Record->Type == TraceBundle::RecordType::Image || entry.Record->Type == TraceBundle::RecordType::TiledImage) && entry.Record->Bucket == bucket && entry.Record->Draw == draw && entry.Record->Target == target)
+			{
+				return &entry;
+			}
+		}
+
+		return nullptr;
+	}
+	bool TraceBundleReader::DecodeTiledImage(const Entry &entry, std::vector<unsigned char> &data) const
+	{
+		using namespace TraceBundle;
+
+		const unsigned int width = entry.Record->Width, height = entry.Record->Height;
+		const unsigned int columns = (width + TileSize - 1) / TileSize, rows = (height + TileSize - 1) / TileSize;
+		const std::size_t pitch = width * 4;
+
+		if (entry.Record->Type != RecordType::TiledImage || entry.Record->DataSize != static_cast<std::uint64_t>(columns) * rows * sizeof(TileHash))
+		{
+			return false;
+		}
+
+		data.resize(pitch * height);
+
+		for (unsigned int i = 0; i < columns * rows; ++i)
+		{
+			TileHash hash;
+			std::memcpy(&hash, entry.Data + i * sizeof(hash), sizeof(hash));
+
+			const auto it = this->mTiles.find(hash);
+
+			if (it == this->mTiles.end())
+			{
+				return false;
+			}
+
+			const Entry &tile = *it->second;
+			const unsigned int column = i % columns, row = i / columns;
+
+			if (tile.Record->Width != std::min(TileSize, width - column * TileSize) || tile.Record->Height != std::min(TileSize, height - row * TileSize) || !DecodeQOI(tile.Data + sizeof(hash), tile.Record->DataSize - sizeof(hash), tile.Record->Width, tile.Record->Height, data.data() + row * TileSize * pitch + column * TileSize * 4, pitch))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool TraceBundleReader::DecodeFrame(const Entry &entry, std::vector<unsigned char> &data) const
+	{
+		const auto it = this->mFrames.find(std::make_pair(entry.Record->Draw, entry.Record->Bucket));
+
+		if (it == this->mFrames.end())
+		{
+			return false;
+		}
+
+		// Walk back to the key frame the delta chain starts at
+		auto key = it;
+
+		while (key->second->Record->Type == TraceBundle::RecordType::DeltaFrame)
+		{
+			if (key == this->mFrames.begin() || std::prev(key)->first.first != entry.Record->Draw)
+			{
+				return false;
+			}
+
+			--key;
+		}
+
+		for (auto frame = key; frame != std::next(it); ++frame)
+		{
+			if (!ApplyFrame(*frame->second, data))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+	bool TraceBundleReader::ApplyFrame(const Entry &entry, std::vector<unsigned char> &data) const
+	{
+		const unsigned int width = entry.Record->Width, height = entry.Record->Height;
+		const std::size_t size = static_cast<std::size_t>(width) * height * 4;
+
+		if (entry.Record->Type == TraceBundle::RecordType::KeyFrame)
+		{
+			data.resize(size);
+
+			return DecodeQOI(entry.Data, static_cast<std::size_t>(entry.Record->DataSize), width, height, data.data());
+		}
+		if (entry.Record->Type != TraceBundle::RecordType::DeltaFrame || data.size() != size)
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> delta(size);
+
+		if (!DecodeQOI(entry.Data, static_cast<std::size_t>(entry.Record->DataSize), width, height, delta.data()))
+		{
+			return false;
+		}
+
+		ApplyDelta(data.data(), delta.data(), size);
+
+		return true;
+	}
+
+	bool TraceBundleReader::ReadEntry(std::uint64_t offset, Entry &entry, std::uint64_t &next) const
+	{
+		// Records are 8 byte aligned when the mapping is, so they can be accessed in place
+		if (offset % 8 != 0 || offset > this->mSize || this->mSize - offset < sizeof(TraceBundle::Record))
+		{
+			return false;
+		}
+
+		const TraceBundle::Record *const record = reinterpret_cast<const TraceBundle::Record *>(this->mData + offset);
+		const std::uint64_t available = this->mSize - offset - sizeof(TraceBundle::Record);
+
+		if (record->NameLength > available || record->DataSize > available - record->NameLength)
+		{
+			return false;
+		}
+
+		const char *const name = reinterpret_cast<const char *>(record + 1);
+
+		entry.Record = record;
+		entry.Name.assign(name, record->NameLength);
+		entry.Data = reinterpret_cast<const unsigned char *>(name + record->NameLength);
+
+		next = offset + sizeof(TraceBundle::Record) + record->NameLength + record->DataSize;
+		next += GetPadding(next);
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <unordered_set>
+#include <unordered_map>
+
+namespace ReShade
+{
+	/*
+	 * Single file container for frame trace dumps, replacing the folder tree of bucket logs and images.
+	 *
+	 * Files are little-endian, start with a 'Header' and are followed by records appended in the order they were produced.
+	 * Every record is a 'Record' structure, then 'NameLength' bytes of name (the path the content had in the folder layout, relative to the dump root) and 'DataSize' bytes of data, padded to a multiple of 8 bytes.
+	 * Image data is the complete encoded file in the format given by 'Record::Format' (see 'ImageFormat').
+	 * Once the capture finished, an index record lists the file offset of all other records, followed by a 'Footer' to locate it from the end of the file.
+	 * A file without footer (the game crashed mid capture) is still readable by walking the records from the start.
+	 *
+	 * Tiled bundles store images as a map of 'TileSize' square tiles instead: The data of a tiled image record is an array of 'TileHash', row by row.
+	 * Every distinct tile is stored only once in the bundle, as a tile record whose data is its 'TileHash' followed by the tile encoded as QOI.
+	 * Tiles on the right and bottom edges are smaller when the image size is not a multiple of the tile size.
+	 *
+	 * Frame streams store one key or delta frame record per render target and captured frame, 'Record::Bucket' is the frame number and 'Record::Draw' the render target slot.
+	 * Key frames are the image encoded as QOI, delta frames the QOI encoded byte-wise difference to the previous captured frame of the same slot (see 'ComputeDelta').
+	 * Seeking to a frame means decoding the last key frame of its slot before it and applying the deltas up to it.
+	 */
+	namespace TraceBundle
+	{
+		const std::uint32_t Signature = 0x42545352; // "RSTB"
+		const std::uint32_t FooterSignature = 0x49545352; // "RSTI"
+		const std::uint32_t Version = 1;
+
+		enum class RecordType : std::uint32_t
+		{
+			Events = 1, // Bucket log text
+			Image = 2,
+			Index = 3, // Data is an array of 'IndexEntry'
+			Tile = 4,
+			TiledImage = 5,
+			KeyFrame = 6,
+			DeltaFrame = 7
+		};
+
+		const unsigned int TileSize = 64;
+
+		struct Header
+		{
+			std::uint32_t Signature, Version;
+			std::uint64_t Reserved;
+		};
+		struct Record
+		{
+			RecordType Type;
+			std::uint32_t Bucket, Draw; // Command list replay and snapshot index within it
+			std::uint32_t Format;
+			std::uint64_t Target; // Render target view the image was captured from
+			std::uint32_t Width, Height;
+			std::uint32_t NameLength, Reserved;
+			std::uint64_t DataSize;
+		};
+		struct IndexEntry
+		{
+			RecordType Type;
+			std::uint32_t Bucket, Draw, Reserved;
+			std::uint64_t Target;
+			std::uint64_t Offset; // Of the 'Record' structure
+		};
+		struct Footer
+		{
+			std::uint64_t IndexOffset;
+			std::uint32_t Count, Signature;
+		};
+		struct TileHash
+		{
+			std::uint64_t Low, High;
+
+			inline bool operator==(const TileHash &other) const
+			{
+				return this->Low == other.Low && this->High == other.High;
+			}
+		};
+		struct TileHasher
+		{
+			inline std::size_t operator()(const TileHash &hash) const
+			{
+				return static_cast<std::size_t>(hash.Low);
+			}
+		};
+
+		TileHash HashTile(const unsigned char *data, std::size_t pitch, unsigned int width, unsigned int height);
+	}
+
+	/*
+	 * Appends records to a bundle from any thread. The index is written on destruction, so it only happens once the last image of a capture was encoded.
+	 */
+	class TraceBundleWriter
+	{
+	public:
+		TraceBundleWriter(const std::string &path, bool tiled);
+		~TraceBundleWriter();
+
+		inline bool IsOpen() const
+		{
+			return this->mFile.is_open();
+		}
+		inline bool IsTiled() const
+		{
+			return this->mTiled;
+		}
+
+		bool Add(TraceBundle::Record record, const std::string &name, const void *data, std::size_t size);
+		bool AddTiled(TraceBundle::Record record, const std::string &name, const unsigned char *data, unsigned int width, unsigned int height);
+
+	private:
+		std::mutex mMutex;
+		std::ofstream mFile;
+		std::uint64_t mOffset;
+		std::vector<TraceBundle::IndexEntry> mIndex;
+		bool mTiled;
+		std::unordered_set<TraceBundle::TileHash, TraceBundle::TileHasher> mTiles;
+	};
+
+	/*
+	 * Reads a bundle from memory, usually a mapped view of the file. Pointers returned point into that memory.
+	 */
+	class TraceBundleReader
+	{
+	public:
+		struct Entry
+		{
+			const TraceBundle::Record *Record;
+			std::string Name;
+			const unsigned char *Data;
+		};
+
+		TraceBundleReader(const unsigned char *data, std::size_t size);
+
+		inline bool IsValid() const
+		{
+			return this->mValid;
+		}
+		inline bool IsComplete() const
+		{
+			return this->mComplete;
+		}
+		inline const std::vector<Entry> &GetEntries() const
+		{
+			return this->mEntries;
+		}
+
+		const Entry *FindImage(std::uint32_t bucket, std::uint32_t draw, std::uint64_t target) const;
+		bool DecodeTiledImage(const Entry &entry, std::vector<unsigned char> &data) const;
+		bool DecodeFrame(const Entry &entry, std::vector<unsigned char> &data) const;
+		bool ApplyFrame(const Entry &entry, std::vector<unsigned char> &data) const; // 'data' has to contain the previous frame of the slot for delta frames
+
+	private:
+		bool ReadEntry(std::uint64_t offset, Entry &entry, std::uint64_t &next) const;
+
+		const unsigned char *mData;
+		std::size_t mSize;
+		bool mValid, mComplete;
+		std::vector<Entry> mEntries;
+		std::unordered_map<TraceBundle::TileHash, const Entry *, TraceBundle::TileHasher> mTiles;
+		std::map<std::pair<std::uint32_t, std::uint32_t>, const Entry *> mFrames; // Sorted by slot, then frame number
+	};
+}
\ No newline at end of file
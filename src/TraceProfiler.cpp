@@ -0,0 +1,209 @@
+#include "TraceProfiler.hpp"
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+	struct Event
+	{
+		const char *Name;
+		char Detail[64];
+		unsigned int Index; // Optional number attached to the event (e.g. the pass), 'UINT_MAX' if there is none
+		unsigned int Generation;
+		LONGLONG Start, End;
+	};
+	struct ThreadBuffer
+	{
+		// With 96 byte events this is 1.5 MB per thread, see 'GetThreadBuffer' for why they are never freed
+		static const unsigned int Capacity = 16384;
+
+		DWORD ThreadId;
+		std::atomic<unsigned int> Generation, Count; // Only ever written by the owning thread, so appending does not need any locks
+		Event Events[Capacity];
+	};
+
+	std::mutex sBuffersMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> sBuffers;
+	std::atomic<unsigned int> sGeneration(0), sFramesLeft(0);
+	LARGE_INTEGER sCaptureStart;
+
+	ThreadBuffer *GetThreadBuffer()
+	{
+		static thread_local ThreadBuffer *buffer = nullptr;
+
+		// Buffers stay until the process exits, since a scope opened during a capture may still record after it ended. Only the threads presenting and
+		// drawing open scopes (the dump and loader workers do not), so that is one or two buffers in practice, allocated on the first capture.
+		if (buffer == nullptr)
+		{
+			std::unique_ptr<ThreadBuffer> newbuffer(new ThreadBuffer());
+			newbuffer->ThreadId = GetCurrentThreadId();
+			newbuffer->Generation.store(sGeneration.load());
+			newbuffer->Count.store(0);
+
+			buffer = newbuffer.get();
+
+			const std::lock_guard<std::mutex> lock(sBuffersMutex);
+
+			sBuffers.push_back(std::move(newbuffer));
+		}
+
+		return buffer;
+	}
+	void WriteEscaped(std::ofstream &file, const char *string)
+	{
+		for (; *string != '\0'; ++string)
+		{
+			if (*string == '"' || *string == '\\')
+			{
+				file << '\\';
+			}
+
+			file << *string;
+		}
+	}
+}
+
+std::atomic<bool> TraceProfiler::sCapturing(false);
+
+void TraceProfiler::Begin(unsigned int frames)
+{
+	// Only the owning thread touches a buffer, so instead of clearing them here each thread starts over once it notices the new generation
+	QueryPerformanceCounter(&sCaptureStart);
+
+	sGeneration++;
+	sFramesLeft = frames;
+	sCapturing = frames != 0;
+}
+bool TraceProfiler::EndFrame()
+{
+	if (!sCapturing.load(std::memory_order_relaxed) || --sFramesLeft != 0)
+	{
+		return false;
+	}
+
+	sCapturing = false;
+
+	return true;
+}
+
+bool TraceProfiler::Save(const boost::filesystem::path &path)
+{
+	std::ofstream file(path.string());
+
+	if (!file)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	const unsigned int generation = sGeneration;
+	const DWORD process = GetCurrentProcessId();
+	bool first = true;
+
+	file << "{\"traceEvents\":[\n";
+
+	const std::lock_guard<std::mutex> lock(sBuffersMutex);
+
+	for (const auto &buffer : sBuffers)
+	{
+		// Threads that did not record anything during this capture still hold events of an earlier one
+		if (buffer->Generation.load(std::memory_order_acquire) != generation)
+		{
+			continue;
+		}
+
+		for (unsigned int i = 0, count = std::min(buffer->Count.load(std::memory_order_acquire), ThreadBuffer::Capacity); i < count; ++i)
+		{
+			const Event &event = buffer->Events[i];
+
+			if (event.Generation != generation)
+			{
+				continue;
+			}
+
+			if (!first)
+			{
+				file << ",\n";
+			}
+
+			first = false;
+
+			file << "{\"name\":\"";
+			WriteEscaped(file, event.Name);
+			file << "\",\"cat\":\"ReShade\",\"ph\":\"X\",\"pid\":" << process << ",\"tid\":" << buffer->ThreadId;
+			file << ",\"ts\":" << (event.Start - sCaptureStart.QuadPart) * 1000000.0 / frequency.QuadPart << ",\"dur\":" << (event.End - event.Start) * 1000000.0 / frequency.QuadPart;
+
+			if (event.Detail[0] != '\0' || event.Index != UINT_MAX)
+			{
+				file << ",\"args\":{";
+
+				if (event.Detail[0] != '\0')
+				{
+					file << "\"detail\":\"";
+					WriteEscaped(file, event.Detail);
+					file << '"';
+				}
+				if (event.Index != UINT_MAX)
+				{
+					file << (event.Detail[0] != '\0' ? "," : "") << "\"index\":" << event.Index;
+				}
+
+				file << '}';
+			}
+
+			file << '}';
+		}
+	}
+
+	file << "\n]}\n";
+
+	return file.good();
+}
+
+void TraceProfiler::Record(const char *name, const char *detail, unsigned int index, const LARGE_INTEGER &start)
+{
+	LARGE_INTEGER end;
+	QueryPerformanceCounter(&end);
+
+	ThreadBuffer *const buffer = GetThreadBuffer();
+	const unsigned int generation = sGeneration.load(std::memory_order_relaxed);
+
+	// First event of this thread in a new capture, so the events of the previous one can be dropped
+	if (buffer->Generation.load(std::memory_order_relaxed) != generation)
+	{
+		buffer->Count.store(0, std::memory_order_relaxed);
+		buffer->Generation.store(generation, std::memory_order_release);
+	}
+
+	const unsigned int count = buffer->Count.load(std::memory_order_relaxed);
+
+	if (count >= ThreadBuffer::Capacity)
+	{
+		return;
+	}
+
+	Event &event = buffer->Events[count];
+	event.Name = name;
+	event.Index = index;
+	event.Generation = generation;
+	event.Start = start.QuadPart;
+	event.End = end.QuadPart;
+
+	if (detail != nullptr)
+	{
+		strncpy_s(event.Detail, detail, _TRUNCATE);
+	}
+	else
+	{
+		event.Detail[0] = '\0';
+	}
+
+	// Publish the event only after it was written completely
+	buffer->Count.store(count + 1, std::memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <boost\filesystem\path.hpp>
+#include <windows.h>
+
+/*
+ * Scoped timers recording into per-thread buffers, which can be saved in the Chrome trace event format (load the file in chrome://tracing).
+ * While no capture is running a timer costs a single relaxed atomic load, so they can stay in release builds.
+ */
+class TraceProfiler
+{
+public:
+	class Scope
+	{
+	public:
+		explicit Scope(const char *name, const char *detail = nullptr, unsigned int index = UINT_MAX) : mName(nullptr), mDetail(detail), mIndex(index)
+		{
+			if (sCapturing.load(std::memory_order_relaxed))
+			{
+				this->mName = name;
+				QueryPerformanceCounter(&this->mStart);
+			}
+		}
+		~Scope()
+		{
+			if (this->mName != nullptr)
+			{
+				Record(this->mName, this->mDetail, this->mIndex, this->mStart);
+			}
+		}
+
+	private:
+		Scope(const Scope &);
+		Scope &operator=(const Scope &);
+
+		const char *mName, *mDetail;
+		unsigned int mIndex;
+		LARGE_INTEGER mStart;
+	};
+
+	static void Begin(unsigned int frames);
+	static bool EndFrame();
+	static inline bool IsCapturing()
+	{
+		return sCapturing.load(std::memory_order_relaxed);
+	}
+
+	static bool Save(const boost::filesystem::path &path);
+
+private:
+	static void Record(const char *name, const char *detail, unsigned int index, const LARGE_INTEGER &start);
+
+	static std::atomic<bool> sCapturing;
+};
\ No newline at end of file
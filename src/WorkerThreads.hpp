@@ -0,0 +1,46 @@
+#pragma once
+
+#include <thread>
+#include <algorithm>
+
+namespace ReShade
+{
+	/*
+	 * Marks the calling thread as part of a worker pool (texture loader, dump writer) while it is alive.
+	 * Work that splits itself between threads stays on marked threads instead, since the pool already keeps the other cores busy.
+	 */
+	class WorkerThreadScope
+	{
+	public:
+		WorkerThreadScope()
+		{
+			GetFlag() = true;
+		}
+		~WorkerThreadScope()
+		{
+			GetFlag() = false;
+		}
+
+		static bool IsActive()
+		{
+			return GetFlag();
+		}
+
+	private:
+		WorkerThreadScope(const WorkerThreadScope &);
+		WorkerThreadScope &operator=(const WorkerThreadScope &);
+
+		static bool &GetFlag()
+		{
+			static thread_local bool flag = false;
+
+			return flag;
+		}
+	};
+
+	// Number of threads to split work between, where 'pieces' is how many parts of it would be worth a thread of their own
+	inline unsigned int GetParallelThreadCount(unsigned int pieces)
+	{
+		return WorkerThreadScope::IsActive() ? 1 : std::max(std::min(std::thread::hardware_concurrency(), pieces), 1u);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,217 @@
+/*
+ * Measures the OpenEXR and PFM encoders used for float dumps on 720p and 4K test images, for half and 32-bit float data with three and four channels.
+ * Every EXR file is decoded again with the zlib decoder of stb and compared to the source, so the run fails if the encoder is not lossless.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc -Idep/stb/include tools/ExrEncoderBenchmark.cpp src/ImageEncoder.cpp src/TextureConversion.cpp dep/stb/src/stb_image.c -o rs-exr-bench -pthread
+ */
+
+#include "ImageEncoder.hpp"
+#include "TextureConversion.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stb_image.h>
+
+using namespace ReShade;
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	// Smooth HDR gradients above 1.0 with some noise, and alpha that is mostly opaque, roughly what a lit scene target looks like
+	std::vector<float> GenerateImage(unsigned int width, unsigned int height)
+	{
+		std::vector<float> image(width * height * 4);
+		unsigned int seed = 1;
+
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				float *const pixel = image.data() + (y * width + x) * 4;
+				seed = seed * 1103515245 + 12345;
+				const float noise = ((seed >> 16) & 0xFF) / 2048.0f;
+
+				pixel[0] = 4.0f * x / width + noise;
+				pixel[1] = 2.0f * y / height + noise;
+				pixel[2] = 0.5f + 0.5f * std::sin(x * 0.01f) * std::cos(y * 0.013f);
+				pixel[3] = (x / 64 + y / 64) % 7 == 0 ? 0.5f : 1.0f;
+			}
+		}
+
+		return image;
+	}
+
+	std::uint64_t ReadLittleEndian(const unsigned char *data, std::size_t size)
+	{
+		std::uint64_t value = 0;
+
+		for (std::size_t i = size; i-- > 0; )
+		{
+			value = (value << 8) | data[i];
+		}
+
+		return value;
+	}
+
+	// Only understands what 'EncodeEXR' writes: Single part scanline files with ZIP compression and all channels of the same type
+	bool CheckEXR(const std::vector<unsigned char> &file, const unsigned char *source, unsigned int width, unsigned int height, unsigned int channels, std::size_t componentSize)
+	{
+		std::size_t position = 8;
+
+		while (position < file.size() && file[position] != 0)
+		{
+			position += std::strlen(reinterpret_cast<const char *>(file.data() + position)) + 1;
+			position += std::strlen(reinterpret_cast<const char *>(file.data() + position)) + 1;
+			position += 4 + ReadLittleEndian(file.data() + position, 4);
+		}
+
+		const unsigned int blockCount = (height + 15) / 16;
+		const std::size_t table = position + 1;
+		std::vector<unsigned char> split, raw;
+
+		if (table + blockCount * 8 > file.size())
+		{
+			return false;
+		}
+
+		for (unsigned int block = 0; block < blockCount; ++block)
+		{
+			const std::size_t offset = static_cast<std::size_t>(ReadLittleEndian(file.data() + table + block * 8, 8));
+
+			if (offset + 8 > file.size())
+			{
+				return false;
+			}
+
+			const unsigned int top = static_cast<unsigned int>(ReadLittleEndian(file.data() + offset, 4)), rows = std::min(16u, height - top);
+			const std::size_t size = static_cast<std::size_t>(ReadLittleEndian(file.data() + offset + 4, 4)), rawSize = rows * width * channels * componentSize;
+			const unsigned char *const data = file.data() + offset + 8;
+
+			if (top != block * 16 || offset + 8 + size > file.size())
+			{
+				return false;
+			}
+
+			raw.resize(rawSize);
+
+			if (size == rawSize)
+			{
+				std::memcpy(raw.data(), data, size);
+			}
+			else
+			{
+				// Undo the difference to the previous byte, then interleave the low and high halves again
+				split.resize(rawSize);
+
+				if (stbi_zlib_decode_buffer(reinterpret_cast<char *>(split.data()), static_cast<int>(rawSize), reinterpret_cast<const char *>(data), static_cast<int>(size)) != static_cast<int>(rawSize))
+				{
+					return false;
+				}
+
+				for (std::size_t i = 1; i < rawSize; ++i)
+				{
+					split[i] = static_cast<unsigned char>(split[i] + split[i - 1] - 128);
+				}
+				for (std::size_t i = 0; i < rawSize; ++i)
+				{
+					raw[i] = split[(i & 1) ? (rawSize + 1) / 2 + i / 2 : i / 2];
+				}
+			}
+
+			// Each row holds all values of one channel after the other, in reverse order of RGBA
+			const unsigned char *in = raw.data();
+
+			for (unsigned int y = top; y < top + rows; ++y)
+			{
+				for (unsigned int channel = channels; channel-- > 0; )
+				{
+					for (unsigned int x = 0; x < width; ++x, in += componentSize)
+					{
+						if (std::memcmp(in, source + ((y * width + x) * 4 + channel) * componentSize, componentSize) != 0)
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <typename F>
+	double Measure(F function, unsigned int runs)
+	{
+		double best = 1e30;
+
+		for (unsigned int run = 0; run < runs; ++run)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		return best;
+	}
+
+	void Run(unsigned int width, unsigned int height, unsigned int runs)
+	{
+		const std::vector<float> image = GenerateImage(width, height);
+		std::vector<std::uint16_t> halfs(image.size());
+		ConvertFloatToHalf(image.data(), halfs.data(), image.size());
+
+		const double megapixels = width * height / 1e6;
+		std::vector<unsigned char> output;
+
+		std::printf("%ux%u (%u runs, best of each, %u hardware threads):\n", width, height, runs, std::thread::hardware_concurrency());
+
+		for (unsigned int channels : { 3u, 4u })
+		{
+			for (bool half : { true, false })
+			{
+				const void *const data = half ? static_cast<const void *>(halfs.data()) : static_cast<const void *>(image.data());
+				const std::size_t componentSize = half ? 2 : 4;
+				const double time = Measure([&]() { output.clear(); EncodeEXR(data, width, height, channels, half, output); }, runs);
+				const std::string name = std::string("EXR ") + (half ? "half " : "float ") + (channels == 3 ? "RGB" : "RGBA");
+
+				std::printf("  %-16s %9.2f ms %8.1f MP/s %11zu bytes (%.0f%% of raw)\n", name.c_str(), time, megapixels * 1000 / time, output.size(), 100.0 * output.size() / (width * height * channels * componentSize));
+
+				if (!CheckEXR(output, static_cast<const unsigned char *>(data), width, height, channels, componentSize))
+				{
+					std::printf("FAIL %ux%u: %s output does not decode to the source image\n", width, height, name.c_str());
+					sFailures++;
+				}
+			}
+		}
+
+		const double time = Measure([&]() { output.clear(); EncodePFM(image.data(), width, height, 3, output); }, runs);
+
+		std::printf("  %-16s %9.2f ms %8.1f MP/s %11zu bytes\n", "PFM float RGB", time, megapixels * 1000 / time, output.size());
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned int runs = argc > 1 ? std::max(static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10)), 1u) : 3;
+
+	Run(1280, 720, runs);
+	Run(3840, 2160, runs);
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all EXR files decoded to their source\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+/*
+ * Checks the rolling percentiles, maximum and stutter count of 'FrameStatistics' against values computed from the sorted frame times.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -DBOOST_SYSTEM_NO_DEPRECATED -Isrc -Idep_ext/boost tools/FrameStatisticsTest.cpp src/FrameStatistics.cpp -o rs-frame-stats-test
+ */
+
+#include "FrameStatistics.hpp"
+
+#include <cmath>
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const char *test, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::printf("FAIL %s: %s\n", test, message.c_str());
+			sFailures++;
+		}
+	}
+
+	void Record(FrameStatistics &statistics, std::deque<float> &window, float frametime)
+	{
+		FrameStatistics::Frame frame;
+		frame.FrameTime = frametime;
+		frame.PostProcessingTime = 0.0f;
+		frame.DrawCalls = 0;
+		statistics.Record(frame);
+
+		window.push_back(frametime);
+
+		if (window.size() > FrameStatistics::Capacity)
+		{
+			window.pop_front();
+		}
+	}
+
+	// Nearest rank percentile of the frames in the window
+	float GetExpectedPercentile(const std::vector<float> &sorted, unsigned int percent)
+	{
+		return sorted[std::max((sorted.size() * percent + 99) / 100, static_cast<std::size_t>(1)) - 1];
+	}
+
+	// Compares everything to the frames in the window, stutters within 'margin' of the threshold may fall either way
+	void Compare(const FrameStatistics &statistics, const std::deque<float> &window, float margin, const char *test)
+	{
+		std::vector<float> sorted(window.begin(), window.end());
+		std::sort(sorted.begin(), sorted.end());
+
+		Check(statistics.GetCount() == sorted.size(), test, "count is " + std::to_string(statistics.GetCount()) + ", expected " + std::to_string(sorted.size()));
+
+		const struct { FrameStatistics::Percentile Percentile; unsigned int Percent; } percentiles[] = { { FrameStatistics::Median, 50 }, { FrameStatistics::P95, 95 }, { FrameStatistics::P99, 99 } };
+
+		for (const auto &percentile : percentiles)
+		{
+			// Interpolation stays within the bucket of the frame at that rank, and the last bucket stands for everything above it
+			const float value = statistics.GetPercentile(percentile.Percentile), expected = std::min(GetExpectedPercentile(sorted, percentile.Percent), FrameStatistics::BucketCount * 0.1f);
+
+			Check(std::fabs(value - expected) <= 0.1f, test, "p" + std::to_string(percentile.Percent) + " is " + std::to_string(value) + ", expected " + std::to_string(expected));
+		}
+
+		Check(statistics.GetMax() == sorted.back(), test, "max is " + std::to_string(statistics.GetMax()) + ", expected " + std::to_string(sorted.back()));
+
+		const float threshold = 2 * statistics.GetPercentile(FrameStatistics::Median);
+		const std::size_t lower = sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), threshold + margin);
+		const std::size_t upper = sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), threshold - margin);
+		const unsigned int stutters = statistics.GetStutterCount();
+
+		Check(stutters >= lower && stutters <= upper, test, "stutter count is " + std::to_string(stutters) + ", expected " + (lower == upper ? std::to_string(lower) : "between " + std::to_string(lower) + " and " + std::to_string(upper)));
+	}
+
+	// A steady 60 FPS with some jitter, a slower tail and a few hitches, chosen so no frame is close to twice the median
+	void TestKnownDistribution()
+	{
+		const char *const test = "known distribution";
+		FrameStatistics statistics;
+		std::deque<float> window;
+
+		for (unsigned int i = 0; i < 1000; ++i)
+		{
+			float frametime = 16.0f + (i % 10) * 0.1f;
+
+			if (i % 20 == 7)
+			{
+				frametime = 25.0f + (i % 3);
+			}
+			if (i % 100 == 42)
+			{
+				frametime = 50.0f + i * 0.01f;
+			}
+
+			Record(statistics, window, frametime);
+		}
+
+		Compare(statistics, window, 0.0f, test);
+
+		Check(std::fabs(statistics.GetPercentile(FrameStatistics::Median) - 16.45f) <= 0.1f, test, "median is " + std::to_string(statistics.GetPercentile(FrameStatistics::Median)) + ", expected about 16.45ms");
+		Check(statistics.GetMax() == 50.0f + 942 * 0.01f, test, "max is not the last hitch");
+		Check(statistics.GetStutterCount() == 10, test, "stutter count is " + std::to_string(statistics.GetStutterCount()) + ", expected the 10 hitches");
+	}
+
+	// Frame times that drift up and down over several windows, so the cursors move both ways while frames leave the window
+	void TestSlidingWindow()
+	{
+		const char *const test = "sliding window";
+		FrameStatistics statistics;
+		std::deque<float> window;
+		unsigned int seed = 1;
+
+		for (unsigned int i = 0; i < FrameStatistics::Capacity * 8; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			const float noise = ((seed >> 8) & 0xFFFF) / 65536.0f;
+			float frametime = 12.0f + 8.0f * std::sin(i * 0.002f) + 4.0f * noise * noise;
+
+			if ((seed >> 24) % 50 == 0)
+			{
+				frametime *= 2.0f + noise * 2.0f;
+			}
+
+			Record(statistics, window, frametime);
+
+			if (i % 97 == 0 || i == FrameStatistics::Capacity * 8 - 1)
+			{
+				// Frames in the bucket holding the threshold are only estimated
+				Compare(statistics, window, 0.2f, test);
+			}
+		}
+	}
+
+	void TestEdges()
+	{
+		const char *const test = "edges";
+		FrameStatistics statistics;
+		std::deque<float> window;
+
+		Check(statistics.GetCount() == 0 && statistics.GetPercentile(FrameStatistics::P99) == 0.0f && statistics.GetMax() == 0.0f && statistics.GetStutterCount() == 0, test, "empty statistics are not zero");
+
+		// A single frame is reported as the middle of its bucket
+		Record(statistics, window, 16.63f);
+		Check(std::fabs(statistics.GetPercentile(FrameStatistics::Median) - 16.65f) < 1e-4f, test, "single frame median is " + std::to_string(statistics.GetPercentile(FrameStatistics::Median)) + ", expected 16.65");
+
+		// Negative and huge frame times end up in the first and last bucket
+		for (float frametime : { -1.0f, 0.0f, 300.0f, 1000.0f, 16.6f })
+		{
+			Record(statistics, window, frametime);
+		}
+
+		Compare(statistics, window, 0.0f, test);
+
+		statistics.Clear();
+		window.clear();
+
+		Check(statistics.GetCount() == 0 && statistics.GetMax() == 0.0f && statistics.GetStutterCount() == 0, test, "statistics are not empty after clearing");
+
+		for (unsigned int i = 0; i < 10; ++i)
+		{
+			Record(statistics, window, i < 9 ? 8.0f : 40.0f);
+		}
+
+		Compare(statistics, window, 0.0f, test);
+		Check(statistics.GetStutterCount() == 1, test, "stutter count after clearing is " + std::to_string(statistics.GetStutterCount()) + ", expected 1");
+	}
+}
+
+int main()
+{
+	TestKnownDistribution();
+	TestSlidingWindow();
+	TestEdges();
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all frame statistics checks passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+/*
+ * Checks the G-buffer decode kernels (see 'GBufferDecode.hpp') against values encoded with the matching scalar encoders, and the parsing and matching of decode profiles.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc -Idep_ext/boost tools/GBufferDecodeTest.cpp src/GBufferDecode.cpp -o rs-gbuffer-test
+ */
+
+#include "GBufferDecode.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+using namespace ReShade;
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const char *test, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::printf("FAIL %s: %s\n", test, message.c_str());
+			sFailures++;
+		}
+	}
+
+	GBufferProfile Parse(const std::string &arguments)
+	{
+		GBufferProfile profile;
+		Check(ParseGBufferProfile(arguments, profile), "parse", "'" + arguments + "' was rejected");
+
+		return profile;
+	}
+
+	// Random unit vectors, including the poles and the equator where the octahedral fold changes sides
+	std::vector<float> GenerateNormals(std::size_t count)
+	{
+		std::vector<float> normals;
+		unsigned int seed = 1;
+
+		const float fixed[][3] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0.6f, -0.8f, 0 }, { 0.48f, 0.6f, -0.64f } };
+
+		for (const auto &normal : fixed)
+		{
+			normals.insert(normals.end(), normal, normal + 3);
+		}
+
+		while (normals.size() < count * 3)
+		{
+			float v[3];
+
+			for (float &component : v)
+			{
+				seed = seed * 1103515245 + 12345;
+				component = ((seed >> 8) & 0xFFFF) / 32767.5f - 1.0f;
+			}
+
+			const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+			if (length > 0.01f)
+			{
+				normals.insert(normals.end(), { v[0] / length, v[1] / length, v[2] / length });
+			}
+		}
+
+		return normals;
+	}
+
+	// Decodes 'count' texels surrounded by guard texels, which have to come back untouched
+	std::vector<float> Decode(const GBufferProfile &profile, const std::vector<float> &texels, const char *test)
+	{
+		const float guard = 12345.0f;
+		std::vector<float> data(texels.size() + 8, guard);
+		std::copy(texels.begin(), texels.end(), data.begin() + 4);
+
+		DecodeGBuffer(profile, data.data() + 4, texels.size() / 4);
+
+		Check(std::all_of(data.begin(), data.begin() + 4, [guard](float value) { return value == guard; }) && std::all_of(data.end() - 4, data.end(), [guard](float value) { return value == guard; }), test, "decode wrote outside of the texels");
+
+		return std::vector<float>(data.begin() + 4, data.end() - 4);
+	}
+
+	// Compares decoded texels to the expected RGBA values and reports the worst error
+	void Compare(const std::vector<float> &decoded, const std::vector<float> &expected, float tolerance, const char *test)
+	{
+		float worst = 0.0f;
+		std::size_t worstIndex = 0;
+
+		for (std::size_t i = 0; i < expected.size(); ++i)
+		{
+			const float error = std::fabs(decoded[i] - expected[i]);
+
+			if (!(error <= worst))
+			{
+				worst = error;
+				worstIndex = i;
+			}
+		}
+
+		Check(worst <= tolerance, test, "texel " + std::to_string(worstIndex / 4) + " channel " + std::to_string(worstIndex % 4) + " is " + std::to_string(decoded[worstIndex]) + ", expected " + std::to_string(expected[worstIndex]));
+	}
+
+	void TestOctahedral(std::size_t count)
+	{
+		const char *const test = "octahedral";
+		const std::vector<float> normals = GenerateNormals(count);
+		std::vector<float> texels, expected;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const float *const n = normals.data() + i * 3;
+			const float sum = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+			float x = n[0] / sum, y = n[1] / sum;
+
+			if (n[2] < 0.0f)
+			{
+				const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f), foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = foldedX, y = foldedY;
+			}
+
+			texels.insert(texels.end(), { x * 0.5f + 0.5f, y * 0.5f + 0.5f, 0.25f, 0.75f });
+			expected.insert(expected.end(), { n[0] * 0.5f + 0.5f, n[1] * 0.5f + 0.5f, n[2] * 0.5f + 0.5f, 1.0f });
+		}
+
+		Compare(Decode(Parse("24 octahedral"), texels, test), expected, 1e-5f, test);
+	}
+	void TestSpheremap(std::size_t count)
+	{
+		const char *const test = "spheremap";
+		const std::vector<float> normals = GenerateNormals(count + 2);
+		std::vector<float> texels, expected;
+
+		for (std::size_t i = 0; texels.size() < count * 4; ++i)
+		{
+			const float *const n = normals.data() + i * 3;
+
+			// The projection is undefined at the pole facing away
+			if (n[2] < -0.99f)
+			{
+				continue;
+			}
+
+			const float f = std::sqrt(8.0f * n[2] + 8.0f);
+
+			texels.insert(texels.end(), { n[0] / f + 0.5f, n[1] / f + 0.5f, 0.0f, 0.0f });
+			expected.insert(expected.end(), { n[0] * 0.5f + 0.5f, n[1] * 0.5f + 0.5f, n[2] * 0.5f + 0.5f, 1.0f });
+		}
+
+		Compare(Decode(Parse("24 spheremap"), texels, test), expected, 1e-4f, test);
+	}
+	void TestDepth(std::size_t count, bool reverse)
+	{
+		const char *const test = reverse ? "reverse depth" : "depth";
+		const float nearPlane = 0.5f, farPlane = 2000.0f;
+		std::vector<float> texels, expected;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			// View depths spread over the range, with more of them close to the camera where depth precision is highest
+			const float t = static_cast<float>(i) / (count - 1), view = nearPlane + (farPlane - nearPlane) * t * t;
+			const float depth = reverse ? nearPlane * (farPlane - view) / (view * (farPlane - nearPlane)) : farPlane * (view - nearPlane) / (view * (farPlane - nearPlane));
+			const float linear = (view - nearPlane) / (farPlane - nearPlane);
+
+			texels.insert(texels.end(), { depth, 0.5f, 0.5f, 0.5f });
+			expected.insert(expected.end(), { linear, linear, linear, 1.0f });
+		}
+
+		// Hyperbolic depth loses precision far away, so this cannot be as tight as the other kernels
+		Compare(Decode(Parse(std::string("40 depth 0.5 2000") + (reverse ? " reverse" : "")), texels, test), expected, 2e-3f, test);
+	}
+	void TestTonemap(std::size_t count)
+	{
+		const char *const test = "tonemap";
+		std::vector<float> texels, expected;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const float value = i * 0.37f - 1.0f;
+			texels.insert(texels.end(), { value, value * 2.0f, value * 0.1f, 0.0f });
+
+			for (float channel : { value, value * 2.0f, value * 0.1f })
+			{
+				const float exposed = std::max(channel * 2.0f, 0.0f);
+				expected.push_back(std::sqrt(exposed / (exposed + 1.0f)));
+			}
+
+			expected.push_back(1.0f);
+		}
+
+		Compare(Decode(Parse("10 tonemap 1"), texels, test), expected, 1e-6f, test);
+	}
+	void TestChannel(std::size_t count)
+	{
+		const char *const test = "channel";
+		std::vector<float> texels, expected;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const float value = i / 64.0f;
+			texels.insert(texels.end(), { 0.1f, 0.2f, 0.3f, value });
+			expected.insert(expected.end(), { value * 4.0f, value * 4.0f, value * 4.0f, 1.0f });
+		}
+
+		Compare(Decode(Parse("28:RT2 channel A 4"), texels, test), expected, 0.0f, test);
+	}
+
+	void TestProfiles()
+	{
+		const char *const test = "profiles";
+		GBufferProfile profile;
+
+		for (const char *invalid : { "", "24", "0 octahedral", "24 unknown", "40 depth", "40 depth 10 1", "40 depth 0 100", "28 channel", "28 channel x", "28 channel rg" })
+		{
+			Check(!ParseGBufferProfile(invalid, profile), test, std::string("'") + invalid + "' was accepted");
+		}
+
+		profile = Parse("40:RT3 depth 0.1 500 reverse");
+		Check(profile.SourceFormat == 40 && profile.Name == "RT3" && profile.Decode == GBufferProfile::Kernel::LinearDepth && profile.Near == 0.1f && profile.Far == 500.0f && profile.ReverseZ, test, "depth arguments were not parsed");
+
+		profile = Parse("10 TONEMAP");
+		Check(profile.Decode == GBufferProfile::Kernel::Tonemap && profile.Exposure == 0.0f, test, "kernel names are not case insensitive or the exposure does not default to zero");
+
+		profile = Parse("28 channel g");
+		Check(profile.Channel == 1 && profile.Scale == 1.0f, test, "channel does not default to a scale of one");
+
+		// Later profiles win, a name restricts a profile to dumps starting with it
+		const std::vector<GBufferProfile> profiles = { Parse("24 octahedral"), Parse("24:RT1 spheremap"), Parse("10 tonemap") };
+
+		const GBufferProfile *const first = FindGBufferProfile(profiles, 24, "RT1_Draw5");
+		const GBufferProfile *const second = FindGBufferProfile(profiles, 24, "RT0_Draw5");
+
+		Check(first != nullptr && first->Decode == GBufferProfile::Kernel::SpheremapNormal, test, "the later profile with a matching name did not win");
+		Check(second != nullptr && second->Decode == GBufferProfile::Kernel::OctahedralNormal, test, "a profile without name did not match all dumps of its format");
+		Check(FindGBufferProfile(profiles, 28, "RT1_Draw5") == nullptr, test, "a profile matched another format");
+	}
+}
+
+int main()
+{
+	// Odd counts run the partial group of four texels at the end too
+	for (std::size_t count : { 1u, 3u, 4u, 257u })
+	{
+		TestOctahedral(count + 6);
+		TestSpheremap(count);
+		TestDepth(count + 1, false);
+		TestDepth(count + 1, true);
+		TestTonemap(count);
+		TestChannel(count);
+	}
+
+	TestProfiles();
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all G-buffer decode checks passed\n");
+	return 0;
+}
\ No newline at end of file
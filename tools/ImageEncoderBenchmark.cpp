@@ -0,0 +1,175 @@
+/*
+ * Compares the reference PNG encoder of stb with the fast PNG and QOI encoders used for dumps, on 720p and 1080p test images or the given image files.
+ * Every encoded image is decoded again and compared to the source, so the run fails if an encoder is not lossless.
+ * Build from the repository root with (the PNG writer of stb has to be compiled as C, since it is declared with C linkage below):
+ *   g++ -std=c++11 -O2 -Isrc -Idep/stb/include tools/ImageEncoderBenchmark.cpp src/ImageEncoder.cpp dep/stb/src/stb_image.c dep/stb/src/stb_dxt.c -x c dep/stb/src/stb_image_write.c -o rs-encoder-bench -pthread
+ */
+
+#include "ImageEncoder.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stb_image.h>
+
+extern "C" unsigned char *stbi_write_png_to_mem(unsigned char *pixels, int stride_bytes, int x, int y, int n, int *out_len);
+
+using namespace ReShade;
+
+namespace
+{
+	struct Image
+	{
+		std::string Name;
+		unsigned int Width, Height;
+		std::vector<unsigned char> Data;
+	};
+
+	unsigned int sFailures = 0;
+
+	// Smooth gradients with some noise and a few flat areas, roughly what a lit scene or a G-buffer target looks like
+	Image GenerateImage(unsigned int width, unsigned int height)
+	{
+		Image image;
+		image.Name = std::to_string(width) + "x" + std::to_string(height) + " generated";
+		image.Width = width;
+		image.Height = height;
+		image.Data.resize(width * height * 4);
+
+		unsigned int seed = 1;
+
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				unsigned char *const pixel = image.Data.data() + (y * width + x) * 4;
+				seed = seed * 1103515245 + 12345;
+				const int noise = static_cast<int>((seed >> 16) & 7) - 4;
+				const bool flat = (x / 160 + y / 120) % 5 == 0;
+
+				pixel[0] = static_cast<unsigned char>(flat ? 32 : std::min(std::max(static_cast<int>(x * 255 / width) + noise, 0), 255));
+				pixel[1] = static_cast<unsigned char>(flat ? 64 : std::min(std::max(static_cast<int>(y * 255 / height) + noise, 0), 255));
+				pixel[2] = static_cast<unsigned char>(flat ? 96 : ((x ^ y) & 0x3F) + 96);
+				pixel[3] = 255;
+			}
+		}
+
+		return image;
+	}
+
+	template <typename F>
+	double Measure(F function, unsigned int runs)
+	{
+		double best = 1e30;
+
+		for (unsigned int run = 0; run < runs; ++run)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		return best;
+	}
+
+	void CheckPNG(const Image &image, const unsigned char *png, std::size_t size, const char *encoder)
+	{
+		int width = 0, height = 0, channels = 0;
+		unsigned char *const decoded = stbi_load_from_memory(png, static_cast<int>(size), &width, &height, &channels, 4);
+
+		if (decoded == nullptr || width != static_cast<int>(image.Width) || height != static_cast<int>(image.Height) || std::memcmp(decoded, image.Data.data(), image.Data.size()) != 0)
+		{
+			std::printf("FAIL %s: %s output does not decode to the source image\n", image.Name.c_str(), encoder);
+			sFailures++;
+		}
+
+		stbi_image_free(decoded);
+	}
+
+	void Run(Image &image, unsigned int runs)
+	{
+		const double megapixels = image.Width * image.Height / 1e6;
+		int stbSize = 0;
+		unsigned char *stbPNG = nullptr;
+		std::vector<unsigned char> fastPNG, qoi;
+
+		const double stbTime = Measure([&]() { stbi_image_free(stbPNG); stbPNG = stbi_write_png_to_mem(image.Data.data(), image.Width * 4, image.Width, image.Height, 4, &stbSize); }, runs);
+		const double fastTime = Measure([&]() { fastPNG.clear(); EncodeFastPNG(image.Data.data(), image.Width, image.Height, fastPNG); }, runs);
+		const double qoiTime = Measure([&]() { qoi.clear(); EncodeQOI(image.Data.data(), image.Width, image.Height, qoi); }, runs);
+
+		std::printf("%s (%u runs, best of each):\n", image.Name.c_str(), runs);
+		std::printf("  %-10s %9.2f ms %8.1f MP/s %10zu bytes\n", "stb PNG", stbTime, megapixels * 1000 / stbTime, static_cast<std::size_t>(stbSize));
+		std::printf("  %-10s %9.2f ms %8.1f MP/s %10zu bytes\n", "fast PNG", fastTime, megapixels * 1000 / fastTime, fastPNG.size());
+		std::printf("  %-10s %9.2f ms %8.1f MP/s %10zu bytes\n", "QOI", qoiTime, megapixels * 1000 / qoiTime, qoi.size());
+
+		CheckPNG(image, stbPNG, stbSize, "stb PNG");
+		CheckPNG(image, fastPNG.data(), fastPNG.size(), "fast PNG");
+
+		std::vector<unsigned char> decoded(image.Data.size());
+
+		if (!DecodeQOI(qoi.data(), qoi.size(), image.Width, image.Height, decoded.data()) || decoded != image.Data)
+		{
+			std::printf("FAIL %s: QOI output does not decode to the source image\n", image.Name.c_str());
+			sFailures++;
+		}
+
+		std::free(stbPNG);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int runs = 5;
+	std::vector<Image> images;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+		{
+			runs = std::max(static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)), 1u);
+			continue;
+		}
+
+		int width = 0, height = 0, channels = 0;
+		unsigned char *const data = stbi_load(argv[i], &width, &height, &channels, 4);
+
+		if (data == nullptr)
+		{
+			std::fprintf(stderr, "error: cannot load '%s'\n", argv[i]);
+			return 2;
+		}
+
+		Image image;
+		image.Name = argv[i];
+		image.Width = width;
+		image.Height = height;
+		image.Data.assign(data, data + width * height * 4);
+		images.push_back(std::move(image));
+
+		stbi_image_free(data);
+	}
+
+	if (images.empty())
+	{
+		images.push_back(GenerateImage(1280, 720));
+		images.push_back(GenerateImage(1920, 1080));
+	}
+
+	for (Image &image : images)
+	{
+		Run(image, runs);
+	}
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all encoders round-tripped losslessly\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+/*
+ * Checks the scheduling of 'ReadbackQueue' against a mock backend, whose copies only finish when the test says so.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc tools/ReadbackQueueTest.cpp src/ReadbackQueue.cpp -o rs-readback-test
+ */
+
+#include "ReadbackQueue.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+using namespace ReShade;
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const char *test, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::printf("FAIL %s: %s\n", test, message.c_str());
+			sFailures++;
+		}
+	}
+
+	// Staging resources are plain numbers, the "GPU" finishes copies in order whenever 'Finish' is called
+	class MockBackend : public ReadbackQueue::Backend
+	{
+	public:
+		MockBackend() : Created(0), Destroyed(0), Waits(0), FailMaps(false), mNext(1)
+		{
+		}
+
+		virtual void *CreateStaging(const ReadbackQueue::Description &desc) override
+		{
+			Created++;
+			Live[mNext] = desc.Width;
+
+			return reinterpret_cast<void *>(mNext++);
+		}
+		virtual void DestroyStaging(void *staging) override
+		{
+			Destroyed++;
+			Live.erase(reinterpret_cast<std::uintptr_t>(staging));
+		}
+		virtual void Copy(void *staging, void *source) override
+		{
+			Copies.push_back(std::make_pair(reinterpret_cast<std::uintptr_t>(staging), reinterpret_cast<std::uintptr_t>(source)));
+			Contents[reinterpret_cast<std::uintptr_t>(staging)] = static_cast<unsigned char>(reinterpret_cast<std::uintptr_t>(source));
+		}
+		virtual MapResult Map(void *staging, bool wait, const unsigned char *&data, std::size_t &pitch) override
+		{
+			const std::uintptr_t id = reinterpret_cast<std::uintptr_t>(staging);
+
+			if (!IsFinished(id))
+			{
+				if (!wait)
+				{
+					return MapResult::Pending;
+				}
+
+				Waits++;
+				Finished.insert(Finished.end(), id);
+			}
+
+			if (FailMaps)
+			{
+				return MapResult::Failed;
+			}
+
+			data = &Contents[id];
+			pitch = 1;
+
+			return MapResult::Ready;
+		}
+		virtual void Unmap(void *) override
+		{
+		}
+
+		// Finishes the oldest copies still running on the "GPU"
+		void Finish(std::size_t count)
+		{
+			for (const auto &copy : Copies)
+			{
+				if (count != 0 && !IsFinished(copy.first))
+				{
+					Finished.push_back(copy.first);
+					count--;
+				}
+			}
+		}
+
+		unsigned int Created, Destroyed, Waits;
+		bool FailMaps;
+		std::map<std::uintptr_t, unsigned int> Live;
+		std::map<std::uintptr_t, unsigned char> Contents;
+		std::vector<std::pair<std::uintptr_t, std::uintptr_t>> Copies;
+		std::vector<std::uintptr_t> Finished;
+
+	private:
+		bool IsFinished(std::uintptr_t id) const
+		{
+			// A staging resource is reused after completing, so only its latest copy counts
+			std::size_t copies = 0, finished = 0;
+
+			for (const auto &copy : Copies)
+			{
+				copies += copy.first == id;
+			}
+			for (std::uintptr_t other : Finished)
+			{
+				finished += other == id;
+			}
+
+			return finished >= copies;
+		}
+
+		std::uintptr_t mNext;
+	};
+
+	const ReadbackQueue::Description Small = { 4, 4, 28 }, Large = { 8, 8, 28 };
+
+	void *Source(std::uintptr_t value)
+	{
+		return reinterpret_cast<void *>(value);
+	}
+
+	void TestCompletesInOrderOnceFinished()
+	{
+		const char *const test = "completes in order once finished";
+		MockBackend backend;
+		std::vector<int> completed;
+		ReadbackQueue queue(backend, 3, 8);
+
+		for (int i = 1; i <= 3; ++i)
+		{
+			queue.Enqueue(Source(i), Small, [&completed](const unsigned char *data, std::size_t) { completed.push_back(data != nullptr ? *data : -1); });
+		}
+
+		queue.Update();
+		Check(completed.empty(), test, "requests completed before the GPU finished them");
+
+		backend.Finish(2);
+		queue.Update();
+		Check(completed == std::vector<int>({ 1, 2 }), test, "expected the two finished copies to complete in order");
+		Check(backend.Waits == 0 && queue.GetStallCount() == 0, test, "waited on the GPU within the latency");
+
+		backend.Finish(1);
+		queue.Update();
+		Check(completed == std::vector<int>({ 1, 2, 3 }), test, "last copy did not complete");
+		Check(backend.Created == 3, test, "expected one staging resource per request in flight, got " + std::to_string(backend.Created));
+	}
+	void TestWaitsAfterLatency()
+	{
+		const char *const test = "waits after latency";
+		MockBackend backend;
+		int completed = 0;
+		ReadbackQueue queue(backend, 2, 8);
+
+		queue.Enqueue(Source(1), Small, [&completed](const unsigned char *data, std::size_t) { completed += data != nullptr; });
+
+		queue.Update();
+		Check(completed == 0 && backend.Waits == 0, test, "waited before the latency was reached");
+
+		queue.Update();
+		Check(completed == 1, test, "request pending for 'latency' frames was not completed");
+		Check(backend.Waits == 1 && queue.GetStallCount() == 1, test, "expected exactly one stall");
+	}
+	void TestDropsWhenFullAndPending()
+	{
+		const char *const test = "drops when full and pending";
+		MockBackend backend;
+		int completed = 0, failed = 0;
+		const ReadbackQueue::Callback callback = [&completed, &failed](const unsigned char *data, std::size_t) { (data != nullptr ? completed : failed)++; };
+		ReadbackQueue queue(backend, 2, 2);
+
+		Check(queue.Enqueue(Source(1), Small, callback) && queue.Enqueue(Source(2), Small, callback), test, "requests within the capacity failed");
+		Check(!queue.Enqueue(Source(3), Small, callback), test, "request beyond the capacity did not fail while all copies are pending");
+		Check(backend.Waits == 0, test, "enqueue waited on the GPU");
+		Check(queue.GetDropCount() == 1 && queue.GetPendingCount() == 2, test, "dropped request was counted wrong or queued anyway");
+		Check(completed == 0 && failed == 0, test, "callback of a dropped request was called");
+	}
+	void TestReusesFinishedWhenFull()
+	{
+		const char *const test = "reuses finished when full";
+		MockBackend backend;
+		std::vector<int> completed;
+		const ReadbackQueue::Callback callback = [&completed](const unsigned char *data, std::size_t) { completed.push_back(data != nullptr ? *data : -1); };
+		ReadbackQueue queue(backend, 4, 2);
+
+		queue.Enqueue(Source(1), Small, callback);
+		queue.Enqueue(Source(2), Small, callback);
+		backend.Finish(1);
+
+		Check(queue.Enqueue(Source(3), Small, callback), test, "request failed although the oldest copy finished");
+		Check(completed == std::vector<int>({ 1 }), test, "finished copy was not completed to make room");
+		Check(backend.Created == 2 && backend.Waits == 0 && queue.GetDropCount() == 0, test, "expected the staging resource of the finished copy to be reused without waiting");
+	}
+	void TestReplacesUnusedOfOtherSize()
+	{
+		const char *const test = "replaces unused of other size";
+		MockBackend backend;
+		int completed = 0;
+		const ReadbackQueue::Callback callback = [&completed](const unsigned char *data, std::size_t) { completed += data != nullptr; };
+		ReadbackQueue queue(backend, 1, 1);
+
+		queue.Enqueue(Source(1), Small, callback);
+		backend.Finish(1);
+		queue.Update();
+
+		Check(queue.Enqueue(Source(2), Large, callback), test, "request of another size failed with an unused resource in the pool");
+		Check(backend.Destroyed == 1 && backend.Live.size() == 1 && backend.Live.begin()->second == Large.Width, test, "unused resource of the other size was not replaced");
+	}
+	void TestEnqueueFromCallback()
+	{
+		const char *const test = "enqueue from callback";
+		MockBackend backend;
+		int completed = 0;
+		ReadbackQueue queue(backend, 1, 1);
+
+		queue.Enqueue(Source(1), Small, [&queue, &completed](const unsigned char *, std::size_t)
+		{
+			completed++;
+
+			// The resource of this request is only released after the callback, so this has to exceed the capacity
+			Check(queue.Enqueue(Source(2), Large, [&completed](const unsigned char *, std::size_t) { completed++; }), "enqueue from callback", "request from a completion callback failed");
+		});
+
+		queue.Update();
+		queue.Flush();
+
+		Check(completed == 2, test, "expected both requests to complete, got " + std::to_string(completed));
+	}
+	void TestFailedMapAndClear()
+	{
+		const char *const test = "failed map and clear";
+		MockBackend backend;
+		int failed = 0;
+		const ReadbackQueue::Callback callback = [&failed](const unsigned char *data, std::size_t) { failed += data == nullptr; };
+		ReadbackQueue queue(backend, 1, 4);
+
+		backend.FailMaps = true;
+		queue.Enqueue(Source(1), Small, callback);
+		backend.Finish(1);
+		queue.Update();
+		Check(failed == 1, test, "failed map did not complete the request with null data");
+
+		backend.FailMaps = false;
+		queue.Enqueue(Source(2), Small, callback);
+		queue.Enqueue(Source(3), Large, callback);
+		queue.Clear();
+		Check(failed == 3, test, "clear did not fail the pending requests");
+		Check(backend.Live.empty() && queue.GetPendingCount() == 0, test, "clear left staging resources alive");
+	}
+}
+
+int main()
+{
+	TestCompletesInOrderOnceFinished();
+	TestWaitsAfterLatency();
+	TestDropsWhenFullAndPending();
+	TestReusesFinishedWhenFull();
+	TestReplacesUnusedOfOtherSize();
+	TestEnqueueFromCallback();
+	TestFailedMapAndClear();
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all readback queue checks passed\n");
+	return 0;
+}
\ No newline at end of file
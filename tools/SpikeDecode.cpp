@@ -0,0 +1,135 @@
+/*
+ * Prints a capture written by the spike recorder (see 'SpikeRecorder.hpp') as a table, one row per frame, with the triggering frame marked.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc tools/SpikeDecode.cpp -o rs-spike-decode
+ */
+
+#include "SpikeRecorder.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	const struct
+	{
+		SpikeRecorder::Event Flag;
+		const char *Name;
+	} sEventNames[] = {
+		{ SpikeRecorder::FileModified, "file-modified" },
+		{ SpikeRecorder::EffectLoaded, "effect-loaded" },
+		{ SpikeRecorder::EffectCompiled, "effect-compiled" },
+		{ SpikeRecorder::EffectProcessed, "effect-processed" },
+		{ SpikeRecorder::TechniqueToggled, "technique-toggled" },
+		{ SpikeRecorder::TechniqueShed, "technique-shed" },
+		{ SpikeRecorder::TechniqueRestored, "technique-restored" },
+		{ SpikeRecorder::TexturesUploaded, "textures-uploaded" }
+	};
+
+	std::string GetEventNames(const SpikeRecorder::Frame &frame)
+	{
+		std::string names;
+		std::uint32_t unknown = frame.Events;
+
+		for (const auto &event : sEventNames)
+		{
+			if ((frame.Events & event.Flag) == 0)
+			{
+				continue;
+			}
+
+			if (!names.empty())
+			{
+				names += ',';
+			}
+
+			names += event.Name;
+
+			if (event.Flag == SpikeRecorder::TexturesUploaded)
+			{
+				names += '(' + std::to_string(frame.TextureUploads) + ')';
+			}
+
+			unknown &= ~event.Flag;
+		}
+
+		// Flags added by a newer runtime are still shown, just not by name
+		if (unknown != 0)
+		{
+			char hex[16];
+			std::snprintf(hex, sizeof(hex), "0x%x", unknown);
+
+			names += names.empty() ? hex : std::string(",") + hex;
+		}
+
+		return names;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2)
+	{
+		std::fprintf(stderr, "usage: %s <spike capture>\n", argv[0]);
+		return 2;
+	}
+
+	FILE *const file = std::fopen(argv[1], "rb");
+
+	if (file == nullptr)
+	{
+		std::fprintf(stderr, "error: cannot open '%s'\n", argv[1]);
+		return 1;
+	}
+
+	SpikeRecorder::Header header;
+
+	if (std::fread(&header, sizeof(header), 1, file) != 1 || header.Signature != SpikeRecorder::Signature)
+	{
+		std::fclose(file);
+		std::fprintf(stderr, "error: '%s' is not a spike capture\n", argv[1]);
+		return 1;
+	}
+	if (header.Version != SpikeRecorder::Version)
+	{
+		std::fclose(file);
+		std::fprintf(stderr, "error: '%s' is a capture of version %u, expected version %u\n", argv[1], header.Version, SpikeRecorder::Version);
+		return 1;
+	}
+
+	std::vector<SpikeRecorder::Frame> frames(header.FrameCount);
+	const std::size_t count = frames.empty() ? 0 : std::fread(frames.data(), sizeof(SpikeRecorder::Frame), frames.size(), file);
+	std::fclose(file);
+
+	if (count != frames.size())
+	{
+		std::fprintf(stderr, "warning: capture is truncated, only %zu of %u frames could be read\n", count, header.FrameCount);
+		frames.resize(count);
+	}
+
+	std::printf("threshold %.3fms, %u frames of history, %zu frames following the spike\n", header.Threshold, header.TriggerFrame, frames.size() > header.TriggerFrame ? frames.size() - header.TriggerFrame - 1 : 0);
+	std::printf("  %12s %10s %10s %8s %10s  %s\n", "frame", "frame_ms", "post_ms", "draws", "vertices", "events");
+
+	float total = 0.0f, worst = 0.0f;
+
+	for (std::size_t i = 0; i < frames.size(); ++i)
+	{
+		const SpikeRecorder::Frame &frame = frames[i];
+		const char marker = i == header.TriggerFrame ? '>' : frame.FrameTime > header.Threshold ? '!' : ' ';
+
+		std::printf("%c %12llu %10.3f %10.3f %8u %10u  %s\n", marker, static_cast<unsigned long long>(frame.Index), frame.FrameTime, frame.PostProcessingTime, frame.DrawCalls, frame.DrawCallVertices, GetEventNames(frame).c_str());
+
+		total += frame.FrameTime;
+		worst = std::max(worst, frame.FrameTime);
+	}
+
+	if (!frames.empty())
+	{
+		std::printf("average %.3fms, worst %.3fms ('>' marks the trigger, '!' later frames above the threshold)\n", total / frames.size(), worst);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+/*
+ * Checks the POSIX backend of 'StatisticsPage': Publishing, the sequence lock, refusing a second page for the same process and cleaning up.
+ * With '--publish <frames>' it instead publishes a made up frame every millisecond, for trying 'tools/StatisticsReader.cpp' against a live page.
+ * Build from the repository root with (add '-lrt' for glibc versions before 2.17):
+ *   g++ -std=c++11 -O2 -Isrc tools/StatisticsPageTest.cpp src/StatisticsPage.cpp -o rs-stats-page-test
+ */
+
+#include "StatisticsPage.hpp"
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace ReShade;
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const char *test, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::printf("FAIL %s: %s\n", test, message.c_str());
+			sFailures++;
+		}
+	}
+
+	// Identifiers no running process has, so tests never collide with a real runtime
+	const unsigned long TestId = 4000000001ul;
+
+	const volatile StatisticsData *MapReadOnly(unsigned long id)
+	{
+		const int file = shm_open(GetStatisticsPageName(id).c_str(), O_RDONLY, 0);
+
+		if (file < 0)
+		{
+			return nullptr;
+		}
+
+		void *const data = mmap(nullptr, sizeof(StatisticsData), PROT_READ, MAP_SHARED, file, 0);
+		close(file);
+
+		return data != MAP_FAILED ? static_cast<const volatile StatisticsData *>(data) : nullptr;
+	}
+
+	void Publish(StatisticsPage &page, std::uint64_t frame)
+	{
+		StatisticsData &data = page.BeginUpdate();
+		data.FrameCount = frame;
+		data.FrameTime = 16.0f + frame % 5;
+		data.PostProcessingTime = 1.5f;
+		data.DrawCalls = 1000 + static_cast<std::uint32_t>(frame % 100);
+		data.TechniqueCount = 1;
+		std::strcpy(data.Techniques[0].Name, "Bloom");
+		data.Techniques[0].Enabled = 1;
+		data.Techniques[0].Cost = 0.25f;
+		page.EndUpdate();
+	}
+
+	void TestPublish()
+	{
+		const char *const test = "publish";
+
+		{
+			StatisticsPage page(TestId);
+			Check(page.IsValid(), test, "page could not be created");
+
+			if (!page.IsValid())
+			{
+				return;
+			}
+
+			const StatisticsPage second(TestId);
+			Check(!second.IsValid(), test, "a second page for the same process was created");
+
+			const volatile StatisticsData *const data = MapReadOnly(TestId);
+			Check(data != nullptr, test, "page cannot be opened by name");
+
+			if (data == nullptr)
+			{
+				return;
+			}
+
+			Check(data->PageSignature == StatisticsData::Signature && data->PageVersion == StatisticsData::Version && data->PageSize == sizeof(StatisticsData), test, "page header was not initialized");
+			Check(data->Sequence == 0 && data->FrameCount == 0 && data->TechniqueCount == 0, test, "new page is not zeroed");
+
+			page.BeginUpdate();
+			Check((data->Sequence & 1) == 1, test, "sequence is not odd during an update");
+			page.EndUpdate();
+
+			Publish(page, 42);
+			Check(data->Sequence == 4 && data->FrameCount == 42 && data->DrawCalls == 1042 && data->TechniqueCount == 1, test, "update is not visible through another mapping");
+
+			munmap(const_cast<StatisticsData *>(data), sizeof(StatisticsData));
+		}
+
+		Check(MapReadOnly(TestId) == nullptr, test, "page was not removed when it was destroyed");
+
+		// Once removed, the name can be published again
+		const StatisticsPage again(TestId);
+		Check(again.IsValid(), test, "page could not be created again after the previous one was destroyed");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 3 && std::strcmp(argv[1], "--publish") == 0)
+	{
+		StatisticsPage page(getpid());
+
+		if (!page.IsValid())
+		{
+			std::fprintf(stderr, "error: cannot publish statistics\n");
+			return 1;
+		}
+
+		std::printf("publishing as process %d\n", static_cast<int>(getpid()));
+		std::fflush(stdout);
+
+		for (std::uint64_t frame = 1, frames = std::strtoull(argv[2], nullptr, 10); frame <= frames; ++frame)
+		{
+			Publish(page, frame);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return 0;
+	}
+
+	TestPublish();
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all statistics page checks passed\n");
+	return 0;
+}
\ No newline at end of file
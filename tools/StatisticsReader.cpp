@@ -0,0 +1,334 @@
+/*
+ * Reads the statistics page a runtime publishes (see 'StatisticsPage.hpp').
+ * It follows a running process and prints one CSV row per frame, saves a copy of the page, or prints such a saved copy.
+ * Build from the repository root with (add '-lrt' for glibc versions before 2.17):
+ *   g++ -std=c++11 -O2 -Isrc tools/StatisticsReader.cpp -o rs-stats
+ */
+
+#include "StatisticsPage.hpp"
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace ReShade;
+
+namespace
+{
+	bool IsValidPage(const StatisticsData &data)
+	{
+		return data.PageSignature == StatisticsData::Signature && data.PageVersion == StatisticsData::Version && data.PageSize == sizeof(StatisticsData) && data.TechniqueCount <= StatisticsData::MaxTechniques;
+	}
+
+	std::string GetTechniqueName(const StatisticsData::Technique &technique)
+	{
+		return std::string(technique.Name, strnlen(technique.Name, sizeof(technique.Name)));
+	}
+
+	void PrintSummary(const StatisticsData &data)
+	{
+		std::printf("frame %llu: %.3fms, post-processing %.3fms, %u draw calls (%u vertices)\n", static_cast<unsigned long long>(data.FrameCount), data.FrameTime, data.PostProcessingTime, data.DrawCalls, data.DrawCallVertices);
+		std::printf("network: %u bytes up / %u bytes down\n", data.NetworkUpload, data.NetworkDownload);
+		std::printf("effect: %s, compile step %u%s\n", data.EffectLoaded ? "loaded" : "not loaded", data.CompileStep, data.EffectErrors ? ", has errors" : "");
+
+		for (unsigned int i = 0; i < data.TechniqueCount; ++i)
+		{
+			const StatisticsData::Technique &technique = data.Techniques[i];
+			const char *const state = !technique.Enabled ? "disabled" : technique.Shed ? "shed" : technique.Demotion > 1 ? "demoted" : "enabled";
+
+			std::printf("  %-32s %-8s %8.3fms (%.3fms CPU / %.3fms GPU", GetTechniqueName(technique).c_str(), state, technique.Cost, technique.CPUCost, technique.GPUCost);
+
+			if (technique.Demotion > 1)
+			{
+				std::printf(", %ux interval", technique.Demotion);
+			}
+
+			std::printf(")\n");
+		}
+	}
+	int ReadFile(const char *path)
+	{
+		StatisticsData data;
+		FILE *const file = std::fopen(path, "rb");
+
+		if (file == nullptr)
+		{
+			std::fprintf(stderr, "error: cannot open '%s'\n", path);
+			return 1;
+		}
+
+		const bool complete = std::fread(&data, sizeof(data), 1, file) == 1;
+		std::fclose(file);
+
+		if (!complete || !IsValidPage(data))
+		{
+			std::fprintf(stderr, "error: '%s' is not a statistics page of version %u\n", path, StatisticsData::Version);
+			return 1;
+		}
+
+		PrintSummary(data);
+		return 0;
+	}
+
+	// Maps the page of another process read-only
+	class PageView
+	{
+	public:
+		explicit PageView(unsigned long id) : mId(id), mPage(nullptr)
+		{
+#ifdef _WIN32
+			this->mMapping = OpenFileMappingW(FILE_MAP_READ, FALSE, GetStatisticsPageName(id).c_str());
+
+			if (this->mMapping != nullptr)
+			{
+				this->mPage = static_cast<const volatile StatisticsData *>(MapViewOfFile(this->mMapping, FILE_MAP_READ, 0, 0, sizeof(StatisticsData)));
+			}
+
+			this->mProcess = OpenProcess(SYNCHRONIZE, FALSE, id);
+#else
+			const int file = shm_open(GetStatisticsPageName(id).c_str(), O_RDONLY, 0);
+
+			if (file >= 0)
+			{
+				void *const data = mmap(nullptr, sizeof(StatisticsData), PROT_READ, MAP_SHARED, file, 0);
+				close(file);
+
+				this->mPage = data != MAP_FAILED ? static_cast<const volatile StatisticsData *>(data) : nullptr;
+			}
+#endif
+		}
+		~PageView()
+		{
+#ifdef _WIN32
+			if (this->mPage != nullptr)
+			{
+				UnmapViewOfFile(const_cast<StatisticsData *>(this->mPage));
+			}
+			if (this->mMapping != nullptr)
+			{
+				CloseHandle(this->mMapping);
+			}
+			if (this->mProcess != nullptr)
+			{
+				CloseHandle(this->mProcess);
+			}
+#else
+			if (this->mPage != nullptr)
+			{
+				munmap(const_cast<StatisticsData *>(this->mPage), sizeof(StatisticsData));
+			}
+#endif
+		}
+
+		const volatile StatisticsData *Get() const
+		{
+			return this->mPage;
+		}
+
+		// Keeps running if the process cannot be waited on
+		bool IsProcessRunning() const
+		{
+#ifdef _WIN32
+			return this->mProcess == nullptr || WaitForSingleObject(this->mProcess, 0) == WAIT_TIMEOUT;
+#else
+			return kill(static_cast<pid_t>(this->mId), 0) == 0 || errno == EPERM;
+#endif
+		}
+
+	private:
+		unsigned long mId;
+		const volatile StatisticsData *mPage;
+#ifdef _WIN32
+		HANDLE mMapping, mProcess;
+#endif
+	};
+
+	// Retries while the runtime is in the middle of an update, which only takes a few microseconds
+	bool CopyPage(const volatile StatisticsData *page, StatisticsData &copy)
+	{
+		for (unsigned int attempt = 0; attempt < 1000; ++attempt)
+		{
+			const std::int32_t sequence = page->Sequence;
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			std::memcpy(&copy, const_cast<const StatisticsData *>(page), sizeof(StatisticsData));
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if ((sequence & 1) == 0 && page->Sequence == sequence)
+			{
+				return true;
+			}
+
+			std::this_thread::yield();
+		}
+
+		return false;
+	}
+	void PrintHeader(const StatisticsData &data)
+	{
+		std::printf("frame,frame_ms,postprocessing_ms,draw_calls,draw_call_vertices");
+
+		for (unsigned int i = 0; i < data.TechniqueCount; ++i)
+		{
+			std::printf(",%s_ms", GetTechniqueName(data.Techniques[i]).c_str());
+		}
+
+		std::printf("\n");
+	}
+	void PrintRow(const StatisticsData &data)
+	{
+		std::printf("%llu,%.3f,%.3f,%u,%u", static_cast<unsigned long long>(data.FrameCount), data.FrameTime, data.PostProcessingTime, data.DrawCalls, data.DrawCallVertices);
+
+		// Shed or disabled techniques do not contribute to the frame, so they are left empty
+		for (unsigned int i = 0; i < data.TechniqueCount; ++i)
+		{
+			const StatisticsData::Technique &technique = data.Techniques[i];
+
+			if (technique.Enabled && !technique.Shed)
+			{
+				std::printf(",%.3f", technique.Cost);
+			}
+			else
+			{
+				std::printf(",");
+			}
+		}
+
+		std::printf("\n");
+		std::fflush(stdout);
+	}
+
+	int Follow(unsigned long id, unsigned int interval, const char *save)
+	{
+		const PageView view(id);
+		const volatile StatisticsData *const page = view.Get();
+
+		if (page == nullptr)
+		{
+			std::fprintf(stderr, "error: process %lu does not publish statistics\n", id);
+			return 1;
+		}
+
+		StatisticsData data;
+		int result = 0;
+
+		if (!CopyPage(page, data) || !IsValidPage(data))
+		{
+			std::fprintf(stderr, "error: statistics page of process %lu is not of version %u\n", id, StatisticsData::Version);
+			result = 1;
+		}
+		else if (save != nullptr)
+		{
+			FILE *const file = std::fopen(save, "wb");
+
+			if (file == nullptr || std::fwrite(&data, sizeof(data), 1, file) != 1)
+			{
+				std::fprintf(stderr, "error: cannot write '%s'\n", save);
+				result = 1;
+			}
+			if (file != nullptr)
+			{
+				std::fclose(file);
+			}
+		}
+		else
+		{
+			// The technique columns are fixed by the first frame, a reloaded effect with other techniques starts a new header
+			PrintHeader(data);
+
+			std::uint64_t lastFrame = data.FrameCount;
+			std::string lastTechniques;
+
+			for (unsigned int i = 0; i < data.TechniqueCount; ++i)
+			{
+				lastTechniques += GetTechniqueName(data.Techniques[i]) + ',';
+			}
+
+			// Runs until the game exits
+			while (view.IsProcessRunning())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+				if (!CopyPage(page, data) || data.FrameCount == lastFrame)
+				{
+					continue;
+				}
+
+				std::string techniques;
+
+				for (unsigned int i = 0; i < data.TechniqueCount; ++i)
+				{
+					techniques += GetTechniqueName(data.Techniques[i]) + ',';
+				}
+
+				if (techniques != lastTechniques)
+				{
+					PrintHeader(data);
+					lastTechniques = techniques;
+				}
+
+				PrintRow(data);
+				lastFrame = data.FrameCount;
+			}
+		}
+
+		return result;
+	}
+
+	bool IsNumber(const char *string)
+	{
+		return *string != '\0' && std::strspn(string, "0123456789") == std::strlen(string);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int interval = 1;
+	const char *save = nullptr, *source = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+		{
+			interval = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+		{
+			save = argv[++i];
+		}
+		else if (source == nullptr)
+		{
+			source = argv[i];
+		}
+		else
+		{
+			source = nullptr;
+			break;
+		}
+	}
+
+	if (source == nullptr)
+	{
+		std::fprintf(stderr, "usage: %s [--interval <ms>] [--save <page file>] <process id>\n       %s <page file>\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	if (IsNumber(source))
+	{
+		return Follow(std::strtoul(source, nullptr, 10), interval, save);
+	}
+
+	return ReadFile(source);
+}
\ No newline at end of file
@@ -0,0 +1,392 @@
+/*
+ * Compares the SSE2 block encoders used for compressed effect textures with the DXT encoder of stb, on generated 1024x1024 and 1023x517 images (the latter with partial blocks) or the given image files.
+ * Reports the PSNR of the decoded blocks and the time per block for BC1 and BC3 (RGBA), BC4 (red) and BC5 (red and green), all on a single thread.
+ * The BC4 and BC5 blocks of the SSE2 encoder are also decoded and checked against the error bound of the eight value mode, so the run fails if they do not round-trip.
+ * Build from the repository root with (the source of stb_dxt is included, so its alpha encoder can be measured on its own for BC4 and BC5):
+ *   g++ -std=c++11 -O2 -Isrc -Idep/stb/include -Idep/stb/src tools/TextureCompressionBenchmark.cpp src/BlockCompression.cpp dep/stb/src/stb_image.c -o rs-compression-bench
+ */
+
+#include "BlockCompression.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stb_image.h>
+#include <stb_dxt.c>
+
+using namespace ReShade;
+
+namespace
+{
+	struct Image
+	{
+		std::string Name;
+		unsigned int Width, Height;
+		std::vector<unsigned char> Data;
+	};
+
+	unsigned int sFailures = 0;
+
+	// Smooth lighting with texture noise, hard edged shapes in saturated colors and an alpha channel with soft and cut out parts, roughly what an effect texture looks like
+	Image GenerateImage(unsigned int width, unsigned int height)
+	{
+		Image image;
+		image.Name = std::to_string(width) + "x" + std::to_string(height) + " generated";
+		image.Width = width;
+		image.Height = height;
+		image.Data.resize(width * height * 4);
+
+		unsigned int seed = 1;
+
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				unsigned char *const pixel = image.Data.data() + (y * width + x) * 4;
+				seed = seed * 1103515245 + 12345;
+				const float noise = static_cast<float>((seed >> 16) & 15) - 8.0f;
+				const float light = 0.5f + 0.5f * std::sin(x * 0.011f) * std::cos(y * 0.007f);
+				const bool shape = ((x / 96) + (y / 80)) % 3 == 0 && (x % 96) > 16 && (y % 80) > 24;
+
+				const float r = shape ? 220.0f : 180.0f * light + 40.0f * x / width;
+				const float g = shape ? 40.0f + 0.1f * y : 140.0f * light + 60.0f * y / height;
+				const float b = shape ? 60.0f : 90.0f + 60.0f * light;
+				const float a = (x / 128 + y / 128) % 4 == 0 ? 0.0f : 255.0f * std::min(1.0f, 0.25f + static_cast<float>(x) / width + 0.5f * light);
+
+				pixel[0] = static_cast<unsigned char>(std::min(std::max(r + noise, 0.0f), 255.0f));
+				pixel[1] = static_cast<unsigned char>(std::min(std::max(g + noise, 0.0f), 255.0f));
+				pixel[2] = static_cast<unsigned char>(std::min(std::max(b + noise, 0.0f), 255.0f));
+				pixel[3] = static_cast<unsigned char>(a);
+			}
+		}
+
+		return image;
+	}
+
+	// All 4x4 blocks of the image with 'channels' interleaved channels starting at 'first', repeating the last row and column for partial blocks like 'CompressImage'
+	std::vector<unsigned char> GatherBlocks(const Image &image, unsigned int first, unsigned int channels)
+	{
+		const unsigned int blocksX = (image.Width + 3) / 4, blocksY = (image.Height + 3) / 4;
+		std::vector<unsigned char> blocks(blocksX * blocksY * 16 * channels);
+		unsigned char *output = blocks.data();
+
+		for (unsigned int by = 0; by < blocksY; ++by)
+		{
+			for (unsigned int bx = 0; bx < blocksX; ++bx)
+			{
+				for (unsigned int i = 0; i < 16; ++i)
+				{
+					const unsigned int x = std::min(bx * 4 + i % 4, image.Width - 1), y = std::min(by * 4 + i / 4, image.Height - 1);
+
+					for (unsigned int c = 0; c < channels; ++c)
+					{
+						*output++ = image.Data[(y * image.Width + x) * 4 + first + c];
+					}
+				}
+			}
+		}
+
+		return blocks;
+	}
+
+	// Scalar decoders following the D3D specification, with interpolated values rounded to nearest
+	void DecodeColorBlock(const unsigned char *block, bool allowThreeColors, unsigned char pixels[64])
+	{
+		const unsigned int packed[2] = { static_cast<unsigned int>(block[0] | (block[1] << 8)), static_cast<unsigned int>(block[2] | (block[3] << 8)) };
+		int palette[4][3];
+
+		for (unsigned int i = 0; i < 2; ++i)
+		{
+			const unsigned int r = (packed[i] >> 11) & 31, g = (packed[i] >> 5) & 63, b = packed[i] & 31;
+
+			palette[i][0] = (r << 3) | (r >> 2);
+			palette[i][1] = (g << 2) | (g >> 4);
+			palette[i][2] = (b << 3) | (b >> 2);
+		}
+
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			if (packed[0] > packed[1] || !allowThreeColors)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			const unsigned int index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				pixels[i * 4 + c] = static_cast<unsigned char>(palette[index][c]);
+			}
+		}
+	}
+	void DecodeBC4Block(const unsigned char *block, unsigned char *values, unsigned int stride)
+	{
+		const int first = block[0], second = block[1];
+		int palette[8] = { first, second };
+
+		for (int i = 1; i < 7 && first > second; ++i)
+		{
+			palette[i + 1] = ((7 - i) * first + i * second + 3) / 7;
+		}
+		for (int i = 1; i < 5 && first <= second; ++i)
+		{
+			palette[i + 1] = ((5 - i) * first + i * second + 2) / 5;
+		}
+
+		if (first <= second)
+		{
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		unsigned long long bits = 0;
+
+		for (unsigned int i = 0; i < 6; ++i)
+		{
+			bits |= static_cast<unsigned long long>(block[2 + i]) << (i * 8);
+		}
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			values[i * stride] = static_cast<unsigned char>(palette[(bits >> (i * 3)) & 7]);
+		}
+	}
+
+	// Decodes all blocks into pixels of four channels, the ones 'format' does not store are left untouched
+	void DecodeBlocks(const char *format, const std::vector<unsigned char> &compressed, std::vector<unsigned char> &decoded)
+	{
+		const std::size_t blockSize = format[2] == '1' || format[2] == '4' ? 8 : 16, count = compressed.size() / blockSize;
+
+		decoded.assign(count * 64, 0);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const unsigned char *const block = compressed.data() + i * blockSize;
+			unsigned char *const pixels = decoded.data() + i * 64;
+
+			switch (format[2])
+			{
+				case '1':
+					DecodeColorBlock(block, true, pixels);
+					break;
+				case '3':
+					DecodeBC4Block(block, pixels + 3, 4);
+					DecodeColorBlock(block + 8, false, pixels);
+					break;
+				case '4':
+					DecodeBC4Block(block, pixels, 4);
+					break;
+				case '5':
+					DecodeBC4Block(block, pixels, 4);
+					DecodeBC4Block(block + 8, pixels + 1, 4);
+					break;
+			}
+		}
+	}
+
+	// Compares the decoded channels to the image, leaving out the padding of partial blocks
+	double ComputePSNR(const Image &image, const std::vector<unsigned char> &decoded, unsigned int channels)
+	{
+		const unsigned int blocksX = (image.Width + 3) / 4;
+		double error = 0.0;
+
+		for (unsigned int y = 0; y < image.Height; ++y)
+		{
+			for (unsigned int x = 0; x < image.Width; ++x)
+			{
+				const unsigned char *const source = image.Data.data() + (y * image.Width + x) * 4;
+				const unsigned char *const pixel = decoded.data() + ((y / 4) * blocksX + x / 4) * 64 + ((y % 4) * 4 + x % 4) * 4;
+
+				for (unsigned int c = 0; c < channels; ++c)
+				{
+					error += (source[c] - pixel[c]) * (source[c] - pixel[c]);
+				}
+			}
+		}
+
+		const double mse = error / (static_cast<double>(image.Width) * image.Height * channels);
+
+		return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+	}
+
+	// Every value has to come back within half a palette step, with the minimum and maximum of the block exact
+	void CheckBC4Blocks(const Image &image, const char *format, const std::vector<unsigned char> &blocks, unsigned int channels, const std::vector<unsigned char> &decoded)
+	{
+		const std::size_t count = blocks.size() / (16 * channels);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			for (unsigned int c = 0; c < channels; ++c)
+			{
+				int low = 255, high = 0, worst = 0;
+
+				for (unsigned int p = 0; p < 16; ++p)
+				{
+					low = std::min<int>(low, blocks[(i * 16 + p) * channels + c]);
+					high = std::max<int>(high, blocks[(i * 16 + p) * channels + c]);
+				}
+				for (unsigned int p = 0; p < 16; ++p)
+				{
+					const int value = blocks[(i * 16 + p) * channels + c], result = decoded[(i * 16 + p) * 4 + c];
+
+					worst = std::max(worst, std::abs(value - result) * 14 - (high - low));
+
+					if ((value == low || value == high) && value != result)
+					{
+						worst = 255 * 14;
+					}
+				}
+
+				// Rounding of the palette entries adds up to half a value to the bound of range / 14
+				if (worst > 7)
+				{
+					std::printf("FAIL %s: %s block %zu channel %u does not round-trip\n", image.Name.c_str(), format, i, c);
+					sFailures++;
+					return;
+				}
+			}
+		}
+	}
+
+	template <typename F>
+	double Measure(F function, unsigned int runs)
+	{
+		double best = 1e30;
+
+		for (unsigned int run = 0; run < runs; ++run)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		return best;
+	}
+
+	void Report(const Image &image, const char *format, const char *encoder, double time, std::size_t count, const std::vector<unsigned char> &compressed, std::vector<unsigned char> &decoded, unsigned int channels)
+	{
+		DecodeBlocks(format, compressed, decoded);
+
+		std::printf("  %-4s %-16s %8.1f ns/block %7.2f dB\n", format, encoder, time * 1e6 / count, ComputePSNR(image, decoded, channels));
+	}
+
+	void Run(const Image &image, unsigned int runs)
+	{
+		const std::vector<unsigned char> rgba = GatherBlocks(image, 0, 4), red = GatherBlocks(image, 0, 1), redGreen = GatherBlocks(image, 0, 2);
+		const std::size_t count = red.size() / 16;
+		std::vector<unsigned char> compressed, decoded;
+
+		// The alpha encoder of stb reads the fourth byte of every pixel, so the single channel blocks are spread out for it first
+		std::vector<unsigned char> stbRed(count * 64), stbGreen(count * 64);
+
+		for (std::size_t i = 0; i < count * 16; ++i)
+		{
+			stbRed[i * 4 + 3] = redGreen[i * 2];
+			stbGreen[i * 4 + 3] = redGreen[i * 2 + 1];
+		}
+
+		stb__InitDXT();
+
+		std::printf("%s (%zu blocks, %u runs, best of each):\n", image.Name.c_str(), count, runs);
+
+		for (const char *format : { "BC1", "BC3" })
+		{
+			const bool alpha = format[2] == '3';
+			const std::size_t blockSize = alpha ? 16 : 8;
+			compressed.resize(count * blockSize);
+
+			double time = Measure([&]() { for (std::size_t i = 0; i < count; ++i) (alpha ? CompressBC3Block : CompressBC1Block)(rgba.data() + i * 64, compressed.data() + i * blockSize); }, runs);
+			Report(image, format, "SSE2", time, count, compressed, decoded, alpha ? 4 : 3);
+
+			for (int mode : { STB_DXT_NORMAL, STB_DXT_HIGHQUAL })
+			{
+				time = Measure([&]() { for (std::size_t i = 0; i < count; ++i) stb_compress_dxt_block(compressed.data() + i * blockSize, rgba.data() + i * 64, alpha, mode); }, runs);
+				Report(image, format, mode == STB_DXT_NORMAL ? "stb" : "stb high quality", time, count, compressed, decoded, alpha ? 4 : 3);
+			}
+		}
+
+		compressed.resize(count * 8);
+
+		double time = Measure([&]() { for (std::size_t i = 0; i < count; ++i) CompressBC4Block(red.data() + i * 16, compressed.data() + i * 8); }, runs);
+		Report(image, "BC4", "SSE2", time, count, compressed, decoded, 1);
+		CheckBC4Blocks(image, "BC4", red, 1, decoded);
+
+		time = Measure([&]() { for (std::size_t i = 0; i < count; ++i) stb__CompressAlphaBlock(compressed.data() + i * 8, stbRed.data() + i * 64, STB_DXT_NORMAL); }, runs);
+		Report(image, "BC4", "stb", time, count, compressed, decoded, 1);
+
+		compressed.resize(count * 16);
+
+		time = Measure([&]() { for (std::size_t i = 0; i < count; ++i) CompressBC5Block(redGreen.data() + i * 32, compressed.data() + i * 16); }, runs);
+		Report(image, "BC5", "SSE2", time, count, compressed, decoded, 2);
+		CheckBC4Blocks(image, "BC5", redGreen, 2, decoded);
+
+		time = Measure([&]() { for (std::size_t i = 0; i < count; ++i) { stb__CompressAlphaBlock(compressed.data() + i * 16, stbRed.data() + i * 64, STB_DXT_NORMAL); stb__CompressAlphaBlock(compressed.data() + i * 16 + 8, stbGreen.data() + i * 64, STB_DXT_NORMAL); } }, runs);
+		Report(image, "BC5", "stb", time, count, compressed, decoded, 2);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int runs = 5;
+	std::vector<Image> images;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+		{
+			runs = std::max(static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)), 1u);
+			continue;
+		}
+
+		int width = 0, height = 0, channels = 0;
+		unsigned char *const data = stbi_load(argv[i], &width, &height, &channels, 4);
+
+		if (data == nullptr)
+		{
+			std::fprintf(stderr, "error: cannot load '%s'\n", argv[i]);
+			return 2;
+		}
+
+		Image image;
+		image.Name = argv[i];
+		image.Width = width;
+		image.Height = height;
+		image.Data.assign(data, data + width * height * 4);
+		images.push_back(std::move(image));
+
+		stbi_image_free(data);
+	}
+
+	if (images.empty())
+	{
+		images.push_back(GenerateImage(1024, 1024));
+		images.push_back(GenerateImage(1023, 517));
+	}
+
+	for (const Image &image : images)
+	{
+		Run(image, runs);
+	}
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all BC4 and BC5 blocks round-tripped\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,355 @@
+/*
+ * Checks 'ConvertToRGBA8' and 'ConvertToRGBA32F' for every texel format against a plain scalar decoder, with row widths that exercise both the SIMD loops and their remainders.
+ * Also checks the half precision and 16-bit unorm encoders on all values that round-trip.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc tools/TextureConversionTest.cpp src/TextureConversion.cpp -o rs-conversion-test
+ */
+
+#include "TextureConversion.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+using namespace ReShade;
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const std::string &test, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::printf("FAIL %s: %s\n", test.c_str(), message.c_str());
+			sFailures++;
+		}
+	}
+
+	const struct
+	{
+		TexelFormat Format;
+		const char *Name;
+	} sFormats[] = {
+		{ TexelFormat::R8, "R8" },
+		{ TexelFormat::RG8, "RG8" },
+		{ TexelFormat::RGBA8, "RGBA8" },
+		{ TexelFormat::BGRA8, "BGRA8" },
+		{ TexelFormat::RGB10A2, "RGB10A2" },
+		{ TexelFormat::RG11B10F, "RG11B10F" },
+		{ TexelFormat::R16F, "R16F" },
+		{ TexelFormat::RG16F, "RG16F" },
+		{ TexelFormat::RGBA16, "RGBA16" },
+		{ TexelFormat::RGBA16F, "RGBA16F" },
+		{ TexelFormat::R32F, "R32F" },
+		{ TexelFormat::RGBA32F, "RGBA32F" },
+		{ TexelFormat::D24S8, "D24S8" }
+	};
+
+	// Small floats without sign bit, 'mantissa' bits of mantissa below a five bit exponent with the half precision bias
+	float DecodeSmallFloat(unsigned int bits, unsigned int mantissa)
+	{
+		const unsigned int exponent = bits >> mantissa, fraction = bits & ((1 << mantissa) - 1);
+
+		if (exponent == 31)
+		{
+			return fraction != 0 ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+		}
+		if (exponent == 0)
+		{
+			return std::ldexp(static_cast<float>(fraction), -14 - static_cast<int>(mantissa));
+		}
+
+		return std::ldexp(static_cast<float>((1 << mantissa) + fraction), static_cast<int>(exponent) - 15 - static_cast<int>(mantissa));
+	}
+	float DecodeHalf(std::uint16_t bits)
+	{
+		const float value = DecodeSmallFloat(bits & 0x7FFF, 10);
+
+		return (bits & 0x8000) != 0 ? -value : value;
+	}
+	template <typename T>
+	T Read(const unsigned char *texel, unsigned int index)
+	{
+		T value;
+		std::memcpy(&value, texel + index * sizeof(T), sizeof(T));
+
+		return value;
+	}
+
+	void DecodeTexel(TexelFormat format, const unsigned char *texel, float rgba[4])
+	{
+		rgba[2] = 0.0f;
+		rgba[3] = 1.0f;
+
+		switch (format)
+		{
+			case TexelFormat::R8:
+				rgba[0] = rgba[1] = rgba[2] = texel[0] / 255.0f;
+				break;
+			case TexelFormat::RG8:
+				rgba[0] = texel[0] / 255.0f;
+				rgba[1] = texel[1] / 255.0f;
+				break;
+			case TexelFormat::RGBA8:
+			case TexelFormat::BGRA8:
+				for (unsigned int i = 0; i < 4; ++i)
+				{
+					rgba[i] = texel[i] / 255.0f;
+				}
+				if (format == TexelFormat::BGRA8)
+				{
+					std::swap(rgba[0], rgba[2]);
+				}
+				break;
+			case TexelFormat::RGB10A2:
+			{
+				const std::uint32_t value = Read<std::uint32_t>(texel, 0);
+				rgba[0] = (value & 0x3FF) / 1023.0f;
+				rgba[1] = ((value >> 10) & 0x3FF) / 1023.0f;
+				rgba[2] = ((value >> 20) & 0x3FF) / 1023.0f;
+				rgba[3] = (value >> 30) / 3.0f;
+				break;
+			}
+			case TexelFormat::RG11B10F:
+			{
+				const std::uint32_t value = Read<std::uint32_t>(texel, 0);
+				rgba[0] = DecodeSmallFloat(value & 0x7FF, 6);
+				rgba[1] = DecodeSmallFloat((value >> 11) & 0x7FF, 6);
+				rgba[2] = DecodeSmallFloat(value >> 22, 5);
+				break;
+			}
+			case TexelFormat::R16F:
+				rgba[0] = rgba[1] = rgba[2] = DecodeHalf(Read<std::uint16_t>(texel, 0));
+				break;
+			case TexelFormat::RG16F:
+				rgba[0] = DecodeHalf(Read<std::uint16_t>(texel, 0));
+				rgba[1] = DecodeHalf(Read<std::uint16_t>(texel, 1));
+				break;
+			case TexelFormat::RGBA16:
+				for (unsigned int i = 0; i < 4; ++i)
+				{
+					rgba[i] = Read<std::uint16_t>(texel, i) / 65535.0f;
+				}
+				break;
+			case TexelFormat::RGBA16F:
+				for (unsigned int i = 0; i < 4; ++i)
+				{
+					rgba[i] = DecodeHalf(Read<std::uint16_t>(texel, i));
+				}
+				break;
+			case TexelFormat::R32F:
+				rgba[0] = rgba[1] = rgba[2] = Read<float>(texel, 0);
+				break;
+			case TexelFormat::RGBA32F:
+				for (unsigned int i = 0; i < 4; ++i)
+				{
+					rgba[i] = Read<float>(texel, i);
+				}
+				break;
+			case TexelFormat::D24S8:
+				rgba[0] = rgba[1] = rgba[2] = (Read<std::uint32_t>(texel, 0) & 0xFFFFFF) / 16777215.0f;
+				break;
+		}
+	}
+
+	// Multiplying with a reciprocal may be off by one unit in the last place compared to dividing
+	bool IsClose(float value, float expected)
+	{
+		if (std::isnan(expected))
+		{
+			return std::isnan(value);
+		}
+		if (std::isinf(expected))
+		{
+			return value == expected;
+		}
+
+		return std::fabs(value - expected) <= std::fabs(expected) * 2e-7f;
+	}
+	unsigned char ToUnorm8(float value)
+	{
+		// Also turns NaN into zero
+		return static_cast<unsigned char>((value > 0.0f ? std::fmin(value, 1.0f) : 0.0f) * 255.0f + 0.5f);
+	}
+
+	// Random bits with some special values mixed in, so float formats see zero, denormals, infinity and NaN
+	std::vector<unsigned char> GenerateTexels(TexelFormat format, unsigned int count, unsigned int &seed)
+	{
+		std::vector<unsigned char> texels(count * GetTexelSize(format));
+
+		for (unsigned char &byte : texels)
+		{
+			seed = seed * 1103515245 + 12345;
+			byte = static_cast<unsigned char>(seed >> 16);
+		}
+
+		const std::uint16_t halfs[] = { 0x0000, 0x8000, 0x0001, 0x03FF, 0x0400, 0x3C00, 0x7BFF, 0x7C00, 0xFC00, 0x7E00 };
+		const float floats[] = { 0.0f, -0.0f, 1e-40f, 0.5f, 1.0f, 65504.0f, std::numeric_limits<float>::infinity(), -1.0f, std::numeric_limits<float>::quiet_NaN() };
+
+		for (unsigned int i = 0; i < count; i += 3)
+		{
+			unsigned char *const texel = texels.data() + i * GetTexelSize(format);
+
+			if (format == TexelFormat::R16F || format == TexelFormat::RG16F || format == TexelFormat::RGBA16F)
+			{
+				std::memcpy(texel, &halfs[i / 3 % 10], 2);
+			}
+			else if (format == TexelFormat::R32F || format == TexelFormat::RGBA32F)
+			{
+				std::memcpy(texel, &floats[i / 3 % 9], 4);
+			}
+			else if (format == TexelFormat::RG11B10F)
+			{
+				// Zero, denormals, the largest finite values, infinity and NaN spread over the three channels
+				const std::uint32_t specials[] = { 0x00000001, 0x0FFF03FF, 0xF7DEFBDF, 0xF801F7C0, 0x00000000 };
+				std::memcpy(texel, &specials[i / 3 % 5], 4);
+			}
+		}
+
+		return texels;
+	}
+
+	void TestFormat(TexelFormat format, const char *name)
+	{
+		unsigned int seed = 1;
+
+		// Remainders of every SIMD loop and more than one block of the float path
+		for (unsigned int width : { 1u, 2u, 3u, 5u, 7u, 8u, 15u, 16u, 17u, 33u, 257u, 300u })
+		{
+			const std::string test = std::string(name) + " width " + std::to_string(width);
+			const unsigned int height = 3;
+			const std::size_t texelSize = GetTexelSize(format), sourcePitch = width * texelSize + 5;
+
+			const std::vector<unsigned char> source = GenerateTexels(format, static_cast<unsigned int>(sourcePitch * height / texelSize + 1), seed);
+
+			// Padding between rows has to stay untouched
+			const std::size_t pitch8 = width * 4 + 12, pitch32 = width * 16 + 32;
+			std::vector<unsigned char> rgba8(pitch8 * height, 0xCD);
+			std::vector<float> rgba32f(pitch32 * height / 4, -123.0f);
+
+			ConvertToRGBA8(format, source.data(), sourcePitch, width, height, rgba8.data(), pitch8);
+			ConvertToRGBA32F(format, source.data(), sourcePitch, width, height, rgba32f.data(), pitch32);
+
+			unsigned int wrong8 = 0, wrong32f = 0, overwritten = 0;
+
+			for (unsigned int y = 0; y < height; ++y)
+			{
+				for (unsigned int x = 0; x < width; ++x)
+				{
+					float expected[4];
+					DecodeTexel(format, source.data() + y * sourcePitch + x * texelSize, expected);
+
+					const unsigned char *const texel8 = rgba8.data() + y * pitch8 + x * 4;
+					const float *const texel32f = rgba32f.data() + y * pitch32 / 4 + x * 4;
+
+					for (unsigned int c = 0; c < 4; ++c)
+					{
+						wrong8 += texel8[c] != ToUnorm8(expected[c]);
+						wrong32f += !IsClose(texel32f[c], expected[c]);
+
+						if (wrong32f == 1 && !IsClose(texel32f[c], expected[c]))
+						{
+							std::printf("  %s: pixel %u,%u channel %u is %.9g, expected %.9g\n", test.c_str(), x, y, c, texel32f[c], expected[c]);
+						}
+					}
+				}
+
+				for (std::size_t i = width * 4; i < pitch8; ++i)
+				{
+					overwritten += rgba8[y * pitch8 + i] != 0xCD;
+				}
+				for (std::size_t i = width * 4; i < pitch32 / 4; ++i)
+				{
+					overwritten += rgba32f[y * pitch32 / 4 + i] != -123.0f;
+				}
+			}
+
+			Check(wrong8 == 0, test, std::to_string(wrong8) + " channels converted to 8-bit differ from the reference");
+			Check(wrong32f == 0, test, std::to_string(wrong32f) + " channels converted to float differ from the reference");
+			Check(overwritten == 0, test, "conversion wrote into the padding between rows");
+		}
+	}
+
+	void TestEncoders()
+	{
+		// Every half precision value other than NaN has to come back unchanged
+		std::vector<float> values;
+		std::vector<std::uint16_t> expected;
+
+		for (unsigned int bits = 0; bits < 0x10000; ++bits)
+		{
+			if ((bits & 0x7C00) != 0x7C00 || (bits & 0x3FF) == 0)
+			{
+				values.push_back(DecodeHalf(static_cast<std::uint16_t>(bits)));
+				expected.push_back(static_cast<std::uint16_t>(bits));
+			}
+		}
+
+		// Ties between two halfs round to the even one, in the normal and the denormal range
+		const float ties[] = { 1.0f + std::ldexp(1.0f, -11), 1.0f + 3 * std::ldexp(1.0f, -11), std::ldexp(1.0f, -25), 3 * std::ldexp(1.0f, -25), 65520.0f, 1e-10f };
+		const std::uint16_t tiesExpected[] = { 0x3C00, 0x3C02, 0x0000, 0x0002, 0x7C00, 0x0000 };
+		values.insert(values.end(), ties, ties + 6);
+		expected.insert(expected.end(), tiesExpected, tiesExpected + 6);
+
+		std::vector<std::uint16_t> halfs(values.size());
+		ConvertFloatToHalf(values.data(), halfs.data(), values.size());
+
+		unsigned int wrong = 0;
+
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			if (halfs[i] != expected[i] && wrong++ == 0)
+			{
+				std::printf("  half of %.9g is 0x%04x, expected 0x%04x\n", values[i], halfs[i], expected[i]);
+			}
+		}
+
+		Check(wrong == 0, "ConvertFloatToHalf", std::to_string(wrong) + " values did not round-trip");
+
+		values.clear();
+
+		for (unsigned int i = 0; i < 0x10000; ++i)
+		{
+			values.push_back(i / 65535.0f);
+		}
+
+		values.push_back(-1.0f);
+		values.push_back(2.0f);
+
+		std::vector<std::uint16_t> unorms(values.size());
+		ConvertFloatToUnorm16(values.data(), unorms.data(), values.size());
+
+		wrong = 0;
+
+		for (std::size_t i = 0; i < 0x10000; ++i)
+		{
+			wrong += unorms[i] != i;
+		}
+
+		Check(wrong == 0 && unorms[0x10000] == 0 && unorms[0x10001] == 0xFFFF, "ConvertFloatToUnorm16", std::to_string(wrong) + " values did not round-trip or out of range values were not clamped");
+	}
+}
+
+int main()
+{
+	for (const auto &format : sFormats)
+	{
+		TestFormat(format.Format, format.Name);
+	}
+
+	TestEncoders();
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all texture conversion checks passed\n");
+	return 0;
+}
\ No newline at end of file
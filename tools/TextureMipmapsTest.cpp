@@ -0,0 +1,183 @@
+/*
+ * Checks 'GenerateMipmaps' against a scalar box filter in double precision, which weights every source texel by the area of it a destination texel covers.
+ * Runs odd and non-power-of-two sizes (so the taps cover parts of up to three texels), single row and column images and one to four channels (four in linear space).
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc tools/TextureMipmapsTest.cpp src/TextureMipmaps.cpp -o rs-mipmaps-test
+ */
+
+#include "TextureMipmaps.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace ReShade;
+
+namespace
+{
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const char *test, const std::string &message)
+	{
+		if (!condition)
+		{
+			std::printf("FAIL %s: %s\n", test, message.c_str());
+			sFailures++;
+		}
+	}
+
+	double ToLinear(unsigned char value)
+	{
+		const double x = value / 255.0;
+
+		return x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+	}
+	double ToGamma(double value)
+	{
+		return value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+	}
+
+	// Gradients with noise on top, so neighbouring texels differ and a wrong weight shows up
+	std::vector<unsigned char> GenerateImage(unsigned int width, unsigned int height, unsigned int channels)
+	{
+		std::vector<unsigned char> image(width * height * channels);
+		unsigned int seed = width * 31 + height;
+
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				for (unsigned int c = 0; c < channels; ++c)
+				{
+					seed = seed * 1103515245 + 12345;
+					const int noise = static_cast<int>((seed >> 16) & 63) - 32;
+
+					image[(y * width + x) * channels + c] = static_cast<unsigned char>(std::min(std::max(static_cast<int>((x * 7 + y * 3 + c * 50) % 256) + noise, 0), 255));
+				}
+			}
+		}
+
+		return image;
+	}
+
+	// Every destination texel averages the source area it covers, partial source texels count by their overlap
+	std::vector<double> Downsample(const std::vector<double> &source, unsigned int width, unsigned int height, unsigned int channels, unsigned int targetWidth, unsigned int targetHeight)
+	{
+		std::vector<double> destination(targetWidth * targetHeight * channels, 0.0);
+		const double scaleX = static_cast<double>(width) / targetWidth, scaleY = static_cast<double>(height) / targetHeight;
+
+		for (unsigned int ty = 0; ty < targetHeight; ++ty)
+		{
+			for (unsigned int tx = 0; tx < targetWidth; ++tx)
+			{
+				for (unsigned int y = 0; y < height; ++y)
+				{
+					for (unsigned int x = 0; x < width; ++x)
+					{
+						const double overlapX = std::min((tx + 1) * scaleX, x + 1.0) - std::max(tx * scaleX, static_cast<double>(x));
+						const double overlapY = std::min((ty + 1) * scaleY, y + 1.0) - std::max(ty * scaleY, static_cast<double>(y));
+
+						if (overlapX <= 0.0 || overlapY <= 0.0)
+						{
+							continue;
+						}
+
+						for (unsigned int c = 0; c < channels; ++c)
+						{
+							destination[(ty * targetWidth + tx) * channels + c] += source[(y * width + x) * channels + c] * overlapX * overlapY / (scaleX * scaleY);
+						}
+					}
+				}
+			}
+		}
+
+		return destination;
+	}
+
+	void Test(unsigned int width, unsigned int height, unsigned int channels)
+	{
+		const std::string test = std::to_string(width) + "x" + std::to_string(height) + " with " + std::to_string(channels) + " channels";
+		const bool gamma = channels == 4;
+		const std::vector<unsigned char> image = GenerateImage(width, height, channels);
+		const std::vector<std::vector<unsigned char>> levels = GenerateMipmaps(image.data(), width, height, channels, 100);
+
+		Check(levels.size() + 1 == GetMipmapCount(width, height), test.c_str(), std::to_string(levels.size()) + " levels were generated, expected " + std::to_string(GetMipmapCount(width, height) - 1));
+
+		std::vector<double> current(image.size());
+
+		for (std::size_t i = 0; i < image.size(); ++i)
+		{
+			current[i] = gamma && (i % 4) != 3 ? ToLinear(image[i]) : image[i] / 255.0;
+		}
+
+		for (std::size_t level = 0; level < levels.size(); ++level)
+		{
+			const unsigned int targetWidth = std::max(width >> 1, 1u), targetHeight = std::max(height >> 1, 1u);
+			const std::vector<double> next = Downsample(current, width, height, channels, targetWidth, targetHeight);
+			const std::vector<unsigned char> &output = levels[level];
+
+			if (output.size() != next.size())
+			{
+				Check(false, test.c_str(), "level " + std::to_string(level + 1) + " has " + std::to_string(output.size()) + " values, expected " + std::to_string(next.size()));
+				return;
+			}
+
+			// The gamma table and single precision can round the other way, but over more than a few texels the error must not be biased
+			int worst = 0;
+			double bias = 0.0;
+			std::size_t worstIndex = 0;
+
+			for (std::size_t i = 0; i < next.size(); ++i)
+			{
+				const double value = std::min(std::max(next[i], 0.0), 1.0);
+				const int expected = static_cast<int>((gamma && (i % 4) != 3 ? ToGamma(value) : value) * 255.0 + 0.5), error = output[i] - expected;
+
+				bias += error;
+
+				if (std::abs(error) > worst)
+				{
+					worst = std::abs(error);
+					worstIndex = i;
+				}
+			}
+
+			Check(worst <= 1, test.c_str(), "level " + std::to_string(level + 1) + " texel " + std::to_string(worstIndex / channels) + " channel " + std::to_string(worstIndex % channels) + " is off by " + std::to_string(worst));
+			Check(next.size() < 64 || std::fabs(bias / next.size()) < 0.1, test.c_str(), "level " + std::to_string(level + 1) + " is off by " + std::to_string(bias / next.size()) + " on average");
+
+			current = next;
+			width = targetWidth;
+			height = targetHeight;
+		}
+	}
+}
+
+int main()
+{
+	const unsigned int sizes[][2] = { { 64, 64 }, { 7, 5 }, { 33, 17 }, { 100, 37 }, { 13, 1 }, { 1, 9 }, { 3, 3 }, { 1, 1 } };
+
+	for (const auto &size : sizes)
+	{
+		for (unsigned int channels = 1; channels <= 4; ++channels)
+		{
+			Test(size[0], size[1], channels);
+		}
+	}
+
+	// Fewer levels than the full chain and invalid input
+	const std::vector<unsigned char> image = GenerateImage(16, 16, 4);
+
+	Check(GenerateMipmaps(image.data(), 16, 16, 4, 3).size() == 2, "levels", "a limited chain does not stop at the requested level");
+	Check(GenerateMipmaps(image.data(), 16, 16, 5, 5).empty() && GenerateMipmaps(nullptr, 16, 16, 4, 5).empty(), "levels", "invalid input generated levels");
+
+	if (sFailures != 0)
+	{
+		std::printf("%u checks failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all mipmap checks passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,336 @@
+/*
+ * Checks the effect texture memory planner against hand built effect trees (aliasing rules and byte accounting).
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -fpermissive -w -Isrc tools/TexturePlanTest.cpp src/EffectAnalysis.cpp -o rs-texture-plan-test
+ */
+
+#include "EffectAnalysis.hpp"
+
+#include <new>
+#include <cstdio>
+
+using namespace ReShade;
+
+namespace
+{
+	typedef EffectTree::Index Index;
+
+	unsigned int sFailures = 0;
+
+	void Check(bool condition, const char *test, const char *message)
+	{
+		if (!condition)
+		{
+			std::fprintf(stderr, "FAIL %s: %s\n", test, message);
+			sFailures++;
+		}
+	}
+
+	// Builds just enough of an effect tree for the analysis: textures, samplers, pixel shaders sampling at most one texture and techniques of passes
+	class Effect
+	{
+	public:
+		Effect() : mLast(this->mAST.Add<EffectNodes::Root>().Index)
+		{
+		}
+
+		Index Texture(unsigned int width, unsigned int height, unsigned int format = EffectNodes::Literal::RGBA8, unsigned int levels = 1, bool annotated = false)
+		{
+			const Index width_ = Uint(width), height_ = Uint(height), format_ = Uint(format), levels_ = Uint(levels);
+			const Index annotation = annotated ? Annotation("source", Uint(0)) : EffectTree::Null;
+			EffectNodes::Variable &texture = this->mAST.Add<EffectNodes::Variable>();
+			texture.Type.Class = EffectNodes::Type::Texture;
+			texture.Name = "texture";
+			texture.Properties[EffectNodes::Variable::Width] = width_;
+			texture.Properties[EffectNodes::Variable::Height] = height_;
+			texture.Properties[EffectNodes::Variable::Format] = format_;
+			texture.Properties[EffectNodes::Variable::MipLevels] = levels_;
+			texture.Annotations = annotation;
+
+			return Declare(texture.Index);
+		}
+		Index Fill()
+		{
+			// float4 PS() : SV_TARGET, the body does not matter to the analysis
+			EffectNodes::Function &function = this->mAST.Add<EffectNodes::Function>();
+			function.ReturnType.Class = EffectNodes::Type::Float;
+			function.ReturnType.Rows = 4, function.ReturnType.Cols = 1;
+			function.Name = "PS";
+			function.ReturnSemantic = "SV_TARGET";
+
+			return Declare(function.Index);
+		}
+		Index Sample(Index texture)
+		{
+			// float4 PS(float2 texcoord : TEXCOORD) : SV_TARGET { return tex2D(sampler, texcoord); }
+			EffectNodes::Variable &sampler = this->mAST.Add<EffectNodes::Variable>();
+			sampler.Type.Class = EffectNodes::Type::Sampler;
+			sampler.Name = "sampler";
+			sampler.Properties[EffectNodes::Variable::Texture] = texture;
+			const Index samplerIndex = Declare(sampler.Index);
+
+			EffectNodes::Variable &texcoord = this->mAST.Add<EffectNodes::Variable>();
+			texcoord.Type.Class = EffectNodes::Type::Float;
+			texcoord.Type.Rows = 2, texcoord.Type.Cols = 1;
+			texcoord.Type.Qualifiers = EffectNodes::Type::Qualifier::In;
+			texcoord.Name = "texcoord";
+			texcoord.Semantic = "TEXCOORD";
+			const Index texcoordIndex = texcoord.Index;
+
+			const Index samplerReference = Reference(samplerIndex), texcoordReference = Reference(texcoordIndex);
+			EffectNodes::Expression &tex = this->mAST.Add<EffectNodes::Expression>();
+			tex.Type.Class = EffectNodes::Type::Float;
+			tex.Type.Rows = 4, tex.Type.Cols = 1;
+			tex.Operator = EffectNodes::Expression::Tex;
+			tex.Operands[0] = samplerReference;
+			tex.Operands[1] = texcoordReference;
+			const Index texIndex = tex.Index;
+
+			EffectNodes::Return &statement = this->mAST.Add<EffectNodes::Return>();
+			statement.Value = texIndex;
+			const Index statementIndex = statement.Index;
+
+			EffectNodes::Function &function = this->mAST.Add<EffectNodes::Function>();
+			function.ReturnType.Class = EffectNodes::Type::Float;
+			function.ReturnType.Rows = 4, function.ReturnType.Cols = 1;
+			function.Name = "PS";
+			function.Parameters = texcoordIndex;
+			function.ParameterCount = 1;
+			function.ReturnSemantic = "SV_TARGET";
+			function.Definition = statementIndex;
+
+			return Declare(function.Index);
+		}
+		Index Pass(Index shader, Index target, unsigned int interval = 1)
+		{
+			const Index annotation = interval != 1 ? Annotation("interval", Uint(interval)) : EffectTree::Null;
+			EffectNodes::Pass &pass = this->mAST.Add<EffectNodes::Pass>();
+			pass.Name = "pass";
+			pass.Annotations = annotation;
+			pass.States[EffectNodes::Pass::PixelShader] = shader;
+			pass.States[EffectNodes::Pass::RenderTarget0] = target;
+
+			return pass.Index;
+		}
+		void Technique(std::initializer_list<Index> passes)
+		{
+			for (auto it = passes.begin(); it + 1 < passes.end(); ++it)
+			{
+				this->mAST[*it].As<EffectNodes::Pass>().NextPass = *(it + 1);
+			}
+
+			EffectNodes::Technique &technique = this->mAST.Add<EffectNodes::Technique>();
+			technique.Name = "technique";
+			technique.Passes = *passes.begin();
+
+			Declare(technique.Index);
+		}
+
+		EffectTexturePlan Plan()
+		{
+			return PlanTextureMemory(this->mAST);
+		}
+		std::size_t Size(Index texture) const
+		{
+			return GetTextureSize(this->mAST, this->mAST[texture].As<EffectNodes::Variable>());
+		}
+
+	private:
+		Index Uint(unsigned int value)
+		{
+			EffectNodes::Literal &literal = this->mAST.Add<EffectNodes::Literal>();
+			literal.Type.Class = EffectNodes::Type::Uint;
+			literal.Type.Rows = literal.Type.Cols = 1;
+			literal.Value.Uint[0] = value;
+
+			return literal.Index;
+		}
+		Index Reference(Index variable)
+		{
+			const EffectNodes::Type type = this->mAST[variable].As<EffectNodes::Variable>().Type;
+			EffectNodes::LValue &reference = this->mAST.Add<EffectNodes::LValue>();
+			reference.Type = type;
+			reference.Reference = variable;
+
+			return reference.Index;
+		}
+		Index Annotation(const char *name, Index value)
+		{
+			EffectNodes::Annotation &annotation = this->mAST.Add<EffectNodes::Annotation>();
+			annotation.Name = name;
+			annotation.Value = value;
+
+			return annotation.Index;
+		}
+		Index Declare(Index index)
+		{
+			this->mAST[this->mLast].As<EffectNodes::Root>().NextDeclaration = index;
+
+			return this->mLast = index;
+		}
+
+		EffectTree mAST;
+		Index mLast;
+	};
+
+	void TestDisjointTechniques()
+	{
+		// Blur scratch buffers of two techniques that never run at the same time
+		Effect effect;
+		const Index a = effect.Texture(512, 512), b = effect.Texture(512, 512);
+		const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b);
+		effect.Technique({ effect.Pass(fill, a), effect.Pass(sampleA, EffectTree::Null) });
+		effect.Technique({ effect.Pass(fill, b), effect.Pass(sampleB, EffectTree::Null) });
+
+		const EffectTexturePlan plan = effect.Plan();
+
+		Check(plan.Aliases.size() == 1 && plan.Aliases.count(b) != 0 && plan.Aliases.at(b) == a, "disjoint techniques", "second texture does not alias the first");
+		Check(plan.TotalBytes == effect.Size(a) + effect.Size(b), "disjoint techniques", "total does not cover both textures");
+		Check(plan.SavedBytes == effect.Size(b), "disjoint techniques", "saved bytes are not the size of the alias");
+	}
+	void TestOverlappingLifetimes()
+	{
+		// Both textures are alive during the second and third pass
+		Effect effect;
+		const Index a = effect.Texture(256, 256), b = effect.Texture(256, 256);
+		const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b);
+		effect.Technique({ effect.Pass(fill, a), effect.Pass(fill, b), effect.Pass(sampleA, EffectTree::Null), effect.Pass(sampleB, EffectTree::Null) });
+
+		const EffectTexturePlan plan = effect.Plan();
+
+		Check(plan.Aliases.empty() && plan.SavedBytes == 0, "overlapping lifetimes", "textures alive at the same time were aliased");
+	}
+	void TestSequentialReuse()
+	{
+		// Three scratch buffers inside one technique whose lifetimes follow each other, so the later two fold into the first
+		Effect effect;
+		const Index a = effect.Texture(128, 128), b = effect.Texture(128, 128), c = effect.Texture(128, 128);
+		const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b), sampleC = effect.Sample(c);
+		effect.Technique({ effect.Pass(fill, a), effect.Pass(sampleA, EffectTree::Null), effect.Pass(fill, b), effect.Pass(sampleB, EffectTree::Null), effect.Pass(fill, c), effect.Pass(sampleC, EffectTree::Null) });
+
+		const EffectTexturePlan plan = effect.Plan();
+
+		Check(plan.Aliases.size() == 2 && plan.Aliases.count(b) != 0 && plan.Aliases.count(c) != 0 && plan.Aliases.at(b) == a && plan.Aliases.at(c) == a, "sequential reuse", "scratch buffers were not folded into the first one");
+		Check(plan.SavedBytes == effect.Size(b) + effect.Size(c), "sequential reuse", "saved bytes do not match the two aliases");
+	}
+	void TestIncompatibleDescriptions()
+	{
+		// Same lifetime pattern as the disjoint case, but size, format or mip count differ
+		const unsigned int variants[][4] = {
+			{ 512, 256, EffectNodes::Literal::RGBA8, 1 },
+			{ 512, 512, EffectNodes::Literal::RGBA16F, 1 },
+			{ 512, 512, EffectNodes::Literal::RGBA8, 0 },
+		};
+
+		for (const auto &variant : variants)
+		{
+			Effect effect;
+			const Index a = effect.Texture(512, 512), b = effect.Texture(variant[0], variant[1], variant[2], variant[3]);
+			const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b);
+			effect.Technique({ effect.Pass(fill, a), effect.Pass(sampleA, EffectTree::Null) });
+			effect.Technique({ effect.Pass(fill, b), effect.Pass(sampleB, EffectTree::Null) });
+
+			Check(effect.Plan().Aliases.empty(), "incompatible descriptions", "textures with different descriptions were aliased");
+		}
+	}
+	void TestPinnedTextures()
+	{
+		// Annotated textures are filled from outside the effect
+		{
+			Effect effect;
+			const Index a = effect.Texture(64, 64), b = effect.Texture(64, 64, EffectNodes::Literal::RGBA8, 1, true);
+			const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b);
+			effect.Technique({ effect.Pass(fill, a), effect.Pass(sampleA, EffectTree::Null) });
+			effect.Technique({ effect.Pass(fill, b), effect.Pass(sampleB, EffectTree::Null) });
+
+			Check(effect.Plan().Aliases.empty(), "pinned textures", "annotated texture was aliased");
+		}
+		// Read before it is written, so it carries contents over from the previous frame
+		{
+			Effect effect;
+			const Index a = effect.Texture(64, 64), b = effect.Texture(64, 64);
+			const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b);
+			effect.Technique({ effect.Pass(fill, a), effect.Pass(sampleA, EffectTree::Null) });
+			effect.Technique({ effect.Pass(sampleB, b), effect.Pass(sampleB, EffectTree::Null) });
+
+			Check(effect.Plan().Aliases.empty(), "pinned textures", "texture read before its first write was aliased");
+		}
+		// Written by a pass that skips frames
+		{
+			Effect effect;
+			const Index a = effect.Texture(64, 64), b = effect.Texture(64, 64);
+			const Index fill = effect.Fill(), sampleA = effect.Sample(a), sampleB = effect.Sample(b);
+			effect.Technique({ effect.Pass(fill, a, 4), effect.Pass(sampleA, EffectTree::Null) });
+			effect.Technique({ effect.Pass(fill, b), effect.Pass(sampleB, EffectTree::Null) });
+
+			Check(effect.Plan().Aliases.empty(), "pinned textures", "texture written every few frames was aliased");
+		}
+	}
+	void TestByteAccounting()
+	{
+		// Sizes include the whole mip chain and round block compressed formats up to full blocks
+		Effect effect;
+		const Index full = effect.Texture(256, 128, EffectNodes::Literal::RGBA8, 0), block = effect.Texture(10, 6, EffectNodes::Literal::DXT1), unused = effect.Texture(32, 32, EffectNodes::Literal::RGBA32F);
+
+		Check(effect.Size(full) == (256 * 128 + 128 * 64 + 64 * 32 + 32 * 16 + 16 * 8 + 8 * 4 + 4 * 2 + 2 * 1 + 1 * 1) * 4, "byte accounting", "full mip chain size is wrong");
+		Check(effect.Size(block) == 3 * 2 * 8, "byte accounting", "block compressed size is not rounded to full blocks");
+
+		const EffectTexturePlan plan = effect.Plan();
+
+		// Textures that no technique touches still count towards the total but are never shared
+		Check(plan.TotalBytes == effect.Size(full) + effect.Size(block) + effect.Size(unused), "byte accounting", "total does not cover every texture");
+		Check(plan.Aliases.empty() && plan.SavedBytes == 0, "byte accounting", "unused textures were aliased");
+	}
+	void TestSavingsStayWithinTotal()
+	{
+		// Many techniques with one scratch buffer each all collapse into a single allocation
+		Effect effect;
+		Index textures[8], samplers[8];
+
+		for (unsigned int i = 0; i < 8; ++i)
+		{
+			textures[i] = effect.Texture(1920, 1080, EffectNodes::Literal::RGBA16F);
+		}
+
+		const Index fill = effect.Fill();
+
+		for (unsigned int i = 0; i < 8; ++i)
+		{
+			samplers[i] = effect.Sample(textures[i]);
+		}
+		for (unsigned int i = 0; i < 8; ++i)
+		{
+			effect.Technique({ effect.Pass(fill, textures[i]), effect.Pass(samplers[i], EffectTree::Null) });
+		}
+
+		const EffectTexturePlan plan = effect.Plan();
+
+		Check(plan.Aliases.size() == 7 && plan.SavedBytes == 7 * effect.Size(textures[0]), "savings within total", "scratch buffers of separate techniques did not share one allocation");
+		Check(plan.SavedBytes < plan.TotalBytes && plan.TotalBytes - plan.SavedBytes == effect.Size(textures[0]), "savings within total", "remaining bytes are not a single allocation");
+
+		for (const auto &alias : plan.Aliases)
+		{
+			Check(alias.second == textures[0] && plan.Aliases.count(alias.second) == 0, "savings within total", "alias does not point at the first declared owner");
+		}
+	}
+}
+
+int main()
+{
+	TestDisjointTechniques();
+	TestOverlappingLifetimes();
+	TestSequentialReuse();
+	TestIncompatibleDescriptions();
+	TestPinnedTextures();
+	TestByteAccounting();
+	TestSavingsStayWithinTotal();
+
+	if (sFailures != 0)
+	{
+		std::fprintf(stderr, "%u check(s) failed\n", sFailures);
+		return 1;
+	}
+
+	std::printf("all texture plan checks passed\n");
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+/*
+ * Measures what tile deduplication ('#pragma reshade dumptiles') saves on a simulated frame trace: a render target snapshotted after every draw, where each draw only covers part of it.
+ * The same trace is written as whole images (fast PNG and QOI) and as tiles, then the tiled bundle is read back and compared to the snapshots.
+ * Build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc tools/TileDedupeBenchmark.cpp src/TraceBundle.cpp src/ImageEncoder.cpp -pthread -o rs-tile-bench
+ */
+
+#include "TraceBundle.hpp"
+#include "ImageEncoder.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+using namespace ReShade;
+
+namespace
+{
+	// Replays the same sequence of draws for every bundle, so the snapshots do not have to be kept in memory
+	class Scene
+	{
+	public:
+		Scene(unsigned int width, unsigned int height) : mWidth(width), mHeight(height), mSeed(1), mPixels(width * height * 4)
+		{
+			for (std::size_t i = 0; i < mPixels.size(); i += 4)
+			{
+				mPixels[i + 0] = 20, mPixels[i + 1] = 24, mPixels[i + 2] = 32, mPixels[i + 3] = 255;
+			}
+		}
+
+		const unsigned char *GetPixels() const
+		{
+			return mPixels.data();
+		}
+
+		// Fills a random rectangle of 32 to 320 pixels with a shaded and slightly noisy gradient, like a small mesh
+		void Draw()
+		{
+			const unsigned int width = 32 + Random() % 289, height = 32 + Random() % 289;
+			const unsigned int left = Random() % (mWidth - width), top = Random() % (mHeight - height);
+			const unsigned int color = Random();
+
+			for (unsigned int y = top; y < top + height; ++y)
+			{
+				for (unsigned int x = left; x < left + width; ++x)
+				{
+					unsigned char *const pixel = mPixels.data() + (y * mWidth + x) * 4;
+					const unsigned int shade = 128 + (x - left) * 96 / width + (Random() & 3);
+
+					pixel[0] = static_cast<unsigned char>(((color & 0xFF) * shade) >> 8);
+					pixel[1] = static_cast<unsigned char>((((color >> 8) & 0xFF) * shade) >> 8);
+					pixel[2] = static_cast<unsigned char>((((color >> 16) & 0xFF) * (shade - (y - top) * 64 / height)) >> 8);
+				}
+			}
+		}
+
+	private:
+		unsigned int Random()
+		{
+			mSeed = mSeed * 1103515245 + 12345;
+			return mSeed >> 8;
+		}
+
+		unsigned int mWidth, mHeight, mSeed;
+		std::vector<unsigned char> mPixels;
+	};
+
+	struct Result
+	{
+		double Milliseconds;
+		std::size_t Bytes;
+	};
+
+	Result WriteBundle(const std::string &path, unsigned int width, unsigned int height, unsigned int draws, ImageFormat format, bool tiled)
+	{
+		Scene scene(width, height);
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		{
+			TraceBundleWriter writer(path, tiled);
+			std::vector<unsigned char> encoded;
+
+			for (unsigned int draw = 0; draw < draws; ++draw)
+			{
+				scene.Draw();
+
+				TraceBundle::Record record = { };
+				record.Type = TraceBundle::RecordType::Image;
+				record.Format = static_cast<std::uint32_t>(format);
+				record.Draw = draw;
+				record.Width = width;
+				record.Height = height;
+
+				const std::string name = "Draw_" + std::to_string(draw);
+
+				if (tiled)
+				{
+					writer.AddTiled(record, name, scene.GetPixels(), width, height);
+					continue;
+				}
+
+				encoded.clear();
+
+				if (format == ImageFormat::QOI)
+				{
+					EncodeQOI(scene.GetPixels(), width, height, encoded);
+				}
+				else
+				{
+					EncodeFastPNG(scene.GetPixels(), width, height, encoded);
+				}
+
+				writer.Add(record, name, encoded.data(), encoded.size());
+			}
+		}
+
+		Result result;
+		result.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		result.Bytes = static_cast<std::size_t>(file.tellg());
+
+		return result;
+	}
+
+	bool VerifyTiledBundle(const std::string &path, unsigned int width, unsigned int height, unsigned int draws)
+	{
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const TraceBundleReader reader(data.data(), data.size());
+
+		if (!reader.IsValid() || !reader.IsComplete())
+		{
+			std::printf("FAIL tiled bundle cannot be read back\n");
+			return false;
+		}
+
+		Scene scene(width, height);
+		std::vector<unsigned char> decoded;
+
+		for (unsigned int draw = 0; draw < draws; ++draw)
+		{
+			scene.Draw();
+
+			const TraceBundleReader::Entry *const entry = reader.FindImage(0, draw, 0);
+
+			if (entry == nullptr || !reader.DecodeTiledImage(*entry, decoded) || decoded.size() != width * height * 4 || std::memcmp(decoded.data(), scene.GetPixels(), decoded.size()) != 0)
+			{
+				std::printf("FAIL snapshot after draw %u does not decode from its tiles\n", draw);
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned int width = 1280, height = 720;
+	const unsigned int draws = argc > 1 ? std::max(static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10)), 1u) : 200;
+	const std::string directory = argc > 2 ? argv[2] : ".";
+
+	const Result png = WriteBundle(directory + "/rs-tile-bench-png.rstb", width, height, draws, ImageFormat::FastPNG, false);
+	const Result qoi = WriteBundle(directory + "/rs-tile-bench-qoi.rstb", width, height, draws, ImageFormat::QOI, false);
+	const Result tiles = WriteBundle(directory + "/rs-tile-bench-tiles.rstb", width, height, draws, ImageFormat::QOI, true);
+
+	std::printf("%u snapshots of a %ux%u target, one per draw:\n", draws, width, height);
+	std::printf("  %-18s %9.1f ms %12zu bytes\n", "fast PNG images", png.Milliseconds, png.Bytes);
+	std::printf("  %-18s %9.1f ms %12zu bytes\n", "QOI images", qoi.Milliseconds, qoi.Bytes);
+	std::printf("  %-18s %9.1f ms %12zu bytes (%.1fx smaller and %.1fx faster than QOI images)\n", "QOI tiles", tiles.Milliseconds, tiles.Bytes, static_cast<double>(qoi.Bytes) / tiles.Bytes, qoi.Milliseconds / tiles.Milliseconds);
+
+	const bool verified = VerifyTiledBundle(directory + "/rs-tile-bench-tiles.rstb", width, height, draws);
+
+	std::remove((directory + "/rs-tile-bench-png.rstb").c_str());
+	std::remove((directory + "/rs-tile-bench-qoi.rstb").c_str());
+	std::remove((directory + "/rs-tile-bench-tiles.rstb").c_str());
+
+	if (!verified)
+	{
+		return 1;
+	}
+
+	std::printf("all tiled snapshots decoded to their source\n");
+	return 0;
+}
\ No newline at end of file
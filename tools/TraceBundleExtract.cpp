@@ -0,0 +1,240 @@
+/*
+ * Extracts a frame trace bundle (".rstb") back into the folder layout of the regular dumps, or lists its content.
+ * Linux only, build from the repository root with:
+ *   g++ -std=c++11 -O2 -Isrc tools/TraceBundleExtract.cpp src/TraceBundle.cpp src/ImageEncoder.cpp -pthread -o rstb-extract
+ */
+
+#include "TraceBundle.hpp"
+#include "ImageEncoder.hpp"
+
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace ReShade;
+
+namespace
+{
+	bool IsSafeName(const std::string &name)
+	{
+		if (name.empty() || name[0] == '/')
+		{
+			return false;
+		}
+
+		for (std::size_t begin = 0, end; begin <= name.size(); begin = end + 1)
+		{
+			end = name.find('/', begin);
+
+			if (end == std::string::npos)
+			{
+				end = name.size();
+			}
+
+			if (name.compare(begin, end - begin, "..") == 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+	bool CreateParentDirectories(const std::string &path)
+	{
+		for (std::size_t i = path.find('/', 1); i != std::string::npos; i = path.find('/', i + 1))
+		{
+			if (mkdir(path.substr(0, i).c_str(), 0755) != 0 && errno != EEXIST)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+	bool WriteFile(const std::string &path, const unsigned char *data, std::size_t size)
+	{
+		if (!CreateParentDirectories(path))
+		{
+			return false;
+		}
+
+		FILE *const file = std::fopen(path.c_str(), "wb");
+
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		const bool success = std::fwrite(data, 1, size, file) == size;
+
+		return std::fclose(file) == 0 && success;
+	}
+	std::string GetEntryName(const TraceBundleReader::Entry &entry)
+	{
+		if (entry.Record->Type == TraceBundle::RecordType::Image)
+		{
+			return entry.Name + GetImageExtension(static_cast<ImageFormat>(entry.Record->Format));
+		}
+		if (entry.Record->Type == TraceBundle::RecordType::TiledImage || entry.Record->Type == TraceBundle::RecordType::KeyFrame || entry.Record->Type == TraceBundle::RecordType::DeltaFrame)
+		{
+			return entry.Name + ".png";
+		}
+
+		return entry.Name;
+	}
+	bool IsFrame(const TraceBundleReader::Entry &entry)
+	{
+		return entry.Record->Type == TraceBundle::RecordType::KeyFrame || entry.Record->Type == TraceBundle::RecordType::DeltaFrame;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const bool list = argc >= 2 && std::strcmp(argv[1], "--list") == 0;
+
+	if (argc < 2 + list || argc > 3 + list)
+	{
+		std::fprintf(stderr, "usage: %s [--list] <bundle.rstb> [output directory]\n", argv[0]);
+		return 2;
+	}
+
+	const std::string path = argv[1 + list];
+	std::string output = argc == 3 + list ? argv[2 + list] : path.substr(0, path.rfind(".rstb"));
+
+	const int fd = open(path.c_str(), O_RDONLY);
+	struct stat info;
+
+	if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		std::fprintf(stderr, "error: cannot open '%s'\n", path.c_str());
+		return 1;
+	}
+
+	void *const mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (mapping == MAP_FAILED)
+	{
+		std::fprintf(stderr, "error: cannot map '%s'\n", path.c_str());
+		return 1;
+	}
+
+	const TraceBundleReader reader(static_cast<const unsigned char *>(mapping), info.st_size);
+
+	if (!reader.IsValid())
+	{
+		std::fprintf(stderr, "error: '%s' is not a frame trace bundle\n", path.c_str());
+		return 1;
+	}
+	if (!reader.IsComplete())
+	{
+		std::fprintf(stderr, "warning: bundle has no index (capture did not finish), recovered %zu records\n", reader.GetEntries().size());
+	}
+
+	if (!output.empty() && output.back() != '/')
+	{
+		output += '/';
+	}
+
+	// Frames of a stream have to be decoded in order, all other records are independent
+	std::vector<const TraceBundleReader::Entry *> entries;
+
+	for (const TraceBundleReader::Entry &entry : reader.GetEntries())
+	{
+		entries.push_back(&entry);
+	}
+
+	std::stable_sort(entries.begin(), entries.end(), [](const TraceBundleReader::Entry *left, const TraceBundleReader::Entry *right)
+	{
+		const bool leftFrame = IsFrame(*left), rightFrame = IsFrame(*right);
+
+		if (leftFrame != rightFrame || !leftFrame)
+		{
+			return rightFrame && !leftFrame;
+		}
+
+		return std::make_pair(left->Record->Draw, left->Record->Bucket) < std::make_pair(right->Record->Draw, right->Record->Bucket);
+	});
+
+	int result = 0;
+	std::vector<unsigned char> decoded, encoded;
+	std::map<std::uint32_t, std::vector<unsigned char>> frames;
+
+	for (const TraceBundleReader::Entry *const pointer : entries)
+	{
+		const TraceBundleReader::Entry &entry = *pointer;
+		const std::string name = GetEntryName(entry);
+
+		if (entry.Record->Type == TraceBundle::RecordType::Tile)
+		{
+			continue;
+		}
+
+		if (list)
+		{
+			std::printf("%-6s bucket %3u draw %4u target %016llx %5ux%-5u %10llu bytes  %s\n", entry.Record->Type == TraceBundle::RecordType::Events ? "events" : entry.Record->Type == TraceBundle::RecordType::KeyFrame ? "key" : entry.Record->Type == TraceBundle::RecordType::DeltaFrame ? "delta" : "image", entry.Record->Bucket, entry.Record->Draw, static_cast<unsigned long long>(entry.Record->Target), entry.Record->Width, entry.Record->Height, static_cast<unsigned long long>(entry.Record->DataSize), name.c_str());
+			continue;
+		}
+
+		if (!IsSafeName(name))
+		{
+			std::fprintf(stderr, "warning: skipping record with invalid name '%s'\n", name.c_str());
+			result = 1;
+			continue;
+		}
+
+		const unsigned char *data = entry.Data;
+		std::size_t size = entry.Record->DataSize;
+
+		// Tiled images are reassembled and written as regular PNG files
+		if (entry.Record->Type == TraceBundle::RecordType::TiledImage)
+		{
+			if (!reader.DecodeTiledImage(entry, decoded))
+			{
+				std::fprintf(stderr, "error: missing or corrupt tiles in '%s'\n", name.c_str());
+				result = 1;
+				continue;
+			}
+
+			EncodeFastPNG(decoded.data(), entry.Record->Width, entry.Record->Height, encoded);
+
+			data = encoded.data();
+			size = encoded.size();
+		}
+		// Stream frames are applied on top of the previous frame of their render target slot
+		else if (IsFrame(entry))
+		{
+			std::vector<unsigned char> &frame = frames[entry.Record->Draw];
+
+			if (!reader.ApplyFrame(entry, frame))
+			{
+				std::fprintf(stderr, "error: cannot decode frame '%s', skipping to the next key frame\n", name.c_str());
+				frame.clear();
+				result = 1;
+				continue;
+			}
+
+			EncodeFastPNG(frame.data(), entry.Record->Width, entry.Record->Height, encoded);
+
+			data = encoded.data();
+			size = encoded.size();
+		}
+
+		if (!WriteFile(output + name, data, size))
+		{
+			std::fprintf(stderr, "error: cannot write '%s%s'\n", output.c_str(), name.c_str());
+			result = 1;
+		}
+	}
+
+	munmap(mapping, info.st_size);
+
+	return result;
+}
\ No newline at end of file